@@ -0,0 +1,483 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.h"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <ctime>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <Eigen/Core>
+
+#include "qserl/util/allocation_tracker.h"
+#include "qserl/util/timer.h"
+#include "perf_counters.h"
+
+#ifndef QSERL_BENCH_GIT_REVISION
+# define QSERL_BENCH_GIT_REVISION "unknown"
+#endif
+#ifndef QSERL_BENCH_BUILD_CONFIG
+# define QSERL_BENCH_BUILD_CONFIG "unknown"
+#endif
+
+namespace qserl {
+namespace bench {
+
+namespace {
+
+std::string
+jsonString(const std::string& i_str)
+{
+  std::string res = "\"";
+  for(const char c : i_str)
+  {
+    if(c == '"' || c == '\\')
+    {
+      res += '\\';
+    }
+    res += c;
+  }
+  return res + "\"";
+}
+
+/**
+* \brief Runs given operation once for warm up.
+* \return The number of iterations of each repetition so that it lasts at least the minimum time.
+*/
+uint64_t
+warmUp(const std::function<void()>& i_operation,
+       double i_minTime)
+{
+  const util::TimePoint start = util::getTimePoint();
+  i_operation();
+  const double warmupNs = static_cast<double>(util::getElapsedTimeNsec(start).count());
+  return std::max<uint64_t>(1, static_cast<uint64_t>(i_minTime * 1.e9 / std::max(warmupNs, 1.)));
+}
+
+/**
+* \brief Runs a repetition of given number of iterations of given operation.
+* \return The time per operation, in nanoseconds.
+*/
+double
+measure(const std::function<void()>& i_operation,
+        uint64_t i_iterations)
+{
+  const util::TimePoint start = util::getTimePoint();
+  for(uint64_t iter = 0; iter < i_iterations; ++iter)
+  {
+    i_operation();
+  }
+  return static_cast<double>(util::getElapsedTimeNsec(start).count()) / static_cast<double>(i_iterations);
+}
+
+/**
+* \brief Fixed dense linear algebra workload, measuring the machine speed.
+*/
+void
+calibrationWorkload()
+{
+  static const int kNumProducts = 2000;
+  Eigen::Matrix<double, 6, 6> a = Eigen::Matrix<double, 6, 6>::Identity();
+  a(0, 5) = 0.1;
+  a(3, 1) = -0.2;
+  Eigen::Matrix<double, 6, 6> b = a;
+  for(int k = 0; k < kNumProducts; ++k)
+  {
+    b = 0.5 * (a * b) + a;
+  }
+  volatile double sink = b.sum();
+  (void)sink;
+}
+
+} // namespace
+
+uint64_t
+allocationCount()
+{
+  return util::AllocationTracker::threadCounts().count;
+}
+
+uint64_t
+allocatedBytes()
+{
+  return util::AllocationTracker::threadCounts().bytes;
+}
+
+Options::Options() :
+    filter(),
+    outputFile("qserl-bench.json"),
+    minTime(0.1),
+    numRepetitions(3),
+    quick(false),
+    baselineFile(),
+    writeBaselineFile(),
+    tolerance(0.3),
+    perfCounters(false)
+{
+}
+
+Runner::Runner(const Options& i_options) :
+    m_options(i_options),
+    m_results(),
+    m_calibrationIterations(0),
+    m_baseline(),
+    m_baselineBuildConfig(),
+    m_perfCounters()
+{
+  if(m_options.perfCounters)
+  {
+    m_perfCounters.reset(new PerfCounters);
+    if(!m_perfCounters->open())
+    {
+      std::cerr << "Hardware counters unavailable (" << m_perfCounters->error() << "), only timings are reported"
+                << std::endl;
+      m_perfCounters.reset();
+    }
+    else if(!m_perfCounters->error().empty())
+    {
+      std::cerr << "Some hardware counters unavailable (" << m_perfCounters->error() << ")" << std::endl;
+    }
+  }
+}
+
+Runner::~Runner()
+{
+}
+
+std::string
+Runner::key(const std::string& i_name,
+            const Params& i_params)
+{
+  std::string res = i_name + "[";
+  for(size_t idxParam = 0; idxParam < i_params.size(); ++idxParam)
+  {
+    res += (idxParam > 0 ? "," : "") + i_params[idxParam].first + "=" + i_params[idxParam].second;
+  }
+  return res + "]";
+}
+
+std::string
+Runner::buildConfig()
+{
+  return QSERL_BENCH_BUILD_CONFIG;
+}
+
+const Options&
+Runner::options() const
+{
+  return m_options;
+}
+
+bool
+Runner::isSelected(const std::string& i_name) const
+{
+  size_t start = 0;
+  while(true)
+  {
+    const size_t end = m_options.filter.find(',', start);
+    if(i_name.find(m_options.filter.substr(start, end - start)) != std::string::npos)
+    {
+      return true;
+    }
+    if(end == std::string::npos)
+    {
+      return false;
+    }
+    start = end + 1;
+  }
+}
+
+Result*
+Runner::run(const std::string& i_name,
+            const Params& i_params,
+            size_t i_numNodes,
+            const std::function<void()>& i_operation)
+{
+  if(!isSelected(i_name))
+  {
+    return nullptr;
+  }
+  // when checking a baseline, only its benchmarks are run
+  if(!m_options.baselineFile.empty() && !m_baseline.count(key(i_name, i_params)))
+  {
+    return nullptr;
+  }
+
+  const uint64_t iterations = warmUp(i_operation, m_options.minTime);
+  const uint64_t allocationCountStart = allocationCount();
+  const uint64_t allocatedBytesStart = allocatedBytes();
+  std::vector<double> nsPerOp, calibrationNs;
+  if(m_perfCounters)
+  {
+    m_perfCounters->reset();
+  }
+  for(int rep = 0; rep < m_options.numRepetitions; ++rep)
+  {
+    // the calibration workload is interleaved with repetitions, so that both are measured at the same machine speed
+    if(m_calibrationIterations > 0)
+    {
+      calibrationNs.push_back(measure(calibrationWorkload, m_calibrationIterations));
+    }
+    if(m_perfCounters)
+    {
+      m_perfCounters->start();
+    }
+    nsPerOp.push_back(measure(i_operation, iterations));
+    if(m_perfCounters)
+    {
+      m_perfCounters->stop();
+    }
+  }
+  const double numOps = static_cast<double>(iterations * m_options.numRepetitions);
+  std::sort(nsPerOp.begin(), nsPerOp.end());
+
+  Result result;
+  result.name = i_name;
+  result.params = i_params;
+  result.iterations = iterations;
+  result.nsPerOp = nsPerOp[nsPerOp.size() / 2];
+  result.minNsPerOp = nsPerOp.front();
+  result.calibrationNs = calibrationNs.empty() ? 0. : *std::min_element(calibrationNs.begin(), calibrationNs.end());
+  result.nsPerNode = i_numNodes > 0 ? result.nsPerOp / static_cast<double>(i_numNodes) : 0.;
+  result.allocsPerOp = static_cast<double>(allocationCount() - allocationCountStart) / numOps;
+  result.bytesPerOp = static_cast<double>(allocatedBytes() - allocatedBytesStart) / numOps;
+  if(m_perfCounters)
+  {
+    // per node values, i.e. per integration step, tell the cost of the RHS kernels from the storage of nodes
+    const double numUnits = numOps * static_cast<double>(std::max<size_t>(i_numNodes, 1));
+    const std::string suffix = i_numNodes > 0 ? "_per_node" : "_per_op";
+    std::array<double, PerfCounters::PC_NUMBER_OF_COUNTERS> values;
+    std::array<bool, PerfCounters::PC_NUMBER_OF_COUNTERS> isRead;
+    for(int counter = 0; counter < PerfCounters::PC_NUMBER_OF_COUNTERS; ++counter)
+    {
+      const PerfCounters::CounterT counterType = static_cast<PerfCounters::CounterT>(counter);
+      isRead[counter] = m_perfCounters->value(counterType, values[counter]);
+      if(isRead[counter])
+      {
+        result.counters.push_back(std::make_pair(PerfCounters::counterName(counterType) + suffix,
+                                                 values[counter] / numUnits));
+      }
+    }
+    if(isRead[PerfCounters::PC_CYCLES] && isRead[PerfCounters::PC_INSTRUCTIONS] &&
+       values[PerfCounters::PC_CYCLES] > 0.)
+    {
+      result.counters.push_back(std::make_pair("ipc", values[PerfCounters::PC_INSTRUCTIONS] /
+                                                      values[PerfCounters::PC_CYCLES]));
+    }
+  }
+  m_results.push_back(result);
+
+  std::cerr << std::left << std::setw(28) << i_name;
+  for(const auto& param : i_params)
+  {
+    std::cerr << " " << param.first << "=" << param.second;
+  }
+  std::cerr << std::right << std::fixed << std::setprecision(1)
+            << "\t" << result.nsPerOp << " ns/op";
+  if(i_numNodes > 0)
+  {
+    std::cerr << "\t" << std::setprecision(2) << result.nsPerNode << " ns/node";
+  }
+  std::cerr << "\t" << std::setprecision(1) << result.allocsPerOp << " allocs/op";
+  for(const auto& counter : result.counters)
+  {
+    std::cerr << "\t" << std::setprecision(2) << counter.second << " " << counter.first;
+  }
+  std::cerr << std::endl;
+  std::cerr.unsetf(std::ios_base::floatfield);
+
+  return &m_results.back();
+}
+
+const std::deque<Result>&
+Runner::results() const
+{
+  return m_results;
+}
+
+void
+Runner::calibrate()
+{
+  // repetitions of the calibration workload are shorter than those of benchmarks, to limit the overhead
+  m_calibrationIterations = warmUp(calibrationWorkload, 0.25 * m_options.minTime);
+}
+
+bool
+Runner::loadBaseline(const std::string& i_file)
+{
+  std::ifstream input(i_file.c_str());
+  if(!input)
+  {
+    return false;
+  }
+  m_baseline.clear();
+  m_baselineBuildConfig.clear();
+  static const std::string kBuildPrefix = "build: ";
+  std::string line;
+  while(std::getline(input, line))
+  {
+    if(line.empty() || line[0] == '#')
+    {
+      continue;
+    }
+    if(line.compare(0, kBuildPrefix.size(), kBuildPrefix) == 0)
+    {
+      m_baselineBuildConfig = line.substr(kBuildPrefix.size());
+      continue;
+    }
+    std::istringstream lineStream(line);
+    std::string benchmarkKey;
+    double normalizedTime;
+    if(lineStream >> benchmarkKey >> normalizedTime)
+    {
+      m_baseline[benchmarkKey] = normalizedTime;
+    }
+  }
+  return true;
+}
+
+const std::string&
+Runner::baselineBuildConfig() const
+{
+  return m_baselineBuildConfig;
+}
+
+bool
+Runner::checkBaseline(std::ostream& io_os) const
+{
+  assert(m_calibrationIterations > 0 && "calibrate() must be called before running benchmarks");
+  std::map<std::string, double> measured;
+  for(const Result& result : m_results)
+  {
+    measured[key(result.name, result.params)] = result.minNsPerOp / result.calibrationNs;
+  }
+
+  int numPassed = 0, numFailed = 0;
+  io_os << "Performance check against " << m_options.baselineFile << ", tolerance " << 100. * m_options.tolerance
+        << "%" << std::endl;
+  io_os << std::fixed << std::setprecision(3);
+  for(const auto& entry : m_baseline)
+  {
+    if(!isSelected(entry.first.substr(0, entry.first.find('['))))
+    {
+      continue;
+    }
+    const auto it = measured.find(entry.first);
+    if(it == measured.end())
+    {
+      // the workload was renamed or removed, the baseline must be updated
+      io_os << "MISSING        " << entry.first << std::endl;
+      ++numFailed;
+      continue;
+    }
+    const double ratio = it->second / entry.second;
+    const bool isPassed = ratio <= 1. + m_options.tolerance;
+    io_os << (isPassed ? "PASS  " : "FAIL  ") << std::setw(8) << ratio << " " << entry.first
+          << " (baseline " << entry.second << ", measured " << it->second << ")" << std::endl;
+    if(isPassed)
+    {
+      ++numPassed;
+    }
+    else
+    {
+      ++numFailed;
+    }
+  }
+  io_os.unsetf(std::ios_base::floatfield);
+  io_os << numPassed << " passed, " << numFailed << " failed" << std::endl;
+  return numFailed == 0;
+}
+
+void
+Runner::writeBaseline(std::ostream& io_os) const
+{
+  assert(m_calibrationIterations > 0 && "calibrate() must be called before running benchmarks");
+  io_os << "# qserl-bench performance baseline, revision " << QSERL_BENCH_GIT_REVISION << "\n"
+        << "# Time per operation divided by the time of the calibration workload.\n"
+        << "# Only the benchmarks listed here are run by --check, by a build of the same configuration.\n"
+        << "build: " << buildConfig() << "\n";
+  io_os << std::setprecision(6);
+  for(const Result& result : m_results)
+  {
+    io_os << key(result.name, result.params) << " " << result.minNsPerOp / result.calibrationNs << "\n";
+  }
+}
+
+void
+Runner::writeJson(std::ostream& io_os) const
+{
+  char date[32];
+  const std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+  io_os << std::setprecision(12);
+  io_os << "{\n";
+  io_os << "  \"context\": {\n";
+  io_os << "    \"date\": " << jsonString(date) << ",\n";
+  io_os << "    \"git_revision\": " << jsonString(QSERL_BENCH_GIT_REVISION) << ",\n";
+#ifdef __VERSION__
+  io_os << "    \"compiler\": " << jsonString(__VERSION__) << ",\n";
+#endif
+#ifdef NDEBUG
+  io_os << "    \"build_type\": \"release\",\n";
+#else
+  io_os << "    \"build_type\": \"debug\",\n";
+#endif
+  io_os << "    \"build_config\": " << jsonString(buildConfig()) << ",\n";
+  io_os << "    \"seed\": " << kSeed << ",\n";
+  io_os << "    \"min_time\": " << m_options.minTime << ",\n";
+  io_os << "    \"repetitions\": " << m_options.numRepetitions << ",\n";
+  io_os << "    \"quick\": " << (m_options.quick ? "true" : "false") << "\n";
+  io_os << "  },\n";
+  io_os << "  \"benchmarks\": [";
+  for(size_t idx = 0; idx < m_results.size(); ++idx)
+  {
+    const Result& result = m_results[idx];
+    io_os << (idx > 0 ? ",\n" : "\n");
+    io_os << "    {\"name\": " << jsonString(result.name) << ", \"params\": {";
+    for(size_t idxParam = 0; idxParam < result.params.size(); ++idxParam)
+    {
+      io_os << (idxParam > 0 ? ", " : "") << jsonString(result.params[idxParam].first) << ": "
+            << jsonString(result.params[idxParam].second);
+    }
+    io_os << "}, \"iterations\": " << result.iterations
+          << ", \"ns_per_op\": " << result.nsPerOp
+          << ", \"min_ns_per_op\": " << result.minNsPerOp
+          << ", \"calibration_ns\": " << result.calibrationNs
+          << ", \"ns_per_node\": " << result.nsPerNode
+          << ", \"allocs_per_op\": " << result.allocsPerOp
+          << ", \"bytes_per_op\": " << result.bytesPerOp
+          << ", \"counters\": {";
+    for(size_t idxCounter = 0; idxCounter < result.counters.size(); ++idxCounter)
+    {
+      io_os << (idxCounter > 0 ? ", " : "") << jsonString(result.counters[idxCounter].first) << ": "
+            << result.counters[idxCounter].second;
+    }
+    io_os << "}}";
+  }
+  io_os << "\n  ]\n}\n";
+}
+
+} // namespace bench
+} // namespace qserl
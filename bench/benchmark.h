@@ -0,0 +1,213 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/** Minimal benchmark harness of the qserl-bench target. */
+
+#ifndef QSERL_BENCH_BENCHMARK_H_
+#define QSERL_BENCH_BENCHMARK_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace qserl {
+namespace bench {
+
+class PerfCounters;
+
+/** \brief Seed of all random workloads, so that results are reproducible across runs and commits. */
+static const uint32_t kSeed = 42;
+
+/**
+* \brief Returns the number of heap allocations done by the calling thread.
+*/
+uint64_t
+allocationCount();
+
+/**
+* \brief Returns the number of bytes requested to the heap by the calling thread.
+*/
+uint64_t
+allocatedBytes();
+
+/**
+* \brief Runner options, set from the command line.
+*/
+struct Options
+{
+  Options();
+
+  std::string filter;       /**< Only benchmarks whose name contains one of these comma separated strings are run. */
+  std::string outputFile;   /**< JSON output file. */
+  double minTime;           /**< Minimum measured time of each repetition, in seconds. */
+  int numRepetitions;       /**< Number of measured repetitions, the median is reported. */
+  bool quick;               /**< True to reduce workload sizes, e.g. for smoke testing. */
+  std::string baselineFile; /**< Baseline to check results against, only its benchmarks are run. */
+  std::string writeBaselineFile;  /**< Baseline file to write from results. */
+  double tolerance;         /**< Relative slowdown w.r.t. the baseline above which a check fails. */
+  bool perfCounters;        /**< True to report hardware counters of benchmarks, if available. */
+};
+
+/**
+* \brief Measures of a single benchmark.
+*/
+struct Result
+{
+  std::string name;
+  std::vector<std::pair<std::string, std::string> > params;
+  std::vector<std::pair<std::string, double> > counters;  /**< Workload specific values, e.g. convergence rate. */
+  uint64_t iterations;          /**< Number of operations per repetition. */
+  double nsPerOp;               /**< Median over repetitions of the time per operation. */
+  double minNsPerOp;            /**< Best repetition, less sensitive to interferences, used for baselines. */
+  double calibrationNs;         /**< Best time of the calibration workload interleaved with repetitions, 0 if none. */
+  double nsPerNode;             /**< Time per operation divided by the number of rod nodes, 0 if not relevant. */
+  double allocsPerOp;
+  double bytesPerOp;
+};
+
+/**
+* \brief Runs benchmarks and collects their results.
+*/
+class Runner
+{
+public:
+  typedef std::vector<std::pair<std::string, std::string> > Params;
+
+  explicit Runner(const Options& i_options);
+
+  ~Runner();
+
+  /**
+  * \brief Returns the key identifying a benchmark in baselines, e.g. "util/exp6[batch=1024]".
+  */
+  static std::string
+  key(const std::string& i_name,
+      const Params& i_params);
+
+  /**
+  * \brief Returns the build type and compiler flags of the benchmarks, e.g. "Release -O3 -DNDEBUG".
+  */
+  static std::string
+  buildConfig();
+
+  const Options&
+  options() const;
+
+  /**
+  * \brief Returns true if the benchmark of given name is selected by the filter.
+  */
+  bool
+  isSelected(const std::string& i_name) const;
+
+  /**
+  * \brief Measures given operation, if selected by the filter.
+  * The operation is run once for warm up, then in batches until the minimum time is reached.
+  * \param i_numNodes Number of rod nodes (or batch items) processed by one operation, to report the time per node.
+  * 0 if not relevant.
+  * \return A pointer to the stored result, to add counters, or a null pointer if not selected.
+  */
+  Result*
+  run(const std::string& i_name,
+      const Params& i_params,
+      size_t i_numNodes,
+      const std::function<void()>& i_operation);
+
+  const std::deque<Result>&
+  results() const;
+
+  /**
+  * \brief Enables the calibration workload, whose time normalizes results in baselines.
+  * It is run interleaved with repetitions of each benchmark, so that normalization also compensates for
+  * machine speed variations during the run (frequency scaling, concurrent load).
+  * The calibration workload is fixed dense linear algebra, independent of the library code, so that
+  * normalized times are comparable across machines of similar architecture.
+  */
+  void
+  calibrate();
+
+  /**
+  * \brief Loads the baseline to check results against.
+  * \return false if the file could not be read.
+  */
+  bool
+  loadBaseline(const std::string& i_file);
+
+  /**
+  * \brief Returns the build configuration the loaded baseline was recorded with, empty if not recorded.
+  * Timings of different build configurations are not comparable, so a baseline should only be checked
+  * by a build of the same configuration (see buildConfig()).
+  */
+  const std::string&
+  baselineBuildConfig() const;
+
+  /**
+  * \brief Compares normalized results to the loaded baseline, and reports each of them.
+  * \return true if no benchmark is slower than its baseline by more than the tolerance, and all selected
+  * baseline benchmarks were run.
+  */
+  bool
+  checkBaseline(std::ostream& io_os) const;
+
+  /**
+  * \brief Writes normalized results as a baseline.
+  */
+  void
+  writeBaseline(std::ostream& io_os) const;
+
+  /**
+  * \brief Writes results as JSON, along with the context of the run.
+  */
+  void
+  writeJson(std::ostream& io_os) const;
+
+private:
+  Options m_options;
+  std::deque<Result> m_results;   /**< Deque, so that returned result pointers remain valid. */
+  uint64_t m_calibrationIterations;   /**< Iterations of calibration repetitions, 0 if not calibrated. */
+  std::map<std::string, double> m_baseline;   /**< Normalized time per operation, by benchmark key. */
+  std::string m_baselineBuildConfig;          /**< Build configuration of the baseline. */
+  std::unique_ptr<PerfCounters> m_perfCounters;   /**< Null if not requested or unavailable. */
+};
+
+/** \brief 3D rod integration, per rod model, number of nodes and integration options. */
+void
+benchRod3dIntegration(Runner& io_runner);
+
+/** \brief 2D rod numeric integration vs analytic geometry. */
+void
+benchRod2dIntegration(Runner& io_runner);
+
+/** \brief Convergence time of 2D inverse geometry and 3D inverse kinematics. */
+void
+benchInverseKinematics(Runner& io_runner);
+
+/** \brief SE(3) exponential and logarithm maps. */
+void
+benchExpLog(Runner& io_runner);
+
+} // namespace bench
+} // namespace qserl
+
+#endif // QSERL_BENCH_BENCHMARK_H_
@@ -0,0 +1,72 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.h"
+
+#include <random>
+
+#include "qserl/util/explog.h"
+
+namespace qserl {
+namespace bench {
+
+void
+benchExpLog(Runner& io_runner)
+{
+  typedef Eigen::Matrix<double, 6, 1> Vector6d;
+  typedef Eigen::Matrix<double, 4, 4> Matrix4d;
+  static const size_t kBatchSize = 1024;
+
+  std::mt19937 generator(kSeed);
+  std::uniform_real_distribution<double> distribution(-1., 1.);
+  std::vector<Vector6d, Eigen::aligned_allocator<Vector6d> > twists(kBatchSize);
+  std::vector<Matrix4d, Eigen::aligned_allocator<Matrix4d> > displacements(kBatchSize);
+  for(size_t idx = 0; idx < kBatchSize; ++idx)
+  {
+    for(int k = 0; k < 6; ++k)
+    {
+      twists[idx][k] = distribution(generator);
+    }
+    displacements[idx] = exp6(twists[idx]);
+  }
+
+  // results are accumulated so that evaluations are not optimized out
+  double sink = 0.;
+  io_runner.run("util/exp6", {{"batch", std::to_string(kBatchSize)}}, kBatchSize,
+                [&twists, &sink]()
+                {
+                  for(const Vector6d& twist : twists)
+                  {
+                    sink += exp6(twist)(0, 3);
+                  }
+                });
+  io_runner.run("util/log6", {{"batch", std::to_string(kBatchSize)}}, kBatchSize,
+                [&displacements, &sink]()
+                {
+                  for(const Matrix4d& displacement : displacements)
+                  {
+                    sink += log6(displacement)[0];
+                  }
+                });
+  volatile double unused = sink;
+  (void)unused;
+}
+
+} // namespace bench
+} // namespace qserl
@@ -0,0 +1,166 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.h"
+
+#include <iostream>
+#include <random>
+#include <sstream>
+
+#include "qserl/rod2d/analytic_q.h"
+#include "qserl/rod2d/inverse_geometry.h"
+#include "qserl/rod3d/ik.h"
+
+namespace qserl {
+namespace bench {
+
+namespace {
+
+static const int kNumTargets = 16;
+
+/**
+* \brief Redirects std::cout to a null stream while in scope, as solvers print their progress.
+*/
+class SilentCout
+{
+public:
+  SilentCout() :
+      m_null(),
+      m_buffer(std::cout.rdbuf(m_null.rdbuf()))
+  {
+  }
+
+  ~SilentCout()
+  {
+    std::cout.rdbuf(m_buffer);
+  }
+
+private:
+  std::ostringstream m_null;
+  std::streambuf* m_buffer;
+};
+
+} // namespace
+
+void
+benchInverseKinematics(Runner& io_runner)
+{
+  std::mt19937 generator(kSeed);
+  std::uniform_real_distribution<double> perturbation(-1., 1.);
+
+  // 2D inverse geometry, from a stable configuration towards geometries of perturbed configurations
+  if(io_runner.isSelected("rod2d/inverse_geometry"))
+  {
+    const Eigen::Vector3d a0(2.3777, -49.6303, -9.8917);
+    std::vector<Eigen::Vector3d> targets;
+    for(int k = 0; k < kNumTargets; ++k)
+    {
+      const Eigen::Vector3d a = a0 + Eigen::Vector3d(0.5 * perturbation(generator), 2. * perturbation(generator),
+                                                     2. * perturbation(generator));
+      rod2d::MotionConstantsQ motionConstants;
+      Eigen::Vector3d qdot, q;
+      if(rod2d::computeMotionConstantsQ(a, motionConstants) &&
+         rod2d::computeQAtPositionT(1., a, motionConstants, qdot, q))
+      {
+        targets.push_back(q);
+      }
+    }
+    int numSolved = 0;
+    Result* result;
+    {
+      SilentCout silentCout;
+      result = io_runner.run("rod2d/inverse_geometry", {{"numTargets", std::to_string(targets.size())}}, 0,
+                             [&targets, &a0, &numSolved]()
+                             {
+                               numSolved = 0;
+                               for(const Eigen::Vector3d& target : targets)
+                               {
+                                 Eigen::Vector3d a;
+                                 numSolved += rod2d::inverseGeometry_Newton(target, 100, 1.e-6, a0, 1., a) ? 1 : 0;
+                               }
+                             });
+    }
+    if(result)
+    {
+      result->counters.push_back(std::make_pair("convergenceRate", static_cast<double>(numSolved) / targets.size()));
+    }
+  }
+
+  // 3D inverse kinematics of the rod tip, from a stable configuration towards tips of perturbed configurations
+  if(io_runner.isSelected("rod3d/ik"))
+  {
+    rod3d::Parameters rodParameters;
+    rodParameters.rodModel = rod3d::Parameters::RM_INEXTENSIBLE;
+    rodParameters.numNodes = 100;
+    const rod3d::RodShPtr rod = rod3d::Rod::create(rodParameters);
+    rod3d::Wrench w0;
+    w0 << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+    rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+    integrationOptions.keepJMatrices = true;
+    rod3d::WorkspaceIntegratedStateShPtr startState = rod3d::WorkspaceIntegratedState::create(
+        w0, rodParameters.numNodes, rod3d::Displacement::Identity(), rodParameters);
+    startState->integrationOptions(integrationOptions);
+    startState->integrate();
+
+    std::vector<rod3d::Displacement, Eigen::aligned_allocator<rod3d::Displacement> > targets;
+    for(int k = 0; k < kNumTargets; ++k)
+    {
+      rod3d::Wrench w;
+      for(int i = 0; i < 6; ++i)
+      {
+        w[i] = w0[i] * (1. + 0.05 * perturbation(generator));
+      }
+      rod3d::WorkspaceIntegratedStateShPtr targetState = rod3d::WorkspaceIntegratedState::create(
+          w, rodParameters.numNodes, rod3d::Displacement::Identity(), rodParameters);
+      if(targetState->integrate() == rod3d::WorkspaceIntegratedState::IR_VALID)
+      {
+        targets.push_back(targetState->nodes().back());
+      }
+    }
+
+    rod3d::InverseKinematics ik(rod);
+    ik.setMaxIter(50);
+    int numSolved = 0;
+    Result* result;
+    {
+      SilentCout silentCout;
+      result = io_runner.run("rod3d/ik", {{"numTargets", std::to_string(targets.size())},
+                                          {"numNodes", std::to_string(rodParameters.numNodes)}}, 0,
+                             [&]()
+                             {
+                               numSolved = 0;
+                               for(const rod3d::Displacement& target : targets)
+                               {
+                                 const rod3d::WorkspaceIntegratedStateShPtr state =
+                                     rod3d::WorkspaceIntegratedState::createCopy(startState);
+                                 numSolved += ik.compute(state, rodParameters.numNodes - 1, target) ==
+                                              rod3d::InverseKinematics::IK_VALID ? 1 : 0;
+                               }
+                             });
+    }
+    if(result)
+    {
+      result->counters.push_back(std::make_pair("convergenceRate", static_cast<double>(numSolved) / targets.size()));
+    }
+  }
+}
+
+} // namespace bench
+} // namespace qserl
@@ -0,0 +1,150 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "benchmark.h"
+
+namespace {
+
+const int kSkipReturnCode = 77;   /**< Reported as skipped by ctest, see bench/CMakeLists.txt. */
+
+void
+printUsage(const char* i_program)
+{
+  std::cerr << "Usage: " << i_program << " [options]\n"
+            << "  --filter STR        only run benchmarks whose name contains STR, or one of comma separated STR\n"
+            << "  --output FILE       JSON output file (default: qserl-bench.json)\n"
+            << "  --min-time SEC      minimum measured time of each repetition (default: 0.1)\n"
+            << "  --repetitions N     number of measured repetitions (default: 3)\n"
+            << "  --quick             reduced workload sizes\n"
+            << "  --check FILE        only run benchmarks of baseline FILE, and fail if slower than the baseline\n"
+            << "                      (exits with code 77 if FILE was recorded with another build configuration)\n"
+            << "  --tolerance X       relative slowdown w.r.t. the baseline for --check (default: 0.3)\n"
+            << "  --write-baseline FILE  write results as baseline FILE\n"
+            << "  --perf-counters     report hardware counters (Linux perf_event), if available\n";
+}
+
+} // namespace
+
+int
+main(int argc,
+     char** argv)
+{
+  qserl::bench::Options options;
+  for(int idxArg = 1; idxArg < argc; ++idxArg)
+  {
+    const bool hasValue = idxArg + 1 < argc;
+    if(!std::strcmp(argv[idxArg], "--filter") && hasValue)
+    {
+      options.filter = argv[++idxArg];
+    }
+    else if(!std::strcmp(argv[idxArg], "--output") && hasValue)
+    {
+      options.outputFile = argv[++idxArg];
+    }
+    else if(!std::strcmp(argv[idxArg], "--min-time") && hasValue)
+    {
+      options.minTime = std::atof(argv[++idxArg]);
+    }
+    else if(!std::strcmp(argv[idxArg], "--repetitions") && hasValue)
+    {
+      options.numRepetitions = std::max(1, std::atoi(argv[++idxArg]));
+    }
+    else if(!std::strcmp(argv[idxArg], "--quick"))
+    {
+      options.quick = true;
+    }
+    else if(!std::strcmp(argv[idxArg], "--check") && hasValue)
+    {
+      options.baselineFile = argv[++idxArg];
+    }
+    else if(!std::strcmp(argv[idxArg], "--tolerance") && hasValue)
+    {
+      options.tolerance = std::atof(argv[++idxArg]);
+    }
+    else if(!std::strcmp(argv[idxArg], "--perf-counters"))
+    {
+      options.perfCounters = true;
+    }
+    else if(!std::strcmp(argv[idxArg], "--write-baseline") && hasValue)
+    {
+      options.writeBaselineFile = argv[++idxArg];
+    }
+    else
+    {
+      printUsage(argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  qserl::bench::Runner runner(options);
+  if(!options.baselineFile.empty() && !runner.loadBaseline(options.baselineFile))
+  {
+    std::cerr << "Failed to read baseline file " << options.baselineFile << std::endl;
+    return EXIT_FAILURE;
+  }
+  // timings of other build configurations are not comparable, the check is skipped rather than misreported
+  if(!options.baselineFile.empty() && runner.baselineBuildConfig() != qserl::bench::Runner::buildConfig())
+  {
+    std::cerr << "Baseline " << options.baselineFile << " was recorded with build configuration \""
+              << runner.baselineBuildConfig() << "\", not \"" << qserl::bench::Runner::buildConfig()
+              << "\": check with a build of the same configuration, or regenerate the baseline" << std::endl;
+    return kSkipReturnCode;
+  }
+  // baselines store times normalized by the machine speed
+  if(!options.baselineFile.empty() || !options.writeBaselineFile.empty())
+  {
+    runner.calibrate();
+  }
+
+  qserl::bench::benchRod3dIntegration(runner);
+  qserl::bench::benchRod2dIntegration(runner);
+  qserl::bench::benchInverseKinematics(runner);
+  qserl::bench::benchExpLog(runner);
+
+  std::ofstream output(options.outputFile.c_str());
+  if(!output)
+  {
+    std::cerr << "Failed to open output file " << options.outputFile << std::endl;
+    return EXIT_FAILURE;
+  }
+  runner.writeJson(output);
+  std::cerr << runner.results().size() << " benchmarks written to " << options.outputFile << std::endl;
+
+  if(!options.writeBaselineFile.empty())
+  {
+    std::ofstream baseline(options.writeBaselineFile.c_str());
+    if(!baseline)
+    {
+      std::cerr << "Failed to open baseline file " << options.writeBaselineFile << std::endl;
+      return EXIT_FAILURE;
+    }
+    runner.writeBaseline(baseline);
+  }
+  if(!options.baselineFile.empty())
+  {
+    return runner.checkBaseline(std::cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
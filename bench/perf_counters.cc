@@ -0,0 +1,187 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "perf_counters.h"
+
+#ifdef __linux__
+# include <cerrno>
+# include <cstring>
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+namespace qserl {
+namespace bench {
+
+namespace {
+
+#ifdef __linux__
+const uint64_t kEventConfigs[PerfCounters::PC_NUMBER_OF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                                                     PERF_COUNT_HW_INSTRUCTIONS,
+                                                                     PERF_COUNT_HW_CACHE_MISSES,
+                                                                     PERF_COUNT_HW_BRANCH_MISSES};
+
+int
+openCounter(uint64_t i_config)
+{
+  perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = i_config;
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+}
+#endif
+
+} // namespace
+
+const char*
+PerfCounters::counterName(CounterT i_counter)
+{
+  static const char* const names[] = {"cycles", "instructions", "cache_misses", "branch_misses"};
+  return names[i_counter];
+}
+
+PerfCounters::PerfCounters() :
+    m_fds(),
+    m_error()
+{
+  m_fds.fill(-1);
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+  for(const int fd : m_fds)
+  {
+    if(fd >= 0)
+    {
+      close(fd);
+    }
+  }
+#endif
+}
+
+bool
+PerfCounters::open()
+{
+#ifdef __linux__
+  bool isAnyOpened = false;
+  for(int counter = 0; counter < PC_NUMBER_OF_COUNTERS; ++counter)
+  {
+    m_fds[counter] = openCounter(kEventConfigs[counter]);
+    if(m_fds[counter] < 0 && m_error.empty())
+    {
+      m_error = std::string(counterName(static_cast<CounterT>(counter))) + ": " + std::strerror(errno);
+    }
+    isAnyOpened = isAnyOpened || m_fds[counter] >= 0;
+  }
+  return isAnyOpened;
+#else
+  m_error = "perf_event is only available on Linux";
+  return false;
+#endif
+}
+
+bool
+PerfCounters::isAvailable(CounterT i_counter) const
+{
+  return m_fds[i_counter] >= 0;
+}
+
+const std::string&
+PerfCounters::error() const
+{
+  return m_error;
+}
+
+void
+PerfCounters::reset()
+{
+#ifdef __linux__
+  for(const int fd : m_fds)
+  {
+    if(fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    }
+  }
+#endif
+}
+
+void
+PerfCounters::start()
+{
+#ifdef __linux__
+  for(const int fd : m_fds)
+  {
+    if(fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+  }
+#endif
+}
+
+void
+PerfCounters::stop()
+{
+#ifdef __linux__
+  for(const int fd : m_fds)
+  {
+    if(fd >= 0)
+    {
+      ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    }
+  }
+#endif
+}
+
+bool
+PerfCounters::value(CounterT i_counter,
+                    double& o_value) const
+{
+  o_value = 0.;
+#ifdef __linux__
+  if(m_fds[i_counter] < 0)
+  {
+    return false;
+  }
+  // value, time enabled, time running
+  uint64_t values[3] = {0, 0, 0};
+  if(read(m_fds[i_counter], values, sizeof(values)) != static_cast<ssize_t>(sizeof(values)) || values[2] == 0)
+  {
+    return false;
+  }
+  o_value = static_cast<double>(values[0]) * static_cast<double>(values[1]) / static_cast<double>(values[2]);
+  return true;
+#else
+  (void)i_counter;
+  return false;
+#endif
+}
+
+} // namespace bench
+} // namespace qserl
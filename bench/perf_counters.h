@@ -0,0 +1,108 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/** Hardware performance counters of the qserl-bench target, read through Linux perf_event. */
+
+#ifndef QSERL_BENCH_PERF_COUNTERS_H_
+#define QSERL_BENCH_PERF_COUNTERS_H_
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+namespace qserl {
+namespace bench {
+
+/**
+* \brief Hardware counters of the calling thread (user space only).
+* Counters that cannot be opened (non Linux systems, containers without perf_event access, virtual machines
+* without a PMU) are reported as unavailable, and the others still work.
+*/
+class PerfCounters
+{
+public:
+  enum CounterT
+  {
+    PC_CYCLES = 0,
+    PC_INSTRUCTIONS,
+    PC_CACHE_MISSES,
+    PC_BRANCH_MISSES,
+    PC_NUMBER_OF_COUNTERS
+  };
+
+  static const char*
+  counterName(CounterT i_counter);
+
+  PerfCounters();
+
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+
+  PerfCounters&
+  operator=(const PerfCounters&) = delete;
+
+  /**
+  * \brief Opens the counters.
+  * \return false if none of them could be opened, see error().
+  */
+  bool
+  open();
+
+  bool
+  isAvailable(CounterT i_counter) const;
+
+  /**
+  * \brief Returns the reason why the first unavailable counter could not be opened.
+  */
+  const std::string&
+  error() const;
+
+  /**
+  * \brief Resets the accumulated counts.
+  */
+  void
+  reset();
+
+  /**
+  * \brief Starts counting, counts accumulate over successive start() / stop() periods.
+  */
+  void
+  start();
+
+  void
+  stop();
+
+  /**
+  * \brief Reads the accumulated count, scaled if the counter was multiplexed with others.
+  * \return false if the counter is unavailable, or was never scheduled (e.g. no PMU in a virtual machine).
+  */
+  bool
+  value(CounterT i_counter,
+        double& o_value) const;
+
+private:
+  std::array<int, PC_NUMBER_OF_COUNTERS> m_fds;   /**< File descriptors, -1 if unavailable. */
+  std::string m_error;
+};
+
+} // namespace bench
+} // namespace qserl
+
+#endif // QSERL_BENCH_PERF_COUNTERS_H_
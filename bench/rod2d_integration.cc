@@ -0,0 +1,98 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.h"
+
+#include <cmath>
+#include <sstream>
+
+#include "qserl/rod2d/analytic_q.h"
+#include "qserl/rod2d/workspace_integrated_state.h"
+
+namespace qserl {
+namespace bench {
+
+void
+benchRod2dIntegration(Runner& io_runner)
+{
+  // rod parameterizations a = (torque, force x, force y) handled by analytic forms
+  static const std::vector<Eigen::Vector3d> aSet = {Eigen::Vector3d(2.3777, -49.6303, -9.8917),
+                                                    Eigen::Vector3d(-1.2339, -21.8067, -12.0168),
+                                                    Eigen::Vector3d(2.5, 8., -16.)};
+  const std::vector<double> deltaTSet = io_runner.options().quick ? std::vector<double>{1.e-2, 1.e-3} :
+                                        std::vector<double>{1.e-2, 1.e-3, 1.e-4};
+  static const rod2d::Displacement2D identityDisp = rod2d::Displacement2D::Zero();
+
+  for(size_t idxA = 0; idxA < aSet.size(); ++idxA)
+  {
+    const Eigen::Vector3d& a = aSet[idxA];
+    const rod2d::Wrench2D wrench(a[1], a[2], a[0]);
+    for(const double deltaT : deltaTSet)
+    {
+      rod2d::Parameters rodParameters;
+      rodParameters.radius = 1.;
+      rodParameters.rodModel = rod2d::Parameters::RM_INEXTENSIBLE;
+      rodParameters.delta_t = deltaT;
+      const size_t numNodes = static_cast<size_t>(rodParameters.numberOfNodes());
+      std::ostringstream deltaTStr;
+      deltaTStr << deltaT;
+      const Runner::Params params = {{"a", std::to_string(idxA)}, {"delta_t", deltaTStr.str()}};
+
+      rod2d::WorkspaceIntegratedStateShPtr state = rod2d::WorkspaceIntegratedState::create(wrench, identityDisp,
+                                                                                           rodParameters);
+      Result* numericResult = io_runner.run("rod2d/integrate_numeric", params, numNodes,
+                                            [&state]()
+                                            {
+                                              state->integrate();
+                                            });
+
+      std::vector<Eigen::Vector3d> analyticQ(numNodes);
+      Result* analyticResult = io_runner.run("rod2d/integrate_analytic", params, numNodes,
+                                             [&a, &analyticQ, numNodes]()
+                                             {
+                                               rod2d::MotionConstantsQ motionConstants;
+                                               rod2d::computeMotionConstantsQ(a, motionConstants);
+                                               Eigen::Vector3d qdot;
+                                               for(size_t idxNode = 0; idxNode < numNodes; ++idxNode)
+                                               {
+                                                 const double t = static_cast<double>(idxNode) /
+                                                                  static_cast<double>(numNodes - 1);
+                                                 rod2d::computeQAtPositionT(t, a, motionConstants, qdot,
+                                                                            analyticQ[idxNode]);
+                                               }
+                                             });
+
+      // accuracy of the numeric integration w.r.t. analytic forms
+      if(numericResult && analyticResult)
+      {
+        double maxPositionError = 0.;
+        for(size_t idxNode = 0; idxNode < numNodes; ++idxNode)
+        {
+          const rod2d::Displacement2D& q = state->nodes()[idxNode];
+          maxPositionError = std::max(maxPositionError, std::hypot(q[0] - analyticQ[idxNode][1],
+                                                                   q[1] - analyticQ[idxNode][2]));
+        }
+        numericResult->counters.push_back(std::make_pair("maxPositionError", maxPositionError));
+      }
+    }
+  }
+}
+
+} // namespace bench
+} // namespace qserl
@@ -0,0 +1,159 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "benchmark.h"
+
+#include "qserl/rod3d/workspace_integrated_state.h"
+
+namespace qserl {
+namespace bench {
+
+namespace {
+
+enum OptionFlagsT
+{
+  OF_KEEP_MU = 1 << 0,
+  OF_KEEP_JDET = 1 << 1,
+  OF_KEEP_M = 1 << 2,
+  OF_KEEP_J = 1 << 3,
+  OF_COMPUTE_J_NU_SV = 1 << 4,
+  OF_NUMBER_OF_COMBINATIONS = 1 << 5
+};
+
+std::string
+optionsName(int i_flags)
+{
+  static const char* const flagNames[] = {"mu", "Jdet", "M", "J", "J_nu_sv"};
+  std::string name;
+  for(int k = 0; k < 5; ++k)
+  {
+    if(i_flags & (1 << k))
+    {
+      name += (name.empty() ? "" : "+") + std::string(flagNames[k]);
+    }
+  }
+  return name.empty() ? "none" : name;
+}
+
+/**
+* \brief Compares the integration precisions, with default integration options.
+*/
+void
+benchRod3dIntegrationPrecision(Runner& io_runner)
+{
+  static const char* const precisionNames[] = {"double", "float", "mixed"};
+  const std::vector<int> numNodesSet = io_runner.options().quick ? std::vector<int>{100, 1000} :
+                                       std::vector<int>{100, 1000, 10000};
+  rod3d::Wrench wrench;
+  wrench << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  for(int model = 0; model < rod3d::Parameters::RM_NUMBER_OF_ROD_MODELS; ++model)
+  {
+    for(const int numNodes : numNodesSet)
+    {
+      for(int precision = 0; precision < rod3d::WorkspaceIntegratedState::IP_NUMBER_OF_INTEGRATION_PRECISIONS;
+          ++precision)
+      {
+        rod3d::Parameters rodParameters;
+        rodParameters.rodModel = static_cast<rod3d::Parameters::RodModelT>(model);
+        rodParameters.numNodes = numNodes;
+
+        rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+        integrationOptions.stop_if_unstable = false;
+        integrationOptions.precision = static_cast<rod3d::WorkspaceIntegratedState::IntegrationPrecisionT>(precision);
+
+        rod3d::WorkspaceIntegratedStateShPtr state = rod3d::WorkspaceIntegratedState::create(
+            wrench, numNodes, rod3d::Displacement::Identity(), rodParameters);
+        state->integrationOptions(integrationOptions);
+        io_runner.run("rod3d/integrate_precision",
+                      {{"model", rod3d::Parameters::getRodModelName(rodParameters.rodModel)},
+                       {"numNodes", std::to_string(numNodes)},
+                       {"precision", precisionNames[precision]}},
+                      numNodes,
+                      [&state]()
+                      {
+                        state->integrate();
+                      });
+      }
+    }
+  }
+}
+
+} // namespace
+
+void
+benchRod3dIntegration(Runner& io_runner)
+{
+  if(io_runner.isSelected("rod3d/integrate_precision"))
+  {
+    benchRod3dIntegrationPrecision(io_runner);
+  }
+  if(!io_runner.isSelected("rod3d/integrate"))
+  {
+    return;
+  }
+
+  const std::vector<int> numNodesSet = io_runner.options().quick ? std::vector<int>{10, 100, 1000} :
+                                       std::vector<int>{10, 100, 1000, 10000, 200000};
+  rod3d::Wrench wrench;
+  wrench << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  for(int model = 0; model < rod3d::Parameters::RM_NUMBER_OF_ROD_MODELS; ++model)
+  {
+    for(const int numNodes : numNodesSet)
+    {
+      for(int flags = 0; flags < OF_NUMBER_OF_COMBINATIONS; ++flags)
+      {
+        // singular values are computed from kept J matrices
+        if((flags & OF_COMPUTE_J_NU_SV) && !(flags & OF_KEEP_J))
+        {
+          continue;
+        }
+        rod3d::Parameters rodParameters;
+        rodParameters.rodModel = static_cast<rod3d::Parameters::RodModelT>(model);
+        rodParameters.numNodes = numNodes;
+
+        rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+        integrationOptions.stop_if_unstable = false;
+        integrationOptions.keepMuValues = (flags & OF_KEEP_MU) != 0;
+        integrationOptions.keepJdet = (flags & OF_KEEP_JDET) != 0;
+        integrationOptions.keepMMatrices = (flags & OF_KEEP_M) != 0;
+        integrationOptions.keepJMatrices = (flags & OF_KEEP_J) != 0;
+        integrationOptions.computeJ_nu_sv = (flags & OF_COMPUTE_J_NU_SV) != 0;
+
+        // the state is integrated again on each operation, as done e.g. by inverse kinematics
+        rod3d::WorkspaceIntegratedStateShPtr state = rod3d::WorkspaceIntegratedState::create(
+            wrench, numNodes, rod3d::Displacement::Identity(), rodParameters);
+        state->integrationOptions(integrationOptions);
+        io_runner.run("rod3d/integrate",
+                      {{"model", rod3d::Parameters::getRodModelName(rodParameters.rodModel)},
+                       {"numNodes", std::to_string(numNodes)},
+                       {"options", optionsName(flags)}},
+                      numNodes,
+                      [&state]()
+                      {
+                        state->integrate();
+                      });
+      }
+    }
+  }
+}
+
+} // namespace bench
+} // namespace qserl
@@ -7,6 +7,9 @@
 #include <qserl/rod3d/rod.h>
 #include <qserl/rod3d/ik.h>
 #include <qserl/util/explog.h>
+#include <qserl/util/logger.h>
+#include <qserl/util/metrics.h>
+#include <qserl/util/trace.h>
 
 #include <eigenpy/eigenpy.hpp>
 
@@ -48,6 +51,41 @@ namespace qserl {
       return make_tuple (w, t);
     }
 
+    /// Trace event of a Python block, used as context manager:
+    /// with TraceScope ("name"): ...
+    class TraceScope
+    {
+    public:
+      TraceScope (const std::string& name)
+        : name_ (util::Tracer::intern (name)), start_ (0) {}
+
+      TraceScope& enter ()
+      {
+        start_ = util::Tracer::now ();
+        return *this;
+      }
+
+      void exit (object, object, object)
+      {
+        if (util::Tracer::isRecording ())
+          util::Tracer::record (name_, start_, util::Tracer::now (), NULL, 0);
+      }
+
+    private:
+      const char* name_;
+      int64_t start_;
+    };
+
+    bool _writeChromeTrace (const std::string& file)
+    {
+      return util::Tracer::writeChromeTrace (file);
+    }
+
+    bool _writeMetrics (const std::string& file)
+    {
+      return util::Metrics::writeText (file);
+    }
+
     Displacement _exp6 (const Vector6d& v) { return exp6 (v); }
     Matrix3d _exp3 (const Vector3d& v) { return exp3 (v); }
     Vector6d _log6 (const Displacement& v) { return log6 (v); }
@@ -58,6 +96,8 @@ namespace qserl {
 
       class_< std::vector<double> >("StdVector_double")
         .def(vector_indexing_suite<std::vector<double> >());
+      class_< std::vector<std::size_t> >("StdVector_size_t")
+        .def(vector_indexing_suite<std::vector<std::size_t> >());
       // Does not work and I don't know why.
       class_< Displacements >("Displacements")
         .def(vector_indexing_suite<Displacements >());
@@ -70,6 +110,24 @@ namespace qserl {
       def ("exp6" , _exp6);
       def ("log6" , _log6);
 
+      def ("isTracingEnabled", util::Tracer::isEnabled);
+      def ("startTracing"    , util::Tracer::start);
+      def ("stopTracing"     , util::Tracer::stop);
+      def ("clearTracing"    , util::Tracer::clear);
+      def ("setThreadName"   , util::Tracer::setThreadName);
+      def ("writeChromeTrace", _writeChromeTrace);
+      class_<TraceScope, boost::noncopyable> ("TraceScope", init<std::string>())
+        .def ("__enter__", &TraceScope::enter, return_self<>())
+        .def ("__exit__" , &TraceScope::exit)
+        ;
+
+      def ("logVerbosity"   , util::Logger::verbosity);
+      def ("setLogVerbosity", util::Logger::setVerbosity);
+      def ("flushLog"       , util::Logger::flush);
+
+      def ("writeMetrics", _writeMetrics);
+      def ("resetMetrics", util::Metrics::reset);
+
       {
         scope parameters =
           class_<Parameters> ("Parameters", init<>())
@@ -114,6 +172,12 @@ namespace qserl {
           .def ("getJMatrix", &WorkspaceIntegratedState::getJMatrix, policy_by_value())
           .def ("J_det"     , &WorkspaceIntegratedState::J_det     , policy_by_value())
           .def ("J_nu_sv"   , &WorkspaceIntegratedState::J_nu_sv   , policy_by_value())
+          .def ("node"      , &WorkspaceIntegratedState::node      , policy_by_value())
+          .def ("outputNodes", &WorkspaceIntegratedState::outputNodes, policy_by_value())
+          .def ("positionsSoA"  , &WorkspaceIntegratedState::positionsSoA  , policy_by_value())
+          .def ("rotationsSoA"  , &WorkspaceIntegratedState::rotationsSoA  , policy_by_value())
+          .def ("quaternionsSoA", &WorkspaceIntegratedState::quaternionsSoA, policy_by_value())
+          .def ("JSoA"          , &WorkspaceIntegratedState::JSoA          , policy_by_value())
           ;
         enum_ <WorkspaceIntegratedState::IntegrationResultT> ("IntegrationResultT");
         // Make IntegrationResultT values accessible with WorkspaceIntegratedState.value
@@ -121,8 +185,15 @@ namespace qserl {
         wis.attr ("IR_SINGULAR"                     ) = WorkspaceIntegratedState::IR_SINGULAR;
         wis.attr ("IR_UNSTABLE"                     ) = WorkspaceIntegratedState::IR_UNSTABLE;
         wis.attr ("IR_OUT_OF_WRENCH_BOUNDS"         ) = WorkspaceIntegratedState::IR_OUT_OF_WRENCH_BOUNDS;
+        wis.attr ("IR_INVALID_OPTIONS"              ) = WorkspaceIntegratedState::IR_INVALID_OPTIONS;
         wis.attr ("IR_NUMBER_OF_INTEGRATION_RESULTS") = WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS;
 
+        enum_ <WorkspaceIntegratedState::IntegrationPrecisionT> ("IntegrationPrecisionT");
+        wis.attr ("IP_DOUBLE"                          ) = WorkspaceIntegratedState::IP_DOUBLE;
+        wis.attr ("IP_FLOAT"                           ) = WorkspaceIntegratedState::IP_FLOAT;
+        wis.attr ("IP_MIXED"                           ) = WorkspaceIntegratedState::IP_MIXED;
+        wis.attr ("IP_NUMBER_OF_INTEGRATION_PRECISIONS") = WorkspaceIntegratedState::IP_NUMBER_OF_INTEGRATION_PRECISIONS;
+
         class_ <WorkspaceIntegratedState::IntegrationOptions> ("IntegrationOptions", init<>())
           .def_readwrite ("computeJ_nu_sv"  , &WorkspaceIntegratedState::IntegrationOptions::computeJ_nu_sv)
           .def_readwrite ("stop_if_unstable", &WorkspaceIntegratedState::IntegrationOptions::stop_if_unstable)
@@ -130,6 +201,14 @@ namespace qserl {
           .def_readwrite ("keepJdet"        , &WorkspaceIntegratedState::IntegrationOptions::keepJdet)
           .def_readwrite ("keepMMatrices"   , &WorkspaceIntegratedState::IntegrationOptions::keepMMatrices)
           .def_readwrite ("keepJMatrices"   , &WorkspaceIntegratedState::IntegrationOptions::keepJMatrices)
+          .def_readwrite ("precision"       , &WorkspaceIntegratedState::IntegrationOptions::precision)
+          .def_readwrite ("outputNodes"     , &WorkspaceIntegratedState::IntegrationOptions::outputNodes)
+          .def_readwrite ("outputStride"    , &WorkspaceIntegratedState::IntegrationOptions::outputStride)
+          .def_readwrite ("checkpointInterval", &WorkspaceIntegratedState::IntegrationOptions::checkpointInterval)
+          .def_readwrite ("keepPositionsSoA"  , &WorkspaceIntegratedState::IntegrationOptions::keepPositionsSoA)
+          .def_readwrite ("keepRotationsSoA"  , &WorkspaceIntegratedState::IntegrationOptions::keepRotationsSoA)
+          .def_readwrite ("keepQuaternionsSoA", &WorkspaceIntegratedState::IntegrationOptions::keepQuaternionsSoA)
+          .def_readwrite ("keepJSoA"          , &WorkspaceIntegratedState::IntegrationOptions::keepJSoA)
           ;
       }
 
@@ -166,6 +245,11 @@ namespace eigenpy {
     ENABLE_SPECIFIC_MATRIX_TYPE(Vector7d);
 
     ENABLE_SPECIFIC_MATRIX_TYPE(Matrix6d);
+
+    ENABLE_SPECIFIC_MATRIX_TYPE(qserl::rod3d::PositionsSoA);
+    ENABLE_SPECIFIC_MATRIX_TYPE(qserl::rod3d::RotationsSoA);
+    ENABLE_SPECIFIC_MATRIX_TYPE(qserl::rod3d::QuaternionsSoA);
+    ENABLE_SPECIFIC_MATRIX_TYPE(qserl::rod3d::Matrices6dSoA);
   }
 }
 
@@ -5,10 +5,18 @@
 #include "qserl/rod2d/analytic_q.h"
 #include "qserl/rod2d/analytic_energy.h"
 #include "qserl/util/constants.h"
+#include "qserl/util/dataset.h"
+#include "qserl/util/regular_grid.h"
 
 #include <iostream>
 #include <fstream>
 #include <chrono>
+#include <limits>
+#include <sstream>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 int
 main()
@@ -31,12 +39,13 @@ main()
   static const double kStabilityThreshold = 1.e-7;        /** Threshold for Jacobian determinant. */
   static const double kStabilityTolerance = 1.e-8;      /** Tolerance for which Jacobian determinant vanishes. */
 
-  bool filterNonSurfacePoints = true;
+  bool filterNonSurfacePoints = true;     // only surface points are written to the text dataset
+  bool writeTextDataset = true;
 
   // set base A-space bounds
   static const int numSamplesTotal = numSamplesTorque * numSamplesForce * numSamplesForce;
 
-  Eigen::Matrix<double, 3, 1> aSpaceUpperBounds, aSpaceLowerBounds;
+  Eigen::VectorXd aSpaceUpperBounds(3), aSpaceLowerBounds(3);
 
   aSpaceUpperBounds[0] = maxTorque;
   aSpaceLowerBounds[0] = -maxTorque;
@@ -45,10 +54,14 @@ main()
     aSpaceUpperBounds[k] = maxForce;
     aSpaceLowerBounds[k] = -maxForce;
   }
-  static const double da_force = 2 * maxForce / static_cast<double>(numSamplesForce);
-  static const double da_torque = 2 * maxTorque / static_cast<double>(numSamplesTorque);
+  // A-space samples grid in TXY convention
+  const qserl::util::RegularGrid aSpaceGrid(aSpaceLowerBounds, aSpaceUpperBounds,
+                                            {numSamplesTorque, numSamplesForce, numSamplesForce});
+  const double da_torque = aSpaceGrid.step()[0];
+  const double da_force = aSpaceGrid.step()[1];
 
   static const char* stabilityDatasetFilename = "stability_dataset_2D.txt";
+  static const char* binaryDatasetFilename = "stability_dataset_2D.bin";
 
   qserl::rod2d::Parameters rodParameters;
   rodParameters.radius = 1.;
@@ -64,11 +77,34 @@ main()
   integrationOptions.keepMMatrices = false;
   integrationOptions.keepJMatrices = false;
 
+  // all grid samples are stored in a binary dataset, filled in place
+  qserl::util::DatasetHeader datasetHeader;
+  datasetHeader.rodDimension = 2;
+  datasetHeader.numSamples = aSpaceGrid.numSamples();
+  datasetHeader.columns = (1u << qserl::util::DC_A) | (1u << qserl::util::DC_STABILITY) |
+                          (1u << qserl::util::DC_ENERGY) | (1u << qserl::util::DC_TIP_POSE);
+  datasetHeader.gridLowerBounds = aSpaceLowerBounds;
+  datasetHeader.gridUpperBounds = aSpaceUpperBounds;
+  datasetHeader.gridNumSamples = {numSamplesTorque, numSamplesForce, numSamplesForce};
+  std::ostringstream sparams;
+  sparams << "# Planar rod case\n# TXY convention\nradius=" << rodParameters.radius << "\nlength="
+          << rodParameters.length << "\nintegrationTime=" << rodParameters.integrationTime << "\nrodModel="
+          << rodParameters.rodModel << "\ndelta_t=" << rodParameters.delta_t << "\n";
+  datasetHeader.parameters = sparams.str();
+  qserl::util::DatasetWriterShPtr datasetWriter = qserl::util::DatasetWriter::create(binaryDatasetFilename,
+                                                                                      datasetHeader);
+  if(!datasetWriter)
+  {
+    std::cerr << "Cannot create dataset file " << binaryDatasetFilename << std::endl;
+    return 1;
+  }
+  const qserl::util::ArrayView<double> dataset_a_TXY = datasetWriter->column(qserl::util::DC_A);
+  const qserl::util::ArrayView<int32_t> dataset_stability = datasetWriter->stabilityColumn();
+  const qserl::util::ArrayView<double> dataset_energy = datasetWriter->column(qserl::util::DC_ENERGY);
+  const qserl::util::ArrayView<double> dataset_tip_pose = datasetWriter->column(qserl::util::DC_TIP_POSE);
+
   int successfullMotionConstants = 0;
   int done = 0;
-  std::vector<Eigen::Vector3d> dataset_a_TXY(numSamplesTotal);
-  std::vector<int> dataset_stability(numSamplesTotal, -1);
-  std::vector<double> dataset_energy(numSamplesTotal, -1.);
 
   const auto startBenchTime = std::chrono::high_resolution_clock::now();
 
@@ -77,20 +113,16 @@ main()
 #pragma omp parallel for schedule(dynamic)
   for(int idxSample = 0; idxSample < numSamplesTotal; ++idxSample)
   {
-    const int i1 = (idxSample % (numSamplesTorque * numSamplesForce)) % numSamplesTorque;
-    const int i2 = (idxSample % (numSamplesTorque * numSamplesForce)) / numSamplesTorque;
-    const int i3 = idxSample / (numSamplesTorque * numSamplesForce);
-
-    Eigen::Vector3d wrench_TXY;
-    wrench_TXY[0] = i1 * da_torque;
-    wrench_TXY[1] = i2 * da_force;
-    wrench_TXY[2] = i3 * da_force;
+    const Eigen::Vector3d wrench_TXY = aSpaceGrid.sample(idxSample);
 
     qserl::rod2d::MotionConstantsQ motionConstants;
     double energy = -1.;
+    qserl::rod2d::Displacement2D tipPose = qserl::rod2d::Displacement2D::Constant(
+        std::numeric_limits<double>::quiet_NaN());
     qserl::rod2d::WorkspaceIntegratedState::IntegrationResultT integrationStatus = qserl::rod2d::WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS;
     if(qserl::rod2d::computeMotionConstantsQ(wrench_TXY, motionConstants))
     {
+#pragma omp atomic
       ++successfullMotionConstants;
       qserl::rod2d::computeTotalElasticEnergy(motionConstants, energy);
 
@@ -104,13 +136,22 @@ main()
                                                                                                             rodParameters);
       rodState->integrationOptions(integrationOptions);
       integrationStatus = rodState->integrate();
+      if(integrationStatus == qserl::rod2d::WorkspaceIntegratedState::IR_VALID)
+      {
+        tipPose = rodState->nodes().back();
+      }
     }
+
+    // samples are stored at disjoint locations of the mapped file
+    for(int k = 0; k < 3; ++k)
+    {
+      dataset_a_TXY[3 * idxSample + k] = wrench_TXY[k];
+      dataset_tip_pose[3 * idxSample + k] = tipPose[k];
+    }
+    dataset_stability[idxSample] = static_cast<int32_t>(integrationStatus);
+    dataset_energy[idxSample] = energy;
 #pragma omp critical
     {
-      // store to data array
-      dataset_a_TXY[idxSample] = wrench_TXY;
-      dataset_stability[idxSample] = static_cast<int>(integrationStatus);
-      dataset_energy[idxSample] = energy;
       ++done;
       if(done % (numSamplesTotal / 100) == 0)
       {
@@ -128,83 +169,62 @@ main()
   std::cout << "Singular samples =" << numSamplesTotal - successfullMotionConstants << " / " << numSamplesTotal
             << std::endl;
 
-  if(filterNonSurfacePoints)
-  {
-    // brute force method complexity in O(n^2)
-    static const int kNumNeighb = 27;
-    static const double forceThresholdDistance = da_force * 1.1; // 10% error margin
-    static const double torqueThresholdDistance = da_torque * 1.1; // 10% error margin
-
-    std::cout << "[PROGRESS] Filtering non surface points..." << std::endl;
-    std::vector<Eigen::Vector3d> dataset_a_TXY_filtered(numSamplesTotal);
-    std::vector<int> dataset_stability_filtered(numSamplesTotal);
-    std::vector<double> dataset_energy_filtered(numSamplesTotal);
+  std::cout << "Writing binary dataset to " << binaryDatasetFilename << "..." << std::endl;
+  datasetWriter->sync();
+  std::cout << "DONE" << std::endl;
 
-    for(size_t i = 0; i < numSamplesTotal; ++i)
+  if(writeTextDataset)
+  {
+    std::vector<size_t> outputSamples;
+    if(filterNonSurfacePoints)
     {
-      const int stabilityI = dataset_stability[i];
-      const Eigen::Vector3d& nodeI = dataset_a_TXY[i];
-      int numStableNeighb = 0;
-      // if stable point, check if has less than n^3 - 1 stable neighbours
-      // if so, then it is a surface point
-      for(size_t j = 0; j < numSamplesTotal; ++j)
-      {
-        if(i != j && dataset_stability[j] == stabilityI)
-        {
-          const Eigen::Vector3d& nodeJ = dataset_a_TXY[j];
-          if(abs(nodeI[0] - nodeJ[0]) < (torqueThresholdDistance &&
-                                         abs(nodeI[1] - nodeJ[1]) < forceThresholdDistance &&
-                                         abs(nodeI[2] - nodeJ[2]) < forceThresholdDistance))
-          {
-            ++numStableNeighb;
-          }
-        }
-      } // end for neighb j
-      if(numStableNeighb < kNumNeighb)
-      {
-        dataset_a_TXY_filtered[i] = nodeI;
-        dataset_stability_filtered[i] = stabilityI;
-        dataset_energy_filtered[i] = dataset_energy[i];
-      }
-      if(i % (numSamplesTotal / 100) == 0)
+      // keep only samples having at least one neighbour of different stability in the A-space grid
+      std::cout << "[PROGRESS] Filtering non surface points..." << std::endl;
+      const std::vector<int> stabilityLabels(dataset_stability.begin(), dataset_stability.end());
+      outputSamples = qserl::util::extractBoundarySamples(aSpaceGrid, stabilityLabels);
+      std::cout << "DONE (" << outputSamples.size() << " surface points)" << std::endl;
+    }
+    else
+    {
+      outputSamples.resize(numSamplesTotal);
+      for(int idxSample = 0; idxSample < numSamplesTotal; ++idxSample)
       {
-        std::cout << "[PROGRESS] Done :" << static_cast<double>(i) * 100 / static_cast<double>(numSamplesTotal)
-                  << std::endl;
+        outputSamples[idxSample] = idxSample;
       }
-
     }
-    std::cout << "DONE" << std::endl;
-  }
 
-  // output to file
-  std::cout << "Writing data to file..." << std::endl;
+    // output to file
+    std::cout << "Writing data to file..." << std::endl;
 
-  // write headers to files
-  std::ofstream ssamples(stabilityDatasetFilename, std::ofstream::out);
-  ssamples << "# Planar rod case" << std::endl;
-  ssamples << "# TXY convention" << std::endl;
-  for(int k = 0; k < 3; ++k)
-  {
-    ssamples << "# A_low[" << k + 3 << "]=" << aSpaceLowerBounds[k] << " / A_upper[" << k + 3 << "]="
-             << aSpaceUpperBounds[k] << std::endl;
-  }
+    // write headers to files
+    std::ofstream ssamples(stabilityDatasetFilename, std::ofstream::out);
+    ssamples << "# Planar rod case\n";
+    ssamples << "# TXY convention\n";
+    for(int k = 0; k < 3; ++k)
+    {
+      ssamples << "# A_low[" << k + 3 << "]=" << aSpaceLowerBounds[k] << " / A_upper[" << k + 3 << "]="
+               << aSpaceUpperBounds[k] << "\n";
+    }
 
-  ssamples << "# Number of samples (torque) = " << numSamplesTorque << std::endl;
-  ssamples << "# Number of samples (force) = " << numSamplesForce << std::endl;
-  ssamples << "#  Total number of samples = " << numSamplesTotal << std::endl;
-  ssamples << "# delta_a3 (torque) = " << da_torque << std::endl;
-  ssamples << "# delta_a[4,5] (force) = " << da_force << std::endl;
-  ssamples << "# a3(T) a4(Fx) a5(Fy) stability energy" << std::endl;
+    ssamples << "# Number of samples (torque) = " << numSamplesTorque << "\n";
+    ssamples << "# Number of samples (force) = " << numSamplesForce << "\n";
+    ssamples << "#  Total number of samples = " << numSamplesTotal << "\n";
+    ssamples << "#  Number of written samples = " << outputSamples.size() << "\n";
+    ssamples << "# delta_a3 (torque) = " << da_torque << "\n";
+    ssamples << "# delta_a[4,5] (force) = " << da_force << "\n";
+    ssamples << "# a3(T) a4(Fx) a5(Fy) stability energy\n";
 
-  for(int idxSample = 0; idxSample < numSamplesTotal; ++idxSample)
-  {
-    ssamples << dataset_a_TXY[idxSample][0] << "\t"
-             << dataset_a_TXY[idxSample][1] << "\t"
-             << dataset_a_TXY[idxSample][2] << "\t"
-             << dataset_stability[idxSample] << "\t"
-             << dataset_energy[idxSample] << std::endl;
+    // no flush per sample
+    for(size_t idxSample : outputSamples)
+    {
+      ssamples << dataset_a_TXY[3 * idxSample] << "\t"
+               << dataset_a_TXY[3 * idxSample + 1] << "\t"
+               << dataset_a_TXY[3 * idxSample + 2] << "\t"
+               << dataset_stability[idxSample] << "\t"
+               << dataset_energy[idxSample] << "\n";
+    }
+    std::cout << "DONE" << std::endl;
   }
-  std::cout << "DONE" << std::endl;
 
   // pause
   char ch;
@@ -29,6 +29,8 @@ if intResult == WorkspaceIntegratedState.IR_VALID:
     ik.maxIterations = 100
     ik.errorThreshold = 1e-3
     ik.verbosity = 1
+    # IK iterations are logged at info level
+    setLogVerbosity(3)
     # Low scale improves converge success rate but increases
     # the number of iterations. (Between 0 and 1)
     ik.scale = 1.
@@ -26,6 +26,7 @@
 #include "qserl/rod2d/workspace_state.h"
 #include "qserl/rod2d/parameters.h"
 #include "qserl/util/forward_class.h"
+#include "qserl/util/integration_stats.h"
 
 namespace qserl {
 namespace rod2d {
@@ -102,7 +103,7 @@ public:
   * rod configuration will be the last valid one before invalidity (exception of IR_SINGULAR configurations).
   * \param[in] i_maxWrench Maximum wrench allowed along the rod. If reached, the function will return IR_OUT_OF_WRENCH_BOUNDS.
   * \param[out] o_tinv Integration time point of invalidity (if the resulting configuration is unstable, this is the conjugate point
-  * and the function will returns IR_UNSTABLE).
+  * located as in conjugatePointT() and the function will returns IR_UNSTABLE).
   * \return The corresponding integration result status depending on the type of the A_free space boundary reached.
   */
   IntegrationResultT
@@ -116,6 +117,16 @@ public:
   bool
   isStable() const;
 
+  /**
+  * \brief Returns the integration time point of the first conjugate point found along the rod, i.e. where
+  * det(J(t)) vanishes, or a negative value if no conjugate point was found.
+  * The conjugate point is located within the integration step where instability is detected, up to the
+  * IntegrationOptions::conjugatePointTolerance accuracy.
+  * \pre Rod must be initialized.
+  */
+  double
+  conjugatePointT() const;
+
   /**
   * \brief Returns the wrench at the rod given node.
   */
@@ -181,6 +192,9 @@ public:
                                               Default is true. */
     IntegratorT integrator;         /** Integrator to be used in numerical integration.
                                               Default is RK4.*/
+    double conjugatePointTolerance;   /**< Accuracy of the conjugate point location (see conjugatePointT()).
+                                              If 0, the conjugate point is located at the node where instability
+                                              is detected. Default is 1e-9. */
   };
 
   /**
@@ -196,6 +210,13 @@ public:
   const IntegrationOptions&
   integrationOptions() const;
 
+  /**
+  * \brief Returns the statistics of the last integration.
+  * Statistics are only collected if the library is built with QSERL_ENABLE_STATS (see util::IntegrationStats).
+  */
+  const util::IntegrationStats&
+  integrationStats() const;
+
 protected:
 
   /**
@@ -223,12 +244,14 @@ protected:
 
   bool m_isInitialized;/**< True if the state has been integrated.*/
   bool m_isStable;      /**< True if DLO state is stable. */
+  double m_conjugatePointT;   /**< Integration time point of the first conjugate point, negative if none. */
   std::vector<costate_type> m_mu;            /**< mu : internal wrenches at each nodes in body frame (N elements). */
   std::vector<Eigen::Matrix<double, 3, 3> > m_M;            /**< dmu / da jacobian matrices (N elements).*/
   std::vector<Eigen::Matrix<double, 3, 3> > m_J;            /**< dq / da jacobian matrices (N elements). */
   std::vector<double> m_J_det;        /**< dq / da jacobian determinants (N elements). */
 
   IntegrationOptions m_integrationOptions;
+  util::IntegrationStats m_stats;  /**< Statistics of the last integration. */
 };
 
 }  // namespace rod2d
@@ -21,6 +21,7 @@
 #define QSERL_3D_INVERSE_KINEMATICS_H_
 
 #include <qserl/rod3d/rod.h>
+#include <qserl/util/integration_stats.h>
 
 namespace qserl {
 namespace rod3d {
@@ -60,6 +61,7 @@ namespace rod3d {
         return m_maxIter;
       }
 
+      /** \brief Logs the error every \c level iterations, at util::LL_INFO level. 0 (default) disables it. */
       void setVerbosity (int level)
       {
         m_verbosity = level;
@@ -85,6 +87,13 @@ namespace rod3d {
         return m_lastResult;
       }
 
+      /// Statistics of the last call to compute, including the accumulated
+      /// statistics of its integrations (see util::IntegrationStats).
+      const util::IntegrationStats& lastStats () const
+      {
+        return m_stats;
+      }
+
     private:
       RodConstShPtr m_rod;
       double m_squareErrorThr;
@@ -92,6 +101,7 @@ namespace rod3d {
       int m_verbosity;
       double m_scale;
       mutable WorkspaceIntegratedState::IntegrationResultT m_lastResult;
+      mutable util::IntegrationStats m_stats;
   };
 
 }  // namespace rod3d
@@ -0,0 +1,240 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_3D_INTEGRATION_CACHE_H_
+#define QSERL_3D_INTEGRATION_CACHE_H_
+
+#include "qserl/exports.h"
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "qserl/rod3d/parameters.h"
+#include "qserl/rod3d/persistent_integration_cache.h"
+#include "qserl/rod3d/types.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/forward_class.h"
+
+namespace qserl {
+namespace rod3d {
+
+DECLARE_CLASS(IntegrationCache);
+
+/**
+* \brief Thread safe least recently used cache of rod integration results.
+* Entries are keyed by the rod parameters, the integration options and the base wrench. The base wrench
+* is either compared exactly, or quantized to a given tolerance, in which case wrenches falling in the same
+* quantization cell share the state integrated from the first of them.
+* Cached states are private copies, and copies are handed out on hits, so callers can freely modify them.
+* The base position is not part of the key, as nodes are expressed in the rod base frame.
+* Only valid states (IR_VALID) are stored, other results only store their result status.
+* A persistent cache can be attached (see persistentCache()), so that results are also looked up from and
+* written to the disk, and shared with other processes and runs.
+*/
+class QSERL_EXPORT IntegrationCache
+{
+public:
+
+  /** \brief Memory budget of the process wide cache, in bytes. */
+  static const size_t kDefaultGlobalMaxMemUsage = static_cast<size_t>(256) << 20;
+
+  /**
+  * \brief Returns the process wide cache, with exact wrench matching and a budget of kDefaultGlobalMaxMemUsage
+  * bytes (see maxMemUsage(size_t)). It holds the states of lazy integrated states (see LazyIntegratedState)
+  * unless they are given another cache.
+  */
+  static const IntegrationCacheShPtr&
+  global();
+
+  /**
+  * \brief Constructor.
+  * \param i_maxMemUsage Memory budget in bytes, as measured by WorkspaceIntegratedState::memUsage().
+  * Least recently used entries are evicted when the budget is exceeded.
+  * \param i_wrenchTolerance Quantization step of base wrench components, 0 for exact matching.
+  */
+  static IntegrationCacheShPtr
+  create(size_t i_maxMemUsage,
+         double i_wrenchTolerance = 0.);
+
+  /**
+  * \brief Returns the cached integration of given base wrench, or integrates it and caches the result.
+  * \param[out] o_state The integrated state, with base position set to i_basePos. Set to a null pointer
+  * if the result is not IR_VALID.
+  * \return The integration result status.
+  */
+  WorkspaceIntegratedState::IntegrationResultT
+  integrate(const Wrench& i_wrench,
+            const Displacement& i_basePos,
+            const Parameters& i_rodParams,
+            const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+            WorkspaceIntegratedStateShPtr& o_state);
+
+  /**
+  * \brief Looks up the cached integration of given base wrench.
+  * \param[out] o_state Copy of the cached state, with base position set to i_basePos, or null pointer
+  * if the cached result is not IR_VALID.
+  * \param[out] o_result The cached integration result status.
+  * \return true if the base wrench was cached.
+  */
+  bool
+  find(const Wrench& i_wrench,
+       const Displacement& i_basePos,
+       const Parameters& i_rodParams,
+       const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+       WorkspaceIntegratedStateShPtr& o_state,
+       WorkspaceIntegratedState::IntegrationResultT& o_result);
+
+  /**
+  * \brief Inserts an integration result into the cache. A private copy of the state is stored.
+  * \param i_state The integrated state, may be null if i_result is not IR_VALID.
+  */
+  void
+  insert(const Wrench& i_wrench,
+         const Parameters& i_rodParams,
+         const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+         const WorkspaceIntegratedStateConstShPtr& i_state,
+         WorkspaceIntegratedState::IntegrationResultT i_result);
+
+  /**
+  * \brief Attaches a persistent cache, or detaches it if null. Entries not found in memory are then looked up in
+  * the persistent cache, and inserted entries are also appended to it.
+  */
+  void
+  persistentCache(const PersistentIntegrationCacheShPtr& i_persistentCache);
+
+  const PersistentIntegrationCacheShPtr&
+  persistentCache() const;
+
+  /**
+  * \brief Removes all entries. Hit and miss counters are kept.
+  */
+  void
+  clear();
+
+  /**
+  * \brief Returns the number of cached entries.
+  */
+  size_t
+  size() const;
+
+  /**
+  * \brief Returns the memory usage of cached entries.
+  */
+  size_t
+  memUsage() const;
+
+  size_t
+  maxMemUsage() const;
+
+  /**
+  * \brief Sets the memory budget in bytes, evicting least recently used entries if it is exceeded.
+  */
+  void
+  maxMemUsage(size_t i_maxMemUsage);
+
+  double
+  wrenchTolerance() const;
+
+  /**
+  * \brief Returns the number of lookups served from the cache.
+  */
+  size_t
+  numHits() const;
+
+  /**
+  * \brief Returns the number of lookups not found in the cache.
+  */
+  size_t
+  numMisses() const;
+
+  /**
+  * \brief Returns the number of lookups served from the persistent cache, counted in numHits() as well.
+  */
+  size_t
+  numPersistentHits() const;
+
+protected:
+
+  /**
+  \brief Constructor
+  */
+  IntegrationCache(size_t i_maxMemUsage,
+                   double i_wrenchTolerance);
+
+  /**
+  * \brief Returns the key of given integration inputs, i.e. their byte representation.
+  */
+  std::string
+  key(const Wrench& i_wrench,
+      const Parameters& i_rodParams,
+      const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions) const;
+
+  /**
+  * \brief Inserts an integration result into the memory cache only. A private copy of the state is stored.
+  */
+  void
+  insertEntry(const std::string& i_key,
+              const WorkspaceIntegratedStateConstShPtr& i_state,
+              WorkspaceIntegratedState::IntegrationResultT i_result);
+
+  /**
+  * \brief Evicts least recently used entries until memory usage fits the budget.
+  * \pre m_mutex is locked.
+  */
+  void
+  evict();
+
+private:
+  struct Entry
+  {
+    std::string key;
+    WorkspaceIntegratedStateConstShPtr state;
+    WorkspaceIntegratedState::IntegrationResultT result;
+    size_t memUsage;
+  };
+
+  /**
+  * \brief FNV-1a hash of keys.
+  */
+  struct KeyHash
+  {
+    size_t
+    operator()(const std::string& i_key) const;
+  };
+
+  typedef std::list<Entry> EntryList;
+
+  size_t m_maxMemUsage;
+  double m_wrenchTolerance;
+  mutable std::mutex m_mutex;
+  EntryList m_entries;     /**< Entries, most recently used first. */
+  std::unordered_map<std::string, EntryList::iterator, KeyHash> m_index;
+  size_t m_memUsage;
+  size_t m_numHits;
+  size_t m_numMisses;
+  size_t m_numPersistentHits;
+  PersistentIntegrationCacheShPtr m_persistentCache;
+};
+
+}  // namespace rod3d
+}  // namespace qserl
+
+#endif // QSERL_3D_INTEGRATION_CACHE_H_
@@ -0,0 +1,158 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_3D_LAZY_INTEGRATED_STATE_H_
+#define QSERL_3D_LAZY_INTEGRATED_STATE_H_
+
+#include "qserl/exports.h"
+
+#include <memory>
+#include <vector>
+
+#include "qserl/rod3d/integration_cache.h"
+#include "qserl/rod3d/parameters.h"
+#include "qserl/rod3d/types.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+
+namespace qserl {
+namespace rod3d {
+
+/**
+* \brief Settings shared by lazy integrated states (see LazyIntegratedState).
+*/
+struct QSERL_EXPORT LazyIntegrationSettings
+{
+  /**
+  * \brief Constructor.
+  * \param i_cache Cache holding the integrated states, or null pointer to integrate on every access.
+  */
+  LazyIntegrationSettings(const Parameters& i_rodParams,
+                          const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions =
+                          WorkspaceIntegratedState::IntegrationOptions(),
+                          const IntegrationCacheShPtr& i_cache = IntegrationCache::global());
+
+  Parameters rodParameters;
+  WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  IntegrationCacheShPtr cache;
+};
+
+typedef std::shared_ptr<const LazyIntegrationSettings> LazyIntegrationSettingsConstShPtr;
+
+/**
+* \brief Rod state given by its base wrench, integrated on access.
+* Only the base wrench, the base position and a handle to shared settings are stored, so large roadmaps can
+* keep one per configuration. The integrated states are held by the cache of the settings, which evicts the
+* least recently used ones once its memory budget is exceeded, and integrates them again when accessed later.
+* As integration is deterministic, an evicted state is integrated again identically.
+* Accessors are thread safe.
+*/
+class QSERL_EXPORT LazyIntegratedState
+{
+public:
+
+  /**
+  * \brief Constructor. Does not integrate.
+  */
+  LazyIntegratedState(const Wrench& i_baseWrench,
+                      const Displacement& i_basePosition,
+                      const LazyIntegrationSettingsConstShPtr& i_settings);
+
+  const Wrench&
+  baseWrench() const;
+
+  /**
+  * \brief Accessor to rod base position (in world frame).
+  */
+  const Displacement&
+  base() const;
+
+  /**
+  * \brief Setter for the rod base position (in world frame). Does not require integrating again.
+  */
+  void
+  base(const Displacement& i_base);
+
+  const LazyIntegrationSettingsConstShPtr&
+  settings() const;
+
+  /**
+  * \brief Returns the integrated state, from the cache or integrated now.
+  * The returned state is a private copy, which stays valid when evicted from the cache. Callers accessing
+  * several nodes should hold it rather than call node() or getJMatrix() repeatedly, each of them looking up
+  * the cache.
+  * \param[out] o_result The integration result status.
+  * \return The integrated state, or a null pointer if the result is not IR_VALID.
+  */
+  WorkspaceIntegratedStateShPtr
+  state(WorkspaceIntegratedState::IntegrationResultT& o_result) const;
+
+  /**
+  * \brief Returns the integrated state, or a null pointer if the integration result is not IR_VALID.
+  */
+  WorkspaceIntegratedStateShPtr
+  state() const;
+
+  /**
+  * \brief Returns the integration result status.
+  */
+  WorkspaceIntegratedState::IntegrationResultT
+  result() const;
+
+  /**
+  * \brief Returns the nodes positions, in <b>base</b> frame.
+  * \throw std::logic_error if the integration result is not IR_VALID.
+  */
+  Displacements
+  nodes() const;
+
+  /**
+  * \brief Returns the position of given node, in <b>base</b> frame.
+  * \throw std::logic_error if the integration result is not IR_VALID.
+  * \throw std::out_of_range if the node is not stored.
+  */
+  Displacement
+  node(size_t i_nodeIdx) const;
+
+  /**
+  * \brief Returns the J matrix of given node.
+  * \pre J matrices are kept by the integration options.
+  * \throw std::logic_error if the integration result is not IR_VALID.
+  * \throw std::out_of_range if the node is not stored.
+  */
+  Matrix6d
+  getJMatrix(size_t i_nodeIdx) const;
+
+  /**
+  * \brief Returns the memory usage of this instance, excluding the shared settings and cached states.
+  */
+  size_t
+  memUsage() const;
+
+private:
+  Wrench m_baseWrench;
+  Displacement m_base;        /**< DLO base position, in world frame (absolute). */
+  LazyIntegrationSettingsConstShPtr m_settings;
+};
+
+typedef std::vector<LazyIntegratedState, Eigen::aligned_allocator<LazyIntegratedState> > LazyIntegratedStates;
+
+}  // namespace rod3d
+}  // namespace qserl
+
+#endif // QSERL_3D_LAZY_INTEGRATED_STATE_H_
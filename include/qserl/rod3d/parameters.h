@@ -22,6 +22,8 @@
 
 #include "qserl/exports.h"
 
+#include <string>
+#include <vector>
 #include <Eigen/Core>
 
 namespace qserl {
@@ -0,0 +1,220 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_3D_PERSISTENT_INTEGRATION_CACHE_H_
+#define QSERL_3D_PERSISTENT_INTEGRATION_CACHE_H_
+
+#include "qserl/exports.h"
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/forward_class.h"
+#include "qserl/util/mapped_file.h"
+
+namespace qserl {
+namespace rod3d {
+
+DECLARE_CLASS(PersistentIntegrationCache);
+
+/**
+* \brief Integration results persisted in a directory, shared by the processes of a host and across runs.
+* Entries are keyed by an opaque byte string (IntegrationCache uses the byte representation of the rod
+* parameters, integration options and base wrench), and located by the 64 bits FNV-1a hash of their key.
+* The directory holds:
+* - append only segment files (segment_<n>.bin). Each entry is a record holding its key, its integration result
+*   and, for valid results, the integrated state in the StateFile format, read in place from the mapped segment.
+* - an index file (index.bin), mapped in memory, which is an open addressing hash table of the record locations.
+* - a lock file (lock), locked with flock() so that concurrent processes read the index under a shared lock and
+*   update it under an exclusive lock.
+* When the disk budget or the index capacity is exceeded, the oldest segments are deleted with their entries.
+* Records are validated when read, so that entries left by a crashed process are ignored.
+* States integrated with checkpoints, structures of arrays or J nu singular values are not persisted, as the
+* StateFile format does not store them.
+* Persistent caches are only available on POSIX systems.
+*/
+class QSERL_EXPORT PersistentIntegrationCache
+{
+public:
+
+  /** \brief Default disk budget, in bytes. */
+  static const size_t kDefaultMaxDiskUsage = static_cast<size_t>(1) << 30;
+
+  /** \brief Default maximum number of entries. */
+  static const size_t kDefaultMaxEntries = static_cast<size_t>(1) << 16;
+
+  /**
+  * \brief Revision of the integrators, recorded in the index so that results persisted by a library with other
+  * integrators are discarded when the cache is opened. To be incremented by any change of the integration results.
+  */
+  static const uint32_t kIntegratorRevision = 1;
+
+  /**
+  * \brief Destructor.
+  */
+  ~PersistentIntegrationCache();
+
+  /**
+  * \brief Opens the cache stored in given directory, creating the directory (but not its parents) and the
+  * index if needed.
+  * \param i_maxDiskUsage Disk budget of the segment files in bytes, enforced by this instance on insertion.
+  * \param i_maxEntries Maximum number of entries, only used when the index is created.
+  * An index created by another integrator revision (see kIntegratorRevision) is cleared with its entries.
+  * \return A null pointer if persistent caches are not available, if the directory cannot be created, or if
+  * it holds an index of another format version.
+  */
+  static PersistentIntegrationCacheShPtr
+  open(const std::string& i_directory,
+       size_t i_maxDiskUsage = kDefaultMaxDiskUsage,
+       size_t i_maxEntries = kDefaultMaxEntries);
+
+  /**
+  * \brief Looks up the integration result of given key.
+  * \param[out] o_state The stored state (see StateFile::state()), or a null pointer if the stored result is
+  * not IR_VALID.
+  * \param[out] o_result The stored integration result status.
+  * \return true if the key is stored.
+  */
+  bool
+  find(const std::string& i_key,
+       WorkspaceIntegratedStateShPtr& o_state,
+       WorkspaceIntegratedState::IntegrationResultT& o_result);
+
+  /**
+  * \brief Appends an integration result to the cache, unless its key is already stored.
+  * \param i_state The integrated state, may be null if i_result is not IR_VALID.
+  * \return false if the result cannot be persisted (unsupported integration options, record larger than the disk
+  * budget, or I/O error).
+  */
+  bool
+  insert(const std::string& i_key,
+         const WorkspaceIntegratedStateConstShPtr& i_state,
+         WorkspaceIntegratedState::IntegrationResultT i_result);
+
+  const std::string&
+  directory() const;
+
+  /**
+  * \brief Returns the number of stored entries.
+  */
+  size_t
+  size() const;
+
+  /**
+  * \brief Returns the size of the segment files, in bytes.
+  */
+  size_t
+  diskUsage() const;
+
+  size_t
+  maxDiskUsage() const;
+
+  size_t
+  maxEntries() const;
+
+protected:
+
+  /**
+  \brief Constructor
+  */
+  PersistentIntegrationCache(const std::string& i_directory,
+                             size_t i_maxDiskUsage);
+
+  bool
+  init(size_t i_maxEntries);
+
+  struct IndexHeader;
+  struct IndexSlot;
+
+  IndexHeader&
+  header() const;
+
+  IndexSlot*
+  slots() const;
+
+  /**
+  * \brief Returns the file name of given segment.
+  */
+  std::string
+  segmentFilename(uint64_t i_segment) const;
+
+  /**
+  * \brief Returns the mapping of given segment, mapped again if it is smaller than given size.
+  * \return A null pointer if the segment does not exist or is smaller than given size.
+  * \pre m_mutex is locked.
+  */
+  util::MappedFileConstShPtr
+  segment(uint64_t i_segment,
+          size_t i_minSize);
+
+  /**
+  * \brief Checks that given slot locates the record of given key.
+  * \param[out] o_stateOffset Byte offset of the stored state in the segment.
+  * \param[out] o_stateSize Size in bytes of the stored state, 0 if the result is not IR_VALID.
+  * \pre m_mutex and the lock file are locked.
+  */
+  bool
+  readRecord(const IndexSlot& i_slot,
+             const std::string& i_key,
+             util::MappedFileConstShPtr& o_segment,
+             WorkspaceIntegratedState::IntegrationResultT& o_result,
+             size_t& o_stateOffset,
+             size_t& o_stateSize);
+
+  /**
+  * \brief Returns the slot locating the record of given key, or a null pointer if it is not stored.
+  * \pre m_mutex and the lock file are locked.
+  */
+  const IndexSlot*
+  findSlot(uint64_t i_hash,
+           const std::string& i_key,
+           util::MappedFileConstShPtr& o_segment,
+           WorkspaceIntegratedState::IntegrationResultT& o_result,
+           size_t& o_stateOffset,
+           size_t& o_stateSize);
+
+  /**
+  * \brief Deletes the oldest segment and removes its entries from the index.
+  * \pre m_mutex and the lock file are exclusively locked.
+  */
+  void
+  evictOldestSegment();
+
+  /**
+  * \brief Removes all segment files of the directory.
+  */
+  void
+  removeSegments() const;
+
+private:
+  std::string m_directory;
+  size_t m_maxDiskUsage;
+  int m_lockFd;                     /**< Lock file descriptor, -1 if not opened. */
+  util::MappedFileShPtr m_index;
+  mutable std::mutex m_mutex;       /**< Serializes the threads of this instance, the lock file serializes processes. */
+  std::map<uint64_t, util::MappedFileConstShPtr> m_segments;   /**< Segments mapped by this instance. */
+};
+
+}  // namespace rod3d
+}  // namespace qserl
+
+#endif // QSERL_3D_PERSISTENT_INTEGRATION_CACHE_H_
@@ -22,6 +22,7 @@
 
 #include "qserl/exports.h"
 
+#include "qserl/rod3d/integration_cache.h"
 #include "qserl/rod3d/parameters.h"
 #include "qserl/rod3d/types.h"
 #include "qserl/rod3d/workspace_integrated_state.h"
@@ -97,6 +98,9 @@ public:
   * Rod base is independant from this as node positions are computed in local base frame.
   * The corresponding rod state will be updated only if the result of integration leads to
   * WorkspaceIntegratedState::IR_VALID (see enum WorkspaceIntegratedState::IntegrationResultT).
+  * If an integration cache is set, the integration result is looked up in the cache first.
+  * Otherwise the integration is done in place into a spare state of the rod, which is a previous state
+  * not referenced anywhere else, so that repeated calls reuse the same states storage.
   * \return The corresponding integration result status (see enum WorkspaceIntegratedState::IntegrationResultT).
   *	Note that IR_OUT_OF_WRENCH_BOUNDS cannot be returned, as out of bounds detection for internal
   * rod wrenches is not implemented yet.
@@ -106,6 +110,19 @@ public:
                                const Displacement& i_basePos,
                                const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions);
 
+  /**
+  * \brief Sets the cache used by integrateStateFromBaseWrench(). A cache can be shared by several rods.
+  * Default is a null pointer, i.e. no caching.
+  */
+  void
+  integrationCache(const IntegrationCacheShPtr& i_cache);
+
+  /**
+  * \brief Accessor to the integration cache, or null pointer if not set.
+  */
+  const IntegrationCacheShPtr&
+  integrationCache() const;
+
   /************************************************************************/
   /*														Static members														*/
   /************************************************************************/
@@ -145,6 +162,10 @@ private:
 
   WorkspaceStateShPtr m_state;
 
+  WorkspaceIntegratedStateShPtr m_spareState;   /**< Previous state, reused if not referenced anywhere else. */
+
+  IntegrationCacheShPtr m_integrationCache;
+
 };
 
 }  // namespace rod3d
@@ -0,0 +1,42 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_3D_STABILITY_ORACLE_H_
+#define QSERL_3D_STABILITY_ORACLE_H_
+
+#include "qserl/exports.h"
+
+#include "qserl/rod3d/parameters.h"
+#include "qserl/util/stability_index.h"
+
+namespace qserl {
+namespace rod3d {
+
+/**
+* \brief Returns a stability oracle integrating the rod of given parameters, to be used
+* by util::StabilityIndex. The oracle takes the base wrench a (see Wrench).
+* Returned oracle is thread safe.
+*/
+QSERL_EXPORT util::StabilityIndex::StabilityOracle
+createStabilityOracle(const Parameters& i_rodParams);
+
+}  // namespace rod3d
+}  // namespace qserl
+
+#endif // QSERL_3D_STABILITY_ORACLE_H_
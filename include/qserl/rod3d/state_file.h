@@ -0,0 +1,255 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_3D_STATE_FILE_H_
+#define QSERL_3D_STATE_FILE_H_
+
+#include "qserl/exports.h"
+
+#include <string>
+#include <vector>
+
+#include "qserl/rod3d/parameters.h"
+#include "qserl/rod3d/types.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/array_view.h"
+#include "qserl/util/forward_class.h"
+#include "qserl/util/mapped_file.h"
+
+namespace qserl {
+namespace rod3d {
+
+DECLARE_CLASS(StateFile);
+
+/**
+* \brief Per stored node arrays of a state file.
+* - SA_NODES: node positions in base frame, encoded as given by NodesEncodingT.
+* - SA_MU: wrenches, 6 doubles.
+* - SA_M: M matrices in column major order, 36 doubles.
+* - SA_J: J matrices in column major order, 36 doubles.
+* - SA_J_DET: J determinants, 1 double.
+*/
+enum StateArrayT
+{
+  SA_NODES = 0,
+  SA_MU,
+  SA_M,
+  SA_J,
+  SA_J_DET,
+  SA_NUMBER_OF_ARRAYS
+};
+
+/**
+* \brief Encoding of the node positions in a state file.
+* - NE_FULL: 4x4 homogeneous matrix in column major order, 16 doubles.
+* - NE_AFFINE: first 3 rows of the homogeneous matrix in column major order, 12 doubles. Lossless, as the last
+*   row of integrated nodes is always (0, 0, 0, 1).
+* - NE_AFFINE_FLOAT: same as NE_AFFINE in single precision, 12 floats. Lossy (relative error about 1e-7).
+*/
+enum NodesEncodingT
+{
+  NE_FULL = 0,
+  NE_AFFINE,
+  NE_AFFINE_FLOAT,
+  NE_NUMBER_OF_NODES_ENCODINGS
+};
+
+/**
+* \brief Binary file of an integrated 3D rod state, so that states can be reloaded without integrating again.
+* The file stores the rod parameters, the integration options, the stability status and the selected per stored
+* node arrays. It is mapped in memory when opened, and arrays are exposed without any copy.
+* Binary layout (native byte order):
+* - header: magic "QSERLST\0", format version, byte order mark, rod parameters, integration options, stability
+*   status, number of integrated nodes, base wrench and position, number of stored nodes, requested and
+*   resolved output nodes, array schema (scalar type, width and byte offset of each array, offset 0 for absent
+*   arrays).
+* - array blocks, each one starting at a 64 bytes aligned offset and storing the values of all stored nodes
+*   contiguously (node after node).
+*/
+class QSERL_EXPORT StateFile
+{
+public:
+
+  /** \brief Mask of all arrays, see write(). */
+  static const unsigned int kAllArrays = (1u << SA_NUMBER_OF_ARRAYS) - 1;
+
+  /**
+  * \brief Writes given integrated state into a state file.
+  * \param i_arrays Bitmask of the arrays to write, bit k for array k. Node positions are always written, and
+  * the other arrays only if kept by the state integration options. Values recomputed from checkpoints are
+  * written as well.
+  * \return false if the file cannot be created.
+  * \pre The state has been integrated.
+  */
+  static bool
+  write(const std::string& i_filename,
+        const WorkspaceIntegratedState& i_state,
+        unsigned int i_arrays = kAllArrays,
+        NodesEncodingT i_nodesEncoding = NE_FULL);
+
+  /**
+  * \brief Serializes given integrated state into a buffer, with the file layout of write() (e.g. to embed it
+  * in a larger file, see open(const util::MappedFileConstShPtr&, size_t, size_t)).
+  */
+  static void
+  serialize(const WorkspaceIntegratedState& i_state,
+            unsigned int i_arrays,
+            NodesEncodingT i_nodesEncoding,
+            std::vector<char>& o_bytes);
+
+  /**
+  * \brief Opens the given state file.
+  * \return A null pointer if the file cannot be opened or is not a valid state file.
+  */
+  static StateFileConstShPtr
+  open(const std::string& i_filename);
+
+  /**
+  * \brief Opens a state file embedded in a mapped file, at given byte offset and of given size.
+  * The state file keeps the mapped file alive.
+  * \pre i_offset is a multiple of 64, so that arrays are aligned.
+  * \return A null pointer if the range is not a valid state file.
+  */
+  static StateFileConstShPtr
+  open(const util::MappedFileConstShPtr& i_file,
+       size_t i_offset,
+       size_t i_size);
+
+  const Parameters&
+  rodParameters() const;
+
+  /**
+  * \brief Returns the integration options of the written state.
+  */
+  const WorkspaceIntegratedState::IntegrationOptions&
+  integrationOptions() const;
+
+  bool
+  isStable() const;
+
+  double
+  conjugatePointT() const;
+
+  const Wrench&
+  baseWrench() const;
+
+  /**
+  * \brief Returns the rod base position (in world frame).
+  */
+  const Displacement&
+  base() const;
+
+  /**
+  * \brief Returns the number of stored nodes, i.e. of values of each array.
+  */
+  size_t
+  numStoredNodes() const;
+
+  /**
+  * \brief Returns the indices of the stored nodes, empty if all nodes are stored
+  * (see WorkspaceIntegratedState::outputNodes()).
+  */
+  const std::vector<size_t>&
+  outputNodes() const;
+
+  bool
+  hasArray(StateArrayT i_array) const;
+
+  NodesEncodingT
+  nodesEncoding() const;
+
+  /**
+  * \brief Returns the number of scalars stored per node in the given array.
+  */
+  size_t
+  arrayWidth(StateArrayT i_array) const;
+
+  /**
+  * \brief Returns the values of a double precision array.
+  * Values of stored node k are stored at [k * arrayWidth, (k + 1) * arrayWidth[.
+  * \pre The array is stored in double precision, i.e. is not the nodes encoded with NE_AFFINE_FLOAT.
+  */
+  util::ArrayView<const double>
+  array(StateArrayT i_array) const;
+
+  /**
+  * \brief Returns the values of a single precision array.
+  * \pre The array is stored in single precision, i.e. is the nodes encoded with NE_AFFINE_FLOAT.
+  */
+  util::ArrayView<const float>
+  floatArray(StateArrayT i_array) const;
+
+  /**
+  * \brief Returns the position of given stored node, in base frame, whatever the nodes encoding.
+  */
+  Displacement
+  node(size_t i_idxStored) const;
+
+  /**
+  * \brief Returns a state holding the stored values, without integrating it.
+  * Its integration options are the written ones, except that only the stored arrays are kept, and that
+  * checkpoints, structures of arrays and J nu singular values are disabled.
+  */
+  WorkspaceIntegratedStateShPtr
+  state() const;
+
+protected:
+
+  StateFile();
+
+  bool
+  init(const util::MappedFileConstShPtr& i_file,
+       size_t i_offset,
+       size_t i_size);
+
+  /**
+  * \brief Selects the arrays of given state to write, and serializes the header.
+  * \param[out] o_storedArrays Whether each array is written, of size SA_NUMBER_OF_ARRAYS.
+  * \param[out] o_size Size in bytes of the state file.
+  */
+  static void
+  layout(const WorkspaceIntegratedState& i_state,
+         unsigned int i_arrays,
+         NodesEncodingT i_nodesEncoding,
+         bool* o_storedArrays,
+         std::vector<char>& o_headerBytes,
+         std::vector<size_t>& o_arrayOffsets,
+         size_t& o_size);
+
+private:
+  util::MappedFileConstShPtr m_file;
+  const char* m_data;     /**< Beginning of the state file in the mapped file. */
+  size_t m_size;
+  Parameters m_rodParameters;
+  WorkspaceIntegratedState::IntegrationOptions m_integrationOptions;
+  bool m_isStable;
+  double m_conjugatePointT;
+  size_t m_numIntegratedNodes;
+  Wrench m_baseWrench;
+  Displacement m_base;
+  size_t m_numStoredNodes;
+  std::vector<size_t> m_outputNodes;
+  NodesEncodingT m_nodesEncoding;
+  std::vector<size_t> m_arrayOffsets;   /**< Byte offset of each array, 0 if not stored. */
+};
+
+}  // namespace rod3d
+}  // namespace qserl
+
+#endif // QSERL_3D_STATE_FILE_H_
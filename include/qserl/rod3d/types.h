@@ -41,6 +41,20 @@ typedef std::vector<Displacement, Eigen::aligned_allocator<Displacement> > Displ
 
 typedef std::vector<Matrix6d    , Eigen::aligned_allocator<Matrix6d    > > Matrices6d;
 
+/** \brief Structure of arrays of node positions: row k holds the k-th coordinate of each node. */
+typedef Eigen::Matrix<double, 3, Eigen::Dynamic, Eigen::RowMajor> PositionsSoA;
+
+/** \brief Structure of arrays of node rotations: row 3 * j + i holds the coefficient (i, j) of each node
+* rotation matrix. */
+typedef Eigen::Matrix<double, 9, Eigen::Dynamic, Eigen::RowMajor> RotationsSoA;
+
+/** \brief Structure of arrays of node rotations as quaternions: rows hold the x, y, z and w coefficients
+* (i.e. Eigen::Quaterniond::coeffs() order). */
+typedef Eigen::Matrix<double, 4, Eigen::Dynamic, Eigen::RowMajor> QuaternionsSoA;
+
+/** \brief Structure of arrays of 6x6 matrices: row 6 * j + i holds the coefficient (i, j) of each matrix. */
+typedef Eigen::Matrix<double, 36, Eigen::Dynamic, Eigen::RowMajor> Matrices6dSoA;
+
 }  // namespace rod3d
 }  // namespace qserl
 
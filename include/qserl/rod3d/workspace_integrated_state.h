@@ -22,11 +22,15 @@
 #include "qserl/exports.h"
 
 #include <array>
+#include <vector>
 
 #include "qserl/rod3d/types.h"
 #include "qserl/rod3d/workspace_state.h"
 #include "qserl/rod3d/parameters.h"
+#include "qserl/util/array_view.h"
+#include "qserl/util/copy_on_write.h"
 #include "qserl/util/forward_class.h"
+#include "qserl/util/integration_stats.h"
 
 namespace qserl {
 namespace rod3d {
@@ -43,9 +47,36 @@ public:
     IR_SINGULAR,                          /**< The rod configuration is singular, i.e. a[1] = a[2] = 0. */
     IR_UNSTABLE,                          /**< The rod configuration is unstable. */
     IR_OUT_OF_WRENCH_BOUNDS,              /**< The rod configuration is out of maximum allowed wrench. */
+    IR_INVALID_OPTIONS,                   /**< The integration options, or the caller buffers given to integrateInto(),
+                                               are invalid. Nothing is integrated nor written. */
     IR_NUMBER_OF_INTEGRATION_RESULTS
   };
 
+  /**< \brief Floating point precision of the integration. Integrated values are stored in double precision
+  * in any case. */
+  enum IntegrationPrecisionT
+  {
+    IP_DOUBLE = 0,                        /**< Costate, state and Jacobians are integrated in double precision. */
+    IP_FLOAT,                             /**< Costate, state and Jacobians are integrated in single precision. */
+    IP_MIXED,                             /**< Costate and state are integrated in double precision, the M and J
+                                               matrices in single precision. */
+    IP_NUMBER_OF_INTEGRATION_PRECISIONS
+  };
+
+  /**
+  * \brief Caller provided buffers the integration outputs are directly written into, see integrateInto().
+  * Each view holds one element per stored node (see IntegrationOptions::outputNodes), each element being
+  * stored in column major order. Empty views are not written.
+  */
+  struct IntegrationOutputs
+  {
+    util::StridedView<double> nodes;    /**< Node positions, in base frame (16 scalars per element). */
+    util::StridedView<double> mu;       /**< Wrenches (6 scalars per element). */
+    util::StridedView<double> M;        /**< M matrices (36 scalars per element). */
+    util::StridedView<double> J;        /**< J matrices (36 scalars per element). */
+    util::StridedView<double> J_det;    /**< Jacobian determinants (1 scalar per element). */
+  };
+
   /**
   * \brief Destructor.
   */
@@ -63,12 +94,14 @@ public:
 
   /**
   * \brief Copy constructor.
+  * The per node buffers (nodes, wrenches, matrices, structures of arrays, checkpoints) are shared with the copy,
+  * and only copied when one of the states writes them, e.g. when it is integrated again.
   */
   static WorkspaceIntegratedStateShPtr
   createCopy(const WorkspaceIntegratedStateConstShPtr& i_other);
 
   /**
-  * \brief Returns a copy of itself.
+  * \brief Returns a copy of itself, sharing its per node buffers (see createCopy()).
   */
   virtual WorkspaceStateShPtr
   clone() const;
@@ -76,17 +109,50 @@ public:
   /**
   * \brief Compute rod state from its base wrench by integration.
   * \return The corresponding integration result status (see enum IntegrationResultT).
-  *	Note that IR_OUT_OF_WRENCH_BOUNDS cannot be returned, as out of bounds detection for internal
-  * rod wrenches is not implemented yet.
+  *	Note that IR_OUT_OF_WRENCH_BOUNDS cannot be returned, as internal rod wrenches are only checked
+  * by integrateWhileValid().
   */
   IntegrationResultT
   integrate();
 
+  /**
+  * \brief Compute rod state from its base wrench by integration until invalid point is found.
+  * Only the valid prefix of the rod is kept, i.e. nodes() (and the optionally kept mu values, M and J matrices
+  * and J determinants) only contain nodes up to the last valid one, while numNodes() remains the number of
+  * nodes of the whole rod discretization.
+  * The stop_if_unstable integration option is ignored, as integration always stops at the first invalid node.
+  * \param[in] i_maxWrench Maximum absolute value of each component of the wrench allowed along the rod.
+  * If exceeded, the function will return IR_OUT_OF_WRENCH_BOUNDS.
+  * \param[out] o_tinv Integration time point of invalidity. If the resulting configuration is unstable, this is the
+  * conjugate point located as in conjugatePointT() and the function returns IR_UNSTABLE. If wrench bounds are
+  * exceeded, this is the time of the last valid node. Negative if the whole rod is valid.
+  * \return The corresponding integration result status depending on the type of the A_free space boundary reached.
+  */
+  IntegrationResultT
+  integrateWhileValid(const Wrench& i_maxWrench,
+                      double& o_tinv);
+
   /** \brief Integrates rod state from given base wrench..
       Numerical integration is done through a 4-th order Runge-Kutta with constant step. */
   IntegrationResultT
   integrateFromBaseWrenchRK4(const Wrench& i_wrench);
 
+  /**
+  * \brief Integrates rod state from given base wrench as integrateFromBaseWrenchRK4(), but writes the outputs
+  * directly into given caller buffers instead of the internal storage, which is left empty (apart from the
+  * base wrench). Nothing is allocated, apart from the output node selection the first time it is used.
+  * Stability (see isStable() and conjugatePointT()) is computed as usual.
+  * The size of each non empty view must be the number of stored nodes, and its stride at least the size of its
+  * elements. Checkpoints and structures of arrays integration options must be disabled. Otherwise nothing is
+  * written, the state is left not integrated and IR_INVALID_OPTIONS is returned.
+  * Views may be interleaved in a same buffer, but the caller must ensure that their elements do not overlap,
+  * which is not checked.
+  * \warning If the configuration is singular, outputs are not written.
+  */
+  IntegrationResultT
+  integrateInto(const Wrench& i_wrench,
+                const IntegrationOutputs& i_outputs);
+
 
   /**
   *\brief Approximate nodes positions by linearization for a neighboring state of this.
@@ -120,6 +186,16 @@ public:
   bool
   isStable() const;
 
+  /**
+  * \brief Returns the integration time point of the first conjugate point found along the rod, i.e. where
+  * det(J(t)) vanishes, or a negative value if no conjugate point was found.
+  * The conjugate point is located within the integration step where instability is detected, up to the
+  * IntegrationOptions::conjugatePointTolerance accuracy.
+  * \pre Rod must be initialized.
+  */
+  double
+  conjugatePointT() const;
+
   /**
   * \brief Returns the wrench at the rod base.
   * \note This is equivalent to access through mu()[0]
@@ -138,10 +214,29 @@ public:
 
   /**
   * \brief Returns the wrench at the rod given node.
+  * \pre The node is stored, see IntegrationOptions::outputNodes, or checkpoints are enabled.
+  * \throw std::out_of_range if the node is not stored.
+  * \warning With checkpoints (see IntegrationOptions::checkpointInterval), the wrench is recomputed if its
+  * segment of nodes is not cached, and this accessor is not thread safe.
   */
   Wrench
   wrench(size_t i_idxNode) const;
 
+  /**
+  * \brief Returns the position of the given node, in the rod base frame.
+  * Unlike nodes()[i_nodeIdx], this is valid whatever the output selection (see IntegrationOptions::outputNodes).
+  * \throw std::out_of_range if the node is not stored.
+  */
+  const Displacement&
+  node(size_t i_nodeIdx) const;
+
+  /**
+  * \brief Returns the sorted indices of the stored nodes, i.e. the node index of each element of nodes(), mu()
+  * (if kept), J_det(), ..., or an empty vector if all nodes are stored.
+  */
+  const std::vector<size_t>&
+  outputNodes() const;
+
   /**
   * \brief Const accessor to the wrenches (costate) of the rod for each node.
   *   \warning Only accessible if the keepMuValues() has been set to true,
@@ -150,20 +245,26 @@ public:
   const Wrenches&
   mu() const;
 
-  /** \brief Returns the M matrix (i.e. dmu(t) / dmu(0) ).
-  *   \warning Only accessible if the keepMMatrices integration option has been set to true.
+  /** \brief Returns the M matrix (i.e. dmu(t) / dmu(0) ) at given node.
+  *   \warning Only accessible if the keepMMatrices integration option has been set to true, and if the node
+  *   is stored or checkpoints are enabled. With checkpoints, the returned reference is only valid until
+  *   the segments cache evicts it, i.e. after a few lazy accesses to other segments (see wrench()).
+  *   \throw std::out_of_range if the node is not stored.
   */
   const Matrix6d&
   getMMatrix(size_t i_nodeIdx) const;
 
-  /** \brief Returns the J matrix (i.e. dq(t) / dmu(0) ).
-  *   \warning Only accessible if the keepJMatrices integration option has been set to true.
+  /** \brief Returns the J matrix (i.e. dq(t) / dmu(0) ) at given node.
+  *   \warning Only accessible if the keepJMatrices integration option has been set to true, and if the node
+  *   is stored or checkpoints are enabled. With checkpoints, the returned reference is only valid until
+  *   the segments cache evicts it (see getMMatrix()).
+  *   \throw std::out_of_range if the node is not stored.
   */
   const Matrix6d&
   getJMatrix(size_t i_nodeIdx) const;
 
   /**
-  * \brief Returns the values for each node of the jacobian determinant.
+  * \brief Returns the values for each stored node of the jacobian determinant.
   * \warning If the DLO is detected as unstable, the determinant will be 0 from
   * the instability point.
   * \warning Only accessible if the keepJdet() has been set to true.
@@ -174,12 +275,44 @@ public:
   /**
   * \brief Const accessor to Jacobian linear speed part nu singular values.
   * \warning Only accessible if the computeJacobianNuSingularValues() has been set to true.
+  * \throw std::out_of_range if the node is not stored.
   */
   const Eigen::Vector3d&
   J_nu_sv(size_t i_nodeIdx) const;
 
+  /**
+  * \brief Const accessor to the stored nodes positions, as a 3 x N structure of arrays.
+  * \warning Only accessible if the keepPositionsSoA integration option has been set to true.
+  */
+  const PositionsSoA&
+  positionsSoA() const;
+
+  /**
+  * \brief Const accessor to the stored nodes rotation matrices, as a 9 x N structure of arrays.
+  * \warning Only accessible if the keepRotationsSoA integration option has been set to true.
+  */
+  const RotationsSoA&
+  rotationsSoA() const;
+
+  /**
+  * \brief Const accessor to the stored nodes rotations as quaternions, as a 4 x N structure of arrays.
+  * \warning Only accessible if the keepQuaternionsSoA integration option has been set to true.
+  */
+  const QuaternionsSoA&
+  quaternionsSoA() const;
+
+  /**
+  * \brief Const accessor to the stored nodes J matrices, as a 36 x N structure of arrays.
+  * \warning Only accessible if the keepJSoA integration option has been set to true.
+  */
+  const Matrices6dSoA&
+  JSoA() const;
+
   /**
   * \brief Returns the memory usage of this instance.
+  * Buffers shared with copies of the state are counted in full by each of them, as each copy keeps them alive
+  * (e.g. an IntegrationCache entry is charged for the buffers it holds, whatever the copies handed out). The
+  * memory usage of a set of copies is thus overestimated by summing theirs.
   */
   size_t
   memUsage() const;
@@ -201,6 +334,32 @@ public:
     bool keepJdet;
     bool keepMMatrices;
     bool keepJMatrices;
+    double conjugatePointTolerance;   /**< Accuracy of the conjugate point location (see conjugatePointT()).
+                                              If 0, the conjugate point is located at the node where instability
+                                              is detected. Default is 1e-9. */
+    IntegrationPrecisionT precision;  /**< Floating point precision of the integration. Single and mixed
+                                              precisions are faster but less accurate, especially the stability
+                                              of configurations close to a conjugate point. Default is IP_DOUBLE. */
+    std::vector<size_t> outputNodes;  /**< Indices of the nodes to store (node positions, and the kept mu values,
+                                              M and J matrices, J determinants and singular values), the base
+                                              node 0 being stored in any case. If empty, see outputStride.
+                                              The rod is still integrated (and its stability checked) at the
+                                              full resolution. Indices must be lower than the number of nodes,
+                                              otherwise integrations return IR_INVALID_OPTIONS. Default is
+                                              empty. */
+    size_t outputStride;              /**< If outputNodes is empty, only every outputStride-th node is stored,
+                                              as well as the tip node. Default is 1, i.e. all nodes. */
+    bool keepPositionsSoA;            /**< True if the stored nodes positions should also be written by the
+                                              integration as a structure of arrays (see positionsSoA()). */
+    bool keepRotationsSoA;            /**< Same as keepPositionsSoA for the rotation matrices. */
+    bool keepQuaternionsSoA;          /**< Same as keepPositionsSoA for the rotations as quaternions. */
+    bool keepJSoA;                    /**< Same as keepPositionsSoA for the J matrices, which are then stored
+                                              even with checkpoints. */
+    size_t checkpointInterval;        /**< If non zero, the kept mu values, M and J matrices are not stored but
+                                              recomputed on access (see wrench(), getMMatrix() and getJMatrix())
+                                              by integrating again from the full state, stored every
+                                              checkpointInterval nodes. mu() then only holds the base wrench and
+                                              J_nu_sv() is not available. Default is 0, i.e. disabled. */
   };
 
   /**
@@ -216,8 +375,18 @@ public:
   const IntegrationOptions&
   integrationOptions() const;
 
+  /**
+  * \brief Returns the statistics of the last integration.
+  * Statistics are only collected if the library is built with QSERL_ENABLE_STATS (see util::IntegrationStats).
+  */
+  const util::IntegrationStats&
+  integrationStats() const;
+
 protected:
 
+  friend class WorkspaceIntegratedStatePool;
+  friend class StateFile;
+
   /**
   \brief Constructor
   */
@@ -231,16 +400,165 @@ protected:
   bool
   init(const Wrench& i_wrench);
 
+  /**
+  * \brief Clears the outputs and the statistics of the last integration, so that a recycled state does not expose
+  * them (see WorkspaceIntegratedStatePool). The per node buffers keep their storage if they are not shared, the
+  * structures of arrays are released.
+  */
+  void
+  clearOutputs();
+
+  /**
+  * \brief Selects the stored nodes from the integration options.
+  * \return The number of stored nodes, 0 if the requested output nodes are invalid.
+  */
+  size_t
+  selectOutputNodes();
+
+  /**
+  * \brief Returns the index of given node in the stored outputs.
+  * \throw std::out_of_range if the node is not in the output selection.
+  */
+  size_t
+  outputIndex(size_t i_nodeIdx) const;
+
+  /**
+  * \brief Returns true if given caller buffers can hold the outputs of given number of stored nodes, and if the
+  * integration options can be used with caller buffers.
+  */
+  bool
+  areValidOutputs(const IntegrationOutputs& i_outputs,
+                  size_t i_numOutputs) const;
+
+  /**
+  * \brief Resizes the kept structures of arrays to given number of stored nodes.
+  * \param i_keepValues True if the values of the first stored nodes must be kept.
+  */
+  void
+  resizeSoA(size_t i_numOutputs,
+            bool i_keepValues);
+
+  /**
+  * \brief Writes the kept structures of arrays of given stored node, from its position and given J matrix.
+  */
+  template<typename JacobianT>
+  void
+  storeSoA(size_t i_idxOutput,
+           const JacobianT& i_J);
+
+  /**
+  * \brief Integrates rod state from given base wrench, into given caller buffers if not null.
+  */
+  IntegrationResultT
+  integrateFromBaseWrench(const Wrench& i_wrench,
+                          const IntegrationOutputs* i_outputs);
+
+  /**
+  * \brief Integrates rod state from given base wrench with given full system, i.e. in its precision.
+  */
+  template<typename FullSystemT>
+  IntegrationResultT
+  integrateRK4(const Wrench& i_wrench,
+               double i_dt,
+               const IntegrationOutputs* i_outputs = nullptr);
+
+  /**
+  * \brief Writes the outputs of given stored node from given full state into given caller buffers.
+  */
+  template<typename FullSystemT>
+  static void
+  writeOutputs(const IntegrationOutputs& i_outputs,
+               size_t i_idxOutput,
+               const typename FullSystemT::state_type& i_x,
+               double i_det);
+
+  /**
+  * \brief Integrates rod state from its base wrench until invalid point is found with given full system,
+  * i.e. in its precision.
+  */
+  template<typename FullSystemT>
+  IntegrationResultT
+  integrateWhileValidRK4(const Wrench& i_maxWrench,
+                         double i_dt,
+                         double& o_tinv);
+
+  static const size_t kFullStateSize = 94;      /**< Size of the full integrated state: costate mu (6), state q
+                                                     (16), M and J matrices (2 x 36). */
+  static const size_t kNumLazySegments = 4;     /**< Number of recomputed segments kept in cache. */
+
+  /**
+  * \brief Full integrated state at a checkpoint node, stored in double precision whatever the integration
+  * precision.
+  */
+  struct Checkpoint
+  {
+    std::array<double, kFullStateSize> x;   /**< Costate and state, then M and J matrices. */
+    double t;                               /**< Integration time of the checkpoint node. */
+  };
+
+  /**
+  * \brief Recomputed wrenches, M and J matrices of the nodes following a checkpoint.
+  */
+  struct LazySegment
+  {
+    size_t checkpointIdx;
+    size_t lastUse;           /**< Access clock of the last use, 0 if the segment is not computed. */
+    Wrenches mu;
+    Matrices6d M;
+    Matrices6d J;
+  };
+
+  /**
+  * \brief Clears the checkpoints and the segments cache.
+  * \return The checkpoint interval, 0 if checkpoints are disabled.
+  */
+  size_t
+  resetCheckpoints();
+
+  /**
+  * \brief Stores given full state as a checkpoint.
+  */
+  template<typename FullSystemT>
+  void
+  saveCheckpoint(const typename FullSystemT::state_type& i_x,
+                 double i_t);
+
+  /**
+  * \brief Returns the recomputed segment containing given node, from the segments cache if possible.
+  */
+  const LazySegment&
+  lazySegment(size_t i_nodeIdx) const;
+
+  /**
+  * \brief Integrates again the nodes following given checkpoint with given full system.
+  */
+  template<typename FullSystemT>
+  void
+  recomputeSegment(size_t i_checkpointIdx,
+                   LazySegment& o_segment) const;
+
   bool m_isInitialized;/**< True if the state has been integrated.*/
   bool m_isStable;    /**< True if DLO state is stable. */
-  Wrenches m_mu;          /**< Wrenches at each nodes (size N). */
-  Matrices6d m_M;
-  Matrices6d m_J;
-
-  std::vector<double> m_J_det;
-  std::vector<Eigen::Vector3d> m_J_nu_sv;      /**< Singular values of the linear speed nu part of the Jacobian matrix. */
+  double m_conjugatePointT;   /**< Integration time point of the first conjugate point, negative if none. */
+  // per node buffers are shared with the copies of the state until written
+  util::CopyOnWrite<Wrenches> m_mu;          /**< Wrenches at each nodes (size N). */
+  util::CopyOnWrite<Matrices6d> m_M;
+  util::CopyOnWrite<Matrices6d> m_J;
+
+  util::CopyOnWrite<std::vector<double> > m_J_det;
+  util::CopyOnWrite<std::vector<Eigen::Vector3d> > m_J_nu_sv;  /**< Singular values of the linear speed nu part of the Jacobian matrix. */
+  std::vector<size_t> m_outputNodes;  /**< Indices of the stored nodes, empty if all nodes are stored. */
+  util::CopyOnWrite<PositionsSoA> m_positionsSoA;        /**< Stored nodes positions, if kept. */
+  util::CopyOnWrite<RotationsSoA> m_rotationsSoA;        /**< Stored nodes rotation matrices, if kept. */
+  util::CopyOnWrite<QuaternionsSoA> m_quaternionsSoA;    /**< Stored nodes rotations as quaternions, if kept. */
+  util::CopyOnWrite<Matrices6dSoA> m_JSoA;               /**< Stored nodes J matrices, if kept. */
+  util::CopyOnWrite<std::vector<Checkpoint> > m_checkpoints;  /**< Full states every checkpointInterval nodes, if enabled. */
+  size_t m_numIntegratedNodes;        /**< Number of (valid) integrated nodes. */
+  mutable std::array<LazySegment, kNumLazySegments> m_lazySegments;   /**< LRU cache of recomputed segments. */
+  mutable size_t m_lazyClock;
 
   IntegrationOptions m_integrationOptions;
+  util::IntegrationStats m_stats;  /**< Statistics of the last integration. */
 };
 
 }  // namespace rod3d
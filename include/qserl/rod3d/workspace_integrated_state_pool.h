@@ -0,0 +1,144 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_3D_WORKSPACE_INTEGRATED_STATE_POOL_H_
+#define QSERL_3D_WORKSPACE_INTEGRATED_STATE_POOL_H_
+
+#include "qserl/exports.h"
+
+#include <mutex>
+#include <vector>
+
+#include "qserl/rod3d/parameters.h"
+#include "qserl/rod3d/types.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/forward_class.h"
+
+namespace qserl {
+namespace rod3d {
+
+DECLARE_CLASS(WorkspaceIntegratedStatePool);
+
+/**
+* \brief Thread safe pool of integrated states of a given rod.
+* States handed out by acquire() go back to the pool when their last shared pointer is released, instead of
+* being deleted, and are recycled with their storage. The shared pointers control blocks are recycled as well,
+* so creating and discarding states in bulk (e.g. in a planner) does not allocate in steady state.
+* The pool is kept alive by the states it handed out.
+*/
+class QSERL_EXPORT WorkspaceIntegratedStatePool
+{
+public:
+
+  /**
+  * \brief Constructor.
+  * \param i_nnodes Number of nodes of the pooled states.
+  * \param i_rodParams Static parameters of the pooled states.
+  */
+  static WorkspaceIntegratedStatePoolShPtr
+  create(unsigned int i_nnodes,
+         const Parameters& i_rodParams);
+
+  /**
+  * \brief Destructor. Deletes the free states.
+  */
+  ~WorkspaceIntegratedStatePool();
+
+  /**
+  * \brief Returns a state initialized as WorkspaceIntegratedState::create() does, i.e. not integrated yet and
+  * with default integration options, recycled from the pool if possible.
+  * Recycled states hold no data of their previous user: nodes, wrenches, matrices, checkpoints, output selection,
+  * conjugate point and statistics are cleared, only the storage of their per node buffers is kept.
+  */
+  WorkspaceIntegratedStateShPtr
+  acquire(const Wrench& i_baseWrench,
+          const Displacement& i_basePosition);
+
+  /**
+  * \brief Creates free states until given number of states is reached, so that as many states can be
+  * acquired without allocating them.
+  */
+  void
+  reserve(size_t i_numStates);
+
+  /**
+  * \brief Returns the number of states in the pool, i.e. not currently acquired.
+  */
+  size_t
+  numFreeStates() const;
+
+  /**
+  * \brief Returns the number of states created by the pool.
+  */
+  size_t
+  numStates() const;
+
+protected:
+
+  /**
+  \brief Constructor
+  */
+  WorkspaceIntegratedStatePool(unsigned int i_nnodes,
+                               const Parameters& i_rodParams);
+
+  /**
+  \brief Init function
+  \param i_weakPtr The weak pointer to the pool.
+  */
+  bool
+  init(const WorkspaceIntegratedStatePoolWkPtr& i_weakPtr);
+
+  /**
+  * \brief Puts back given state into the pool.
+  */
+  void
+  release(WorkspaceIntegratedState* io_state);
+
+  /**
+  * \brief Allocates a shared pointer control block of given size, recycled if possible.
+  */
+  void*
+  allocateBlock(size_t i_size);
+
+  /**
+  * \brief Puts back given shared pointer control block of given size into the pool.
+  */
+  void
+  deallocateBlock(void* i_block,
+                  size_t i_size);
+
+private:
+  template<typename T>
+  class BlockAllocator;
+  struct Releaser;
+
+  WorkspaceIntegratedStatePoolWkPtr m_weakPtr;
+  unsigned int m_numNodes;
+  Parameters m_rodParameters;
+  mutable std::mutex m_mutex;
+  std::vector<WorkspaceIntegratedState*> m_freeStates;
+  std::vector<void*> m_freeBlocks;    /**< Free control blocks, all of size m_blockSize. */
+  size_t m_blockSize;                 /**< Size of the control blocks, 0 until the first one is allocated. */
+  size_t m_numStates;
+};
+
+}  // namespace rod3d
+}  // namespace qserl
+
+#endif // QSERL_3D_WORKSPACE_INTEGRATED_STATE_POOL_H_
@@ -24,6 +24,7 @@
 
 #include "qserl/rod3d/types.h"
 #include "qserl/rod3d/parameters.h"
+#include "qserl/util/copy_on_write.h"
 #include "qserl/util/forward_class.h"
 
 namespace qserl {
@@ -53,6 +54,7 @@ public:
 
   /**
   * \brief Returns a copy of itself.
+  * The nodes are shared with the copy until one of them is integrated again.
   */
   virtual WorkspaceStateShPtr
   clone() const;
@@ -70,6 +72,27 @@ public:
   const Displacements&
   nodes() const;
 
+  /**
+  * \brief Exports the rod nodes positions, in <b>base</b> frame, as a structure of arrays.
+  * \param o_positions 3 x numNodes matrix, resized if needed.
+  */
+  void
+  exportPositions(PositionsSoA& o_positions) const;
+
+  /**
+  * \brief Exports the rod nodes rotation matrices, in <b>base</b> frame, as a structure of arrays.
+  * \param o_rotations 9 x numNodes matrix, resized if needed.
+  */
+  void
+  exportRotations(RotationsSoA& o_rotations) const;
+
+  /**
+  * \brief Exports the rod nodes rotations as quaternions, in <b>base</b> frame, as a structure of arrays.
+  * \param o_quaternions 4 x numNodes matrix, resized if needed.
+  */
+  void
+  exportQuaternions(QuaternionsSoA& o_quaternions) const;
+
   /**
   * \brief Accessor to rod base position (in world frame).
   */
@@ -130,7 +153,7 @@ protected:
                  const Parameters& i_rodParams);
 
   size_t m_numNodes;    /**< Number of nodes N. */
-  Displacements m_nodes;      /**< Position of each node (size N), in base frame. */
+  util::CopyOnWrite<Displacements> m_nodes;   /**< Position of each node (size N), in base frame. */
   Displacement m_base;        /**< DLO base position, in world frame (absolute). */
 
   Parameters m_rodParameters;
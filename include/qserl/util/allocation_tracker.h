@@ -0,0 +1,190 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/**
+* \file allocation_tracker.h
+* \brief Heap allocation accounting.
+* Allocations are counted by hooks replacing the allocation functions of the process, which are linked in test and
+* benchmark executables only (see src/util/allocation_hooks.cc). Allocations are counted per thread, and attributed
+* to the library functions declared with QSERL_ALLOCATION_SCOPE("name"), which are compiled out unless
+* QSERL_ENABLE_ALLOCATION_TRACKING is defined.
+*/
+
+#ifndef QSERL_UTIL_ALLOCATION_TRACKER_H_
+#define QSERL_UTIL_ALLOCATION_TRACKER_H_
+
+#include "qserl/exports.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Number of heap allocations and allocated bytes.
+*/
+struct AllocationCounts
+{
+  uint64_t count;
+  uint64_t bytes;
+};
+
+inline AllocationCounts
+operator-(const AllocationCounts& i_lhs,
+          const AllocationCounts& i_rhs)
+{
+  AllocationCounts res = {i_lhs.count - i_rhs.count, i_lhs.bytes - i_rhs.bytes};
+  return res;
+}
+
+/**
+* \brief Allocations of an API declared with QSERL_ALLOCATION_SCOPE, merged over all threads.
+* Counts are inclusive, i.e. include the allocations of nested APIs.
+*/
+struct AllocationReport
+{
+  std::string name;
+  uint64_t calls;
+  AllocationCounts allocations;
+};
+
+/**
+* \brief Process wide heap allocation accounting.
+*/
+class QSERL_EXPORT AllocationTracker
+{
+public:
+  struct Api;
+
+  /**
+  * \brief Returns true if the allocation hooks are linked in the executable, i.e. if allocations are counted.
+  */
+  static bool
+  isEnabled();
+
+  /**
+  * \brief Returns true if the library was compiled with QSERL_ENABLE_ALLOCATION_TRACKING, i.e. if allocations are
+  * attributed to the library APIs.
+  */
+  static bool
+  isPerApiEnabled();
+
+  /**
+  * \brief Returns the allocations made by the calling thread since its start.
+  */
+  static AllocationCounts
+  threadCounts();
+
+  /**
+  * \brief Returns the allocations of all APIs called at least once, sorted by name.
+  */
+  static std::vector<AllocationReport>
+  report();
+
+  /**
+  * \brief Prints the report as a table.
+  */
+  static void
+  printReport(std::ostream& io_os);
+
+  /**
+  * \brief Clears the counts of all APIs.
+  */
+  static void
+  reset();
+
+  /**
+  * \brief Returns the API of given name, registering it on first call.
+  * \param i_name API name, must outlive the tracker (i.e. a string literal).
+  */
+  static Api*
+  api(const char* i_name);
+
+  /**
+  * \brief Enters given API on the calling thread.
+  * \return false if the API was already entered, e.g. on recursive calls, in which case it is not counted again.
+  */
+  static bool
+  enter(Api* i_api);
+
+  /**
+  * \brief Leaves the last API entered on the calling thread, if enter() returned true.
+  */
+  static void
+  leave(bool i_entered);
+
+  /**
+  * \brief Counts an allocation of the calling thread. Called by the allocation hooks, must not allocate.
+  */
+  static void
+  recordAllocation(std::size_t i_size);
+
+  /**
+  * \brief Called by the allocation hooks on startup.
+  */
+  static void
+  setEnabled();
+};
+
+/**
+* \brief Attributes the allocations made during its scope to an API.
+*/
+class AllocationScope
+{
+public:
+  explicit AllocationScope(AllocationTracker::Api* i_api) :
+      m_entered(AllocationTracker::enter(i_api))
+  {
+  }
+
+  ~AllocationScope()
+  {
+    AllocationTracker::leave(m_entered);
+  }
+
+  AllocationScope(const AllocationScope&) = delete;
+
+  AllocationScope&
+  operator=(const AllocationScope&) = delete;
+
+private:
+  bool m_entered;
+};
+
+} // namespace util
+} // namespace qserl
+
+#define QSERL_ALLOCATION_CONCAT_IMPL(a, b) a##b
+#define QSERL_ALLOCATION_CONCAT(a, b) QSERL_ALLOCATION_CONCAT_IMPL(a, b)
+
+#ifdef QSERL_ENABLE_ALLOCATION_TRACKING
+# define QSERL_ALLOCATION_SCOPE(name) \
+  static ::qserl::util::AllocationTracker::Api* const QSERL_ALLOCATION_CONCAT(qserlAllocationApi, __LINE__) = \
+      ::qserl::util::AllocationTracker::api(name); \
+  ::qserl::util::AllocationScope QSERL_ALLOCATION_CONCAT(qserlAllocationScope, __LINE__)( \
+      QSERL_ALLOCATION_CONCAT(qserlAllocationApi, __LINE__))
+#else
+# define QSERL_ALLOCATION_SCOPE(name)
+#endif
+
+#endif // QSERL_UTIL_ALLOCATION_TRACKER_H_
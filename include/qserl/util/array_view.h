@@ -0,0 +1,159 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_UTIL_ARRAY_VIEW_H_
+#define QSERL_UTIL_ARRAY_VIEW_H_
+
+#include <cassert>
+#include <cstddef>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Non owning view over a contiguous array of elements.
+*/
+template<typename T>
+class ArrayView
+{
+public:
+  ArrayView() :
+      m_data(nullptr),
+      m_size(0)
+  {
+  }
+
+  ArrayView(T* i_data,
+            size_t i_size) :
+      m_data(i_data),
+      m_size(i_size)
+  {
+  }
+
+  T*
+  data() const
+  {
+    return m_data;
+  }
+
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+  T&
+  operator[](size_t i_idx) const
+  {
+    assert(i_idx < m_size && "index out of bounds");
+    return m_data[i_idx];
+  }
+
+  T*
+  begin() const
+  {
+    return m_data;
+  }
+
+  T*
+  end() const
+  {
+    return m_data + m_size;
+  }
+
+private:
+  T* m_data;
+  size_t m_size;
+};
+
+/**
+* \brief Non owning view over an array of elements made of several contiguous scalars, with a constant
+* stride (in scalars) between the first scalars of consecutive elements.
+* E.g. a view over the 4x4 displacements of N nodes in a caller buffer of N x 16 doubles has a stride of 16.
+*/
+template<typename T>
+class StridedView
+{
+public:
+  StridedView() :
+      m_data(nullptr),
+      m_size(0),
+      m_stride(0)
+  {
+  }
+
+  StridedView(T* i_data,
+              size_t i_size,
+              std::ptrdiff_t i_stride) :
+      m_data(i_data),
+      m_size(i_size),
+      m_stride(i_stride)
+  {
+  }
+
+  T*
+  data() const
+  {
+    return m_data;
+  }
+
+  /** \brief Returns the number of elements. */
+  size_t
+  size() const
+  {
+    return m_size;
+  }
+
+  /** \brief Returns the number of scalars between the first scalars of consecutive elements. */
+  std::ptrdiff_t
+  stride() const
+  {
+    return m_stride;
+  }
+
+  bool
+  empty() const
+  {
+    return m_size == 0;
+  }
+
+  /** \brief Returns a pointer to the first scalar of given element. */
+  T*
+  element(size_t i_idx) const
+  {
+    assert(i_idx < m_size && "index out of bounds");
+    return m_data + static_cast<std::ptrdiff_t>(i_idx) * m_stride;
+  }
+
+private:
+  T* m_data;
+  size_t m_size;
+  std::ptrdiff_t m_stride;
+};
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_ARRAY_VIEW_H_
@@ -0,0 +1,180 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+
+#ifndef QSERL_UTIL_COPY_ON_WRITE_H_
+#define QSERL_UTIL_COPY_ON_WRITE_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Value shared between copies until one of them is written.
+* Copying costs a reference count increment. Write accesses go through mutate() or overwrite(), which make the
+* value unique to this instance first. Read accesses of shared values from several threads are safe, and so are
+* writes to distinct instances sharing a value, including an instance written while the other copies of its value
+* are released by other threads; as for any value, an instance must not be written while read or copied.
+* A default constructed instance holds a default constructed value, allocated on the first write.
+*/
+template<typename T>
+class CopyOnWrite
+{
+public:
+  CopyOnWrite() :
+      m_value()
+  {
+  }
+
+  explicit CopyOnWrite(const T& i_value) :
+      m_value(std::make_shared<T>(i_value))
+  {
+  }
+
+  /** \brief Read access to the value. */
+  const T&
+  get() const
+  {
+    static const T s_defaultValue{};
+    return m_value ? *m_value : s_defaultValue;
+  }
+
+  /** \brief Write access to the value, copied first if it is shared. */
+  T&
+  mutate()
+  {
+    if(!m_value)
+    {
+      m_value = std::make_shared<T>();
+    }
+    else if(!isUnique())
+    {
+      m_value = std::make_shared<T>(*m_value);
+    }
+    return *m_value;
+  }
+
+  /**
+  * \brief Write access to the value, for callers about to overwrite it entirely.
+  * A shared value is not copied but replaced by a default constructed one, so the contents are unspecified.
+  */
+  T&
+  overwrite()
+  {
+    if(!m_value || !isUnique())
+    {
+      m_value = std::make_shared<T>();
+    }
+    return *m_value;
+  }
+
+  /**
+  * \brief Empties the container value, keeping its storage if it is not shared.
+  * A shared value is released rather than copied, and an empty one is not allocated.
+  */
+  void
+  clear()
+  {
+    if(!m_value)
+    {
+      return;
+    }
+    if(isUnique())
+    {
+      m_value->clear();
+    }
+    else
+    {
+      m_value.reset();
+    }
+  }
+
+  /** \brief Returns true if the value is shared with other instances. */
+  bool
+  isShared() const
+  {
+    return m_value && !isUnique();
+  }
+
+  /** \name Read accessors of container values. */
+  /** \{ */
+  size_t
+  size() const
+  {
+    return get().size();
+  }
+
+  bool
+  empty() const
+  {
+    return get().empty();
+  }
+
+  template<typename U = T>
+  auto
+  operator[](size_t i_idx) const -> decltype(std::declval<const U&>()[i_idx])
+  {
+    assert(i_idx < size() && "index out of bounds");
+    return get()[i_idx];
+  }
+
+  template<typename U = T>
+  auto
+  front() const -> decltype(std::declval<const U&>().front())
+  {
+    return get().front();
+  }
+
+  template<typename U = T>
+  auto
+  back() const -> decltype(std::declval<const U&>().back())
+  {
+    return get().back();
+  }
+  /** \} */
+
+private:
+  /**
+  * \brief Returns true if this instance holds the only reference to its value.
+  * use_count() is a relaxed load, so the acquire fence orders the writes which follow after the reads of the
+  * copies released by other threads, whose reference count decrements are release operations.
+  */
+  bool
+  isUnique() const
+  {
+    if(m_value.use_count() != 1)
+    {
+      return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+  }
+
+  std::shared_ptr<T> m_value;
+};
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_COPY_ON_WRITE_H_
@@ -0,0 +1,214 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_UTIL_DATASET_H_
+#define QSERL_UTIL_DATASET_H_
+
+#include "qserl/exports.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+#include "qserl/util/array_view.h"
+#include "qserl/util/forward_class.h"
+#include "qserl/util/mapped_file.h"
+
+namespace qserl {
+namespace util {
+
+DECLARE_CLASS(Dataset);
+DECLARE_CLASS(DatasetWriter);
+
+/**
+* \brief Columns of an A-space dataset.
+* Each column stores a fixed number of scalars per sample:
+* - DC_A: base wrench a (3 for planar rods in TXY order, 6 for 3D rods), double.
+* - DC_STABILITY: integration result code, int32.
+* - DC_ENERGY: total elastic energy, double.
+* - DC_TIP_POSE: rod tip pose, as (x, y, theta) for planar rods or the 4x4 homogeneous matrix
+*   in column major order for 3D rods, double.
+* - DC_TIP_JACOBIAN: Jacobian matrix dq(1)/da in column major order (3x3 or 6x6), double.
+*/
+enum DatasetColumnT
+{
+  DC_A = 0,
+  DC_STABILITY,
+  DC_ENERGY,
+  DC_TIP_POSE,
+  DC_TIP_JACOBIAN,
+  DC_NUMBER_OF_COLUMNS
+};
+
+/**
+* \brief Scalar type of dataset columns.
+*/
+enum DatasetScalarT
+{
+  DS_FLOAT64 = 0,
+  DS_INT32,
+  DS_NUMBER_OF_SCALAR_TYPES
+};
+
+/**
+* \brief Description of a dataset content.
+*/
+struct QSERL_EXPORT DatasetHeader
+{
+  DatasetHeader();
+
+  /**
+  * \brief Returns the dimension of the A-space (3 for planar rods, 6 for 3D rods).
+  */
+  size_t
+  aDimension() const;
+
+  bool
+  hasColumn(DatasetColumnT i_column) const;
+
+  /**
+  * \brief Returns the number of scalars stored per sample in the given column.
+  */
+  size_t
+  columnWidth(DatasetColumnT i_column) const;
+
+  static DatasetScalarT
+  columnScalarType(DatasetColumnT i_column);
+
+  unsigned int rodDimension;            /**< 2 for planar rods, 3 for 3D rods. */
+  size_t numSamples;                    /**< Number of stored samples. */
+  unsigned int columns;                 /**< Bitmask of stored columns, bit k is set if column k is stored. */
+  Eigen::VectorXd gridLowerBounds;      /**< A-space grid lower bounds, empty if samples are not on a grid. */
+  Eigen::VectorXd gridUpperBounds;      /**< A-space grid upper bounds, empty if samples are not on a grid. */
+  std::vector<size_t> gridNumSamples;   /**< Number of grid samples along each axis. */
+  std::string parameters;               /**< Free form description of the rod and integration parameters. */
+};
+
+/**
+* \brief Writes a binary dataset file.
+* The file is created at its final size and mapped in memory, so columns can be filled
+* in place, concurrently for different samples.
+* Binary layout (native byte order):
+* - header: magic "QSERLDS\0", format version, byte order mark, rod dimension, grid dimension,
+*   number of samples, column schema (scalar type, width and byte offset of each column,
+*   offset 0 for absent columns), grid bounds and sample counts, parameters string.
+* - column blocks, each one starting at a 64 bytes aligned offset and storing the column values
+*   of all samples contiguously (sample after sample).
+*/
+class QSERL_EXPORT DatasetWriter
+{
+public:
+
+  /**
+  * \brief Creates the dataset file described by the given header.
+  * \return A null pointer if the file cannot be created.
+  */
+  static DatasetWriterShPtr
+  create(const std::string& i_filename,
+         const DatasetHeader& i_header);
+
+  const DatasetHeader&
+  header() const;
+
+  /**
+  * \brief Returns the values of a floating point column.
+  * Values of sample k are stored at [k * columnWidth, (k + 1) * columnWidth[.
+  * \pre The column is stored and its scalar type is DS_FLOAT64.
+  */
+  ArrayView<double>
+  column(DatasetColumnT i_column);
+
+  /**
+  * \brief Returns the values of the stability column.
+  * \pre The DC_STABILITY column is stored.
+  */
+  ArrayView<int32_t>
+  stabilityColumn();
+
+  /**
+  * \brief Flushes the written values to the disk.
+  * \return false if an error occured.
+  */
+  bool
+  sync();
+
+protected:
+
+  DatasetWriter(const DatasetHeader& i_header);
+
+  bool
+  init(const std::string& i_filename);
+
+private:
+  DatasetHeader m_header;
+  MappedFileShPtr m_file;
+  std::vector<size_t> m_columnOffsets;
+};
+
+/**
+* \brief Read only access to a binary dataset file written by DatasetWriter.
+* The file is mapped in memory and columns are exposed without any copy.
+*/
+class QSERL_EXPORT Dataset
+{
+public:
+
+  /**
+  * \brief Opens the given dataset file.
+  * \return A null pointer if the file cannot be opened or is not a valid dataset.
+  */
+  static DatasetConstShPtr
+  open(const std::string& i_filename);
+
+  const DatasetHeader&
+  header() const;
+
+  /**
+  * \brief Returns the values of a floating point column.
+  * Values of sample k are stored at [k * columnWidth, (k + 1) * columnWidth[.
+  * \pre The column is stored and its scalar type is DS_FLOAT64.
+  */
+  ArrayView<const double>
+  column(DatasetColumnT i_column) const;
+
+  /**
+  * \brief Returns the values of the stability column.
+  * \pre The DC_STABILITY column is stored.
+  */
+  ArrayView<const int32_t>
+  stabilityColumn() const;
+
+protected:
+
+  Dataset();
+
+  bool
+  init(const std::string& i_filename);
+
+private:
+  DatasetHeader m_header;
+  MappedFileConstShPtr m_file;
+  std::vector<size_t> m_columnOffsets;
+};
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_DATASET_H_
@@ -0,0 +1,105 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_UTIL_INTEGRATION_STATS_H_
+#define QSERL_UTIL_INTEGRATION_STATS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Statistics and phase timings of a rod integration or of an inverse kinematics solve.
+* Statistics are only collected if the library is built with QSERL_ENABLE_STATS, otherwise the
+* instrumentation is compiled out and all values remain to zero.
+* Times are wall clock times in nanoseconds.
+*/
+struct IntegrationStats
+{
+  IntegrationStats()
+  {
+    reset();
+  }
+
+  /**
+  * \brief Returns true if statistics are collected, i.e. if the library is built with QSERL_ENABLE_STATS.
+  */
+  static bool
+  isEnabled()
+  {
+#ifdef QSERL_ENABLE_STATS
+    return true;
+#else
+    return false;
+#endif
+  }
+
+  void
+  reset()
+  {
+    numSteps = 0;
+    numRhsEvaluations = 0;
+    rhsTimeNs = 0;
+    determinantTimeNs = 0;
+    svdTimeNs = 0;
+    storageTimeNs = 0;
+    linearSolveTimeNs = 0;
+    totalTimeNs = 0;
+    stabilityThresholdNode = -1;
+    numIterations = 0;
+  }
+
+  /**
+  * \brief Accumulates the statistics of a nested integration into the ones of its caller, e.g. of an inverse
+  * kinematics solve. totalTimeNs is left unchanged as it is measured by the caller, and the stability threshold
+  * node is the one of i_other.
+  */
+  IntegrationStats&
+  operator+=(const IntegrationStats& i_other)
+  {
+    numSteps += i_other.numSteps;
+    numRhsEvaluations += i_other.numRhsEvaluations;
+    rhsTimeNs += i_other.rhsTimeNs;
+    determinantTimeNs += i_other.determinantTimeNs;
+    svdTimeNs += i_other.svdTimeNs;
+    storageTimeNs += i_other.storageTimeNs;
+    linearSolveTimeNs += i_other.linearSolveTimeNs;
+    stabilityThresholdNode = i_other.stabilityThresholdNode;
+    numIterations += i_other.numIterations;
+    return *this;
+  }
+
+  size_t numSteps;              /**< Number of integration steps taken (over all integrated systems). */
+  size_t numRhsEvaluations;     /**< Number of evaluations of the right hand side of integrated systems. */
+  int64_t rhsTimeNs;            /**< Time spent evaluating right hand sides. */
+  int64_t determinantTimeNs;    /**< Time spent computing det(J) for stability checks. */
+  int64_t svdTimeNs;            /**< Time spent computing singular values of J. */
+  int64_t storageTimeNs;        /**< Time spent storing nodes and optionally kept values. */
+  int64_t linearSolveTimeNs;    /**< Time spent decomposing and solving jacobian systems (inverse kinematics). */
+  int64_t totalTimeNs;          /**< Total time. */
+  int stabilityThresholdNode;   /**< Index of the node where det(J) thresholding switched on, -1 if never. */
+  int numIterations;            /**< Number of solver iterations (inverse kinematics). */
+};
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_INTEGRATION_STATS_H_
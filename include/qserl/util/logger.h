@@ -0,0 +1,181 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/**
+* \file logger.h
+* \brief Leveled logger of the library.
+* Messages are written with QSERL_LOG(level, message), where message is a stream expression, e.g.
+* QSERL_LOG(util::LL_DEBUG, "iter = " << iter). Messages above the verbosity cost a single branch and are not
+* formatted. Others are formatted on the calling thread into its own lock-free ring buffer, and written
+* asynchronously to the sink by a drain thread, so that parallel solvers are not serialized by output.
+*/
+
+#ifndef QSERL_UTIL_LOGGER_H_
+#define QSERL_UTIL_LOGGER_H_
+
+#include "qserl/exports.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <streambuf>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Levels of log messages, by decreasing severity.
+*/
+enum LogLevelT
+{
+  LL_ERROR = 1,
+  LL_WARNING,
+  LL_INFO,
+  LL_DEBUG
+};
+
+/**
+* \brief Process wide asynchronous logger.
+*/
+class QSERL_EXPORT Logger
+{
+public:
+  /** Maximal length of a message, longer messages are truncated. */
+  static const size_t kMaxMessageLength = 239;
+
+  /** Number of messages buffered per thread, messages logged while the buffer is full are dropped. */
+  static const size_t kBufferCapacity = 256;
+
+  /**
+  * \brief Returns the verbosity, i.e. the level of the least severe messages written, 0 if logging is off.
+  */
+  static int
+  verbosity()
+  {
+    return s_verbosity.load(std::memory_order_relaxed);
+  }
+
+  /**
+  * \brief Sets the verbosity, i.e. the level of the least severe messages written (LL_WARNING by default).
+  * \param i_verbosity 0 turns logging off.
+  */
+  static void
+  setVerbosity(int i_verbosity);
+
+  static bool
+  isEnabled(LogLevelT i_level)
+  {
+    return static_cast<int>(i_level) <= s_verbosity.load(std::memory_order_relaxed);
+  }
+
+  /**
+  * \brief Sets the stream messages are written to (standard output by default).
+  * Messages already logged are flushed to the previous sink.
+  * \param io_sink Stream which must outlive the logger, or until another sink is set.
+  */
+  static void
+  setSink(std::ostream& io_sink);
+
+  /**
+  * \brief Writes the messages logged so far by all threads to the sink, in time order.
+  */
+  static void
+  flush();
+
+  /**
+  * \brief Returns the number of messages dropped since the start, as their thread buffer was full.
+  */
+  static uint64_t
+  numDroppedMessages();
+
+  /**
+  * \brief Returns the number of allocated thread buffers. Buffers of exited threads are deleted by flush(), once
+  * their messages are written.
+  */
+  static size_t
+  numThreadBuffers();
+
+  /**
+  * \brief Appends a message to the buffer of the calling thread.
+  */
+  static void
+  log(LogLevelT i_level,
+      const char* i_message,
+      size_t i_length);
+
+  /**
+  * \brief Returns the name of given level, e.g. "WARNING".
+  */
+  static const char*
+  levelName(LogLevelT i_level);
+
+private:
+  static std::atomic<int> s_verbosity;
+};
+
+/**
+* \brief Formats a message in place, and logs it on destruction.
+*/
+class LogRecord : private std::streambuf
+{
+public:
+  explicit LogRecord(LogLevelT i_level) :
+      m_level(i_level),
+      m_stream(this)
+  {
+    setp(m_message, m_message + Logger::kMaxMessageLength);
+  }
+
+  ~LogRecord()
+  {
+    Logger::log(m_level, pbase(), static_cast<size_t>(pptr() - pbase()));
+  }
+
+  std::ostream&
+  stream()
+  {
+    return m_stream;
+  }
+
+  LogRecord(const LogRecord&) = delete;
+
+  LogRecord&
+  operator=(const LogRecord&) = delete;
+
+private:
+  LogLevelT m_level;
+  char m_message[Logger::kMaxMessageLength];
+  std::ostream m_stream;
+};
+
+} // namespace util
+} // namespace qserl
+
+#define QSERL_LOG(level, message) \
+  do \
+  { \
+    if(::qserl::util::Logger::isEnabled(level)) \
+    { \
+      ::qserl::util::LogRecord qserlLogRecord(level); \
+      qserlLogRecord.stream() << message; \
+    } \
+  } while(false)
+
+#endif // QSERL_UTIL_LOGGER_H_
@@ -0,0 +1,129 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_UTIL_MAPPED_FILE_H_
+#define QSERL_UTIL_MAPPED_FILE_H_
+
+#include "qserl/exports.h"
+
+#include <string>
+#include <vector>
+
+#include "qserl/util/forward_class.h"
+
+namespace qserl {
+namespace util {
+
+DECLARE_CLASS(MappedFile);
+
+/**
+* \brief File mapped in memory.
+* Files are mapped through mmap() on POSIX systems. On other systems, the file content is
+* loaded in memory (and written back on destruction for writable files).
+*/
+class QSERL_EXPORT MappedFile
+{
+public:
+
+  /**
+  * \brief Destructor. Unmaps the file.
+  */
+  ~MappedFile();
+
+  /**
+  * \brief Maps an existing file in read only mode.
+  * \return A null pointer if the file cannot be opened or mapped.
+  */
+  static MappedFileConstShPtr
+  open(const std::string& i_filename);
+
+  /**
+  * \brief Maps an existing file in read / write mode, keeping its content and size.
+  * \return A null pointer if the file cannot be opened or mapped, or is empty.
+  */
+  static MappedFileShPtr
+  openWritable(const std::string& i_filename);
+
+  /**
+  * \brief Creates (or truncates) a file of given size and maps it in read / write mode.
+  * \return A null pointer if the file cannot be created or mapped.
+  */
+  static MappedFileShPtr
+  create(const std::string& i_filename,
+         size_t i_size);
+
+  /**
+  * \brief Returns the mapped file content.
+  */
+  const char*
+  data() const;
+
+  /**
+  * \brief Returns the mapped file content.
+  * \pre The file has been mapped in read / write mode.
+  */
+  char*
+  data();
+
+  /**
+  * \brief Returns the size in bytes of the mapped file.
+  */
+  size_t
+  size() const;
+
+  /**
+  * \brief Returns the name of the mapped file.
+  */
+  const std::string&
+  filename() const;
+
+  /**
+  * \brief Flushes changes to the disk.
+  * \return false if an error occured.
+  */
+  bool
+  sync();
+
+protected:
+
+  /**
+  \brief Constructor
+  */
+  MappedFile(const std::string& i_filename,
+             bool i_writable);
+
+  /**
+  * \brief Opens and maps the file. Writable files are created with given size if it is non zero,
+  * and opened with their current size otherwise.
+  */
+  bool
+  init(size_t i_size);
+
+private:
+  std::string m_filename;
+  bool m_writable;
+  char* m_data;
+  size_t m_size;
+  std::vector<char> m_buffer;   /**< File content if memory mapping is not available. */
+};
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_MAPPED_FILE_H_
@@ -0,0 +1,256 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/**
+* \file metrics.h
+* \brief Process wide metrics: counters and histograms aggregated over all calls and threads, e.g. integration results
+* or inverse kinematics iterations. Metrics of the library are collected unless compiled with QSERL_ENABLE_METRICS
+* undefined, and exported in the Prometheus text format.
+*/
+
+#ifndef QSERL_UTIL_METRICS_H_
+#define QSERL_UTIL_METRICS_H_
+
+#include "qserl/exports.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Number of shards of counters and histograms, threads updating distinct shards unless more threads are running.
+*/
+const int kNumMetricShards = 16;
+
+/**
+* \brief Returns the shard of the calling thread, assigned on first call.
+*/
+QSERL_EXPORT int
+metricShard();
+
+/**
+* \brief Monotonic counter, sharded so that concurrent threads do not contend on the same cache line.
+*/
+class QSERL_EXPORT Counter
+{
+public:
+  Counter();
+
+  void
+  increment(uint64_t i_value = 1)
+  {
+    m_shards[metricShard()].value.fetch_add(i_value, std::memory_order_relaxed);
+  }
+
+  /**
+  * \brief Returns the sum of all shards.
+  */
+  uint64_t
+  value() const;
+
+  void
+  reset();
+
+private:
+  struct Shard
+  {
+    std::atomic<uint64_t> value;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+
+  std::array<Shard, kNumMetricShards> m_shards;
+};
+
+/**
+* \brief Histogram of observed values, in buckets of given upper bounds (inclusive) plus an overflow bucket.
+*/
+class QSERL_EXPORT Histogram
+{
+public:
+  explicit Histogram(const std::vector<double>& i_bounds);
+
+  void
+  observe(double i_value);
+
+  const std::vector<double>&
+  bounds() const
+  {
+    return m_bounds;
+  }
+
+  /**
+  * \brief Returns the number of observations per bucket (the last one counting values above all bounds).
+  */
+  std::vector<uint64_t>
+  counts() const;
+
+  double
+  sum() const;
+
+  void
+  reset();
+
+  /**
+  * \brief Returns i_count bounds, starting at i_start and multiplied by i_factor.
+  */
+  static std::vector<double>
+  exponentialBounds(double i_start,
+                    double i_factor,
+                    int i_count);
+
+private:
+  struct Shard
+  {
+    explicit Shard(size_t i_numBuckets);
+
+    std::unique_ptr<std::atomic<uint64_t>[]> counts;
+    std::atomic<double> sum;
+  };
+
+  std::vector<double> m_bounds;
+  std::vector<std::unique_ptr<Shard> > m_shards;
+};
+
+struct CounterSnapshot
+{
+  std::string name;
+  std::string help;
+  uint64_t value;
+};
+
+struct HistogramSnapshot
+{
+  std::string name;
+  std::string help;
+  std::vector<double> bounds;
+  std::vector<uint64_t> counts; /**< Per bucket, the last one counting values above all bounds. */
+  uint64_t count;
+  double sum;
+};
+
+struct MetricsSnapshot
+{
+  std::vector<CounterSnapshot> counters;      /**< Sorted by name. */
+  std::vector<HistogramSnapshot> histograms;  /**< Sorted by name. */
+};
+
+/**
+* \brief Process wide registry of metrics.
+* Names may carry labels, e.g. qserl_rod3d_integrations_total{result="valid"}, metrics of the same name up to their
+* labels forming a family.
+*/
+class QSERL_EXPORT Metrics
+{
+public:
+  /**
+  * \brief Returns true if the library was compiled with QSERL_ENABLE_METRICS.
+  */
+  static bool
+  isEnabled();
+
+  /**
+  * \brief Returns the counter of given name, registering it on first call.
+  * Returned references stay valid until the process exits.
+  */
+  static Counter&
+  counter(const std::string& i_name,
+          const std::string& i_help);
+
+  /**
+  * \brief Returns the histogram of given name, registering it with given bounds on first call.
+  * Returned references stay valid until the process exits.
+  */
+  static Histogram&
+  histogram(const std::string& i_name,
+            const std::string& i_help,
+            const std::vector<double>& i_bounds);
+
+  /**
+  * \brief Returns the current values of all metrics.
+  * May be called while other threads update metrics, updates are not atomic across metrics.
+  */
+  static MetricsSnapshot
+  snapshot();
+
+  /**
+  * \brief Writes all metrics in the Prometheus text exposition format.
+  */
+  static void
+  writeText(std::ostream& io_os);
+
+  /**
+  * \brief Writes all metrics in the Prometheus text exposition format to given file, replaced atomically so that
+  * it can be read at any time (e.g. by a node exporter textfile collector).
+  * \return false if the file could not be written.
+  */
+  static bool
+  writeText(const std::string& i_file);
+
+  /**
+  * \brief Resets all metrics to zero.
+  */
+  static void
+  reset();
+};
+
+/**
+* \brief Observes the time elapsed during its scope, in seconds, into a histogram.
+*/
+class MetricsTimer
+{
+public:
+  explicit MetricsTimer(Histogram& io_histogram) :
+      m_histogram(io_histogram),
+      m_start(std::chrono::steady_clock::now())
+  {
+  }
+
+  ~MetricsTimer()
+  {
+    m_histogram.observe(std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count());
+  }
+
+  MetricsTimer(const MetricsTimer&) = delete;
+
+  MetricsTimer&
+  operator=(const MetricsTimer&) = delete;
+
+private:
+  Histogram& m_histogram;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace util
+} // namespace qserl
+
+#ifdef QSERL_ENABLE_METRICS
+# define QSERL_METRICS(statement) statement
+#else
+# define QSERL_METRICS(statement)
+#endif
+
+#endif // QSERL_UTIL_METRICS_H_
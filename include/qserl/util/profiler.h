@@ -0,0 +1,173 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/**
+* \file profiler.h
+* \brief Hierarchical scoped profiler, compiled out unless QSERL_ENABLE_PROFILER is defined.
+* Zones are declared with QSERL_PROFILE_ZONE("name") and time the enclosing scope. Timings are accumulated
+* per thread, along the call path of nested zones, and merged on report.
+*/
+
+#ifndef QSERL_UTIL_PROFILER_H_
+#define QSERL_UTIL_PROFILER_H_
+
+#include "qserl/exports.h"
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+# if defined(_MSC_VER)
+#  include <intrin.h>
+# else
+#  include <x86intrin.h>
+# endif
+# define QSERL_PROFILER_USE_TSC
+#endif
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Timings of a profiled zone along a given call path, merged over all threads.
+*/
+struct ProfileZoneReport
+{
+  std::string path;   /**< Names of the enclosing zones and of the zone, separated by '/'. */
+  std::string name;
+  int depth;          /**< Number of enclosing zones. */
+  size_t count;
+  double totalNs;
+  double selfNs;      /**< Total time minus the time spent in child zones. */
+  double minNs;
+  double maxNs;
+  double p50Ns;       /**< Percentiles, accurate to the histogram resolution (1/4 of an octave). */
+  double p99Ns;
+};
+
+/**
+* \brief Process wide profiler collecting the timings of QSERL_PROFILE_ZONE scopes.
+* Time is measured with the time stamp counter where available (x86), which is assumed invariant,
+* and converted to nanoseconds on report.
+*/
+class QSERL_EXPORT Profiler
+{
+public:
+  typedef uint64_t Ticks;
+
+  struct Node;
+
+  /**
+  * \brief Returns true if the library was compiled with QSERL_ENABLE_PROFILER.
+  */
+  static bool
+  isEnabled();
+
+  /**
+  * \brief Returns the timings of all zones, in depth first order of the call tree.
+  * May be called while other threads are profiling, their running zones are not accounted.
+  */
+  static std::vector<ProfileZoneReport>
+  report();
+
+  /**
+  * \brief Prints the report as a table, zones being indented by depth.
+  */
+  static void
+  printReport(std::ostream& io_os);
+
+  /**
+  * \brief Clears the timings of all zones.
+  */
+  static void
+  reset();
+
+  /**
+  * \brief Returns the current time in ticks.
+  */
+  static Ticks
+  now()
+  {
+#ifdef QSERL_PROFILER_USE_TSC
+    return __rdtsc();
+#else
+    return static_cast<Ticks>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+  }
+
+  /**
+  * \brief Enters the zone of given name, child of the current zone of the calling thread.
+  * \param i_name Zone name, must outlive the profiler (i.e. a string literal).
+  */
+  static Node*
+  enter(const char* i_name);
+
+  /**
+  * \brief Leaves given zone, which must be the current zone of the calling thread.
+  */
+  static void
+  leave(Node* i_node,
+        Ticks i_elapsed);
+};
+
+/**
+* \brief Times its scope as a profiler zone.
+*/
+class ProfileZone
+{
+public:
+  explicit ProfileZone(const char* i_name) :
+      m_node(Profiler::enter(i_name)),
+      m_start(Profiler::now())
+  {
+  }
+
+  ~ProfileZone()
+  {
+    Profiler::leave(m_node, Profiler::now() - m_start);
+  }
+
+  ProfileZone(const ProfileZone&) = delete;
+
+  ProfileZone&
+  operator=(const ProfileZone&) = delete;
+
+private:
+  Profiler::Node* m_node;
+  Profiler::Ticks m_start;
+};
+
+} // namespace util
+} // namespace qserl
+
+#define QSERL_PROFILE_CONCAT_IMPL(a, b) a##b
+#define QSERL_PROFILE_CONCAT(a, b) QSERL_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef QSERL_ENABLE_PROFILER
+# define QSERL_PROFILE_ZONE(name) \
+  ::qserl::util::ProfileZone QSERL_PROFILE_CONCAT(qserlProfileZone, __LINE__)(name)
+#else
+# define QSERL_PROFILE_ZONE(name)
+#endif
+
+#endif // QSERL_UTIL_PROFILER_H_
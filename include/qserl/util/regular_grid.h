@@ -0,0 +1,150 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_UTIL_REGULAR_GRID_H_
+#define QSERL_UTIL_REGULAR_GRID_H_
+
+#include "qserl/exports.h"
+
+#include <vector>
+#include <Eigen/Core>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Regular sampling of an axis aligned box of dimension n, typically the A-space
+* of rod base wrenches (n = 3 for planar rods, n = 6 for 3D rods).
+* Samples span the box bounds included, i.e. the k-th sample along axis d is
+* lowerBounds[d] + k * step[d], for k in [0, numSamples(d) - 1].
+* Samples are stored in first axis major order, i.e. the flat index of grid index (i_0, ..., i_n-1)
+* is i_0 + N_0 * (i_1 + N_1 * (i_2 + ...)).
+*/
+class QSERL_EXPORT RegularGrid
+{
+public:
+
+  /**
+  * \brief Constructor.
+  * \param i_lowerBounds Lower bounds of the sampled box.
+  * \param i_upperBounds Upper bounds of the sampled box.
+  * \param i_numSamples Number of samples along each axis (each must be greater or equal to 2).
+  */
+  RegularGrid(const Eigen::VectorXd& i_lowerBounds,
+              const Eigen::VectorXd& i_upperBounds,
+              const std::vector<size_t>& i_numSamples);
+
+  /**
+  * \brief Returns the dimension n of the grid.
+  */
+  size_t
+  dimension() const;
+
+  /**
+  * \brief Returns the total number of samples of the grid.
+  */
+  size_t
+  numSamples() const;
+
+  /**
+  * \brief Returns the number of samples along the given axis.
+  */
+  size_t
+  numSamples(size_t i_axis) const;
+
+  /**
+  * \brief Returns the offset in flat index between two successive samples along the given axis.
+  */
+  size_t
+  stride(size_t i_axis) const;
+
+  const Eigen::VectorXd&
+  lowerBounds() const;
+
+  const Eigen::VectorXd&
+  upperBounds() const;
+
+  /**
+  * \brief Returns the distance between two successive samples along each axis.
+  */
+  const Eigen::VectorXd&
+  step() const;
+
+  /**
+  * \brief Returns the flat index of the sample of given grid index.
+  */
+  size_t
+  flatIndex(const std::vector<size_t>& i_gridIndex) const;
+
+  /**
+  * \brief Computes the grid index of the sample of given flat index.
+  */
+  void
+  gridIndex(size_t i_flatIndex,
+            std::vector<size_t>& o_gridIndex) const;
+
+  /**
+  * \brief Returns the coordinates of the sample of given flat index.
+  */
+  Eigen::VectorXd
+  sample(size_t i_flatIndex) const;
+
+  /**
+  * \brief Returns true if the given point lies in the grid bounds.
+  */
+  bool
+  contains(const Eigen::VectorXd& i_point) const;
+
+  /**
+  * \brief Computes the grid index of the lower corner of the grid cell containing the given point,
+  * i.e. for each axis the index of the greatest sample lower or equal to the point coordinate,
+  * clamped to [0, numSamples(d) - 2].
+  * \return false if the point is out of the grid bounds.
+  */
+  bool
+  cellIndex(const Eigen::VectorXd& i_point,
+            std::vector<size_t>& o_gridIndex) const;
+
+private:
+  Eigen::VectorXd m_lowerBounds;
+  Eigen::VectorXd m_upperBounds;
+  Eigen::VectorXd m_step;
+  std::vector<size_t> m_numSamples;
+  std::vector<size_t> m_strides;
+  size_t m_numSamplesTotal;
+};
+
+/**
+* \brief Extracts the boundary samples of a labelled grid, i.e. the samples having at least one
+* neighbour with a different label within their 3^n - 1 neighbourhood (the 26-neighbourhood for a
+* 3-dimensional grid). Samples on the grid border are only compared with their in-grid neighbours.
+* Neighbours are found by index arithmetic, so complexity is linear in the number of samples.
+* The grid is processed in parallel if OpenMP is available.
+* \param i_grid The sampling grid.
+* \param i_labels The label of each grid sample (e.g. the integration result status), indexed by flat index.
+* \return Flat indices of the boundary samples, sorted in increasing order.
+*/
+QSERL_EXPORT std::vector<size_t>
+extractBoundarySamples(const RegularGrid& i_grid,
+                       const std::vector<int>& i_labels);
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_REGULAR_GRID_H_
@@ -0,0 +1,180 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#ifndef QSERL_UTIL_STABILITY_INDEX_H_
+#define QSERL_UTIL_STABILITY_INDEX_H_
+
+#include "qserl/exports.h"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include <Eigen/Core>
+
+#include "qserl/util/dataset.h"
+#include "qserl/util/forward_class.h"
+#include "qserl/util/regular_grid.h"
+
+namespace qserl {
+namespace util {
+
+DECLARE_CLASS(StabilityIndex);
+
+/**
+* \brief Lookup index of rod stability over a sampled A-space grid.
+* Stability of each grid sample is stored in a bitset, along with a second bitset flagging the
+* uniform grid cells, i.e. the cells whose 2^n corners share the same stability.
+* Queries landing in a uniform cell are answered in constant time from the bitsets. Queries landing
+* in a boundary cell (or out of the grid) are answered by the stability oracle, which usually runs
+* a full rod integration (see rod2d::createStabilityOracle() and rod3d::createStabilityOracle()).
+* Oracle answers for boundary cells can optionally be cached, on a grid refining each boundary cell.
+* Queries are thread safe.
+*/
+class QSERL_EXPORT StabilityIndex
+{
+public:
+
+  /**
+  * \brief Function returning true if the rod configuration of given base wrench a is stable.
+  * Must be thread safe if the index is queried concurrently.
+  */
+  typedef std::function<bool(const Eigen::VectorXd&)> StabilityOracle;
+
+  /**
+  * \brief Creates the index of given grid samples stability.
+  * \param i_grid The A-space grid.
+  * \param i_isStable Stability of each grid sample, indexed by flat index.
+  * \param i_oracle Stability oracle used for queries which cannot be answered by the index.
+  * \return A null pointer if the stability is not given for each grid sample.
+  */
+  static StabilityIndexShPtr
+  create(const RegularGrid& i_grid,
+         const std::vector<bool>& i_isStable,
+         const StabilityOracle& i_oracle);
+
+  /**
+  * \brief Creates the index from the stability column of a dataset sampled on a grid.
+  * Samples are considered as stable if their integration result code is IR_VALID (0).
+  * \return A null pointer if the dataset samples do not lie on a grid, or if the dataset does not store
+  * the DC_STABILITY column.
+  */
+  static StabilityIndexShPtr
+  create(const Dataset& i_dataset,
+         const StabilityOracle& i_oracle);
+
+  const RegularGrid&
+  grid() const;
+
+  /**
+  * \brief Returns true if the rod configuration of given base wrench is stable.
+  * \param i_a The base wrench, in the grid convention.
+  */
+  bool
+  isStable(const Eigen::VectorXd& i_a) const;
+
+  /**
+  * \brief Returns true if the given base wrench lies in a boundary cell of the grid, or out of the grid,
+  * i.e. if its stability cannot be answered from the grid samples only.
+  */
+  bool
+  isOnBoundary(const Eigen::VectorXd& i_a) const;
+
+  /**
+  * \brief Enables caching of the oracle answers in boundary cells.
+  * Each boundary cell is refined in i_resolution^n sub cells, a query then returns the cached
+  * answer of its sub cell if any.
+  * \param i_resolution Number of sub cells per axis in each boundary cell, 0 to disable caching.
+  * \return false if the refined grid has more than 2^64 sub cells, which cannot be keyed. Caching
+  * is then disabled.
+  * \note Changing the resolution clears the cache. Must not be called concurrently with queries.
+  */
+  bool
+  cacheResolution(unsigned int i_resolution);
+
+  unsigned int
+  cacheResolution() const;
+
+  /**
+  * \brief Returns the number of cached oracle answers.
+  */
+  size_t
+  cacheSize() const;
+
+  /**
+  * \brief Returns the number of boundary cells of the grid.
+  */
+  size_t
+  numBoundaryCells() const;
+
+  /**
+  * \brief Returns the number of calls to the stability oracle since creation.
+  */
+  size_t
+  numOracleCalls() const;
+
+  /**
+  * \brief Returns the memory usage of this instance.
+  */
+  size_t
+  memUsage() const;
+
+protected:
+
+  /**
+  \brief Constructor
+  */
+  StabilityIndex(const RegularGrid& i_grid,
+                 const StabilityOracle& i_oracle);
+
+  bool
+  init(const std::vector<bool>& i_isStable);
+
+  /**
+  * \brief Computes the flat index of the lower corner of the cell containing given point.
+  * \return false if the point is out of the grid.
+  */
+  bool
+  cellFlatIndex(const Eigen::VectorXd& i_a,
+                size_t& o_cellIdx) const;
+
+  /**
+  * \brief Returns the key of the cached sub cell containing given point.
+  */
+  uint64_t
+  cacheKey(const Eigen::VectorXd& i_a) const;
+
+private:
+  RegularGrid m_grid;
+  StabilityOracle m_oracle;
+  std::vector<uint64_t> m_stableBits;     /**< Stability of each grid sample. */
+  std::vector<uint64_t> m_uniformBits;    /**< Uniformity of each cell, indexed by the flat index of its lower corner. */
+  size_t m_numBoundaryCells;
+  unsigned int m_cacheResolution;
+  mutable std::mutex m_cacheMutex;
+  mutable std::unordered_map<uint64_t, bool> m_cache;
+  mutable std::atomic<size_t> m_numOracleCalls;
+};
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_STABILITY_INDEX_H_
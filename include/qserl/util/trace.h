@@ -0,0 +1,193 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/**
+* \file trace.h
+* \brief Timeline tracing in the Chrome trace event format, compiled out unless QSERL_ENABLE_TRACING is defined.
+* Scopes declared with QSERL_TRACE_SCOPE("name") are recorded, while tracing is started, as complete events with
+* the identifier of their thread. Traces can be opened in chrome://tracing or https://ui.perfetto.dev.
+*/
+
+#ifndef QSERL_UTIL_TRACE_H_
+#define QSERL_UTIL_TRACE_H_
+
+#include "qserl/exports.h"
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Process wide recorder of trace events.
+* Events are appended to per thread buffers without locking, and only read when the trace is written.
+*/
+class QSERL_EXPORT Tracer
+{
+public:
+
+  /**
+  * \brief Returns true if the library was compiled with QSERL_ENABLE_TRACING.
+  */
+  static bool
+  isEnabled();
+
+  /**
+  * \brief Starts recording events.
+  */
+  static void
+  start();
+
+  /**
+  * \brief Stops recording events. Recorded events are kept until clear().
+  */
+  static void
+  stop();
+
+  static bool
+  isRecording()
+  {
+    return s_isRecording.load(std::memory_order_relaxed);
+  }
+
+  /**
+  * \brief Discards recorded events.
+  * \pre No thread is within a traced scope, e.g. tracing is stopped and worker threads are idle.
+  */
+  static void
+  clear();
+
+  /**
+  * \brief Returns the number of recorded events.
+  */
+  static size_t
+  numEvents();
+
+  /**
+  * \brief Names the calling thread in traces.
+  */
+  static void
+  setThreadName(const std::string& i_name);
+
+  /**
+  * \brief Returns a copy of given string which lives as long as the process, to name events from
+  * non literal strings (e.g. from Python).
+  */
+  static const char*
+  intern(const std::string& i_name);
+
+  /**
+  * \brief Writes recorded events in the Chrome trace event JSON format.
+  * May be called while other threads are recording, events completed so far are written.
+  */
+  static void
+  writeChromeTrace(std::ostream& io_os);
+
+  /**
+  * \brief Writes recorded events in the Chrome trace event JSON format to given file.
+  * \return false if the file could not be written.
+  */
+  static bool
+  writeChromeTrace(const std::string& i_file);
+
+  /**
+  * \brief Returns the time elapsed since the tracer creation, in nanoseconds.
+  */
+  static int64_t
+  now();
+
+  /**
+  * \brief Records a complete event of the calling thread.
+  * \param i_name Event name, must outlive the tracer (i.e. a string literal, or interned).
+  * \param i_argName Name of the event argument, null pointer if none.
+  */
+  static void
+  record(const char* i_name,
+         int64_t i_startNs,
+         int64_t i_endNs,
+         const char* i_argName,
+         int64_t i_argValue);
+
+private:
+  static std::atomic<bool> s_isRecording;
+};
+
+/**
+* \brief Records its scope as a trace event, if tracing is started on entry.
+*/
+class TraceScope
+{
+public:
+  explicit TraceScope(const char* i_name) :
+      m_name(Tracer::isRecording() ? i_name : nullptr),
+      m_start(m_name ? Tracer::now() : 0),
+      m_argName(nullptr),
+      m_argValue(0)
+  {
+  }
+
+  ~TraceScope()
+  {
+    if(m_name)
+    {
+      Tracer::record(m_name, m_start, Tracer::now(), m_argName, m_argValue);
+    }
+  }
+
+  /**
+  * \brief Attaches an integer argument to the event, e.g. the index of a processed item.
+  * \param i_name Argument name, must outlive the tracer.
+  */
+  void
+  arg(const char* i_name,
+      int64_t i_value)
+  {
+    m_argName = i_name;
+    m_argValue = i_value;
+  }
+
+  TraceScope(const TraceScope&) = delete;
+
+  TraceScope&
+  operator=(const TraceScope&) = delete;
+
+private:
+  const char* m_name;
+  int64_t m_start;
+  const char* m_argName;
+  int64_t m_argValue;
+};
+
+} // namespace util
+} // namespace qserl
+
+#define QSERL_TRACE_CONCAT_IMPL(a, b) a##b
+#define QSERL_TRACE_CONCAT(a, b) QSERL_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef QSERL_ENABLE_TRACING
+# define QSERL_TRACE_SCOPE(name) \
+  ::qserl::util::TraceScope QSERL_TRACE_CONCAT(qserlTraceScope, __LINE__)(name)
+#else
+# define QSERL_TRACE_SCOPE(name)
+#endif
+
+#endif // QSERL_UTIL_TRACE_H_
@@ -27,6 +27,7 @@
 #include <boost/math/special_functions/ellint_2.hpp>
 #include <boost/math/special_functions/acosh.hpp>
 #include "util/jacobi_elliptic.h"
+#include "qserl/util/profiler.h"
 #include "util/utils.h"
 
 namespace qserl {
@@ -36,6 +37,7 @@ bool
 computeMotionConstantsDqDa(const Eigen::Vector3d& i_a,
                            MotionConstantsDqDa& o_mc)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeMotionConstantsDqDa");
   static const double kEpsilonNullTorque = 1.e-10;
   static const double kEpsilonNullForce = 1.e-10;
 
@@ -327,6 +329,7 @@ computeDqDaAtPositionT(double i_t,
                        const MotionConstantsDqDa& i_mc,
                        Eigen::Matrix3d& o_dqda)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeDqDaAtPositionT");
   if(i_mc.qc.lambda[3] >= 0.)
   {
     //if (abs(i_a[0]) < kEpsilonNullTorque)
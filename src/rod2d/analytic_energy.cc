@@ -26,6 +26,7 @@
 #include <boost/math/special_functions/ellint_2.hpp>
 #include "util/jacobi_elliptic.h"
 
+#include "qserl/util/profiler.h"
 #include "util/utils.h"
 
 namespace qserl {
@@ -35,6 +36,7 @@ bool
 computeTotalElasticEnergy(const MotionConstantsQ& i_mc,
                           double& o_energy)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeTotalElasticEnergy");
   const double gamma_1 = i_mc.r * (1. + i_mc.tau);
 
   double am_gamma_1;
@@ -27,6 +27,7 @@
 #include <boost/math/special_functions/acosh.hpp>
 #include <boost/math/special_functions/jacobi_elliptic.hpp>
 
+#include "qserl/util/profiler.h"
 #include "util/utils.h"
 
 namespace qserl {
@@ -36,6 +37,7 @@ bool
 computeMotionConstantsMu(const Eigen::Vector3d& i_a,
                          MotionConstantsMu& o_mc)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeMotionConstantsMu");
   static const double kEpsilonNullTorque = 1.e-10;
   static const double kEpsilonNullForce = 1.e-10;
 
@@ -141,6 +143,7 @@ computeMuAtPositionT(double i_t,
                      const MotionConstantsMu& i_mc,
                      Eigen::Vector3d& o_mu)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeMuAtPositionT");
   double k_t = 0.;      // k(t) is rod curvature at position t
   double k_dot_t = 0.;
   if(i_mc.lambda[3] >= 0.)
@@ -28,6 +28,7 @@
 #include <boost/math/special_functions/acosh.hpp>
 #include "util/jacobi_elliptic.h"
 
+#include "qserl/util/profiler.h"
 #include "util/utils.h"
 
 namespace qserl {
@@ -38,6 +39,7 @@ bool
 computeMotionConstantsQ(const Eigen::Vector3d& i_a,
                         MotionConstantsQ& o_mc)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeMotionConstantsQ");
   static const double kEpsilonNullTorque = 1.e-10;
   static const double kEpsilonNullForce = 1.e-10;
 
@@ -181,6 +183,7 @@ computeQAtPositionT(double i_t,
                     Eigen::Vector3d& o_qdot,
                     Eigen::Vector3d& o_q)
 {
+  QSERL_PROFILE_ZONE("rod2d::computeQAtPositionT");
   static const double kEpsilonNullTorque = 1.e-10;
   static const double kEpsilonNullForce = 1.e-10;
 
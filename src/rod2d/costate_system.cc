@@ -19,7 +19,6 @@
 
 #include "costate_system.h"
 
-#include <functional>
 
 namespace qserl {
 namespace rod2d {
@@ -39,11 +38,9 @@ CostateSystem::CostateSystem(double i_inv_stiffness,
     m_length(i_length),
     m_rodModel(i_rodModel)
 {
-  using namespace std::placeholders;
-
   if(m_rodModel == Parameters::RM_INEXTENSIBLE)
   {
-    m_evaluationCallback = std::bind(&CostateSystem::evaluateInextensible, this, _1, _2, _3);
+    m_evaluationCallback = &CostateSystem::evaluateInextensible;
   }
   else
     assert(false && "invalid rod model");
@@ -58,7 +55,7 @@ CostateSystem::operator()(const state_type& i_mu,
                           state_type& o_dmudt,
                           double i_t)
 {
-  return m_evaluationCallback(i_mu, o_dmudt, i_t);
+  return (this->*m_evaluationCallback)(i_mu, o_dmudt, i_t);
 }
 
 void
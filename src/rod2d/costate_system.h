@@ -22,8 +22,6 @@
 
 #include "qserl/exports.h"
 
-#include <functional>
-
 #include "qserl/rod2d/workspace_integrated_state.h"
 
 namespace qserl {
@@ -58,9 +56,11 @@ private:
   double m_length;
   Parameters::RodModelT m_rodModel;
 
-  std::function<void(const state_type&,
-                     state_type&,
-                     double)> m_evaluationCallback;
+  /** Derivative evaluation of the rod model, a member function pointer so that systems are cheap to copy
+  and do not allocate. */
+  void (CostateSystem::*m_evaluationCallback)(const state_type&,
+                                              state_type&,
+                                              double);
 
   /**
   * Derivative evaluation at time t for the inextensible (RM_INEXTENSIBLE) rod model.
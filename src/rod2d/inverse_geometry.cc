@@ -23,11 +23,13 @@
 
 #include "qserl/rod2d/inverse_geometry.h"
 
-#include <iostream>
-
 #include <Eigen/LU>
 #include "qserl/rod2d/analytic_dqda.h"
+#include "qserl/util/allocation_tracker.h"
+#include "qserl/util/logger.h"
+#include "qserl/util/profiler.h"
 #include "qserl/util/timer.h"
+#include "qserl/util/trace.h"
 #include "util/utils.h"
 
 namespace qserl {
@@ -44,6 +46,9 @@ inverseGeometry_Newton(const Eigen::Vector3d& i_q_des,
   static const double t = 1.;
   static const double kJacobianDetNullTolerance = 1.e-9;
 
+  QSERL_PROFILE_ZONE("rod2d::inverseGeometry");
+  QSERL_TRACE_SCOPE("rod2d::inverseGeometry");
+  QSERL_ALLOCATION_SCOPE("rod2d::inverseGeometry");
   util::TimePoint startSolveTime = util::getTimePoint();
 
   const double sqrdMaxNormError = util::sqr(i_maxNormError);
@@ -66,9 +71,9 @@ inverseGeometry_Newton(const Eigen::Vector3d& i_q_des,
     if(!singularityFound)
     {
       const Eigen::Vector3d r_a_k = q_a_k - i_q_des;
-      std::cout << "[DEBUG] [iter=" << iter << "] a_k = " << a_k << std::endl;
-      std::cout << "[DEBUG] [iter=" << iter << "] q(a_k) = " << q_a_k << std::endl;
-      std::cout << "[DEBUG] [iter=" << iter << "] ||r(a_k)|| = " << r_a_k.norm() << std::endl;
+      QSERL_LOG(util::LL_DEBUG, "[iter=" << iter << "] a_k = " << a_k.transpose());
+      QSERL_LOG(util::LL_DEBUG, "[iter=" << iter << "] q(a_k) = " << q_a_k.transpose());
+      QSERL_LOG(util::LL_DEBUG, "[iter=" << iter << "] ||r(a_k)|| = " << r_a_k.norm());
       if(r_a_k.squaredNorm() > sqrdMaxNormError)
       {
         // inverse the jacobian and check rank
@@ -82,7 +87,7 @@ inverseGeometry_Newton(const Eigen::Vector3d& i_q_des,
         }
         else
         {
-          std::cout << "[WARNING] inverseGeometry_Newton(): unstability point found at iter = " << iter << std::endl;
+          QSERL_LOG(util::LL_WARNING, "inverseGeometry_Newton(): unstability point found at iter = " << iter);
           isUnstable = true;
         }
       }
@@ -94,7 +99,7 @@ inverseGeometry_Newton(const Eigen::Vector3d& i_q_des,
     }
     else
     {
-      std::cout << "[WARNING] inverseGeometry_Newton(): singularity point found at iter = " << iter << std::endl;
+      QSERL_LOG(util::LL_WARNING, "inverseGeometry_Newton(): singularity point found at iter = " << iter);
     }
     ++iter;
   }
@@ -104,8 +109,8 @@ inverseGeometry_Newton(const Eigen::Vector3d& i_q_des,
   if(success)
   {
     o_a = a_k;
-    std::cout << "[PROGRESS] inverseGeometry_Newton(): succefully solved after " << iter << " iterations" <<
-              " _ took " << solveTimeUs << "us" << std::endl;
+    QSERL_LOG(util::LL_INFO, "inverseGeometry_Newton(): succefully solved after " << iter << " iterations" <<
+                             " _ took " << solveTimeUs << "us");
   }
   return success;
 }
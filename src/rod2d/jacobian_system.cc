@@ -19,7 +19,6 @@
 
 #include "jacobian_system.h"
 
-#include <functional>
 
 namespace qserl {
 namespace rod2d {
@@ -45,11 +44,9 @@ JacobianSystem::JacobianSystem(double i_inv_stiffness,
     m_rodModel(i_rodModel)
 {
   assert (m_dt > 0. && "integration step time must be positive.");
-  using namespace std::placeholders;
-
   if(m_rodModel == Parameters::RM_INEXTENSIBLE)
   {
-    m_evaluationCallback = std::bind(&JacobianSystem::evaluateInextensible, this, _1, _2, _3);
+    m_evaluationCallback = &JacobianSystem::evaluateInextensible;
   }
   else
     assert(false && "invalid rod model");
@@ -65,7 +62,7 @@ JacobianSystem::operator()(const state_type& i_MJ,
                            state_type& o_dMJdt,
                            double i_t)
 {
-  return m_evaluationCallback(i_MJ, o_dMJdt, i_t);
+  return (this->*m_evaluationCallback)(i_MJ, o_dMJdt, i_t);
 }
 
 void
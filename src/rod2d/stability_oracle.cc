@@ -0,0 +1,51 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/rod2d/stability_oracle.h"
+
+#include <cassert>
+
+#include "qserl/rod2d/workspace_integrated_state.h"
+
+namespace qserl {
+namespace rod2d {
+
+util::StabilityIndex::StabilityOracle
+createStabilityOracle(const Parameters& i_rodParams)
+{
+  WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.stop_if_unstable = true;
+  integrationOptions.keepMuValues = false;
+  integrationOptions.keepJdet = false;
+  integrationOptions.keepMMatrices = false;
+  integrationOptions.keepJMatrices = false;
+
+  return [i_rodParams, integrationOptions](const Eigen::VectorXd& i_a_TXY)
+  {
+    assert(i_a_TXY.size() == 3 && "planar rod base wrench must be of dimension 3");
+    static const Displacement2D identityDisp = Displacement2D{0., 0., 0.};
+    const Wrench2D wrench_XYT{i_a_TXY[1], i_a_TXY[2], i_a_TXY[0]};
+    WorkspaceIntegratedStateShPtr rodState = WorkspaceIntegratedState::create(wrench_XYT, identityDisp, i_rodParams);
+    rodState->integrationOptions(integrationOptions);
+    return rodState->integrate() == WorkspaceIntegratedState::IR_VALID;
+  };
+}
+
+}  // namespace rod2d
+}  // namespace qserl
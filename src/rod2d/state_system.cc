@@ -19,8 +19,6 @@
 
 #include "state_system.h"
 
-#include <functional>
-
 namespace qserl {
 namespace rod2d {
 
@@ -44,11 +42,9 @@ StateSystem::StateSystem(double i_inv_stiffness,
     m_rodModel(i_rodModel)
 {
   assert (m_dt > 0. && "integration step time must be positive.");
-  using namespace std::placeholders;
-
   if(m_rodModel == Parameters::RM_INEXTENSIBLE)
   {
-    m_evaluationCallback = std::bind(&StateSystem::evaluateInextensible, this, _1, _2, _3);
+    m_evaluationCallback = &StateSystem::evaluateInextensible;
   }
   else
     assert(false && "invalid rod model");
@@ -63,7 +59,7 @@ StateSystem::operator()(const state_type& i_q,
                         state_type& o_dqdt,
                         double i_t)
 {
-  return m_evaluationCallback(i_q, o_dqdt, i_t);
+  return (this->*m_evaluationCallback)(i_q, o_dqdt, i_t);
 }
 
 void
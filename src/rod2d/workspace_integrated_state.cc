@@ -26,13 +26,114 @@
 #include <boost/numeric/odeint.hpp>
 
 #include "qserl/rod2d/rod.h"
+#include "qserl/util/allocation_tracker.h"
+#include "qserl/util/metrics.h"
+#include "qserl/util/profiler.h"
+#include "qserl/util/trace.h"
 #include "state_system.h"
 #include "costate_system.h"
 #include "jacobian_system.h"
+#include "util/conjugate_point.h"
+#include "util/stats.h"
 
 namespace qserl {
 namespace rod2d {
 
+namespace {
+
+/**
+* \brief Locates the conjugate point within the integration step [i_t, i_t + i_dt] of the jacobian system,
+* given the jacobian states at both ends of the step.
+*/
+double
+locateConjugatePoint(JacobianSystem& io_jacobianSystem,
+                     const WorkspaceIntegratedState::jacobian_state_type& i_MJ0,
+                     const WorkspaceIntegratedState::jacobian_state_type& i_MJ1,
+                     double i_t,
+                     double i_dt,
+                     double i_tolerance)
+{
+  if(i_tolerance <= 0.)
+  {
+    return i_t + i_dt;
+  }
+  QSERL_PROFILE_ZONE("rod2d::locateConjugatePoint");
+  WorkspaceIntegratedState::jacobian_state_type dMJ0, dMJ1;
+  io_jacobianSystem(i_MJ0, dMJ0, i_t);
+  io_jacobianSystem(i_MJ1, dMJ1, i_t + i_dt);
+  typedef Eigen::Map<const Eigen::Matrix<double, 3, 3> > ConstMatrixMap;
+  return util::findConjugatePoint<3>(i_t, i_t + i_dt,
+                                     ConstMatrixMap(i_MJ0.data() + 9), ConstMatrixMap(dMJ0.data() + 9),
+                                     ConstMatrixMap(i_MJ1.data() + 9), ConstMatrixMap(dMJ1.data() + 9),
+                                     i_tolerance);
+}
+
+/** Per thread buffers of the values computed by an integration but not kept by the state. */
+enum ScratchBufferT
+{
+  SB_MU = 0,
+  SB_M,
+  SB_J,
+  SB_J_DET
+};
+
+/**
+* \brief Returns the scratch buffer of the calling thread for values of type T, so that values not kept by a state
+* do not add to its memory print and are not reallocated at each integration.
+*/
+template<ScratchBufferT Buffer, typename T>
+std::vector<T>&
+scratchBuffer()
+{
+  static thread_local std::vector<T> s_buffer;
+  return s_buffer;
+}
+
+#ifdef QSERL_ENABLE_METRICS
+/**
+* \brief Process wide metrics of the integrations, registered at static initialization.
+*/
+struct IntegrationMetrics
+{
+  IntegrationMetrics() :
+      results(),
+      integrateSeconds(&util::Metrics::histogram("qserl_rod2d_integration_seconds{method=\"rk4\"}",
+                                                 "Duration of the rod2d integrations, in seconds.",
+                                                 util::Histogram::exponentialBounds(1e-6, 4., 12))),
+      integrateWhileValidSeconds(&util::Metrics::histogram("qserl_rod2d_integration_seconds{method=\"while_valid\"}",
+                                                           "Duration of the rod2d integrations, in seconds.",
+                                                           util::Histogram::exponentialBounds(1e-6, 4., 12)))
+  {
+    static const char* const kResultNames[WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS] =
+        {"valid", "singular", "unstable", "out_of_wrench_bounds"};
+    for(int result = 0; result < WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS; ++result)
+    {
+      results[result] = &util::Metrics::counter(std::string("qserl_rod2d_integrations_total{result=\"") +
+                                                kResultNames[result] + "\"}",
+                                                "Number of rod2d integrations, by result.");
+    }
+  }
+
+  util::Counter* results[WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS];
+  util::Histogram* integrateSeconds;
+  util::Histogram* integrateWhileValidSeconds;
+};
+
+const IntegrationMetrics s_integrationMetrics;
+#endif
+
+/**
+* \brief Counts given integration result in the process wide metrics and returns it.
+*/
+WorkspaceIntegratedState::IntegrationResultT
+countResult(WorkspaceIntegratedState::IntegrationResultT i_result)
+{
+  QSERL_METRICS(s_integrationMetrics.results[i_result]->increment());
+  return i_result;
+}
+
+} // namespace
+
 /************************************************************************/
 /*													Constructor																	*/
 /************************************************************************/
@@ -41,11 +142,13 @@ WorkspaceIntegratedState::WorkspaceIntegratedState(const Displacement2D& i_baseP
     WorkspaceState(std::vector<Displacement2D>(), i_basePosition, i_rodParams),
     m_isInitialized{false},
     m_isStable{false},
+    m_conjugatePointT{-1.},
     m_mu{},
     m_M{},
     m_J{},
     m_J_det{},
-    m_integrationOptions{} // initialize to default values
+    m_integrationOptions{}, // initialize to default values
+    m_stats{}
 {
   assert (m_rodParameters.delta_t > 0. and "step integration time must be stricly positive");
   m_numNodes = m_rodParameters.numberOfNodes();
@@ -67,6 +170,7 @@ WorkspaceIntegratedState::create(const Wrench2D& i_baseWrench,
                                  const Displacement2D& i_basePosition,
                                  const Parameters& i_rodParams)
 {
+  QSERL_ALLOCATION_SCOPE("rod2d::WorkspaceIntegratedState::create");
   WorkspaceIntegratedStateShPtr shPtr(new WorkspaceIntegratedState(i_basePosition, i_rodParams));
 
   if(!shPtr->init(i_baseWrench))
@@ -144,24 +248,31 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
   const double dt = m_rodParameters.delta_t;
 
   m_isInitialized = true;
+  m_conjugatePointT = -1.;
+  QSERL_PROFILE_ZONE("rod2d::integrate");
+  QSERL_TRACE_SCOPE("rod2d::integrate");
+  QSERL_ALLOCATION_SCOPE("rod2d::integrate");
+  QSERL_METRICS(util::MetricsTimer latencyTimer(*s_integrationMetrics.integrateSeconds));
+  m_stats.reset();
+  QSERL_STATS(util::StatsTimer totalTimer(m_stats.totalTimeNs));
 
   const Wrench2D mu_0(Eigen::Matrix<double, 3, 1>(i_wrench.data()));
   if(Rod::isConfigurationSingular(mu_0))
   {
-    return IR_SINGULAR;
+    return countResult(IR_SINGULAR);
   }
 
   // 1. solve the costate system to find mu
   const double stiffnessCoefficient = Rod::getStiffnessCoefficients(m_rodParameters);
   const double invStiffness = 1. / stiffnessCoefficient;
   CostateSystem costate_system(invStiffness, m_rodParameters.length, m_rodParameters.rodModel);
+  auto&& stepped_costate_system = util::instrument(costate_system, m_stats);
 
   // init mu(0) = a					(base DLO wrench)
   costate_type mu_t = i_wrench;
 
-  // until C++0x, there is no convenient way to release memory of a vector
-  // so we use temporary allocated vectors if we do not want our instance
-  // memory print to explode.
+  // values which are not kept are computed in per thread buffers, so that our instance memory print
+  // does not explode.
   std::vector<costate_type>* mu_buffer;
   if(m_integrationOptions.keepMuValues)
   {
@@ -171,7 +282,8 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
   }
   else
   {
-    mu_buffer = new std::vector<costate_type>(m_numNodes, CostateSystem::defaultState());
+    mu_buffer = &scratchBuffer<SB_MU, costate_type>();
+    mu_buffer->assign(m_numNodes, CostateSystem::defaultState());
     m_mu.assign(1, mu_t); // store mu_0
   }
 
@@ -181,12 +293,14 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
   size_t step_idx = 1;
   for(double t = ktstart; step_idx < m_numNodes; ++step_idx, t += dt)
   {
-    css_stepper.do_step(costate_system, mu_t, t, dt);
+    css_stepper.do_step(stepped_costate_system, mu_t, t, dt);
+    QSERL_STATS(++m_stats.numSteps);
     (*mu_buffer)[step_idx] = mu_t;
   }
 
   // 2. solve the state system to find q
   StateSystem state_system(invStiffness, m_rodParameters.length, dt, *mu_buffer, m_rodParameters.rodModel);
+  auto&& stepped_state_system = util::instrument(state_system, m_stats);
   boost::numeric::odeint::runge_kutta4<state_type> sss_stepper;
   m_nodes.resize(m_numNodes);
 
@@ -198,7 +312,8 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
   step_idx = 1;
   for(double t = ktstart; step_idx < m_numNodes; ++step_idx, t += dt)
   {
-    sss_stepper.do_step(state_system, q_t, t, dt);
+    sss_stepper.do_step(stepped_state_system, q_t, t, dt);
+    QSERL_STATS(++m_stats.numSteps);
 //    m_nodes[step_idx] = q_t;
     m_nodes[step_idx] = Eigen::Map<Displacement2D>(q_t.data());
   }
@@ -207,6 +322,7 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
   {
     // 3. Solve the jacobian system (and check non-degenerescence of matrix J)
     JacobianSystem jacobianSystem(invStiffness, dt, *mu_buffer, m_rodParameters.rodModel);
+    auto&& stepped_jacobian_system = util::instrument(jacobianSystem, m_stats);
     boost::numeric::odeint::runge_kutta4<jacobian_state_type> jacobianStepper;
     std::vector<Eigen::Matrix<double, 3, 3> >* M_buffer;
     if(m_integrationOptions.keepMMatrices)
@@ -216,7 +332,8 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
     }
     else
     {
-      M_buffer = new std::vector<Eigen::Matrix<double, 3, 3> >(m_numNodes, Eigen::Matrix<double, 3, 3>::Zero());
+      M_buffer = &scratchBuffer<SB_M, Eigen::Matrix<double, 3, 3> >();
+      M_buffer->assign(m_numNodes, Eigen::Matrix<double, 3, 3>::Zero());
     }
 
     std::vector<Eigen::Matrix<double, 3, 3> >* J_buffer;
@@ -227,7 +344,8 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
     }
     else
     {
-      J_buffer = new std::vector<Eigen::Matrix<double, 3, 3> >(m_numNodes, Eigen::Matrix<double, 3, 3>::Zero());
+      J_buffer = &scratchBuffer<SB_J, Eigen::Matrix<double, 3, 3> >();
+      J_buffer->assign(m_numNodes, Eigen::Matrix<double, 3, 3>::Zero());
     }
 
     // init M_0 to identity and J_0 to zero
@@ -251,56 +369,49 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const costate_type& i_wrenc
     }
     else
     {
-      J_det_buffer = new std::vector<double>(m_numNodes, 0.);
+      J_det_buffer = &scratchBuffer<SB_J_DET, double>();
+      J_det_buffer->assign(m_numNodes, 0.);
     }
 
+    jacobian_state_type jacobian_prev;
     for(double t = ktstart; step_idx < m_numNodes && (!m_integrationOptions.stop_if_unstable || m_isStable);
         ++step_idx, t += dt)
     {
-      jacobianStepper.do_step(jacobianSystem, jacobian_t, t, dt);
-      (*M_buffer)[step_idx] = Eigen::Map<Eigen::Matrix<double, 3, 3> >(jacobian_t.data());
-      (*J_buffer)[step_idx] = Eigen::Map<Eigen::Matrix<double, 3, 3> >(jacobian_t.data() + 9);
+      jacobian_prev = jacobian_t;
+      jacobianStepper.do_step(stepped_jacobian_system, jacobian_t, t, dt);
+      QSERL_STATS(++m_stats.numSteps);
+      {
+        QSERL_STATS(util::StatsTimer storageTimer(m_stats.storageTimeNs));
+        (*M_buffer)[step_idx] = Eigen::Map<Eigen::Matrix<double, 3, 3> >(jacobian_t.data());
+        (*J_buffer)[step_idx] = Eigen::Map<Eigen::Matrix<double, 3, 3> >(jacobian_t.data() + 9);
+      }
       // check if stable
       double& J_det = (*J_det_buffer)[step_idx];
-      J_det = (*J_buffer)[step_idx].determinant();
-      if(abs(J_det) > JacobianSystem::kStabilityThreshold)
+      {
+        QSERL_STATS(util::StatsTimer determinantTimer(m_stats.determinantTimeNs));
+        J_det = (*J_buffer)[step_idx].determinant();
+      }
+      if(!isThresholdOn && abs(J_det) > JacobianSystem::kStabilityThreshold)
       {
         isThresholdOn = true;
+        QSERL_STATS(m_stats.stabilityThresholdNode = static_cast<int>(step_idx));
       }
-      if(isThresholdOn && (abs(J_det) < JacobianSystem::kStabilityTolerance ||
-                           J_det * (*J_det_buffer)[step_idx - 1] < 0.))
+      if(m_isStable && isThresholdOn && (abs(J_det) < JacobianSystem::kStabilityTolerance ||
+                                         J_det * (*J_det_buffer)[step_idx - 1] < 0.))
       {  // zero crossing
         m_isStable = false;
+        m_conjugatePointT = locateConjugatePoint(jacobianSystem, jacobian_prev, jacobian_t, t, dt,
+                                                 m_integrationOptions.conjugatePointTolerance);
       }
     }
-
-    if(!m_integrationOptions.keepJdet)
-    {
-      delete J_det_buffer;
-    }
-
-    if(!m_integrationOptions.keepMMatrices)
-    {
-      delete M_buffer;
-    }
-
-    if(!m_integrationOptions.keepJMatrices)
-    {
-      delete J_buffer;
-    }
-  }
-
-  if(!m_integrationOptions.keepMuValues)
-  {
-    delete mu_buffer;
   }
 
   if(!m_isStable)
   {
-    return IR_UNSTABLE;
+    return countResult(IR_UNSTABLE);
   }
 
-  return IR_VALID;
+  return countResult(IR_VALID);
 }
 
 /************************************************************************/
@@ -479,6 +590,16 @@ WorkspaceIntegratedState::isStable() const
   return m_isStable;
 }
 
+/************************************************************************/
+/*														conjugatePointT														*/
+/************************************************************************/
+double
+WorkspaceIntegratedState::conjugatePointT() const
+{
+  assert(m_isInitialized && "the state must be integrated first");
+  return m_conjugatePointT;
+}
+
 /************************************************************************/
 /*																wrench																*/
 /************************************************************************/
@@ -541,11 +662,22 @@ WorkspaceIntegratedState::memUsage() const
   return WorkspaceState::memUsage() +
          sizeof(m_isInitialized) +
          sizeof(m_isStable) +
+         sizeof(m_conjugatePointT) +
          m_mu.capacity() * sizeof(costate_type) +
          m_M.capacity() * sizeof(Eigen::Matrix<double, 3, 3>) +
          m_J.capacity() * sizeof(Eigen::Matrix<double, 3, 3>) +
          m_J_det.capacity() * sizeof(double) +
-         sizeof(m_integrationOptions);
+         sizeof(m_integrationOptions) +
+         sizeof(m_stats);
+}
+
+/************************************************************************/
+/*												integrationStats															*/
+/************************************************************************/
+const util::IntegrationStats&
+WorkspaceIntegratedState::integrationStats() const
+{
+  return m_stats;
 }
 
 /************************************************************************/
@@ -579,37 +711,46 @@ WorkspaceIntegratedState::integrateWhileValid(const Wrench2D& i_maxWrench,
   o_tinv = -1.;
 
   m_isInitialized = true;
+  m_conjugatePointT = -1.;
+  QSERL_PROFILE_ZONE("rod2d::integrateWhileValid");
+  QSERL_TRACE_SCOPE("rod2d::integrateWhileValid");
+  QSERL_ALLOCATION_SCOPE("rod2d::integrateWhileValid");
+  QSERL_METRICS(util::MetricsTimer latencyTimer(*s_integrationMetrics.integrateWhileValidSeconds));
+  m_stats.reset();
+  QSERL_STATS(util::StatsTimer totalTimer(m_stats.totalTimeNs));
 
   const Wrench2D mu_0(Eigen::Matrix<double, 3, 1>(m_mu[0].data()));
   if(Rod::isConfigurationSingular(mu_0))
   {
-    return IR_SINGULAR;
+    return countResult(IR_SINGULAR);
   }
 
   const double stiffnessCoefficient = Rod::getStiffnessCoefficients(m_rodParameters);
   const double invStiffness = 1. / stiffnessCoefficient;
   CostateSystem costate_system(invStiffness, m_rodParameters.length, m_rodParameters.rodModel);
+  auto&& stepped_costate_system = util::instrument(costate_system, m_stats);
   boost::numeric::odeint::runge_kutta4<costate_type> css_stepper;
 
   // init mu(0) = a					(base DLO wrench)
   costate_type mu_t = m_mu[0];
 
-  // until C++0x, there is no convenient way to release memory of a vector
-  // so we use temporary allocated vectors if we do not want our instance
-  // memory print to explode.
+  // values which are not kept are computed in per thread buffers, so that our instance memory print
+  // does not explode.
   std::vector<costate_type>* mu_buffer;
   if(m_integrationOptions.keepMuValues)
   {
     mu_buffer = &m_mu;
+    m_mu.resize(1);
   }
   else
   {
-    mu_buffer = new std::vector<costate_type>();
-    (*mu_buffer).push_back(m_mu[0]);
+    mu_buffer = &scratchBuffer<SB_MU, costate_type>();
+    mu_buffer->assign(1, m_mu[0]);
   }
 
   // init state integrator and q(0)
   StateSystem state_system(invStiffness, m_rodParameters.length, dt, *mu_buffer, m_rodParameters.rodModel);
+  auto&& stepped_state_system = util::instrument(state_system, m_stats);
   boost::numeric::odeint::runge_kutta4<state_type> sss_stepper;
   state_type q_t = StateSystem::defaultState();
   m_nodes.clear();
@@ -619,12 +760,15 @@ WorkspaceIntegratedState::integrateWhileValid(const Wrench2D& i_maxWrench,
 
   // init jacobian integarator and M_0 to identity and J_0 to zero
   JacobianSystem jacobianSystem(invStiffness, dt, *mu_buffer, m_rodParameters.rodModel);
+  auto&& stepped_jacobian_system = util::instrument(jacobianSystem, m_stats);
   boost::numeric::odeint::runge_kutta4<jacobian_state_type> jacobianStepper;
   jacobian_state_type jacobian_t;
   Eigen::Map<Eigen::Matrix<double, 3, 3> > M_t_e(jacobian_t.data());
   Eigen::Map<Eigen::Matrix<double, 3, 3> > J_t_e(jacobian_t.data() + 9);
   M_t_e.setIdentity();
   J_t_e.setZero();
+  m_M.clear();
+  m_J.clear();
   if(m_integrationOptions.keepMMatrices)
   {
     m_M.push_back(M_t_e);
@@ -648,7 +792,8 @@ WorkspaceIntegratedState::integrateWhileValid(const Wrench2D& i_maxWrench,
   while(isStable and not isOutOfWrenchBounds and iter < maxIter)
   {
     // integrate co-state
-    css_stepper.do_step(costate_system, mu_t, t, dt);
+    css_stepper.do_step(stepped_costate_system, mu_t, t, dt);
+    QSERL_STATS(++m_stats.numSteps);
     Wrench2D scaledMaxWrench;
     if(t > 1.)
     {
@@ -671,24 +816,34 @@ WorkspaceIntegratedState::integrateWhileValid(const Wrench2D& i_maxWrench,
     {
       (*mu_buffer).push_back(mu_t);
       // integrate jacobian
-      jacobianStepper.do_step(jacobianSystem, jacobian_t, t, dt);
+      const jacobian_state_type jacobian_prev = jacobian_t;
+      jacobianStepper.do_step(stepped_jacobian_system, jacobian_t, t, dt);
+      QSERL_STATS(++m_stats.numSteps);
       Eigen::Map<Eigen::Matrix<double, 3, 3> > J_cur = Eigen::Map<Eigen::Matrix<double, 3, 3> >(jacobian_t.data() + 9);
       // compute jacobian and check stability
       Jdet_prev = Jdet_cur;
-      Jdet_cur = J_cur.determinant();
-      if(abs(Jdet_cur) > JacobianSystem::kStabilityThreshold)
+      {
+        QSERL_STATS(util::StatsTimer determinantTimer(m_stats.determinantTimeNs));
+        Jdet_cur = J_cur.determinant();
+      }
+      if(!isThresholdOn && abs(Jdet_cur) > JacobianSystem::kStabilityThreshold)
       {
         isThresholdOn = true;
+        QSERL_STATS(m_stats.stabilityThresholdNode = iter);
       }
       if(isThresholdOn && (abs(Jdet_cur) < JacobianSystem::kStabilityTolerance ||
                            Jdet_cur * Jdet_prev < 0.))  // zero crossing
       {
         isStable = false;
+        m_conjugatePointT = locateConjugatePoint(jacobianSystem, jacobian_prev, jacobian_t, t, dt,
+                                                 m_integrationOptions.conjugatePointTolerance);
       }
       if(isStable)
       {
         // integrate state
-        sss_stepper.do_step(state_system, q_t, t, dt);
+        sss_stepper.do_step(stepped_state_system, q_t, t, dt);
+        QSERL_STATS(++m_stats.numSteps);
+        QSERL_STATS(util::StatsTimer storageTimer(m_stats.storageTimeNs));
         if(m_integrationOptions.keepMMatrices)
         {
           m_M.push_back(Eigen::Map<Eigen::Matrix<double, 3, 3> >(jacobian_t.data()));
@@ -714,23 +869,18 @@ WorkspaceIntegratedState::integrateWhileValid(const Wrench2D& i_maxWrench,
     }
   }
 
-  if(not m_integrationOptions.keepMuValues)
-  {
-    delete mu_buffer;
-  }
-
   if(!isStable)
   {
     // conjugate point found
-    o_tinv = t;
-    return IR_UNSTABLE;
+    o_tinv = m_conjugatePointT;
+    return countResult(IR_UNSTABLE);
   }
   else if(isOutOfWrenchBounds)
   {
     o_tinv = t;
-    return IR_OUT_OF_WRENCH_BOUNDS;
+    return countResult(IR_OUT_OF_WRENCH_BOUNDS);
   }
-  return IR_VALID;
+  return countResult(IR_VALID);
 }
 
 /************************************************************************/
@@ -743,7 +893,8 @@ WorkspaceIntegratedState::IntegrationOptions::IntegrationOptions() :
     keepMMatrices(false),
     keepJMatrices(false),
     computeJacobians(true),
-    integrator(WorkspaceIntegratedState::IN_RK4)
+    integrator(WorkspaceIntegratedState::IN_RK4),
+    conjugatePointTolerance(1.e-9)
 {
 }
 
@@ -19,308 +19,348 @@
 
 #include "full_system.h"
 #include <Eigen/Geometry>
-#include "util/lie_algebra_utils.h"
 
 namespace qserl {
 namespace rod3d {
 
-FullSystem::state_type
-FullSystem::defaultState()
+namespace {
+
+template<typename ScalarT>
+Eigen::Matrix<ScalarT, 3, 3>
+hat(const Eigen::Matrix<ScalarT, 3, 1>& i_v)
+{
+  Eigen::Matrix<ScalarT, 3, 3> out;
+  out << 0., -i_v[2], i_v[1],
+      i_v[2], 0., -i_v[0],
+      -i_v[1], i_v[0], 0.;
+  return out;
+}
+
+} // namespace
+
+template<typename ScalarT, typename JacobianScalarT>
+typename FullSystemTpl<ScalarT, JacobianScalarT>::state_type
+FullSystemTpl<ScalarT, JacobianScalarT>::defaultState()
 {
   state_type defaultStateArray;
-  defaultStateArray.fill(0.);
+  std::fill(costateData(defaultStateArray), costateData(defaultStateArray) + 22, ScalarT(0));
+  std::fill(jacobianData(defaultStateArray), jacobianData(defaultStateArray) + 72, JacobianScalarT(0));
   return defaultStateArray;
 }
 
-FullSystem::FullSystem(const Parameters& i_params,
-                             double i_dt) :
-  m_inv_c(i_params.stiffnessCoefficients.cwiseInverse()),
+template<typename ScalarT, typename JacobianScalarT>
+FullSystemTpl<ScalarT, JacobianScalarT>::FullSystemTpl(const Parameters& i_params,
+                                                       double i_dt) :
+  m_inv_c(i_params.stiffnessCoefficients.cwiseInverse().template cast<ScalarT>()),
+  m_jacobian_inv_c(i_params.stiffnessCoefficients.cwiseInverse().template cast<JacobianScalarT>()),
   m_rodParameters(i_params),
   m_dt(i_dt),
   m_stability_threshold(1.e-5),
   m_stability_tolerance(1.e-12)
 {
-  using namespace std::placeholders;
-
-  m_b[0] = m_inv_c[2] - m_inv_c[1];
-  m_b[1] = m_inv_c[0] - m_inv_c[2];
-  m_b[2] = m_inv_c[1] - m_inv_c[0];
-  m_b[3] = m_inv_c[5] - m_inv_c[4];
-  m_b[4] = m_inv_c[3] - m_inv_c[5];
-  m_b[5] = m_inv_c[4] - m_inv_c[3];
+  const Eigen::Matrix<double, 6, 1> inv_c = i_params.stiffnessCoefficients.cwiseInverse();
+  m_b[0] = static_cast<JacobianScalarT>(inv_c[2] - inv_c[1]);
+  m_b[1] = static_cast<JacobianScalarT>(inv_c[0] - inv_c[2]);
+  m_b[2] = static_cast<JacobianScalarT>(inv_c[1] - inv_c[0]);
+  m_b[3] = static_cast<JacobianScalarT>(inv_c[5] - inv_c[4]);
+  m_b[4] = static_cast<JacobianScalarT>(inv_c[3] - inv_c[5]);
+  m_b[5] = static_cast<JacobianScalarT>(inv_c[4] - inv_c[3]);
 
   if(m_rodParameters.rodModel == Parameters::RM_INEXTENSIBLE)
   {
-    m_evaluationCallback = std::bind(&FullSystem::evaluateInextensible, this, _1, _2, _3);
+    m_evaluationCallback = &FullSystemTpl::evaluateInextensible;
   }
   else if(m_rodParameters.rodModel == Parameters::RM_EXTENSIBLE_SHEARABLE)
   {
-    m_evaluationCallback = std::bind(&FullSystem::evaluateExtensibleShearable, this, _1, _2, _3);
+    m_evaluationCallback = &FullSystemTpl::evaluateExtensibleShearable;
   }
   else if(m_rodParameters.rodModel == Parameters::RM_INEXTENSIBLE_WITH_GRAVITY)
   {
     // XXX Note that w will be pointing to the opposite direction of gravity
     const Eigen::Vector3d w = -m_rodParameters.gravity * m_rodParameters.unitaryMass;
-    m_w_x_0 = Eigen::Vector4d{w[0], w[1], w[2], 0.};
-    m_evaluationCallback = std::bind(&FullSystem::evaluateInextensibleWithGravity, this, _1, _2, _3);
+    m_w_x_0 = Eigen::Vector4d{w[0], w[1], w[2], 0.}.template cast<ScalarT>();
+    m_evaluationCallback = &FullSystemTpl::evaluateInextensibleWithGravity;
   }
   else
     assert(false && "invalid rod model");
 }
 
-FullSystem::~FullSystem()
+template<typename ScalarT, typename JacobianScalarT>
+FullSystemTpl<ScalarT, JacobianScalarT>::~FullSystemTpl()
 {
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 void
-FullSystem::operator()(const state_type& i_x,
-                          state_type& o_dxdt,
-                          double i_t)
+FullSystemTpl<ScalarT, JacobianScalarT>::operator()(const state_type& i_x,
+                                                    state_type& o_dxdt,
+                                                    double i_t)
 {
-  return m_evaluationCallback(i_x, o_dxdt, i_t);
+  return (this->*m_evaluationCallback)(i_x, o_dxdt, i_t);
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 void
-FullSystem::evaluateInextensible(const state_type& i_x,
-                                    state_type& o_dxdt,
-                                    double /*i_t*/)
+FullSystemTpl<ScalarT, JacobianScalarT>::evaluateInextensible(const state_type& i_x,
+                                                              state_type& o_dxdt,
+                                                              double /*i_t*/)
 {
   // ----------------------
   // costate
-  static const Eigen::Matrix<double, 3, 1> ke_1 = Eigen::Matrix3d::Identity().col(0);
-  const Eigen::Map<const Eigen::Matrix<double, 3, 1> > m_e(i_x.data() + mu_index());
-  const Eigen::Map<const Eigen::Matrix<double, 3, 1> > f_e(i_x.data() + mu_index() + 3);
-  const Eigen::Matrix<double, 3, 1> u = m_e.cwiseProduct(m_inv_c.block<3, 1>(0, 0));
+  const Vector3 ke_1 = Vector3::UnitX();
+  const Eigen::Map<const Vector3> m_e(costateData(i_x) + mu_index());
+  const Eigen::Map<const Vector3> f_e(costateData(i_x) + mu_index() + 3);
+  const Vector3 u = m_e.cwiseProduct(m_inv_c.template head<3>());
 
-  Eigen::Map<Eigen::Matrix<double, 3, 1> > dmdt_e(o_dxdt.data() + mu_index());
-  Eigen::Map<Eigen::Matrix<double, 3, 1> > dfdt_e(o_dxdt.data() + mu_index() + 3);
+  Eigen::Map<Vector3> dmdt_e(costateData(o_dxdt) + mu_index());
+  Eigen::Map<Vector3> dfdt_e(costateData(o_dxdt) + mu_index() + 3);
 
   dmdt_e = -u.cross(m_e) - (ke_1).cross(f_e);
   dfdt_e = -u.cross(f_e);
 
   // ----------------------
   // state
-  Eigen::Matrix4d u_hat_h;
+  Matrix4 u_hat_h;
   u_hat_h << 0, -u[2], u[1], 1.,
     u[2], 0., -u[0], 0.,
     -u[1], u[0], 0., 0.,
     0., 0., 0., 0.;
 
-  const Eigen::Map<const Eigen::Matrix4d> q_e(i_x.data() + q_index());
-  Eigen::Map<Eigen::Matrix4d> dqdt_e(o_dxdt.data() + q_index());
+  const Eigen::Map<const Matrix4> q_e(costateData(i_x) + q_index());
+  Eigen::Map<Matrix4> dqdt_e(costateData(o_dxdt) + q_index());
 
   dqdt_e = q_e * u_hat_h;
 
   // ----------------------
   // Jacobians
-  const Eigen::Map<const Eigen::Matrix<double, 6, 1> > mu_k(i_x.data() + mu_index());
+  const JacobianVector6 mu_k =
+    Eigen::Map<const Eigen::Matrix<ScalarT, 6, 1> >(costateData(i_x) + mu_index()).template cast<JacobianScalarT>();
+  const JacobianVector3 u_k = u.template cast<JacobianScalarT>();
+  const JacobianVector6& inv_c = m_jacobian_inv_c;
 
   // F matrix
-  Eigen::Matrix<double, 6, 6> F;
+  JacobianMatrix6 F;
   F << 0., mu_k[2] * m_b[0], mu_k[1] * m_b[0], 0., 0., 0.,
     mu_k[2] * m_b[1], 0, mu_k[0] * m_b[1], 0., 0., 1.,
     mu_k[1] * m_b[2], mu_k[0] * m_b[2], 0., 0., -1., 0.,
-    0., -mu_k[5] * m_inv_c[1], mu_k[4] * m_inv_c[2], 0., u[2], -u[1],
-    mu_k[5] * m_inv_c[0], 0, -mu_k[3] * m_inv_c[2], -u[2], 0., u[0],
-    -mu_k[4] * m_inv_c[0], mu_k[3] * m_inv_c[1], 0, u[1], -u[0], 0.;
+    0., -mu_k[5] * inv_c[1], mu_k[4] * inv_c[2], 0., u_k[2], -u_k[1],
+    mu_k[5] * inv_c[0], 0, -mu_k[3] * inv_c[2], -u_k[2], 0., u_k[0],
+    -mu_k[4] * inv_c[0], mu_k[3] * inv_c[1], 0, u_k[1], -u_k[0], 0.;
 
   // G matrix
-  Eigen::Matrix<double, 6, 6> G;
+  JacobianMatrix6 G;
   G.setZero();
-  G.diagonal() << m_inv_c[0], m_inv_c[1], m_inv_c[2], 0, 0, 0;
+  G.diagonal() << inv_c[0], inv_c[1], inv_c[2], 0, 0, 0;
 
   // H matrix
-  Eigen::Matrix<double, 6, 6> H;
-  H << 0, u[2], -u[1], 0, 0, 0,
-    -u[2], 0, u[0], 0, 0, 0,
-    u[1], -u[0], 0, 0, 0, 0,
-    0, 0, 0, 0, u[2], -u[1],
-    0, 0, 1, -u[2], 0, u[0],
-    0, -1, 0, u[1], -u[0], 0;
+  JacobianMatrix6 H;
+  H << 0, u_k[2], -u_k[1], 0, 0, 0,
+    -u_k[2], 0, u_k[0], 0, 0, 0,
+    u_k[1], -u_k[0], 0, 0, 0, 0,
+    0, 0, 0, 0, u_k[2], -u_k[1],
+    0, 0, 1, -u_k[2], 0, u_k[0],
+    0, -1, 0, u_k[1], -u_k[0], 0;
 
   // create mapping between mj array and M & J eigen matrices
-  const Eigen::Map<const Eigen::Matrix<double, 6, 6> > M_e(i_x.data() + MJ_index());
-  const Eigen::Map<const Eigen::Matrix<double, 6, 6> > J_e(i_x.data() + MJ_index() + 36);
+  const Eigen::Map<const JacobianMatrix6> M_e(jacobianData(i_x));
+  const Eigen::Map<const JacobianMatrix6> J_e(jacobianData(i_x) + J_index());
 
   // create mapping between dmjdt array and dMdt & dJdt eigen matrices
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > dMdt_e(o_dxdt.data() + MJ_index());
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > dJdt_e(o_dxdt.data() + MJ_index() + 36);
+  Eigen::Map<JacobianMatrix6> dMdt_e(jacobianData(o_dxdt));
+  Eigen::Map<JacobianMatrix6> dJdt_e(jacobianData(o_dxdt) + J_index());
 
   dMdt_e = F * M_e;
   dJdt_e = G * M_e + H * J_e;
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 void
-FullSystem::evaluateInextensibleWithGravity(const state_type& i_x,
-                                               state_type& o_dxdt,
-                                               double /*i_t*/)
+FullSystemTpl<ScalarT, JacobianScalarT>::evaluateInextensibleWithGravity(const state_type& i_x,
+                                                                         state_type& o_dxdt,
+                                                                         double /*i_t*/)
 {
   // ----------------------
   // costate
-  static const Eigen::Matrix<double, 3, 1> ke_1 = Eigen::Matrix3d::Identity().col(0);
-  const Eigen::Map<const Eigen::Matrix<double, 3, 1> > m_e(i_x.data() + mu_index());
-  const Eigen::Map<const Eigen::Matrix<double, 3, 1> > f_e(i_x.data() + mu_index() + 3);
-  const Eigen::Matrix<double, 3, 1> u = m_e.cwiseProduct(m_inv_c.block<3, 1>(0, 0));
+  const Vector3 ke_1 = Vector3::UnitX();
+  const Eigen::Map<const Vector3> m_e(costateData(i_x) + mu_index());
+  const Eigen::Map<const Vector3> f_e(costateData(i_x) + mu_index() + 3);
+  const Vector3 u = m_e.cwiseProduct(m_inv_c.template head<3>());
 
-  Eigen::Map<Eigen::Matrix<double, 3, 1> > dmdt_e(o_dxdt.data() + mu_index());
-  Eigen::Map<Eigen::Matrix<double, 3, 1> > dfdt_e(o_dxdt.data() + mu_index() + 3);
+  Eigen::Map<Vector3> dmdt_e(costateData(o_dxdt) + mu_index());
+  Eigen::Map<Vector3> dfdt_e(costateData(o_dxdt) + mu_index() + 3);
 
-  const Eigen::Map<const Eigen::Matrix4d> q_e(i_x.data() + q_index());
-  const Eigen::Vector3d w_x = (q_e * m_w_x_0).block<3, 1>(0, 0);
+  const Eigen::Map<const Matrix4> q_e(costateData(i_x) + q_index());
+  const Vector3 w_x = (q_e * m_w_x_0).template head<3>();
 
   dmdt_e = -u.cross(m_e) - (ke_1).cross(f_e);
   dfdt_e = -u.cross(f_e) + w_x;
 
   // ----------------------
   // state
-  Eigen::Matrix4d u_hat_h;
+  Matrix4 u_hat_h;
   u_hat_h << 0, -u[2], u[1], 1.,
     u[2], 0., -u[0], 0.,
     -u[1], u[0], 0., 0.,
     0., 0., 0., 0.;
 
-  Eigen::Map<Eigen::Matrix4d> dqdt_e(o_dxdt.data() + q_index());
+  Eigen::Map<Matrix4> dqdt_e(costateData(o_dxdt) + q_index());
 
   dqdt_e = q_e * u_hat_h;
 
   // ----------------------
   // Jacobians
-  const Eigen::Map<const Eigen::Matrix<double, 6, 1> > mu_k(i_x.data() + mu_index());
+  const JacobianVector6 mu_k =
+    Eigen::Map<const Eigen::Matrix<ScalarT, 6, 1> >(costateData(i_x) + mu_index()).template cast<JacobianScalarT>();
+  const JacobianVector3 u_k = u.template cast<JacobianScalarT>();
+  const JacobianVector6& inv_c = m_jacobian_inv_c;
 
   // F matrix
-  Eigen::Matrix<double, 6, 6> F;
+  JacobianMatrix6 F;
   F << 0., mu_k[2] * m_b[0], mu_k[1] * m_b[0], 0., 0., 0.,
     mu_k[2] * m_b[1], 0, mu_k[0] * m_b[1], 0., 0., 1.,
     mu_k[1] * m_b[2], mu_k[0] * m_b[2], 0., 0., -1., 0.,
-    0., -mu_k[5] * m_inv_c[1], mu_k[4] * m_inv_c[2], 0., u[2], -u[1],
-    mu_k[5] * m_inv_c[0], 0, -mu_k[3] * m_inv_c[2], -u[2], 0., u[0],
-    -mu_k[4] * m_inv_c[0], mu_k[3] * m_inv_c[1], 0, u[1], -u[0], 0.;
+    0., -mu_k[5] * inv_c[1], mu_k[4] * inv_c[2], 0., u_k[2], -u_k[1],
+    mu_k[5] * inv_c[0], 0, -mu_k[3] * inv_c[2], -u_k[2], 0., u_k[0],
+    -mu_k[4] * inv_c[0], mu_k[3] * inv_c[1], 0, u_k[1], -u_k[0], 0.;
 
   // G matrix
-  Eigen::Matrix<double, 6, 6> G;
+  JacobianMatrix6 G;
   G.setZero();
-  G.diagonal() << m_inv_c[0], m_inv_c[1], m_inv_c[2], 0, 0, 0;
+  G.diagonal() << inv_c[0], inv_c[1], inv_c[2], 0, 0, 0;
 
   // H matrix
-  Eigen::Matrix<double, 6, 6> H;
-  H << 0, u[2], -u[1], 0, 0, 0,
-    -u[2], 0, u[0], 0, 0, 0,
-    u[1], -u[0], 0, 0, 0, 0,
-    0, 0, 0, 0, u[2], -u[1],
-    0, 0, 1, -u[2], 0, u[0],
-    0, -1, 0, u[1], -u[0], 0;
+  JacobianMatrix6 H;
+  H << 0, u_k[2], -u_k[1], 0, 0, 0,
+    -u_k[2], 0, u_k[0], 0, 0, 0,
+    u_k[1], -u_k[0], 0, 0, 0, 0,
+    0, 0, 0, 0, u_k[2], -u_k[1],
+    0, 0, 1, -u_k[2], 0, u_k[0],
+    0, -1, 0, u_k[1], -u_k[0], 0;
 
   // K matrix
-  Eigen::Matrix<double, 6, 6> K;
+  JacobianMatrix6 K;
   K.setZero();
-  K.block<3, 3>(3, 0) = util::hat(w_x);
+  K.template block<3, 3>(3, 0) = hat<JacobianScalarT>(w_x.template cast<JacobianScalarT>());
 
   // create mapping between mj array and M & J eigen matrices
-  const Eigen::Map<const Eigen::Matrix<double, 6, 6> > M_e(i_x.data() + MJ_index());
-  const Eigen::Map<const Eigen::Matrix<double, 6, 6> > J_e(i_x.data() + MJ_index() + 36);
+  const Eigen::Map<const JacobianMatrix6> M_e(jacobianData(i_x));
+  const Eigen::Map<const JacobianMatrix6> J_e(jacobianData(i_x) + J_index());
 
   // create mapping between dmjdt array and dMdt & dJdt eigen matrices
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > dMdt_e(o_dxdt.data() + MJ_index());
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > dJdt_e(o_dxdt.data() + MJ_index() + 36);
+  Eigen::Map<JacobianMatrix6> dMdt_e(jacobianData(o_dxdt));
+  Eigen::Map<JacobianMatrix6> dJdt_e(jacobianData(o_dxdt) + J_index());
 
   dMdt_e = F * M_e - K * J_e;
   dJdt_e = G * M_e + H * J_e;
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 void
-FullSystem::evaluateExtensibleShearable(const state_type& i_x,
-                                           state_type& o_dxdt,
-                                           double /*i_t*/)
+FullSystemTpl<ScalarT, JacobianScalarT>::evaluateExtensibleShearable(const state_type& i_x,
+                                                                     state_type& o_dxdt,
+                                                                     double /*i_t*/)
 {
   // ----------------------
   // costate
-  static const Eigen::Matrix<double, 3, 1> ke_1 = Eigen::Matrix3d::Identity().col(0);
-  const Eigen::Map<const Eigen::Matrix<double, 3, 1> > m_e(i_x.data() + mu_index());
-  const Eigen::Map<const Eigen::Matrix<double, 3, 1> > f_e(i_x.data() + mu_index() + 3);
-  const Eigen::Matrix<double, 3, 1> u_m = m_e.cwiseProduct(m_inv_c.block<3, 1>(0, 0));
-  const Eigen::Matrix<double, 3, 1> u_f = f_e.cwiseProduct(m_inv_c.block<3, 1>(3, 0));
+  const Vector3 ke_1 = Vector3::UnitX();
+  const Eigen::Map<const Vector3> m_e(costateData(i_x) + mu_index());
+  const Eigen::Map<const Vector3> f_e(costateData(i_x) + mu_index() + 3);
+  const Vector3 u_m = m_e.cwiseProduct(m_inv_c.template head<3>());
+  const Vector3 u_f = f_e.cwiseProduct(m_inv_c.template tail<3>());
 
-  Eigen::Map<Eigen::Matrix<double, 3, 1> > dmdt_e(o_dxdt.data() + mu_index());
-  Eigen::Map<Eigen::Matrix<double, 3, 1> > dfdt_e(o_dxdt.data() + mu_index() + 3);
+  Eigen::Map<Vector3> dmdt_e(costateData(o_dxdt) + mu_index());
+  Eigen::Map<Vector3> dfdt_e(costateData(o_dxdt) + mu_index() + 3);
 
   dmdt_e = -u_m.cross(m_e) - (u_f + ke_1).cross(f_e);
   dfdt_e = -u_m.cross(f_e);
 
   // ----------------------
   // state
-  Eigen::Matrix4d u_hat_h;
+  Matrix4 u_hat_h;
   u_hat_h << 0, -u_m[2], u_m[1], (1 + u_f[0]),
     u_m[2], 0., -u_m[0], u_f[1],
     -u_m[1], u_m[0], 0., u_f[2],
     0., 0., 0., 0.;
 
-  const Eigen::Map<const Eigen::Matrix4d> q_e(i_x.data() + q_index());
-  Eigen::Map<Eigen::Matrix4d> dqdt_e(o_dxdt.data() + q_index());
+  const Eigen::Map<const Matrix4> q_e(costateData(i_x) + q_index());
+  Eigen::Map<Matrix4> dqdt_e(costateData(o_dxdt) + q_index());
 
   dqdt_e = q_e * u_hat_h;
 
   // ----------------------
   // Jacobians
-  const Eigen::Map<const Eigen::Matrix<double, 6, 1> > mu_k(i_x.data() + mu_index());
+  const JacobianVector6 mu_k =
+    Eigen::Map<const Eigen::Matrix<ScalarT, 6, 1> >(costateData(i_x) + mu_index()).template cast<JacobianScalarT>();
+  const JacobianVector3 u_mk = u_m.template cast<JacobianScalarT>();
+  const JacobianVector3 u_fk = u_f.template cast<JacobianScalarT>();
+  const JacobianVector6& inv_c = m_jacobian_inv_c;
 
   // F matrix
-  Eigen::Matrix<double, 6, 6> F;
+  JacobianMatrix6 F;
   F << 0., mu_k[2] * m_b[0], mu_k[1] * m_b[0], 0., mu_k[5] * m_b[3], mu_k[4] * m_b[3],
     mu_k[2] * m_b[1], 0, mu_k[0] * m_b[1], mu_k[5] * m_b[4], 0., 1 + mu_k[3] * m_b[4],
     mu_k[1] * m_b[2], mu_k[0] * m_b[2], 0., mu_k[4] * m_b[5], -1 + mu_k[3] * m_b[5], 0.,
-    0., -mu_k[5] * m_inv_c[1], mu_k[4] * m_inv_c[2], 0., u_m[2], -u_m[1],
-    mu_k[5] * m_inv_c[0], 0, -mu_k[3] * m_inv_c[2], -u_m[2], 0., u_m[0],
-    -mu_k[4] * m_inv_c[0], mu_k[3] * m_inv_c[1], 0, u_m[1], -u_m[0], 0.;
+    0., -mu_k[5] * inv_c[1], mu_k[4] * inv_c[2], 0., u_mk[2], -u_mk[1],
+    mu_k[5] * inv_c[0], 0, -mu_k[3] * inv_c[2], -u_mk[2], 0., u_mk[0],
+    -mu_k[4] * inv_c[0], mu_k[3] * inv_c[1], 0, u_mk[1], -u_mk[0], 0.;
 
   // G matrix
-  Eigen::Matrix<double, 6, 6> G;
+  JacobianMatrix6 G;
   G.setZero();
-  G.diagonal() << m_inv_c[0], m_inv_c[1], m_inv_c[2], m_inv_c[3], m_inv_c[4], m_inv_c[5];
+  G.diagonal() << inv_c[0], inv_c[1], inv_c[2], inv_c[3], inv_c[4], inv_c[5];
 
   // H matrix
-  Eigen::Matrix<double, 6, 6> H;
-  H << 0, u_m[2], -u_m[1], 0, 0, 0,
-    -u_m[2], 0, u_m[0], 0, 0, 0,
-    u_m[1], -u_m[0], 0, 0, 0, 0,
-    0, u_f[2], -u_f[1], 0, u_m[2], -u_m[1],
-    -u_f[2], 0, 1 + u_f[0], -u_m[2], 0, u_m[0],
-    u_f[1], -1 - u_f[0], 0, u_m[1], -u_m[0], 0;
+  JacobianMatrix6 H;
+  H << 0, u_mk[2], -u_mk[1], 0, 0, 0,
+    -u_mk[2], 0, u_mk[0], 0, 0, 0,
+    u_mk[1], -u_mk[0], 0, 0, 0, 0,
+    0, u_fk[2], -u_fk[1], 0, u_mk[2], -u_mk[1],
+    -u_fk[2], 0, 1 + u_fk[0], -u_mk[2], 0, u_mk[0],
+    u_fk[1], -1 - u_fk[0], 0, u_mk[1], -u_mk[0], 0;
 
   // create mapping between mj array and M & J eigen matrices
-  const Eigen::Map<const Eigen::Matrix<double, 6, 6> > M_e(i_x.data() + MJ_index());
-  const Eigen::Map<const Eigen::Matrix<double, 6, 6> > J_e(i_x.data() + MJ_index() + 36);
+  const Eigen::Map<const JacobianMatrix6> M_e(jacobianData(i_x));
+  const Eigen::Map<const JacobianMatrix6> J_e(jacobianData(i_x) + J_index());
 
   // create mapping between dmjdt array and dMdt & dJdt eigen matrices
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > dMdt_e(o_dxdt.data() + MJ_index());
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > dJdt_e(o_dxdt.data() + MJ_index() + 36);
+  Eigen::Map<JacobianMatrix6> dMdt_e(jacobianData(o_dxdt));
+  Eigen::Map<JacobianMatrix6> dJdt_e(jacobianData(o_dxdt) + J_index());
 
   dMdt_e = F * M_e;
   dJdt_e = G * M_e + H * J_e;
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 double
-FullSystem::jacobianStabilityThreshold() const
+FullSystemTpl<ScalarT, JacobianScalarT>::jacobianStabilityThreshold() const
 {
   return m_stability_threshold;
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 void
-FullSystem::jacobianStabilityThreshold(double stability_threshold)
+FullSystemTpl<ScalarT, JacobianScalarT>::jacobianStabilityThreshold(double stability_threshold)
 {
   m_stability_threshold = stability_threshold;
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 double
-FullSystem::jacobianStabilityTolerance() const
+FullSystemTpl<ScalarT, JacobianScalarT>::jacobianStabilityTolerance() const
 {
   return m_stability_tolerance;
 }
 
+template<typename ScalarT, typename JacobianScalarT>
 void
-FullSystem::jacobianStabilityTolerance(double stability_tolerance)
+FullSystemTpl<ScalarT, JacobianScalarT>::jacobianStabilityTolerance(double stability_tolerance)
 {
   m_stability_tolerance = stability_tolerance;
 }
 
+template class FullSystemTpl<double>;
+template class FullSystemTpl<float>;
+template class FullSystemTpl<double, float>;
+
 }  // namespace rod3d
 }  // namespace qserl
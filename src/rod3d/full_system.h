@@ -22,27 +22,142 @@
 
 #include "qserl/exports.h"
 
-#include <functional>
+#include <boost/numeric/odeint/algebra/range_algebra.hpp>
+
 #include "qserl/rod3d/workspace_integrated_state.h"
 
 namespace qserl {
 namespace rod3d {
 
-class QSERL_EXPORT FullSystem
+/**
+* \brief State of a full system integrated in mixed precision, with the costate mu and the state q in ScalarT
+* and the M and J matrices in JacobianScalarT.
+*/
+template<typename ScalarT, typename JacobianScalarT>
+struct MixedFullState
+{
+  std::array<ScalarT, 22> x;            /**< 6 first are costate mu, 16 following for state q (4x4 matrix). */
+  std::array<JacobianScalarT, 72> mj;   /**< M and J matrices resp (2 x (6x6) matrices). */
+};
+
+/**
+* \brief odeint algebra of MixedFullState, applying operations to both of its parts.
+*/
+struct MixedFullStateAlgebra
+{
+  template<typename S1, typename S2, typename Op>
+  static void
+  for_each2(S1& s1, S2& s2, Op op)
+  {
+    boost::numeric::odeint::range_algebra::for_each2(s1.x, s2.x, op);
+    boost::numeric::odeint::range_algebra::for_each2(s1.mj, s2.mj, op);
+  }
+
+  template<typename S1, typename S2, typename S3, typename Op>
+  static void
+  for_each3(S1& s1, S2& s2, S3& s3, Op op)
+  {
+    boost::numeric::odeint::range_algebra::for_each3(s1.x, s2.x, s3.x, op);
+    boost::numeric::odeint::range_algebra::for_each3(s1.mj, s2.mj, s3.mj, op);
+  }
+
+  template<typename S1, typename S2, typename S3, typename S4, typename Op>
+  static void
+  for_each4(S1& s1, S2& s2, S3& s3, S4& s4, Op op)
+  {
+    boost::numeric::odeint::range_algebra::for_each4(s1.x, s2.x, s3.x, s4.x, op);
+    boost::numeric::odeint::range_algebra::for_each4(s1.mj, s2.mj, s3.mj, s4.mj, op);
+  }
+
+  template<typename S1, typename S2, typename S3, typename S4, typename S5, typename Op>
+  static void
+  for_each5(S1& s1, S2& s2, S3& s3, S4& s4, S5& s5, Op op)
+  {
+    boost::numeric::odeint::range_algebra::for_each5(s1.x, s2.x, s3.x, s4.x, s5.x, op);
+    boost::numeric::odeint::range_algebra::for_each5(s1.mj, s2.mj, s3.mj, s4.mj, s5.mj, op);
+  }
+
+  template<typename S1, typename S2, typename S3, typename S4, typename S5, typename S6, typename Op>
+  static void
+  for_each6(S1& s1, S2& s2, S3& s3, S4& s4, S5& s5, S6& s6, Op op)
+  {
+    boost::numeric::odeint::range_algebra::for_each6(s1.x, s2.x, s3.x, s4.x, s5.x, s6.x, op);
+    boost::numeric::odeint::range_algebra::for_each6(s1.mj, s2.mj, s3.mj, s4.mj, s5.mj, s6.mj, op);
+  }
+};
+
+/**
+* \brief Layout of the state of a full system: a single array when both scalar types match, a MixedFullState
+* otherwise.
+*/
+template<typename ScalarT, typename JacobianScalarT>
+struct FullStateTraits
+{
+  typedef MixedFullState<ScalarT, JacobianScalarT> state_type;
+  typedef MixedFullStateAlgebra algebra_type;
+  typedef double value_type;    /**< Scalar type of the stepper coefficients. */
+
+  static ScalarT*
+  costateData(state_type& io_x) { return io_x.x.data(); }
+
+  static const ScalarT*
+  costateData(const state_type& i_x) { return i_x.x.data(); }
+
+  static JacobianScalarT*
+  jacobianData(state_type& io_x) { return io_x.mj.data(); }
+
+  static const JacobianScalarT*
+  jacobianData(const state_type& i_x) { return i_x.mj.data(); }
+};
+
+template<typename ScalarT>
+struct FullStateTraits<ScalarT, ScalarT>
+{
+  typedef std::array<ScalarT, 94> state_type;
+  typedef boost::numeric::odeint::range_algebra algebra_type;
+  typedef ScalarT value_type;
+
+  static ScalarT*
+  costateData(state_type& io_x) { return io_x.data(); }
+
+  static const ScalarT*
+  costateData(const state_type& i_x) { return i_x.data(); }
+
+  static ScalarT*
+  jacobianData(state_type& io_x) { return io_x.data() + 22; }
+
+  static const ScalarT*
+  jacobianData(const state_type& i_x) { return i_x.data() + 22; }
+};
+
+/**
+* \brief Costate, state and Jacobian system of the 3D rod, integrated with mu and q in ScalarT and the M and J
+* matrices in JacobianScalarT.
+* Explicitly instantiated for double (FullSystem), float (FullSystemFloat) and mixed double/float
+* (FullSystemMixed) precisions.
+*/
+template<typename ScalarT, typename JacobianScalarT = ScalarT>
+class QSERL_EXPORT FullSystemTpl
 {
 public:
-  typedef std::array<double, 94> state_type; /**< 6 first are costate mu,
+  typedef ScalarT scalar_type;
+  typedef JacobianScalarT jacobian_scalar_type;
+  typedef FullStateTraits<ScalarT, JacobianScalarT> traits_type;
+  typedef typename traits_type::state_type state_type; /**< 6 first are costate mu,
                                                   16 following for state q (4x4 matrix),
                                                   72 following for M and J matrices resp (2 x (6x6) matrices).
-                                                  See index helpers <x>_index() methods below. */
+                                                  See index helpers <x>_index() and costateData() /
+                                                  jacobianData() methods below. */
+  typedef typename traits_type::algebra_type algebra_type;
+  typedef typename traits_type::value_type value_type;
 
   /**
   * Constructors, destructors
   */
-  FullSystem(const Parameters& i_params,
+  FullSystemTpl(const Parameters& i_params,
                 double i_dt);
 
-  virtual ~FullSystem();
+  virtual ~FullSystemTpl();
 
   void
   operator()(const state_type& i_x,
@@ -54,22 +169,40 @@ public:
   defaultState();
 
   /**
-   * @return starting index of costate mu within a full state
+   * @return pointer to the costate mu and the state q of a full state, see mu_index() and q_index()
+   */
+  static ScalarT*
+  costateData(state_type& io_x) { return traits_type::costateData(io_x); }
+
+  static const ScalarT*
+  costateData(const state_type& i_x) { return traits_type::costateData(i_x); }
+
+  /**
+   * @return pointer to the jacobian state of a full state, M matrix followed by J matrix
+   */
+  static JacobianScalarT*
+  jacobianData(state_type& io_x) { return traits_type::jacobianData(io_x); }
+
+  static const JacobianScalarT*
+  jacobianData(const state_type& i_x) { return traits_type::jacobianData(i_x); }
+
+  /**
+   * @return starting index of costate mu within costateData()
    */
   static size_t
   mu_index() { return 0ul; }
 
   /**
-   * @return starting index of state q within a full state
+   * @return starting index of state q within costateData()
    */
   static size_t
   q_index() { return 6ul; }
 
   /**
-   * @return starting index of jacobian state (M and J matrices) within a full state
+   * @return starting index of J matrix within jacobianData()
    */
   static size_t
-  MJ_index() { return 22ul; }
+  J_index() { return 36ul; }
 
   /**
    * @brief The determinant of the jacobian, starting at 0 for t=0, is checked for zero-crossing
@@ -106,9 +239,15 @@ public:
   jacobianStabilityTolerance(double stability_tolerance);
 
 private:
+  typedef Eigen::Matrix<ScalarT, 3, 1> Vector3;
+  typedef Eigen::Matrix<ScalarT, 4, 4> Matrix4;
+  typedef Eigen::Matrix<JacobianScalarT, 3, 1> JacobianVector3;
+  typedef Eigen::Matrix<JacobianScalarT, 6, 1> JacobianVector6;
+  typedef Eigen::Matrix<JacobianScalarT, 6, 6> JacobianMatrix6;
 
-  Eigen::Matrix<double, 6, 1> m_inv_c;    /**< Inverse stiffness coefficients (already stored in parameters, but used to speedup the computation. */
-  Eigen::Matrix<double, 6, 1> m_b;      /**<	Precomputed values from inverse stiffness coefficients, where:
+  Eigen::Matrix<ScalarT, 6, 1> m_inv_c;    /**< Inverse stiffness coefficients (already stored in parameters, but used to speedup the computation. */
+  JacobianVector6 m_jacobian_inv_c;     /**< Inverse stiffness coefficients in the precision of the jacobian state. */
+  JacobianVector6 m_b;      /**<	Precomputed values from inverse stiffness coefficients, where:
                                           b(1) = inv_c(3) - inv_c(2)
                                           b(2) = inv_c(1) - inv_c(3)
                                           b(3) = inv_c(2) - inv_c(1)
@@ -116,15 +255,17 @@ private:
                                           b(5) = inv_c(4) - inv_c(6)
                                           b(6) = inv_c(5) - inv_c(4)
                                           */
-  Eigen::Vector4d m_w_x_0;                /** Gravity field in base frame. */
+  Eigen::Matrix<ScalarT, 4, 1> m_w_x_0;   /** Gravity field in base frame. */
   Parameters m_rodParameters;
   double m_dt;
   double m_stability_threshold;
   double m_stability_tolerance;
 
-  std::function<void(const state_type&,
-                     state_type&,
-                     double)> m_evaluationCallback;
+  /** Derivative evaluation of the rod model, a member function pointer so that systems are cheap to copy
+  and do not allocate. */
+  void (FullSystemTpl::*m_evaluationCallback)(const state_type&,
+                                              state_type&,
+                                              double);
 
   /**
   * Derivative evaluation at time t for the inextensible (RM_INEXTENSIBLE) rod model.
@@ -151,6 +292,14 @@ private:
                                   double i_t);
 };
 
+typedef FullSystemTpl<double> FullSystem;                 /**< Double precision system. */
+typedef FullSystemTpl<float> FullSystemFloat;             /**< Single precision system. */
+typedef FullSystemTpl<double, float> FullSystemMixed;     /**< Costate and state in double, M and J in float. */
+
+extern template class FullSystemTpl<double>;
+extern template class FullSystemTpl<float>;
+extern template class FullSystemTpl<double, float>;
+
 }  // namespace rod3d
 }  // namespace qserl
 
@@ -18,19 +18,63 @@
 **/
 
 #include <qserl/rod3d/ik.h>
+#include <qserl/util/allocation_tracker.h>
 #include <qserl/util/explog.h>
+#include <qserl/util/logger.h>
+#include <qserl/util/metrics.h>
+#include <qserl/util/profiler.h>
+#include <qserl/util/trace.h>
 
-#include <iostream>
+#include "util/stats.h"
 
 namespace qserl {
 namespace rod3d {
 
+  namespace {
+#ifdef QSERL_ENABLE_METRICS
+    /// Process wide metrics of the inverse kinematics, registered at static initialization.
+    struct IkMetrics
+    {
+      IkMetrics () :
+        iterations (&util::Metrics::histogram ("qserl_rod3d_ik_iterations",
+              "Number of iterations of the inverse kinematics.",
+              std::vector<double> {0, 1, 2, 3, 5, 8, 13, 20, 50, 100})),
+        seconds (&util::Metrics::histogram ("qserl_rod3d_ik_seconds",
+              "Duration of the inverse kinematics, in seconds.",
+              util::Histogram::exponentialBounds (1e-5, 4., 12)))
+      {
+        static const char* const kResultNames[InverseKinematics::IR_NUMBER_OF_INTEGRATION_RESULTS] =
+          { "valid", "jacobian_singular", "integration_failed", "max_iter_reached" };
+        for (int result = 0; result < InverseKinematics::IR_NUMBER_OF_INTEGRATION_RESULTS; ++result)
+          results[result] = &util::Metrics::counter (std::string ("qserl_rod3d_ik_results_total{result=\"")
+              + kResultNames[result] + "\"}", "Number of inverse kinematics calls, by result.");
+      }
+
+      util::Counter* results[InverseKinematics::IR_NUMBER_OF_INTEGRATION_RESULTS];
+      util::Histogram* iterations;
+      util::Histogram* seconds;
+    };
+
+    const IkMetrics s_ikMetrics;
+#endif
+
+    /// Counts given result and number of iterations in the process wide metrics and returns the result.
+    InverseKinematics::ResultT countResult (InverseKinematics::ResultT result, int numIterations)
+    {
+      QSERL_METRICS(s_ikMetrics.results[result]->increment());
+      QSERL_METRICS(s_ikMetrics.iterations->observe (numIterations));
+      (void) numIterations;
+      return result;
+    }
+  }
+
   InverseKinematics::InverseKinematics (const RodConstShPtr& rod) :
     m_rod (rod),
     m_squareErrorThr (1e-6),
     m_maxIter (20),
-    m_verbosity (INT_MAX),
-    m_scale (1.)
+    m_verbosity (0),
+    m_scale (1.),
+    m_stats ()
   {}
 
   InverseKinematics::ResultT InverseKinematics::compute (const WorkspaceIntegratedStateShPtr& state,
@@ -46,32 +90,45 @@ namespace rod3d {
     typedef Eigen::FullPivLU<Matrix6d> Decomposition;
     Decomposition decomposition (6,6);
 
+    QSERL_PROFILE_ZONE ("rod3d::ik");
+    QSERL_TRACE_SCOPE ("rod3d::ik");
+    QSERL_ALLOCATION_SCOPE ("rod3d::ik");
+    QSERL_METRICS(util::MetricsTimer latencyTimer (*s_ikMetrics.seconds));
+    m_stats.reset();
+    QSERL_STATS(util::StatsTimer totalTimer (m_stats.totalTimeNs));
+
     int iter = m_maxIter;
     while (true) {
-      iMt = iMo * state->nodes()[iNode];
+      iMt = iMo * state->node (iNode);
       error = log6 (iMt);
       double errorNorm2 = error.squaredNorm();
-      if (iter % m_verbosity == 0)
-        std::cout << iter << '\t' << errorNorm2 << '\t' << w.transpose() << std::endl;
-      if (errorNorm2 < m_squareErrorThr) return IK_VALID;
-      if (iter == 0) return IK_MAX_ITER_REACHED;
+      if (m_verbosity > 0 && iter % m_verbosity == 0)
+        QSERL_LOG (util::LL_INFO, "ik: " << iter << '\t' << errorNorm2 << '\t' << w.transpose());
+      if (errorNorm2 < m_squareErrorThr) return countResult (IK_VALID, m_maxIter - iter);
+      if (iter == 0) return countResult (IK_MAX_ITER_REACHED, m_maxIter - iter);
 
-      const Matrix6d& J (state->getJMatrix (iNode));
-      decomposition.compute (J);
-      if (!decomposition.isInvertible())
-        return IK_JACOBIAN_SINGULAR;
-      dw = decomposition.solve (error);
+      QSERL_STATS(++m_stats.numIterations);
+      {
+        QSERL_PROFILE_ZONE ("rod3d::ik::linearSolve");
+        QSERL_STATS(util::StatsTimer linearSolveTimer (m_stats.linearSolveTimeNs));
+        const Matrix6d& J (state->getJMatrix (iNode));
+        decomposition.compute (J);
+        if (!decomposition.isInvertible())
+          return countResult (IK_JACOBIAN_SINGULAR, m_maxIter - iter);
+        dw = decomposition.solve (error);
+      }
 
       w -= m_scale * dw;
 
       m_lastResult = state->integrateFromBaseWrenchRK4 (w);
+      QSERL_STATS(m_stats += state->integrationStats());
 
       if (m_lastResult != WorkspaceIntegratedState::IR_VALID)
-        return IK_INTEGRATION_FAILED;
+        return countResult (IK_INTEGRATION_FAILED, m_maxIter - iter + 1);
 
       iter--;
     }
-    return IK_MAX_ITER_REACHED;
+    return countResult (IK_MAX_ITER_REACHED, m_maxIter - iter);
   }
 }  // namespace rod3d
 }  // namespace qserl
@@ -0,0 +1,454 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/rod3d/integration_cache.h"
+#include "qserl/util/metrics.h"
+#include "util/utils.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+
+namespace qserl {
+namespace rod3d {
+
+namespace {
+
+template<typename T>
+void
+appendBytes(std::string& io_key,
+            const T& i_value)
+{
+  io_key.append(reinterpret_cast<const char*>(&i_value), sizeof(T));
+}
+
+void
+appendDouble(std::string& io_key,
+             double i_value)
+{
+  // -0. and 0. must share the same key
+  appendBytes(io_key, i_value + 0.);
+}
+
+#ifdef QSERL_ENABLE_METRICS
+/**
+* \brief Lookups of all integration caches, registered at static initialization.
+*/
+util::Counter& s_hitsCounter = util::Metrics::counter("qserl_rod3d_integration_cache_hits_total",
+                                                      "Number of lookups found in integration caches.");
+util::Counter& s_missesCounter = util::Metrics::counter("qserl_rod3d_integration_cache_misses_total",
+                                                        "Number of lookups not found in integration caches.");
+util::Counter& s_persistentHitsCounter = util::Metrics::counter(
+    "qserl_rod3d_integration_cache_persistent_hits_total",
+    "Number of lookups found in the persistent caches of integration caches.");
+#endif
+
+} // namespace
+
+const size_t IntegrationCache::kDefaultGlobalMaxMemUsage;
+
+/************************************************************************/
+/*													Constructor																	*/
+/************************************************************************/
+IntegrationCache::IntegrationCache(size_t i_maxMemUsage,
+                                   double i_wrenchTolerance) :
+    m_maxMemUsage(i_maxMemUsage),
+    m_wrenchTolerance(i_wrenchTolerance),
+    m_mutex(),
+    m_entries(),
+    m_index(),
+    m_memUsage(0),
+    m_numHits(0),
+    m_numMisses(0),
+    m_numPersistentHits(0),
+    m_persistentCache()
+{
+}
+
+/************************************************************************/
+/*														create																		*/
+/************************************************************************/
+IntegrationCacheShPtr
+IntegrationCache::create(size_t i_maxMemUsage,
+                         double i_wrenchTolerance)
+{
+  assert(i_wrenchTolerance >= 0. && "wrench tolerance must be positive");
+  return IntegrationCacheShPtr(new IntegrationCache(i_maxMemUsage, i_wrenchTolerance));
+}
+
+/************************************************************************/
+/*															global																	*/
+/************************************************************************/
+const IntegrationCacheShPtr&
+IntegrationCache::global()
+{
+  static const IntegrationCacheShPtr s_globalCache = create(kDefaultGlobalMaxMemUsage);
+  return s_globalCache;
+}
+
+/************************************************************************/
+/*															key																			*/
+/************************************************************************/
+std::string
+IntegrationCache::key(const Wrench& i_wrench,
+                      const Parameters& i_rodParams,
+                      const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions) const
+{
+  std::string key;
+  key.reserve(sizeof(uint32_t) + 33 * sizeof(double));
+  // results of other integrator revisions are not reused, even if persisted in a shared cache
+  appendBytes(key, PersistentIntegrationCache::kIntegratorRevision);
+  appendDouble(key, i_rodParams.radius);
+  for(int k = 0; k < 6; ++k)
+  {
+    appendDouble(key, i_rodParams.stiffnessCoefficients[k]);
+  }
+  appendBytes(key, static_cast<int32_t>(i_rodParams.rodModel));
+  appendBytes(key, static_cast<int32_t>(i_rodParams.numNodes));
+  for(int k = 0; k < 3; ++k)
+  {
+    appendDouble(key, i_rodParams.gravity[k]);
+  }
+  appendDouble(key, i_rodParams.unitaryMass);
+  appendDouble(key, i_rodParams.integrationTime);
+
+  const char options[] = {i_integrationOptions.computeJ_nu_sv, i_integrationOptions.stop_if_unstable,
+                          i_integrationOptions.keepMuValues, i_integrationOptions.keepJdet,
+                          i_integrationOptions.keepMMatrices, i_integrationOptions.keepJMatrices,
+                          i_integrationOptions.keepPositionsSoA, i_integrationOptions.keepRotationsSoA,
+                          i_integrationOptions.keepQuaternionsSoA, i_integrationOptions.keepJSoA};
+  key.append(options, sizeof(options));
+  appendDouble(key, i_integrationOptions.conjugatePointTolerance);
+  appendBytes(key, static_cast<int32_t>(i_integrationOptions.precision));
+  appendBytes(key, static_cast<uint64_t>(i_integrationOptions.outputStride));
+  appendBytes(key, static_cast<uint64_t>(i_integrationOptions.checkpointInterval));
+  appendBytes(key, static_cast<uint64_t>(i_integrationOptions.outputNodes.size()));
+  for(const size_t nodeIdx : i_integrationOptions.outputNodes)
+  {
+    appendBytes(key, static_cast<uint64_t>(nodeIdx));
+  }
+
+  // the tolerance gives the meaning of the wrench part, which matters for keys shared by persistent caches
+  appendDouble(key, m_wrenchTolerance);
+  for(int k = 0; k < 6; ++k)
+  {
+    if(m_wrenchTolerance > 0.)
+    {
+      appendBytes(key, static_cast<int64_t>(std::floor(i_wrench[k] / m_wrenchTolerance)));
+    }
+    else
+    {
+      appendDouble(key, i_wrench[k]);
+    }
+  }
+  return key;
+}
+
+/************************************************************************/
+/*														KeyHash																		*/
+/************************************************************************/
+size_t
+IntegrationCache::KeyHash::operator()(const std::string& i_key) const
+{
+  return static_cast<size_t>(util::fnv1aHash(i_key));
+}
+
+/************************************************************************/
+/*														integrate																	*/
+/************************************************************************/
+WorkspaceIntegratedState::IntegrationResultT
+IntegrationCache::integrate(const Wrench& i_wrench,
+                            const Displacement& i_basePos,
+                            const Parameters& i_rodParams,
+                            const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+                            WorkspaceIntegratedStateShPtr& o_state)
+{
+  WorkspaceIntegratedState::IntegrationResultT result;
+  if(find(i_wrench, i_basePos, i_rodParams, i_integrationOptions, o_state, result))
+  {
+    return result;
+  }
+
+  // integration is done without lock, concurrent misses on the same key both integrate
+  o_state = WorkspaceIntegratedState::create(i_wrench, i_rodParams.numNodes, i_basePos, i_rodParams);
+  o_state->integrationOptions(i_integrationOptions);
+  result = o_state->integrate();
+  if(result != WorkspaceIntegratedState::IR_VALID)
+  {
+    o_state.reset();
+  }
+  insert(i_wrench, i_rodParams, i_integrationOptions, o_state, result);
+  return result;
+}
+
+/************************************************************************/
+/*															find																		*/
+/************************************************************************/
+bool
+IntegrationCache::find(const Wrench& i_wrench,
+                       const Displacement& i_basePos,
+                       const Parameters& i_rodParams,
+                       const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+                       WorkspaceIntegratedStateShPtr& o_state,
+                       WorkspaceIntegratedState::IntegrationResultT& o_result)
+{
+  const std::string entryKey = key(i_wrench, i_rodParams, i_integrationOptions);
+  WorkspaceIntegratedStateConstShPtr cachedState;
+  PersistentIntegrationCacheShPtr persistentCache;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const auto it = m_index.find(entryKey);
+    if(it != m_index.end())
+    {
+      ++m_numHits;
+      QSERL_METRICS(s_hitsCounter.increment());
+      // move to front of the LRU list
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      cachedState = it->second->state;
+      o_result = it->second->result;
+    }
+    else if(!m_persistentCache)
+    {
+      ++m_numMisses;
+      QSERL_METRICS(s_missesCounter.increment());
+      return false;
+    }
+    else
+    {
+      persistentCache = m_persistentCache;
+    }
+  }
+
+  // the persistent cache is read without lock, and its entries are kept in memory
+  if(persistentCache)
+  {
+    WorkspaceIntegratedStateShPtr persistentState;
+    const bool isFound = persistentCache->find(entryKey, persistentState, o_result);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if(!isFound)
+      {
+        ++m_numMisses;
+        QSERL_METRICS(s_missesCounter.increment());
+        return false;
+      }
+      ++m_numHits;
+      ++m_numPersistentHits;
+      QSERL_METRICS(s_hitsCounter.increment());
+      QSERL_METRICS(s_persistentHitsCounter.increment());
+    }
+    insertEntry(entryKey, persistentState, o_result);
+    cachedState = persistentState;
+  }
+
+  // copy outside of the lock, cached states are never modified
+  if(cachedState)
+  {
+    o_state = WorkspaceIntegratedState::createCopy(cachedState);
+    o_state->base(i_basePos);
+  }
+  else
+  {
+    o_state.reset();
+  }
+  return true;
+}
+
+/************************************************************************/
+/*															insert																	*/
+/************************************************************************/
+void
+IntegrationCache::insert(const Wrench& i_wrench,
+                         const Parameters& i_rodParams,
+                         const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+                         const WorkspaceIntegratedStateConstShPtr& i_state,
+                         WorkspaceIntegratedState::IntegrationResultT i_result)
+{
+  const std::string entryKey = key(i_wrench, i_rodParams, i_integrationOptions);
+  insertEntry(entryKey, i_state, i_result);
+  PersistentIntegrationCacheShPtr persistentCache;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    persistentCache = m_persistentCache;
+  }
+  if(persistentCache)
+  {
+    persistentCache->insert(entryKey, i_state, i_result);
+  }
+}
+
+/************************************************************************/
+/*														insertEntry																	*/
+/************************************************************************/
+void
+IntegrationCache::insertEntry(const std::string& i_key,
+                              const WorkspaceIntegratedStateConstShPtr& i_state,
+                              WorkspaceIntegratedState::IntegrationResultT i_result)
+{
+  assert((i_state || i_result != WorkspaceIntegratedState::IR_VALID) && "valid results must provide their state");
+  Entry entry;
+  entry.key = i_key;
+  if(i_result == WorkspaceIntegratedState::IR_VALID)
+  {
+    entry.state = WorkspaceIntegratedState::createCopy(i_state);
+  }
+  entry.result = i_result;
+  entry.memUsage = sizeof(Entry) + 2 * entry.key.capacity() + (entry.state ? entry.state->memUsage() : 0);
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+  const auto it = m_index.find(entry.key);
+  if(it != m_index.end())
+  {
+    m_memUsage -= it->second->memUsage;
+    m_entries.erase(it->second);
+    m_index.erase(it);
+  }
+  m_memUsage += entry.memUsage;
+  m_entries.push_front(std::move(entry));
+  m_index.insert(std::make_pair(m_entries.front().key, m_entries.begin()));
+  evict();
+}
+
+/************************************************************************/
+/*															evict																		*/
+/************************************************************************/
+void
+IntegrationCache::evict()
+{
+  while(m_memUsage > m_maxMemUsage && !m_entries.empty())
+  {
+    m_memUsage -= m_entries.back().memUsage;
+    m_index.erase(m_entries.back().key);
+    m_entries.pop_back();
+  }
+}
+
+/************************************************************************/
+/*															clear																		*/
+/************************************************************************/
+void
+IntegrationCache::clear()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_index.clear();
+  m_entries.clear();
+  m_memUsage = 0;
+}
+
+/************************************************************************/
+/*														persistentCache																	*/
+/************************************************************************/
+void
+IntegrationCache::persistentCache(const PersistentIntegrationCacheShPtr& i_persistentCache)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_persistentCache = i_persistentCache;
+}
+
+/************************************************************************/
+/*														persistentCache																	*/
+/************************************************************************/
+const PersistentIntegrationCacheShPtr&
+IntegrationCache::persistentCache() const
+{
+  return m_persistentCache;
+}
+
+/************************************************************************/
+/*															size																		*/
+/************************************************************************/
+size_t
+IntegrationCache::size() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_entries.size();
+}
+
+/************************************************************************/
+/*														memUsage																	*/
+/************************************************************************/
+size_t
+IntegrationCache::memUsage() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_memUsage;
+}
+
+/************************************************************************/
+/*													maxMemUsage																	*/
+/************************************************************************/
+size_t
+IntegrationCache::maxMemUsage() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_maxMemUsage;
+}
+
+/************************************************************************/
+/*														maxMemUsage																	*/
+/************************************************************************/
+void
+IntegrationCache::maxMemUsage(size_t i_maxMemUsage)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_maxMemUsage = i_maxMemUsage;
+  evict();
+}
+
+/************************************************************************/
+/*												wrenchTolerance																*/
+/************************************************************************/
+double
+IntegrationCache::wrenchTolerance() const
+{
+  return m_wrenchTolerance;
+}
+
+/************************************************************************/
+/*														numHits																		*/
+/************************************************************************/
+size_t
+IntegrationCache::numHits() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numHits;
+}
+
+/************************************************************************/
+/*														numMisses																	*/
+/************************************************************************/
+size_t
+IntegrationCache::numMisses() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numMisses;
+}
+
+/************************************************************************/
+/*														numPersistentHits																	*/
+/************************************************************************/
+size_t
+IntegrationCache::numPersistentHits() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numPersistentHits;
+}
+
+}  // namespace rod3d
+}  // namespace qserl
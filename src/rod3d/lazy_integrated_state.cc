@@ -0,0 +1,200 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/rod3d/lazy_integrated_state.h"
+
+#include <cassert>
+#include <stdexcept>
+
+namespace qserl {
+namespace rod3d {
+
+namespace {
+
+void
+throwResultNotValid()
+{
+  throw std::logic_error("qserl::rod3d::LazyIntegratedState: the integration result is not valid");
+}
+
+} // namespace
+
+/************************************************************************/
+/*														Constructor																	*/
+/************************************************************************/
+LazyIntegrationSettings::LazyIntegrationSettings(const Parameters& i_rodParams,
+                                                 const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions,
+                                                 const IntegrationCacheShPtr& i_cache) :
+    rodParameters(i_rodParams),
+    integrationOptions(i_integrationOptions),
+    cache(i_cache)
+{
+}
+
+/************************************************************************/
+/*														Constructor																	*/
+/************************************************************************/
+LazyIntegratedState::LazyIntegratedState(const Wrench& i_baseWrench,
+                                         const Displacement& i_basePosition,
+                                         const LazyIntegrationSettingsConstShPtr& i_settings) :
+    m_baseWrench(i_baseWrench),
+    m_base(i_basePosition),
+    m_settings(i_settings)
+{
+  assert(m_settings && "settings must be given");
+}
+
+/************************************************************************/
+/*														baseWrench																	*/
+/************************************************************************/
+const Wrench&
+LazyIntegratedState::baseWrench() const
+{
+  return m_baseWrench;
+}
+
+/************************************************************************/
+/*															base																		*/
+/************************************************************************/
+const Displacement&
+LazyIntegratedState::base() const
+{
+  return m_base;
+}
+
+/************************************************************************/
+/*															base																		*/
+/************************************************************************/
+void
+LazyIntegratedState::base(const Displacement& i_base)
+{
+  m_base = i_base;
+}
+
+/************************************************************************/
+/*															settings																	*/
+/************************************************************************/
+const LazyIntegrationSettingsConstShPtr&
+LazyIntegratedState::settings() const
+{
+  return m_settings;
+}
+
+/************************************************************************/
+/*															state																		*/
+/************************************************************************/
+WorkspaceIntegratedStateShPtr
+LazyIntegratedState::state(WorkspaceIntegratedState::IntegrationResultT& o_result) const
+{
+  WorkspaceIntegratedStateShPtr integratedState;
+  if(m_settings->cache)
+  {
+    o_result = m_settings->cache->integrate(m_baseWrench, m_base, m_settings->rodParameters,
+                                            m_settings->integrationOptions, integratedState);
+  }
+  else
+  {
+    integratedState = WorkspaceIntegratedState::create(m_baseWrench, m_settings->rodParameters.numNodes, m_base,
+                                                       m_settings->rodParameters);
+    integratedState->integrationOptions(m_settings->integrationOptions);
+    o_result = integratedState->integrate();
+    if(o_result != WorkspaceIntegratedState::IR_VALID)
+    {
+      integratedState.reset();
+    }
+  }
+  return integratedState;
+}
+
+/************************************************************************/
+/*															state																		*/
+/************************************************************************/
+WorkspaceIntegratedStateShPtr
+LazyIntegratedState::state() const
+{
+  WorkspaceIntegratedState::IntegrationResultT result;
+  return state(result);
+}
+
+/************************************************************************/
+/*															result																	*/
+/************************************************************************/
+WorkspaceIntegratedState::IntegrationResultT
+LazyIntegratedState::result() const
+{
+  WorkspaceIntegratedState::IntegrationResultT result;
+  state(result);
+  return result;
+}
+
+/************************************************************************/
+/*															nodes																		*/
+/************************************************************************/
+Displacements
+LazyIntegratedState::nodes() const
+{
+  const WorkspaceIntegratedStateShPtr integratedState = state();
+  if(!integratedState)
+  {
+    throwResultNotValid();
+  }
+  return integratedState->nodes();
+}
+
+/************************************************************************/
+/*															node																		*/
+/************************************************************************/
+Displacement
+LazyIntegratedState::node(size_t i_nodeIdx) const
+{
+  const WorkspaceIntegratedStateShPtr integratedState = state();
+  if(!integratedState)
+  {
+    throwResultNotValid();
+  }
+  return integratedState->node(i_nodeIdx);
+}
+
+/************************************************************************/
+/*														getJMatrix																	*/
+/************************************************************************/
+Matrix6d
+LazyIntegratedState::getJMatrix(size_t i_nodeIdx) const
+{
+  const WorkspaceIntegratedStateShPtr integratedState = state();
+  if(!integratedState)
+  {
+    throwResultNotValid();
+  }
+  return integratedState->getJMatrix(i_nodeIdx);
+}
+
+/************************************************************************/
+/*															memUsage																	*/
+/************************************************************************/
+size_t
+LazyIntegratedState::memUsage() const
+{
+  return sizeof(m_baseWrench) +
+         sizeof(m_base) +
+         sizeof(m_settings);
+}
+
+}  // namespace rod3d
+}  // namespace qserl
@@ -0,0 +1,681 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/rod3d/persistent_integration_cache.h"
+#include "qserl/rod3d/state_file.h"
+#include "util/utils.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QSERL_HAS_FLOCK
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qserl {
+namespace rod3d {
+
+/**
+* \brief Header of the index file, followed by its slots.
+*/
+struct PersistentIntegrationCache::IndexHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrderMark;
+  uint64_t numSlots;        /**< Power of two. */
+  uint64_t numEntries;
+  uint64_t firstSegment;    /**< Oldest segment. */
+  uint64_t lastSegment;     /**< Segment records are appended to. */
+  uint64_t diskUsage;       /**< Size of the segments from firstSegment to lastSegment. */
+  uint64_t integratorRevision;  /**< kIntegratorRevision of the library which created the index. */
+};
+
+/**
+* \brief Location of a record, empty if its hash is 0.
+*/
+struct PersistentIntegrationCache::IndexSlot
+{
+  uint64_t hash;
+  uint64_t segment;
+  uint64_t offset;
+  uint64_t size;
+};
+
+namespace {
+
+/**
+* \brief Header of a segment record, followed by its key and its state (at the next aligned offset).
+*/
+struct RecordHeader
+{
+  char magic[8];
+  uint32_t result;
+  uint32_t reserved;
+  uint64_t keySize;
+  uint64_t stateSize;
+};
+
+const char kIndexMagic[8] = {'Q', 'S', 'E', 'R', 'L', 'I', 'X', '\0'};
+const char kRecordMagic[8] = {'Q', 'S', 'E', 'R', 'L', 'R', 'C', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kAlignment = 64;     /**< Alignment of records, so that the arrays of stored states are aligned. */
+const size_t kNumSegments = 8;    /**< Number of segments the disk budget is split into. */
+
+size_t
+alignOffset(size_t i_offset)
+{
+  return (i_offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+/**
+* \brief FNV-1a hash of keys, 0 being reserved for empty slots.
+*/
+uint64_t
+keyHash(const std::string& i_key)
+{
+  const uint64_t hash = util::fnv1aHash(i_key);
+  return hash == 0 ? 1 : hash;
+}
+
+#ifdef QSERL_HAS_FLOCK
+/**
+* \brief Scoped lock of a file, shared or exclusive.
+*/
+class FileLock
+{
+public:
+  FileLock(int i_fd,
+           bool i_exclusive) :
+      m_fd(i_fd)
+  {
+    while(flock(m_fd, i_exclusive ? LOCK_EX : LOCK_SH) != 0 && errno == EINTR)
+    {
+    }
+  }
+
+  ~FileLock()
+  {
+    flock(m_fd, LOCK_UN);
+  }
+
+private:
+  int m_fd;
+};
+
+/**
+* \brief Returns the size of given file, 0 if it does not exist.
+*/
+size_t
+fileSize(const std::string& i_filename)
+{
+  struct stat fileStat;
+  return stat(i_filename.c_str(), &fileStat) == 0 ? static_cast<size_t>(fileStat.st_size) : 0;
+}
+#endif
+
+/**
+* \brief Returns true if the integration options of given state can be persisted in the StateFile format.
+*/
+bool
+isPersistable(const WorkspaceIntegratedState& i_state)
+{
+  const WorkspaceIntegratedState::IntegrationOptions& options = i_state.integrationOptions();
+  return options.checkpointInterval == 0 && !options.computeJ_nu_sv && !options.keepPositionsSoA &&
+         !options.keepRotationsSoA && !options.keepQuaternionsSoA && !options.keepJSoA &&
+         (!options.keepJdet || i_state.J_det().size() >= i_state.nodes().size());
+}
+
+} // namespace
+
+const size_t PersistentIntegrationCache::kDefaultMaxDiskUsage;
+const size_t PersistentIntegrationCache::kDefaultMaxEntries;
+const uint32_t PersistentIntegrationCache::kIntegratorRevision;
+
+/************************************************************************/
+/*														Constructor																	*/
+/************************************************************************/
+PersistentIntegrationCache::PersistentIntegrationCache(const std::string& i_directory,
+                                                       size_t i_maxDiskUsage) :
+    m_directory(i_directory),
+    m_maxDiskUsage(i_maxDiskUsage),
+    m_lockFd(-1),
+    m_index(),
+    m_mutex(),
+    m_segments()
+{
+}
+
+/************************************************************************/
+/*														Destructor																	*/
+/************************************************************************/
+PersistentIntegrationCache::~PersistentIntegrationCache()
+{
+#ifdef QSERL_HAS_FLOCK
+  if(m_lockFd >= 0)
+  {
+    ::close(m_lockFd);
+  }
+#endif
+}
+
+/************************************************************************/
+/*															open																		*/
+/************************************************************************/
+PersistentIntegrationCacheShPtr
+PersistentIntegrationCache::open(const std::string& i_directory,
+                                 size_t i_maxDiskUsage,
+                                 size_t i_maxEntries)
+{
+  assert(i_maxEntries > 0 && "maximum number of entries must be positive");
+  PersistentIntegrationCacheShPtr cache(new PersistentIntegrationCache(i_directory, i_maxDiskUsage));
+  if(!cache->init(i_maxEntries))
+  {
+    cache.reset();
+  }
+  return cache;
+}
+
+/************************************************************************/
+/*															init																		*/
+/************************************************************************/
+bool
+PersistentIntegrationCache::init(size_t i_maxEntries)
+{
+#ifdef QSERL_HAS_FLOCK
+  if(mkdir(m_directory.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    return false;
+  }
+  m_lockFd = ::open((m_directory + "/lock").c_str(), O_RDWR | O_CREAT, 0644);
+  if(m_lockFd < 0)
+  {
+    return false;
+  }
+  FileLock lock(m_lockFd, true);
+
+  const std::string indexFilename = m_directory + "/index.bin";
+  m_index = util::MappedFile::openWritable(indexFilename);
+  if(m_index && m_index->size() >= sizeof(IndexHeader))
+  {
+    const IndexHeader& indexHeader = header();
+    if(std::memcmp(indexHeader.magic, kIndexMagic, sizeof(kIndexMagic)) == 0)
+    {
+      if(indexHeader.version != kVersion || indexHeader.byteOrderMark != kByteOrderMark ||
+         indexHeader.numSlots == 0 || (indexHeader.numSlots & (indexHeader.numSlots - 1)) != 0 ||
+         m_index->size() != sizeof(IndexHeader) + indexHeader.numSlots * sizeof(IndexSlot))
+      {
+        return false;
+      }
+      if(indexHeader.integratorRevision == kIntegratorRevision)
+      {
+        return true;
+      }
+      // results of another integrator revision are stale, the index is created again
+    }
+    else
+    {
+      // an index without magic was not completely created, e.g. by a crashed process
+      static const char kEmptyMagic[sizeof(kIndexMagic)] = {};
+      if(std::memcmp(indexHeader.magic, kEmptyMagic, sizeof(kEmptyMagic)) != 0)
+      {
+        return false;
+      }
+    }
+  }
+
+  // segments of a previous index cannot be located anymore
+  removeSegments();
+  uint64_t numSlots = 16;
+  while(numSlots < 2 * i_maxEntries)
+  {
+    numSlots *= 2;
+  }
+  m_index = util::MappedFile::create(indexFilename, sizeof(IndexHeader) + numSlots * sizeof(IndexSlot));
+  if(!m_index)
+  {
+    return false;
+  }
+  std::memset(m_index->data(), 0, m_index->size());
+  IndexHeader& indexHeader = header();
+  indexHeader.version = kVersion;
+  indexHeader.byteOrderMark = kByteOrderMark;
+  indexHeader.numSlots = numSlots;
+  indexHeader.integratorRevision = kIntegratorRevision;
+  // the magic is written last, once the index is valid
+  std::memcpy(indexHeader.magic, kIndexMagic, sizeof(kIndexMagic));
+  return m_index->sync();
+#else
+  (void) i_maxEntries;
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*															header																	*/
+/************************************************************************/
+PersistentIntegrationCache::IndexHeader&
+PersistentIntegrationCache::header() const
+{
+  return *reinterpret_cast<IndexHeader*>(m_index->data());
+}
+
+/************************************************************************/
+/*															slots																		*/
+/************************************************************************/
+PersistentIntegrationCache::IndexSlot*
+PersistentIntegrationCache::slots() const
+{
+  return reinterpret_cast<IndexSlot*>(m_index->data() + sizeof(IndexHeader));
+}
+
+/************************************************************************/
+/*														segmentFilename																	*/
+/************************************************************************/
+std::string
+PersistentIntegrationCache::segmentFilename(uint64_t i_segment) const
+{
+  return m_directory + "/segment_" + std::to_string(i_segment) + ".bin";
+}
+
+/************************************************************************/
+/*															segment																	*/
+/************************************************************************/
+util::MappedFileConstShPtr
+PersistentIntegrationCache::segment(uint64_t i_segment,
+                                    size_t i_minSize)
+{
+  // segments deleted by any process are not mapped anymore by this instance
+  m_segments.erase(m_segments.begin(), m_segments.lower_bound(header().firstSegment));
+
+  util::MappedFileConstShPtr& file = m_segments[i_segment];
+  if(!file || file->size() < i_minSize)
+  {
+    // records appended since the segment was mapped are mapped again
+    file = util::MappedFile::open(segmentFilename(i_segment));
+  }
+  if(!file || file->size() < i_minSize)
+  {
+    m_segments.erase(i_segment);
+    return util::MappedFileConstShPtr();
+  }
+  return file;
+}
+
+/************************************************************************/
+/*														readRecord																	*/
+/************************************************************************/
+bool
+PersistentIntegrationCache::readRecord(const IndexSlot& i_slot,
+                                       const std::string& i_key,
+                                       util::MappedFileConstShPtr& o_segment,
+                                       WorkspaceIntegratedState::IntegrationResultT& o_result,
+                                       size_t& o_stateOffset,
+                                       size_t& o_stateSize)
+{
+  const IndexHeader& indexHeader = header();
+  if(i_slot.segment < indexHeader.firstSegment || i_slot.segment > indexHeader.lastSegment ||
+     i_slot.offset % kAlignment != 0 || i_slot.size < sizeof(RecordHeader))
+  {
+    return false;
+  }
+  o_segment = segment(i_slot.segment, i_slot.offset + i_slot.size);
+  if(!o_segment)
+  {
+    return false;
+  }
+
+  const char* record = o_segment->data() + i_slot.offset;
+  RecordHeader recordHeader;
+  std::memcpy(&recordHeader, record, sizeof(RecordHeader));
+  o_stateOffset = alignOffset(sizeof(RecordHeader) + i_key.size());
+  if(std::memcmp(recordHeader.magic, kRecordMagic, sizeof(kRecordMagic)) != 0 ||
+     recordHeader.keySize != i_key.size() ||
+     recordHeader.result >= WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS ||
+     o_stateOffset + recordHeader.stateSize != i_slot.size ||
+     std::memcmp(record + sizeof(RecordHeader), i_key.data(), i_key.size()) != 0)
+  {
+    return false;
+  }
+  o_result = static_cast<WorkspaceIntegratedState::IntegrationResultT>(recordHeader.result);
+  o_stateOffset += static_cast<size_t>(i_slot.offset);
+  o_stateSize = static_cast<size_t>(recordHeader.stateSize);
+  return true;
+}
+
+/************************************************************************/
+/*															findSlot																	*/
+/************************************************************************/
+const PersistentIntegrationCache::IndexSlot*
+PersistentIntegrationCache::findSlot(uint64_t i_hash,
+                                     const std::string& i_key,
+                                     util::MappedFileConstShPtr& o_segment,
+                                     WorkspaceIntegratedState::IntegrationResultT& o_result,
+                                     size_t& o_stateOffset,
+                                     size_t& o_stateSize)
+{
+  const uint64_t mask = header().numSlots - 1;
+  const IndexSlot* indexSlots = slots();
+  // linear probing, the index load is at most one half
+  for(uint64_t idx = i_hash & mask; indexSlots[idx].hash != 0; idx = (idx + 1) & mask)
+  {
+    if(indexSlots[idx].hash == i_hash &&
+       readRecord(indexSlots[idx], i_key, o_segment, o_result, o_stateOffset, o_stateSize))
+    {
+      return &indexSlots[idx];
+    }
+  }
+  return nullptr;
+}
+
+/************************************************************************/
+/*															find																		*/
+/************************************************************************/
+bool
+PersistentIntegrationCache::find(const std::string& i_key,
+                                 WorkspaceIntegratedStateShPtr& o_state,
+                                 WorkspaceIntegratedState::IntegrationResultT& o_result)
+{
+#ifdef QSERL_HAS_FLOCK
+  const uint64_t hash = keyHash(i_key);
+  util::MappedFileConstShPtr segmentFile;
+  size_t stateOffset, stateSize;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    FileLock fileLock(m_lockFd, false);
+    if(!findSlot(hash, i_key, segmentFile, o_result, stateOffset, stateSize))
+    {
+      return false;
+    }
+  }
+
+  // records are never modified, and the mapping remains valid if the segment is deleted meanwhile
+  o_state.reset();
+  if(o_result == WorkspaceIntegratedState::IR_VALID)
+  {
+    const StateFileConstShPtr stateFile = StateFile::open(segmentFile, stateOffset, stateSize);
+    if(!stateFile)
+    {
+      return false;
+    }
+    o_state = stateFile->state();
+  }
+  return true;
+#else
+  (void) i_key;
+  (void) o_state;
+  (void) o_result;
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*															insert																	*/
+/************************************************************************/
+bool
+PersistentIntegrationCache::insert(const std::string& i_key,
+                                   const WorkspaceIntegratedStateConstShPtr& i_state,
+                                   WorkspaceIntegratedState::IntegrationResultT i_result)
+{
+#ifdef QSERL_HAS_FLOCK
+  assert((i_state || i_result != WorkspaceIntegratedState::IR_VALID) && "valid results must provide their state");
+  // the record is serialized without lock
+  std::vector<char> record(alignOffset(sizeof(RecordHeader) + i_key.size()), 0);
+  if(i_result == WorkspaceIntegratedState::IR_VALID)
+  {
+    if(!isPersistable(*i_state))
+    {
+      return false;
+    }
+    std::vector<char> stateBytes;
+    StateFile::serialize(*i_state, StateFile::kAllArrays, NE_FULL, stateBytes);
+    record.insert(record.end(), stateBytes.begin(), stateBytes.end());
+  }
+  RecordHeader recordHeader;
+  std::memcpy(recordHeader.magic, kRecordMagic, sizeof(kRecordMagic));
+  recordHeader.result = static_cast<uint32_t>(i_result);
+  recordHeader.reserved = 0;
+  recordHeader.keySize = i_key.size();
+  recordHeader.stateSize = record.size() - alignOffset(sizeof(RecordHeader) + i_key.size());
+  std::memcpy(record.data(), &recordHeader, sizeof(RecordHeader));
+  std::memcpy(record.data() + sizeof(RecordHeader), i_key.data(), i_key.size());
+  if(record.size() + kAlignment > m_maxDiskUsage)
+  {
+    return false;
+  }
+
+  const uint64_t hash = keyHash(i_key);
+  std::lock_guard<std::mutex> lock(m_mutex);
+  FileLock fileLock(m_lockFd, true);
+  util::MappedFileConstShPtr segmentFile;
+  WorkspaceIntegratedState::IntegrationResultT result;
+  size_t stateOffset, stateSize;
+  if(findSlot(hash, i_key, segmentFile, result, stateOffset, stateSize))
+  {
+    // inserted by another process or thread
+    return true;
+  }
+
+  // makes room for the record, a new segment is started so that the current one can be deleted if needed
+  IndexHeader& indexHeader = header();
+  const size_t maxEntries = static_cast<size_t>(indexHeader.numSlots / 2);
+  size_t segmentSize = fileSize(segmentFilename(indexHeader.lastSegment));
+  const bool isFull = indexHeader.numEntries + 1 > maxEntries ||
+                      indexHeader.diskUsage + record.size() + kAlignment > m_maxDiskUsage;
+  if(segmentSize > 0 && (isFull || segmentSize + record.size() > m_maxDiskUsage / kNumSegments))
+  {
+    ++indexHeader.lastSegment;
+    segmentSize = 0;
+  }
+  while((indexHeader.numEntries + 1 > maxEntries ||
+         indexHeader.diskUsage + record.size() + kAlignment > m_maxDiskUsage) &&
+        indexHeader.firstSegment < indexHeader.lastSegment)
+  {
+    evictOldestSegment();
+  }
+
+  // appends the record at the next aligned offset of the segment
+  const int fd = ::open(segmentFilename(indexHeader.lastSegment).c_str(), O_WRONLY | O_CREAT, 0644);
+  if(fd < 0)
+  {
+    return false;
+  }
+  const size_t offset = alignOffset(segmentSize);
+  size_t written = 0;
+  while(written < record.size())
+  {
+    const ssize_t numBytes = pwrite(fd, record.data() + written, record.size() - written,
+                                    static_cast<off_t>(offset + written));
+    if(numBytes < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if(numBytes <= 0)
+    {
+      // a partially written record is not indexed
+      ::close(fd);
+      return false;
+    }
+    written += static_cast<size_t>(numBytes);
+  }
+  ::close(fd);
+  indexHeader.diskUsage += offset + record.size() - segmentSize;
+
+  // the hash is written last, so that a crash leaves either no slot or a complete one
+  const uint64_t mask = indexHeader.numSlots - 1;
+  IndexSlot* indexSlots = slots();
+  uint64_t idx = hash & mask;
+  while(indexSlots[idx].hash != 0)
+  {
+    idx = (idx + 1) & mask;
+  }
+  indexSlots[idx].segment = indexHeader.lastSegment;
+  indexSlots[idx].offset = offset;
+  indexSlots[idx].size = record.size();
+  indexSlots[idx].hash = hash;
+  ++indexHeader.numEntries;
+  return true;
+#else
+  (void) i_key;
+  (void) i_state;
+  (void) i_result;
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*														evictOldestSegment																	*/
+/************************************************************************/
+void
+PersistentIntegrationCache::evictOldestSegment()
+{
+#ifdef QSERL_HAS_FLOCK
+  IndexHeader& indexHeader = header();
+  const std::string filename = segmentFilename(indexHeader.firstSegment);
+  const size_t segmentSize = fileSize(filename);
+  std::remove(filename.c_str());
+  indexHeader.diskUsage -= std::min(static_cast<size_t>(indexHeader.diskUsage), segmentSize);
+  ++indexHeader.firstSegment;
+  m_segments.erase(m_segments.begin(), m_segments.lower_bound(indexHeader.firstSegment));
+
+  // open addressing without tombstones: the remaining entries are inserted again
+  IndexSlot* indexSlots = slots();
+  std::vector<IndexSlot> remainingSlots;
+  remainingSlots.reserve(static_cast<size_t>(indexHeader.numEntries));
+  for(uint64_t idx = 0; idx < indexHeader.numSlots; ++idx)
+  {
+    if(indexSlots[idx].hash != 0 && indexSlots[idx].segment >= indexHeader.firstSegment)
+    {
+      remainingSlots.push_back(indexSlots[idx]);
+    }
+  }
+  std::memset(indexSlots, 0, indexHeader.numSlots * sizeof(IndexSlot));
+  const uint64_t mask = indexHeader.numSlots - 1;
+  for(const IndexSlot& slot : remainingSlots)
+  {
+    uint64_t idx = slot.hash & mask;
+    while(indexSlots[idx].hash != 0)
+    {
+      idx = (idx + 1) & mask;
+    }
+    indexSlots[idx] = slot;
+  }
+  indexHeader.numEntries = remainingSlots.size();
+#endif
+}
+
+/************************************************************************/
+/*														removeSegments																	*/
+/************************************************************************/
+void
+PersistentIntegrationCache::removeSegments() const
+{
+#ifdef QSERL_HAS_FLOCK
+  DIR* dir = opendir(m_directory.c_str());
+  if(!dir)
+  {
+    return;
+  }
+  std::vector<std::string> filenames;
+  while(const struct dirent* entry = readdir(dir))
+  {
+    const std::string filename(entry->d_name);
+    if(filename.compare(0, 8, "segment_") == 0 && filename.size() > 12 &&
+       filename.compare(filename.size() - 4, 4, ".bin") == 0)
+    {
+      filenames.push_back(m_directory + "/" + filename);
+    }
+  }
+  closedir(dir);
+  for(const std::string& filename : filenames)
+  {
+    std::remove(filename.c_str());
+  }
+#endif
+}
+
+/************************************************************************/
+/*														directory																	*/
+/************************************************************************/
+const std::string&
+PersistentIntegrationCache::directory() const
+{
+  return m_directory;
+}
+
+/************************************************************************/
+/*															size																		*/
+/************************************************************************/
+size_t
+PersistentIntegrationCache::size() const
+{
+#ifdef QSERL_HAS_FLOCK
+  std::lock_guard<std::mutex> lock(m_mutex);
+  FileLock fileLock(m_lockFd, false);
+  return static_cast<size_t>(header().numEntries);
+#else
+  return 0;
+#endif
+}
+
+/************************************************************************/
+/*														diskUsage																	*/
+/************************************************************************/
+size_t
+PersistentIntegrationCache::diskUsage() const
+{
+#ifdef QSERL_HAS_FLOCK
+  std::lock_guard<std::mutex> lock(m_mutex);
+  FileLock fileLock(m_lockFd, false);
+  return static_cast<size_t>(header().diskUsage);
+#else
+  return 0;
+#endif
+}
+
+/************************************************************************/
+/*														maxDiskUsage																	*/
+/************************************************************************/
+size_t
+PersistentIntegrationCache::maxDiskUsage() const
+{
+  return m_maxDiskUsage;
+}
+
+/************************************************************************/
+/*														maxEntries																	*/
+/************************************************************************/
+size_t
+PersistentIntegrationCache::maxEntries() const
+{
+  return static_cast<size_t>(header().numSlots / 2);
+}
+
+}  // namespace rod3d
+}  // namespace qserl
@@ -31,7 +31,9 @@ namespace rod3d {
 Rod::Rod(const Parameters& i_parameters) :
     m_weakPtr{},
     m_staticParameters{i_parameters},
-    m_state{}
+    m_state{},
+    m_spareState{},
+    m_integrationCache{}
 {
 }
 
@@ -82,17 +84,58 @@ Rod::integrateStateFromBaseWrench(const Wrench& i_wrench,
                                   const Displacement& i_basePos,
                                   const WorkspaceIntegratedState::IntegrationOptions& i_integrationOptions)
 {
-  WorkspaceIntegratedStateShPtr intState = WorkspaceIntegratedState::create(i_wrench, m_staticParameters.numNodes,
-                                                                            i_basePos, m_staticParameters);
-  intState->integrationOptions(i_integrationOptions);
-  WorkspaceIntegratedState::IntegrationResultT success = intState->integrate();
+  WorkspaceIntegratedState::IntegrationResultT success;
+  if(m_integrationCache)
+  {
+    WorkspaceIntegratedStateShPtr intState;
+    success = m_integrationCache->integrate(i_wrench, i_basePos, m_staticParameters, i_integrationOptions, intState);
+    if(success == WorkspaceIntegratedState::IR_VALID)
+    {
+      m_state = intState;
+    }
+    return success;
+  }
+
+  // the spare state is integrated in place, unless someone else still references it
+  if(!m_spareState || m_spareState.use_count() > 1)
+  {
+    m_spareState = WorkspaceIntegratedState::create(i_wrench, m_staticParameters.numNodes, i_basePos,
+                                                    m_staticParameters);
+  }
+  else
+  {
+    m_spareState->base(i_basePos);
+  }
+  m_spareState->integrationOptions(i_integrationOptions);
+  success = m_spareState->integrateFromBaseWrenchRK4(i_wrench);
   if(success == WorkspaceIntegratedState::IR_VALID)
   {
-    m_state = intState;
+    // the replaced state becomes the spare one
+    WorkspaceStateShPtr previousState = m_state;
+    m_state = m_spareState;
+    m_spareState = std::dynamic_pointer_cast<WorkspaceIntegratedState>(previousState);
   }
   return success;
 }
 
+/************************************************************************/
+/*												integrationCache															*/
+/************************************************************************/
+void
+Rod::integrationCache(const IntegrationCacheShPtr& i_cache)
+{
+  m_integrationCache = i_cache;
+}
+
+/************************************************************************/
+/*												integrationCache															*/
+/************************************************************************/
+const IntegrationCacheShPtr&
+Rod::integrationCache() const
+{
+  return m_integrationCache;
+}
+
 /************************************************************************/
 /*												radius																				*/
 /************************************************************************/
@@ -0,0 +1,807 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/rod3d/state_file.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace qserl {
+namespace rod3d {
+
+namespace {
+
+typedef WorkspaceIntegratedState::IntegrationOptions IntegrationOptions;
+
+const char kMagic[8] = {'Q', 'S', 'E', 'R', 'L', 'S', 'T', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kAlignment = 64;
+
+/** \brief Scalar types of the stored arrays. */
+enum ScalarT
+{
+  ST_FLOAT64 = 0,
+  ST_FLOAT32
+};
+
+/** \brief Boolean integration options, stored as bits of a single flags field (bit k for option k). */
+bool IntegrationOptions::* const kOptionFlags[] = {
+    &IntegrationOptions::computeJ_nu_sv,
+    &IntegrationOptions::stop_if_unstable,
+    &IntegrationOptions::keepMuValues,
+    &IntegrationOptions::keepJdet,
+    &IntegrationOptions::keepMMatrices,
+    &IntegrationOptions::keepJMatrices,
+    &IntegrationOptions::keepPositionsSoA,
+    &IntegrationOptions::keepRotationsSoA,
+    &IntegrationOptions::keepQuaternionsSoA,
+    &IntegrationOptions::keepJSoA};
+const size_t kNumOptionFlags = sizeof(kOptionFlags) / sizeof(kOptionFlags[0]);
+
+size_t
+alignOffset(size_t i_offset)
+{
+  return (i_offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+ScalarT
+arrayScalarType(StateArrayT i_array,
+                NodesEncodingT i_nodesEncoding)
+{
+  return i_array == SA_NODES && i_nodesEncoding == NE_AFFINE_FLOAT ? ST_FLOAT32 : ST_FLOAT64;
+}
+
+size_t
+scalarSize(ScalarT i_type)
+{
+  return i_type == ST_FLOAT32 ? sizeof(float) : sizeof(double);
+}
+
+size_t
+storedArrayWidth(StateArrayT i_array,
+                 NodesEncodingT i_nodesEncoding)
+{
+  switch(i_array)
+  {
+    case SA_NODES:
+      return i_nodesEncoding == NE_FULL ? 16 : 12;
+    case SA_MU:
+      return 6;
+    case SA_M:
+    case SA_J:
+      return 36;
+    case SA_J_DET:
+      return 1;
+    default:
+      assert(false && "invalid state array");
+      return 0;
+  }
+}
+
+template<typename T>
+void
+appendPod(std::vector<char>& io_buffer,
+          const T& i_value)
+{
+  const char* bytes = reinterpret_cast<const char*>(&i_value);
+  io_buffer.insert(io_buffer.end(), bytes, bytes + sizeof(T));
+}
+
+void
+appendDoubles(std::vector<char>& io_buffer,
+              const double* i_values,
+              size_t i_size)
+{
+  const char* bytes = reinterpret_cast<const char*>(i_values);
+  io_buffer.insert(io_buffer.end(), bytes, bytes + i_size * sizeof(double));
+}
+
+/**
+* \brief Sequential reader of the header bytes, with bounds checking.
+*/
+class HeaderReader
+{
+public:
+  HeaderReader(const char* i_data,
+               size_t i_size) :
+      m_data(i_data),
+      m_size(i_size),
+      m_pos(0)
+  {
+  }
+
+  template<typename T>
+  bool
+  read(T& o_value)
+  {
+    if(m_pos + sizeof(T) > m_size)
+    {
+      return false;
+    }
+    std::memcpy(&o_value, m_data + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return true;
+  }
+
+  bool
+  readDoubles(double* o_values,
+              size_t i_size)
+  {
+    if(i_size * sizeof(double) > m_size - m_pos)
+    {
+      return false;
+    }
+    std::memcpy(o_values, m_data + m_pos, i_size * sizeof(double));
+    m_pos += i_size * sizeof(double);
+    return true;
+  }
+
+  bool
+  readIndices(std::vector<size_t>& o_indices)
+  {
+    uint64_t size;
+    if(!read(size) || size > (m_size - m_pos) / sizeof(uint64_t))
+    {
+      return false;
+    }
+    o_indices.resize(static_cast<size_t>(size));
+    for(size_t idx = 0; idx < o_indices.size(); ++idx)
+    {
+      uint64_t value = 0;
+      read(value);
+      o_indices[idx] = static_cast<size_t>(value);
+    }
+    return true;
+  }
+
+private:
+  const char* m_data;
+  size_t m_size;
+  size_t m_pos;
+};
+
+void
+appendIndices(std::vector<char>& io_buffer,
+              const std::vector<size_t>& i_indices)
+{
+  appendPod(io_buffer, static_cast<uint64_t>(i_indices.size()));
+  for(size_t idx = 0; idx < i_indices.size(); ++idx)
+  {
+    appendPod(io_buffer, static_cast<uint64_t>(i_indices[idx]));
+  }
+}
+
+/**
+* \brief Serializes the header of given state and computes the byte offset of each stored array.
+*/
+void
+serializeHeader(const WorkspaceIntegratedState& i_state,
+                size_t i_numIntegratedNodes,
+                const bool* i_storedArrays,
+                NodesEncodingT i_nodesEncoding,
+                std::vector<char>& o_bytes,
+                std::vector<size_t>& o_arrayOffsets,
+                size_t& o_fileSize)
+{
+  const Parameters& params = i_state.staticParameters();
+  const IntegrationOptions& options = i_state.integrationOptions();
+  const size_t numStoredNodes = i_state.nodes().size();
+
+  // the header size must be known to place the arrays
+  const size_t headerSize = sizeof(kMagic) + 2 * sizeof(uint32_t) +
+                            12 * sizeof(double) + 2 * sizeof(uint32_t) +
+                            2 * sizeof(uint32_t) + sizeof(double) + 3 * sizeof(uint64_t) +
+                            options.outputNodes.size() * sizeof(uint64_t) +
+                            sizeof(uint32_t) + sizeof(double) + sizeof(uint64_t) +
+                            22 * sizeof(double) +
+                            2 * sizeof(uint64_t) + i_state.outputNodes().size() * sizeof(uint64_t) +
+                            2 * sizeof(uint32_t) + SA_NUMBER_OF_ARRAYS * (2 * sizeof(uint32_t) + sizeof(uint64_t));
+  o_arrayOffsets.assign(SA_NUMBER_OF_ARRAYS, 0);
+  size_t offset = alignOffset(headerSize);
+  for(int idx = 0; idx < SA_NUMBER_OF_ARRAYS; ++idx)
+  {
+    const StateArrayT array = static_cast<StateArrayT>(idx);
+    if(i_storedArrays[idx])
+    {
+      o_arrayOffsets[idx] = offset;
+      offset = alignOffset(offset + numStoredNodes * storedArrayWidth(array, i_nodesEncoding) *
+                                    scalarSize(arrayScalarType(array, i_nodesEncoding)));
+    }
+  }
+  o_fileSize = offset;
+
+  o_bytes.clear();
+  o_bytes.reserve(headerSize);
+  o_bytes.insert(o_bytes.end(), kMagic, kMagic + sizeof(kMagic));
+  appendPod(o_bytes, kVersion);
+  appendPod(o_bytes, kByteOrderMark);
+
+  // rod parameters
+  appendPod(o_bytes, params.radius);
+  appendDoubles(o_bytes, params.stiffnessCoefficients.data(), 6);
+  appendPod(o_bytes, static_cast<uint32_t>(params.rodModel));
+  appendPod(o_bytes, static_cast<uint32_t>(params.numNodes));
+  appendDoubles(o_bytes, params.gravity.data(), 3);
+  appendPod(o_bytes, params.unitaryMass);
+  appendPod(o_bytes, params.integrationTime);
+
+  // integration options
+  uint32_t flags = 0;
+  for(size_t idx = 0; idx < kNumOptionFlags; ++idx)
+  {
+    flags |= (options.*kOptionFlags[idx] ? 1u : 0u) << idx;
+  }
+  appendPod(o_bytes, flags);
+  appendPod(o_bytes, static_cast<uint32_t>(options.precision));
+  appendPod(o_bytes, options.conjugatePointTolerance);
+  appendPod(o_bytes, static_cast<uint64_t>(options.outputStride));
+  appendPod(o_bytes, static_cast<uint64_t>(options.checkpointInterval));
+  appendIndices(o_bytes, options.outputNodes);
+
+  // integration status
+  appendPod(o_bytes, static_cast<uint32_t>(i_state.isStable() ? 1 : 0));
+  appendPod(o_bytes, i_state.conjugatePointT());
+  appendPod(o_bytes, static_cast<uint64_t>(i_numIntegratedNodes));
+  appendDoubles(o_bytes, i_state.baseWrench().data(), 6);
+  appendDoubles(o_bytes, i_state.base().data(), 16);
+
+  // stored nodes and arrays schema
+  appendPod(o_bytes, static_cast<uint64_t>(numStoredNodes));
+  appendIndices(o_bytes, i_state.outputNodes());
+  appendPod(o_bytes, static_cast<uint32_t>(i_nodesEncoding));
+  appendPod(o_bytes, static_cast<uint32_t>(SA_NUMBER_OF_ARRAYS));
+  for(int idx = 0; idx < SA_NUMBER_OF_ARRAYS; ++idx)
+  {
+    const StateArrayT array = static_cast<StateArrayT>(idx);
+    appendPod(o_bytes, static_cast<uint32_t>(arrayScalarType(array, i_nodesEncoding)));
+    appendPod(o_bytes, static_cast<uint32_t>(storedArrayWidth(array, i_nodesEncoding)));
+    appendPod(o_bytes, static_cast<uint64_t>(o_arrayOffsets[idx]));
+  }
+  assert(o_bytes.size() == headerSize && "inconsistent state file header size");
+}
+
+/**
+* \brief Writes the stored arrays of given state at their offset in given buffer.
+*/
+void
+writeArrays(const WorkspaceIntegratedState& i_state,
+            const bool* i_storedArrays,
+            NodesEncodingT i_nodesEncoding,
+            const std::vector<size_t>& i_arrayOffsets,
+            char* o_data)
+{
+  const Displacements& nodes = i_state.nodes();
+  const std::vector<size_t>& outputNodes = i_state.outputNodes();
+  const size_t numStoredNodes = nodes.size();
+
+  // node positions
+  if(i_nodesEncoding == NE_AFFINE_FLOAT)
+  {
+    float* values = reinterpret_cast<float*>(o_data + i_arrayOffsets[SA_NODES]);
+    for(size_t idx = 0; idx < numStoredNodes; ++idx)
+    {
+      Eigen::Map<Eigen::Matrix<float, 3, 4> >(values + 12 * idx) = nodes[idx].topRows<3>().cast<float>();
+    }
+  }
+  else
+  {
+    double* values = reinterpret_cast<double*>(o_data + i_arrayOffsets[SA_NODES]);
+    for(size_t idx = 0; idx < numStoredNodes; ++idx)
+    {
+      if(i_nodesEncoding == NE_FULL)
+      {
+        Eigen::Map<Displacement>(values + 16 * idx) = nodes[idx];
+      }
+      else
+      {
+        assert(nodes[idx].row(3) == Eigen::RowVector4d(0., 0., 0., 1.) && "node is not a rigid displacement");
+        Eigen::Map<Eigen::Matrix<double, 3, 4> >(values + 12 * idx) = nodes[idx].topRows<3>();
+      }
+    }
+  }
+
+  // kept values, read through the accessors so that the ones recomputed from checkpoints are written as well
+  for(size_t idx = 0; idx < numStoredNodes; ++idx)
+  {
+    const size_t idxNode = outputNodes.empty() ? idx : outputNodes[idx];
+    if(i_storedArrays[SA_MU])
+    {
+      Eigen::Map<Wrench>(reinterpret_cast<double*>(o_data + i_arrayOffsets[SA_MU]) + 6 * idx) =
+          i_state.wrench(idxNode);
+    }
+    if(i_storedArrays[SA_M])
+    {
+      Eigen::Map<Matrix6d>(reinterpret_cast<double*>(o_data + i_arrayOffsets[SA_M]) + 36 * idx) =
+          i_state.getMMatrix(idxNode);
+    }
+    if(i_storedArrays[SA_J])
+    {
+      Eigen::Map<Matrix6d>(reinterpret_cast<double*>(o_data + i_arrayOffsets[SA_J]) + 36 * idx) =
+          i_state.getJMatrix(idxNode);
+    }
+  }
+  if(i_storedArrays[SA_J_DET] && numStoredNodes > 0)
+  {
+    std::memcpy(o_data + i_arrayOffsets[SA_J_DET], i_state.J_det().data(), numStoredNodes * sizeof(double));
+  }
+}
+
+} // namespace
+
+const unsigned int StateFile::kAllArrays;
+
+/************************************************************************/
+/*														Constructor																	*/
+/************************************************************************/
+StateFile::StateFile() :
+    m_file(),
+    m_data(nullptr),
+    m_size(0),
+    m_rodParameters(),
+    m_integrationOptions(),
+    m_isStable(false),
+    m_conjugatePointT(-1.),
+    m_numIntegratedNodes(0),
+    m_baseWrench(Wrench::Zero()),
+    m_base(Displacement::Identity()),
+    m_numStoredNodes(0),
+    m_outputNodes(),
+    m_nodesEncoding(NE_FULL),
+    m_arrayOffsets(SA_NUMBER_OF_ARRAYS, 0)
+{
+}
+
+/************************************************************************/
+/*															layout																	*/
+/************************************************************************/
+void
+StateFile::layout(const WorkspaceIntegratedState& i_state,
+                  unsigned int i_arrays,
+                  NodesEncodingT i_nodesEncoding,
+                  bool* o_storedArrays,
+                  std::vector<char>& o_headerBytes,
+                  std::vector<size_t>& o_arrayOffsets,
+                  size_t& o_size)
+{
+  assert(i_state.m_isInitialized && "the state must be integrated first");
+  assert(i_nodesEncoding >= NE_FULL && i_nodesEncoding < NE_NUMBER_OF_NODES_ENCODINGS && "invalid nodes encoding");
+
+  const IntegrationOptions& options = i_state.integrationOptions();
+  o_storedArrays[SA_NODES] = true;
+  o_storedArrays[SA_MU] = options.keepMuValues && (i_arrays & (1u << SA_MU));
+  o_storedArrays[SA_M] = options.keepMMatrices && (i_arrays & (1u << SA_M));
+  o_storedArrays[SA_J] = options.keepJMatrices && (i_arrays & (1u << SA_J));
+  o_storedArrays[SA_J_DET] = options.keepJdet && (i_arrays & (1u << SA_J_DET)) &&
+                             i_state.J_det().size() >= i_state.nodes().size();
+  serializeHeader(i_state, i_state.m_numIntegratedNodes, o_storedArrays, i_nodesEncoding,
+                  o_headerBytes, o_arrayOffsets, o_size);
+}
+
+/************************************************************************/
+/*															write																		*/
+/************************************************************************/
+bool
+StateFile::write(const std::string& i_filename,
+                 const WorkspaceIntegratedState& i_state,
+                 unsigned int i_arrays,
+                 NodesEncodingT i_nodesEncoding)
+{
+  bool storedArrays[SA_NUMBER_OF_ARRAYS];
+  std::vector<char> headerBytes;
+  std::vector<size_t> arrayOffsets;
+  size_t fileSize;
+  layout(i_state, i_arrays, i_nodesEncoding, storedArrays, headerBytes, arrayOffsets, fileSize);
+
+  util::MappedFileShPtr file = util::MappedFile::create(i_filename, fileSize);
+  if(!file)
+  {
+    return false;
+  }
+  std::memcpy(file->data(), headerBytes.data(), headerBytes.size());
+  writeArrays(i_state, storedArrays, i_nodesEncoding, arrayOffsets, file->data());
+  return file->sync();
+}
+
+/************************************************************************/
+/*														serialize																	*/
+/************************************************************************/
+void
+StateFile::serialize(const WorkspaceIntegratedState& i_state,
+                     unsigned int i_arrays,
+                     NodesEncodingT i_nodesEncoding,
+                     std::vector<char>& o_bytes)
+{
+  bool storedArrays[SA_NUMBER_OF_ARRAYS];
+  std::vector<char> headerBytes;
+  std::vector<size_t> arrayOffsets;
+  size_t size;
+  layout(i_state, i_arrays, i_nodesEncoding, storedArrays, headerBytes, arrayOffsets, size);
+
+  o_bytes.assign(size, 0);
+  std::memcpy(o_bytes.data(), headerBytes.data(), headerBytes.size());
+  writeArrays(i_state, storedArrays, i_nodesEncoding, arrayOffsets, o_bytes.data());
+}
+
+/************************************************************************/
+/*															open																		*/
+/************************************************************************/
+StateFileConstShPtr
+StateFile::open(const std::string& i_filename)
+{
+  const util::MappedFileConstShPtr file = util::MappedFile::open(i_filename);
+  if(!file)
+  {
+    return StateFileConstShPtr();
+  }
+  return open(file, 0, file->size());
+}
+
+/************************************************************************/
+/*															open																		*/
+/************************************************************************/
+StateFileConstShPtr
+StateFile::open(const util::MappedFileConstShPtr& i_file,
+                size_t i_offset,
+                size_t i_size)
+{
+  StateFileShPtr stateFile(new StateFile());
+  if(!stateFile->init(i_file, i_offset, i_size))
+  {
+    stateFile.reset();
+  }
+  return stateFile;
+}
+
+/************************************************************************/
+/*															init																		*/
+/************************************************************************/
+bool
+StateFile::init(const util::MappedFileConstShPtr& i_file,
+                size_t i_offset,
+                size_t i_size)
+{
+  assert(i_file && "file must be given");
+  assert(i_offset % kAlignment == 0 && "state file offset must be aligned");
+  if(i_offset > i_file->size() || i_size > i_file->size() - i_offset)
+  {
+    return false;
+  }
+  m_file = i_file;
+  m_data = i_file->data() + i_offset;
+  m_size = i_size;
+  HeaderReader reader(m_data, m_size);
+
+  char magic[sizeof(kMagic)];
+  uint32_t version, byteOrderMark;
+  if(!reader.read(magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+     !reader.read(version) || version != kVersion ||
+     !reader.read(byteOrderMark) || byteOrderMark != kByteOrderMark)
+  {
+    return false;
+  }
+
+  // rod parameters
+  uint32_t rodModel, numNodes;
+  if(!reader.read(m_rodParameters.radius) || !reader.readDoubles(m_rodParameters.stiffnessCoefficients.data(), 6) ||
+     !reader.read(rodModel) || rodModel >= Parameters::RM_NUMBER_OF_ROD_MODELS ||
+     !reader.read(numNodes) || numNodes < 2 ||
+     !reader.readDoubles(m_rodParameters.gravity.data(), 3) || !reader.read(m_rodParameters.unitaryMass) ||
+     !reader.read(m_rodParameters.integrationTime))
+  {
+    return false;
+  }
+  m_rodParameters.rodModel = static_cast<Parameters::RodModelT>(rodModel);
+  m_rodParameters.numNodes = static_cast<int>(numNodes);
+
+  // integration options
+  uint32_t flags, precision;
+  uint64_t outputStride, checkpointInterval;
+  if(!reader.read(flags) || !reader.read(precision) || precision > WorkspaceIntegratedState::IP_MIXED ||
+     !reader.read(m_integrationOptions.conjugatePointTolerance) ||
+     !reader.read(outputStride) || !reader.read(checkpointInterval) ||
+     !reader.readIndices(m_integrationOptions.outputNodes))
+  {
+    return false;
+  }
+  for(size_t idx = 0; idx < kNumOptionFlags; ++idx)
+  {
+    m_integrationOptions.*kOptionFlags[idx] = (flags & (1u << idx)) != 0;
+  }
+  m_integrationOptions.precision = static_cast<WorkspaceIntegratedState::IntegrationPrecisionT>(precision);
+  m_integrationOptions.outputStride = static_cast<size_t>(outputStride);
+  m_integrationOptions.checkpointInterval = static_cast<size_t>(checkpointInterval);
+
+  // integration status
+  uint32_t isStable;
+  uint64_t numIntegratedNodes, numStoredNodes;
+  if(!reader.read(isStable) || !reader.read(m_conjugatePointT) ||
+     !reader.read(numIntegratedNodes) || numIntegratedNodes > numNodes ||
+     !reader.readDoubles(m_baseWrench.data(), 6) || !reader.readDoubles(m_base.data(), 16) ||
+     !reader.read(numStoredNodes) || !reader.readIndices(m_outputNodes))
+  {
+    return false;
+  }
+  m_isStable = isStable != 0;
+  m_numIntegratedNodes = static_cast<size_t>(numIntegratedNodes);
+  m_numStoredNodes = static_cast<size_t>(numStoredNodes);
+  if(m_numStoredNodes > (m_outputNodes.empty() ? numNodes : m_outputNodes.size()))
+  {
+    return false;
+  }
+  for(size_t idx = 0; idx < m_outputNodes.size(); ++idx)
+  {
+    if(m_outputNodes[idx] >= numNodes)
+    {
+      return false;
+    }
+  }
+
+  // arrays schema
+  uint32_t nodesEncoding, numArrays;
+  if(!reader.read(nodesEncoding) || nodesEncoding >= NE_NUMBER_OF_NODES_ENCODINGS || !reader.read(numArrays))
+  {
+    return false;
+  }
+  m_nodesEncoding = static_cast<NodesEncodingT>(nodesEncoding);
+  for(uint32_t idx = 0; idx < numArrays; ++idx)
+  {
+    uint32_t scalarType, width;
+    uint64_t offset;
+    if(!reader.read(scalarType) || !reader.read(width) || !reader.read(offset))
+    {
+      return false;
+    }
+    // arrays unknown to this version are ignored
+    if(idx >= SA_NUMBER_OF_ARRAYS || offset == 0)
+    {
+      continue;
+    }
+    const StateArrayT stateArray = static_cast<StateArrayT>(idx);
+    if(scalarType != static_cast<uint32_t>(arrayScalarType(stateArray, m_nodesEncoding)) ||
+       width != storedArrayWidth(stateArray, m_nodesEncoding) || offset % kAlignment != 0 ||
+       offset > m_size ||
+       numStoredNodes * width * scalarSize(static_cast<ScalarT>(scalarType)) > m_size - offset)
+    {
+      return false;
+    }
+    m_arrayOffsets[idx] = static_cast<size_t>(offset);
+  }
+  return hasArray(SA_NODES);
+}
+
+/************************************************************************/
+/*														rodParameters																	*/
+/************************************************************************/
+const Parameters&
+StateFile::rodParameters() const
+{
+  return m_rodParameters;
+}
+
+/************************************************************************/
+/*														integrationOptions																	*/
+/************************************************************************/
+const WorkspaceIntegratedState::IntegrationOptions&
+StateFile::integrationOptions() const
+{
+  return m_integrationOptions;
+}
+
+/************************************************************************/
+/*															isStable																	*/
+/************************************************************************/
+bool
+StateFile::isStable() const
+{
+  return m_isStable;
+}
+
+/************************************************************************/
+/*														conjugatePointT																	*/
+/************************************************************************/
+double
+StateFile::conjugatePointT() const
+{
+  return m_conjugatePointT;
+}
+
+/************************************************************************/
+/*														baseWrench																	*/
+/************************************************************************/
+const Wrench&
+StateFile::baseWrench() const
+{
+  return m_baseWrench;
+}
+
+/************************************************************************/
+/*															base																		*/
+/************************************************************************/
+const Displacement&
+StateFile::base() const
+{
+  return m_base;
+}
+
+/************************************************************************/
+/*														numStoredNodes																	*/
+/************************************************************************/
+size_t
+StateFile::numStoredNodes() const
+{
+  return m_numStoredNodes;
+}
+
+/************************************************************************/
+/*														outputNodes																	*/
+/************************************************************************/
+const std::vector<size_t>&
+StateFile::outputNodes() const
+{
+  return m_outputNodes;
+}
+
+/************************************************************************/
+/*															hasArray																	*/
+/************************************************************************/
+bool
+StateFile::hasArray(StateArrayT i_array) const
+{
+  assert(i_array >= SA_NODES && i_array < SA_NUMBER_OF_ARRAYS && "invalid state array");
+  return m_arrayOffsets[i_array] != 0;
+}
+
+/************************************************************************/
+/*														nodesEncoding																	*/
+/************************************************************************/
+NodesEncodingT
+StateFile::nodesEncoding() const
+{
+  return m_nodesEncoding;
+}
+
+/************************************************************************/
+/*														arrayWidth																	*/
+/************************************************************************/
+size_t
+StateFile::arrayWidth(StateArrayT i_array) const
+{
+  return storedArrayWidth(i_array, m_nodesEncoding);
+}
+
+/************************************************************************/
+/*															array																		*/
+/************************************************************************/
+util::ArrayView<const double>
+StateFile::array(StateArrayT i_array) const
+{
+  assert(hasArray(i_array) && "array is not stored in the state file");
+  assert(arrayScalarType(i_array, m_nodesEncoding) == ST_FLOAT64 && "array is not stored in double precision");
+  return util::ArrayView<const double>(reinterpret_cast<const double*>(m_data + m_arrayOffsets[i_array]),
+                                       m_numStoredNodes * arrayWidth(i_array));
+}
+
+/************************************************************************/
+/*														floatArray																	*/
+/************************************************************************/
+util::ArrayView<const float>
+StateFile::floatArray(StateArrayT i_array) const
+{
+  assert(hasArray(i_array) && "array is not stored in the state file");
+  assert(arrayScalarType(i_array, m_nodesEncoding) == ST_FLOAT32 && "array is not stored in single precision");
+  return util::ArrayView<const float>(reinterpret_cast<const float*>(m_data + m_arrayOffsets[i_array]),
+                                      m_numStoredNodes * arrayWidth(i_array));
+}
+
+/************************************************************************/
+/*															node																		*/
+/************************************************************************/
+Displacement
+StateFile::node(size_t i_idxStored) const
+{
+  assert(i_idxStored < m_numStoredNodes && "invalid stored node index");
+  Displacement node = Displacement::Identity();
+  switch(m_nodesEncoding)
+  {
+    case NE_FULL:
+      node = Eigen::Map<const Displacement>(array(SA_NODES).data() + 16 * i_idxStored);
+      break;
+    case NE_AFFINE:
+      node.topRows<3>() = Eigen::Map<const Eigen::Matrix<double, 3, 4> >(array(SA_NODES).data() + 12 * i_idxStored);
+      break;
+    default:
+      node.topRows<3>() = Eigen::Map<const Eigen::Matrix<float, 3, 4> >(
+          floatArray(SA_NODES).data() + 12 * i_idxStored).cast<double>();
+      break;
+  }
+  return node;
+}
+
+/************************************************************************/
+/*															state																		*/
+/************************************************************************/
+WorkspaceIntegratedStateShPtr
+StateFile::state() const
+{
+  WorkspaceIntegratedState::IntegrationOptions options = m_integrationOptions;
+  options.keepMuValues = hasArray(SA_MU);
+  options.keepMMatrices = hasArray(SA_M);
+  options.keepJMatrices = hasArray(SA_J);
+  options.keepJdet = hasArray(SA_J_DET);
+  options.computeJ_nu_sv = false;
+  options.keepPositionsSoA = false;
+  options.keepRotationsSoA = false;
+  options.keepQuaternionsSoA = false;
+  options.keepJSoA = false;
+  options.checkpointInterval = 0;
+
+  WorkspaceIntegratedStateShPtr state(new WorkspaceIntegratedState(m_rodParameters.numNodes, m_base,
+                                                                   m_rodParameters));
+  state->init(m_baseWrench);
+  state->integrationOptions(options);
+  state->m_isInitialized = true;
+  state->m_isStable = m_isStable;
+  state->m_conjugatePointT = m_conjugatePointT;
+  state->m_numIntegratedNodes = m_numIntegratedNodes;
+  state->m_outputNodes = m_outputNodes;
+
+  Displacements& nodes = state->m_nodes.overwrite();
+  nodes.resize(m_numStoredNodes);
+  for(size_t idx = 0; idx < m_numStoredNodes; ++idx)
+  {
+    nodes[idx] = node(idx);
+  }
+  if(options.keepMuValues)
+  {
+    Wrenches& mu = state->m_mu.overwrite();
+    mu.resize(m_numStoredNodes);
+    for(size_t idx = 0; idx < m_numStoredNodes; ++idx)
+    {
+      mu[idx] = Eigen::Map<const Wrench>(array(SA_MU).data() + 6 * idx);
+    }
+  }
+  if(options.keepMMatrices)
+  {
+    Matrices6d& M = state->m_M.overwrite();
+    M.resize(m_numStoredNodes);
+    for(size_t idx = 0; idx < m_numStoredNodes; ++idx)
+    {
+      M[idx] = Eigen::Map<const Matrix6d>(array(SA_M).data() + 36 * idx);
+    }
+  }
+  if(options.keepJMatrices)
+  {
+    Matrices6d& J = state->m_J.overwrite();
+    J.resize(m_numStoredNodes);
+    for(size_t idx = 0; idx < m_numStoredNodes; ++idx)
+    {
+      J[idx] = Eigen::Map<const Matrix6d>(array(SA_J).data() + 36 * idx);
+    }
+  }
+  if(options.keepJdet)
+  {
+    util::ArrayView<const double> J_det = array(SA_J_DET);
+    state->m_J_det.overwrite().assign(J_det.begin(), J_det.end());
+  }
+  return state;
+}
+
+}  // namespace rod3d
+}  // namespace qserl
@@ -21,16 +21,197 @@
 
 #include "qserl/rod3d/workspace_integrated_state.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 #include <Eigen/Eigenvalues>
 #include <Eigen/Geometry>
 #include <boost/numeric/odeint.hpp>
 
 #include "qserl/rod3d/rod.h"
+#include "qserl/util/allocation_tracker.h"
+#include "qserl/util/metrics.h"
+#include "qserl/util/profiler.h"
+#include "qserl/util/trace.h"
 #include "full_system.h"
+#include "util/conjugate_point.h"
+#include "util/stats.h"
 
 namespace qserl {
 namespace rod3d {
 
+namespace {
+
+const size_t kCostateSize = 22;       /**< Size of the costate mu and state q part of the full state. */
+const size_t kJacobiansSize = 72;     /**< Size of the M and J matrices part of the full state. */
+
+/**
+* \brief Locates the conjugate point within the integration step [i_t, i_t + i_dt] of the full system,
+* given the states at both ends of the step.
+*/
+template<typename FullSystemT>
+double
+locateConjugatePoint(FullSystemT& io_fullSystem,
+                     const typename FullSystemT::state_type& i_x0,
+                     const typename FullSystemT::state_type& i_x1,
+                     double i_t,
+                     double i_dt,
+                     double i_tolerance)
+{
+  if(i_tolerance <= 0.)
+  {
+    return i_t + i_dt;
+  }
+  QSERL_PROFILE_ZONE("rod3d::locateConjugatePoint");
+  typename FullSystemT::state_type dxdt0, dxdt1;
+  io_fullSystem(i_x0, dxdt0, i_t);
+  io_fullSystem(i_x1, dxdt1, i_t + i_dt);
+  typedef Eigen::Map<const Eigen::Matrix<typename FullSystemT::jacobian_scalar_type, 6, 6> > ConstMatrixMap;
+  const size_t J_index = FullSystemT::J_index();
+  return util::findConjugatePoint<6>(i_t, i_t + i_dt,
+                                     ConstMatrixMap(FullSystemT::jacobianData(i_x0) + J_index).template cast<double>(),
+                                     ConstMatrixMap(FullSystemT::jacobianData(dxdt0) + J_index).template cast<double>(),
+                                     ConstMatrixMap(FullSystemT::jacobianData(i_x1) + J_index).template cast<double>(),
+                                     ConstMatrixMap(FullSystemT::jacobianData(dxdt1) + J_index).template cast<double>(),
+                                     i_tolerance);
+}
+
+/**
+* \brief Returns true if each component of given wrench is within [-i_maxWrench, i_maxWrench].
+*/
+bool
+isWithinBounds(const Wrench& i_wrench,
+               const Wrench& i_maxWrench)
+{
+  return (i_wrench.cwiseAbs().array() <= i_maxWrench.array()).all();
+}
+
+#ifdef QSERL_ENABLE_METRICS
+/**
+* \brief Process wide metrics of the integrations, registered at static initialization.
+*/
+struct IntegrationMetrics
+{
+  IntegrationMetrics() :
+      results(),
+      integrateSeconds(&util::Metrics::histogram("qserl_rod3d_integration_seconds{method=\"rk4\"}",
+                                                 "Duration of the rod3d integrations, in seconds.",
+                                                 util::Histogram::exponentialBounds(1e-6, 4., 12))),
+      integrateWhileValidSeconds(&util::Metrics::histogram("qserl_rod3d_integration_seconds{method=\"while_valid\"}",
+                                                           "Duration of the rod3d integrations, in seconds.",
+                                                           util::Histogram::exponentialBounds(1e-6, 4., 12)))
+  {
+    static const char* const kResultNames[WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS] =
+        {"valid", "singular", "unstable", "out_of_wrench_bounds", "invalid_options"};
+    for(int result = 0; result < WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS; ++result)
+    {
+      results[result] = &util::Metrics::counter(std::string("qserl_rod3d_integrations_total{result=\"") +
+                                                kResultNames[result] + "\"}",
+                                                "Number of rod3d integrations, by result.");
+    }
+  }
+
+  util::Counter* results[WorkspaceIntegratedState::IR_NUMBER_OF_INTEGRATION_RESULTS];
+  util::Histogram* integrateSeconds;
+  util::Histogram* integrateWhileValidSeconds;
+};
+
+const IntegrationMetrics s_integrationMetrics;
+#endif
+
+/**
+* \brief Counts given integration result in the process wide metrics and returns it.
+*/
+WorkspaceIntegratedState::IntegrationResultT
+countResult(WorkspaceIntegratedState::IntegrationResultT i_result)
+{
+  QSERL_METRICS(s_integrationMetrics.results[i_result]->increment());
+  return i_result;
+}
+
+/**
+* \brief Resizes given structure of arrays to given number of columns, keeping the values of the first columns
+* if requested.
+*/
+template<typename SoA>
+void
+resizeColumns(util::CopyOnWrite<SoA>& io_soa,
+              Eigen::Index i_numColumns,
+              bool i_keepValues)
+{
+  if(i_numColumns == 0 && io_soa.get().cols() == 0)
+  {
+    // not kept, and already empty
+    return;
+  }
+  if(i_keepValues)
+  {
+    io_soa.mutate().conservativeResize(Eigen::NoChange, i_numColumns);
+  }
+  else
+  {
+    io_soa.overwrite().resize(Eigen::NoChange, i_numColumns);
+  }
+}
+
+/**
+* \brief Returns true if given caller buffer is empty, or holds given number of elements of given size, its stride
+* being at least the element size. Overlapping with other caller buffers is not checked.
+*/
+bool
+isValidOutputView(const util::StridedView<double>& i_view,
+                  size_t i_numElements,
+                  std::ptrdiff_t i_elementSize)
+{
+  return i_view.empty() || (i_view.data() && i_view.size() == i_numElements &&
+                            std::abs(i_view.stride()) >= i_elementSize);
+}
+
+/**
+* \brief Returns the memory usage of the recomputed segments.
+*/
+template<typename LazySegments>
+size_t
+lazySegmentsMemUsage(const LazySegments& i_segments)
+{
+  size_t memUsage = sizeof(i_segments);
+  for(const auto& segment : i_segments)
+  {
+    memUsage += segment.mu.capacity() * sizeof(Wrench) +
+                (segment.M.capacity() + segment.J.capacity()) * sizeof(Matrix6d);
+  }
+  return memUsage;
+}
+
+/**
+* \brief Throws std::out_of_range for a node which is not stored by the state.
+*/
+void
+throwNodeNotStored(size_t i_nodeIdx)
+{
+  throw std::out_of_range("qserl::rod3d::WorkspaceIntegratedState: node " + std::to_string(i_nodeIdx) +
+                          " is not stored");
+}
+
+/**
+* \brief Returns the element of given stored outputs, throws std::out_of_range if it is not stored.
+*/
+template<typename VectorT>
+const typename VectorT::value_type&
+storedOutput(const VectorT& i_outputs,
+             size_t i_idxOutput,
+             size_t i_nodeIdx)
+{
+  if(i_idxOutput >= i_outputs.size())
+  {
+    throwNodeNotStored(i_nodeIdx);
+  }
+  return i_outputs[i_idxOutput];
+}
+
+} // namespace
+
 /************************************************************************/
 /*													Constructor																	*/
 /************************************************************************/
@@ -40,12 +221,23 @@ WorkspaceIntegratedState::WorkspaceIntegratedState(unsigned int i_nnodes,
     WorkspaceState(Displacements(), i_basePosition, i_rodParams),
     m_isInitialized{false},
     m_isStable{false},
+    m_conjugatePointT{-1.},
     m_mu{},
     m_M{},
     m_J{},
     m_J_det{},
     m_J_nu_sv{},
-    m_integrationOptions{} // initialize to default values
+    m_outputNodes{},
+    m_positionsSoA{},
+    m_rotationsSoA{},
+    m_quaternionsSoA{},
+    m_JSoA{},
+    m_checkpoints{},
+    m_numIntegratedNodes{0},
+    m_lazySegments{},
+    m_lazyClock{0},
+    m_integrationOptions{}, // initialize to default values
+    m_stats{}
 {
   assert (i_nnodes > 1 && "rod number of nodes must be greater or equal to 2");
   m_numNodes = i_nnodes;
@@ -67,6 +259,7 @@ WorkspaceIntegratedState::create(const Wrench& i_baseWrench,
                                  const Displacement& i_basePosition,
                                  const Parameters& i_rodParams)
 {
+  QSERL_ALLOCATION_SCOPE("rod3d::WorkspaceIntegratedState::create");
   WorkspaceIntegratedStateShPtr shPtr(new WorkspaceIntegratedState(i_nnodes, i_basePosition, i_rodParams));
 
   if(!shPtr->init(i_baseWrench))
@@ -99,12 +292,118 @@ WorkspaceIntegratedState::init(const Wrench& i_wrench)
   m_isStable = false;
   m_isInitialized = false;
 
-  m_mu.resize(1);
-  m_mu[0] = i_wrench;
+  m_mu.overwrite().assign(1, i_wrench);
 
   return success;
 }
 
+/************************************************************************/
+/*														clearOutputs																	*/
+/************************************************************************/
+void
+WorkspaceIntegratedState::clearOutputs()
+{
+  m_isInitialized = false;
+  m_isStable = false;
+  m_conjugatePointT = -1.;
+  m_nodes.clear();
+  m_mu.clear();
+  m_M.clear();
+  m_J.clear();
+  m_J_det.clear();
+  m_J_nu_sv.clear();
+  m_outputNodes.clear();
+  resizeColumns(m_positionsSoA, 0, false);
+  resizeColumns(m_rotationsSoA, 0, false);
+  resizeColumns(m_quaternionsSoA, 0, false);
+  resizeColumns(m_JSoA, 0, false);
+  m_checkpoints.clear();
+  m_numIntegratedNodes = 0;
+  for(LazySegment& segment : m_lazySegments)
+  {
+    segment.lastUse = 0;
+  }
+  m_stats.reset();
+}
+
+/************************************************************************/
+/*														selectOutputNodes																	*/
+/************************************************************************/
+size_t
+WorkspaceIntegratedState::selectOutputNodes()
+{
+  // the selection member is reused, so it does not allocate once sized
+  m_outputNodes.clear();
+  const std::vector<size_t>& requestedNodes = m_integrationOptions.outputNodes;
+  const size_t stride = m_integrationOptions.outputStride;
+  if(requestedNodes.empty() && stride <= 1)
+  {
+    return m_numNodes;
+  }
+
+  m_outputNodes.push_back(0);
+  if(!requestedNodes.empty())
+  {
+    m_outputNodes.insert(m_outputNodes.end(), requestedNodes.begin(), requestedNodes.end());
+    std::sort(m_outputNodes.begin(), m_outputNodes.end());
+    m_outputNodes.erase(std::unique(m_outputNodes.begin(), m_outputNodes.end()), m_outputNodes.end());
+    if(m_outputNodes.back() >= m_numNodes)
+    {
+      m_outputNodes.clear();
+      return 0;
+    }
+  }
+  else
+  {
+    for(size_t idxNode = stride; idxNode < m_numNodes; idxNode += stride)
+    {
+      m_outputNodes.push_back(idxNode);
+    }
+    if(m_outputNodes.back() != m_numNodes - 1)
+    {
+      m_outputNodes.push_back(m_numNodes - 1);
+    }
+  }
+
+  return m_outputNodes.size();
+}
+
+/************************************************************************/
+/*														outputIndex																	*/
+/************************************************************************/
+size_t
+WorkspaceIntegratedState::outputIndex(size_t i_nodeIdx) const
+{
+  if(m_outputNodes.empty())
+  {
+    return i_nodeIdx;
+  }
+  const std::vector<size_t>::const_iterator itNode = std::lower_bound(m_outputNodes.begin(), m_outputNodes.end(),
+                                                                      i_nodeIdx);
+  if(itNode == m_outputNodes.end() || *itNode != i_nodeIdx)
+  {
+    throwNodeNotStored(i_nodeIdx);
+  }
+  return static_cast<size_t>(itNode - m_outputNodes.begin());
+}
+
+/************************************************************************/
+/*														areValidOutputs																*/
+/************************************************************************/
+bool
+WorkspaceIntegratedState::areValidOutputs(const IntegrationOutputs& i_outputs,
+                                          size_t i_numOutputs) const
+{
+  return m_integrationOptions.checkpointInterval == 0 &&
+         !m_integrationOptions.keepPositionsSoA && !m_integrationOptions.keepRotationsSoA &&
+         !m_integrationOptions.keepQuaternionsSoA && !m_integrationOptions.keepJSoA &&
+         isValidOutputView(i_outputs.nodes, i_numOutputs, 16) &&
+         isValidOutputView(i_outputs.mu, i_numOutputs, 6) &&
+         isValidOutputView(i_outputs.M, i_numOutputs, 36) &&
+         isValidOutputView(i_outputs.J, i_numOutputs, 36) &&
+         isValidOutputView(i_outputs.J_det, i_numOutputs, 1);
+}
+
 /************************************************************************/
 /*														 clone																		*/
 /************************************************************************/
@@ -130,130 +429,403 @@ WorkspaceIntegratedState::integrate()
 WorkspaceIntegratedState::IntegrationResultT
 WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const Wrench& i_wrench)
 {
+  return integrateFromBaseWrench(i_wrench, nullptr);
+}
+
+/************************************************************************/
+/*														integrateInto																	*/
+/************************************************************************/
+WorkspaceIntegratedState::IntegrationResultT
+WorkspaceIntegratedState::integrateInto(const Wrench& i_wrench,
+                                        const IntegrationOutputs& i_outputs)
+{
+  return integrateFromBaseWrench(i_wrench, &i_outputs);
+}
 
+/************************************************************************/
+/*														integrateFromBaseWrench																	*/
+/************************************************************************/
+WorkspaceIntegratedState::IntegrationResultT
+WorkspaceIntegratedState::integrateFromBaseWrench(const Wrench& i_wrench,
+                                                  const IntegrationOutputs* i_outputs)
+{
   static const double ktstart = 0.;                          // Start integration time
   const double ktend = m_rodParameters.integrationTime;      // End integration time
   const double dt = (ktend - ktstart) / static_cast<double>(m_numNodes - 1);  // Integration time step
 
+  QSERL_PROFILE_ZONE("rod3d::integrate");
+  QSERL_TRACE_SCOPE("rod3d::integrate");
+  QSERL_ALLOCATION_SCOPE("rod3d::integrate");
+  QSERL_METRICS(util::MetricsTimer latencyTimer(*s_integrationMetrics.integrateSeconds));
+  m_stats.reset();
+  QSERL_STATS(util::StatsTimer totalTimer(m_stats.totalTimeNs));
+
+  // the output selection and the caller buffers are validated before anything is written
+  const size_t numOutputs = selectOutputNodes();
+  if(numOutputs == 0 || (i_outputs && !areValidOutputs(*i_outputs, numOutputs)))
+  {
+    m_isInitialized = false;
+    m_isStable = false;
+    m_nodes.clear();
+    return countResult(IR_INVALID_OPTIONS);
+  }
   m_isInitialized = true;
+  m_conjugatePointT = -1.;
 
   if(Rod::isConfigurationSingular(i_wrench))
   {
-    return IR_SINGULAR;
+    // outputs of a previous integration are not kept, only the base wrench is
+    const Wrench baseWrench = i_wrench;
+    clearOutputs();
+    m_mu.overwrite().assign(1, baseWrench);
+    m_isInitialized = true;
+    return countResult(IR_SINGULAR);
+  }
+
+  switch(m_integrationOptions.precision)
+  {
+    case IP_FLOAT:
+      return countResult(integrateRK4<FullSystemFloat>(i_wrench, dt, i_outputs));
+    case IP_MIXED:
+      return countResult(integrateRK4<FullSystemMixed>(i_wrench, dt, i_outputs));
+    default:
+      return countResult(integrateRK4<FullSystem>(i_wrench, dt, i_outputs));
+  }
+}
+
+/************************************************************************/
+/*														resetCheckpoints																	*/
+/************************************************************************/
+size_t
+WorkspaceIntegratedState::resetCheckpoints()
+{
+  // storage and cache are reused, so they do not allocate once sized
+  m_checkpoints.clear();
+  m_numIntegratedNodes = 1;
+  for(LazySegment& segment : m_lazySegments)
+  {
+    segment.lastUse = 0;
   }
+  const size_t checkpointInterval = m_integrationOptions.checkpointInterval;
+  if(checkpointInterval > 0)
+  {
+    m_checkpoints.overwrite().reserve((m_numNodes - 1) / checkpointInterval + 1);
+  }
+  return checkpointInterval;
+}
+
+/************************************************************************/
+/*														saveCheckpoint																	*/
+/************************************************************************/
+template<typename FullSystemT>
+void
+WorkspaceIntegratedState::saveCheckpoint(const typename FullSystemT::state_type& i_x,
+                                         double i_t)
+{
+  static_assert(kCostateSize + kJacobiansSize == kFullStateSize, "unexpected full state size");
+  std::vector<Checkpoint>& checkpoints = m_checkpoints.mutate();
+  checkpoints.push_back(Checkpoint());
+  Checkpoint& checkpoint = checkpoints.back();
+  std::copy(FullSystemT::costateData(i_x), FullSystemT::costateData(i_x) + kCostateSize, checkpoint.x.begin());
+  std::copy(FullSystemT::jacobianData(i_x), FullSystemT::jacobianData(i_x) + kJacobiansSize,
+            checkpoint.x.begin() + kCostateSize);
+  checkpoint.t = i_t;
+}
+
+/************************************************************************/
+/*														resizeSoA																	*/
+/************************************************************************/
+void
+WorkspaceIntegratedState::resizeSoA(size_t i_numOutputs,
+                                    bool i_keepValues)
+{
+  const Eigen::Index numOutputs = static_cast<Eigen::Index>(i_numOutputs);
+  resizeColumns(m_positionsSoA, m_integrationOptions.keepPositionsSoA ? numOutputs : 0, i_keepValues);
+  resizeColumns(m_rotationsSoA, m_integrationOptions.keepRotationsSoA ? numOutputs : 0, i_keepValues);
+  resizeColumns(m_quaternionsSoA, m_integrationOptions.keepQuaternionsSoA ? numOutputs : 0, i_keepValues);
+  resizeColumns(m_JSoA, m_integrationOptions.keepJSoA ? numOutputs : 0, i_keepValues);
+}
+
+/************************************************************************/
+/*															storeSoA																	*/
+/************************************************************************/
+template<typename JacobianT>
+void
+WorkspaceIntegratedState::storeSoA(size_t i_idxOutput,
+                                   const JacobianT& i_J)
+{
+  const Displacement& node = m_nodes[i_idxOutput];
+  if(m_integrationOptions.keepPositionsSoA)
+  {
+    m_positionsSoA.mutate().col(i_idxOutput) = node.block<3, 1>(0, 3);
+  }
+  if(m_integrationOptions.keepRotationsSoA)
+  {
+    for(int j = 0; j < 3; ++j)
+    {
+      m_rotationsSoA.mutate().block<3, 1>(3 * j, i_idxOutput) = node.block<3, 1>(0, j);
+    }
+  }
+  if(m_integrationOptions.keepQuaternionsSoA)
+  {
+    m_quaternionsSoA.mutate().col(i_idxOutput) = Eigen::Quaterniond(node.topLeftCorner<3, 3>()).coeffs();
+  }
+  if(m_integrationOptions.keepJSoA)
+  {
+    // J maps are column major, as the structure of arrays rows
+    m_JSoA.mutate().col(i_idxOutput) = Eigen::Map<const Eigen::Matrix<typename JacobianT::Scalar, 36, 1> >(
+        i_J.data()).template cast<double>();
+  }
+}
+
+/************************************************************************/
+/*														writeOutputs																	*/
+/************************************************************************/
+template<typename FullSystemT>
+void
+WorkspaceIntegratedState::writeOutputs(const IntegrationOutputs& i_outputs,
+                                       size_t i_idxOutput,
+                                       const typename FullSystemT::state_type& i_x,
+                                       double i_det)
+{
+  typedef typename FullSystemT::scalar_type Scalar;
+  typedef typename FullSystemT::jacobian_scalar_type JacobianScalar;
+  // caller buffers may not be aligned
+  if(!i_outputs.nodes.empty())
+  {
+    Eigen::Map<Displacement>(i_outputs.nodes.element(i_idxOutput)) = Eigen::Map<const Eigen::Matrix<Scalar, 4, 4> >(
+        FullSystemT::costateData(i_x) + FullSystemT::q_index()).template cast<double>();
+  }
+  if(!i_outputs.mu.empty())
+  {
+    Eigen::Map<Wrench>(i_outputs.mu.element(i_idxOutput)) = Eigen::Map<const Eigen::Matrix<Scalar, 6, 1> >(
+        FullSystemT::costateData(i_x) + FullSystemT::mu_index()).template cast<double>();
+  }
+  if(!i_outputs.M.empty())
+  {
+    Eigen::Map<Matrix6d>(i_outputs.M.element(i_idxOutput)) = Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> >(
+        FullSystemT::jacobianData(i_x)).template cast<double>();
+  }
+  if(!i_outputs.J.empty())
+  {
+    Eigen::Map<Matrix6d>(i_outputs.J.element(i_idxOutput)) = Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> >(
+        FullSystemT::jacobianData(i_x) + FullSystemT::J_index()).template cast<double>();
+  }
+  if(!i_outputs.J_det.empty())
+  {
+    *i_outputs.J_det.element(i_idxOutput) = i_det;
+  }
+}
+
+/************************************************************************/
+/*														integrateRK4															*/
+/************************************************************************/
+template<typename FullSystemT>
+WorkspaceIntegratedState::IntegrationResultT
+WorkspaceIntegratedState::integrateRK4(const Wrench& i_wrench,
+                                       double i_dt,
+                                       const IntegrationOutputs* i_outputs)
+{
+  typedef typename FullSystemT::state_type state_type;
+  typedef typename FullSystemT::scalar_type Scalar;
+  typedef typename FullSystemT::jacobian_scalar_type JacobianScalar;
+  static const double ktstart = 0.;                          // Start integration time
+  const double dt = i_dt;                                    // Integration time step
 
   // 1. solve the costate system to find mu
-  FullSystem full_system(m_rodParameters, dt);
-  boost::numeric::odeint::runge_kutta4<FullSystem::state_type> fss_stepper;
+  FullSystemT full_system(m_rodParameters, dt);
+  auto&& stepped_system = util::instrument(full_system, m_stats);
+  boost::numeric::odeint::runge_kutta4<state_type, typename FullSystemT::value_type, state_type, double,
+                                       typename FullSystemT::algebra_type> fss_stepper;
 
-  FullSystem::state_type x_t = FullSystem::defaultState();
+  // the system is stepped out of place between two states, so the state at the beginning of each
+  // step remains available to locate the conjugate point
+  std::array<state_type, 2> states;
+  size_t idxCurState = 0;
+  states[idxCurState] = FullSystemT::defaultState();
+  state_type& x_0 = states[idxCurState];
 
   // Set initial state
   // init mu(0) = a	(base DLO wrench)
   for(int i = 0; i < 6; ++i)
   {
-    (x_t.data() + FullSystem::mu_index())[i] = i_wrench[i];   // order in wrench is angular then linear
+    // order in wrench is angular then linear
+    FullSystemT::costateData(x_0)[FullSystemT::mu_index() + i] = static_cast<Scalar>(i_wrench[i]);
   }
   // init q_0 to identity
-  Eigen::Map<Eigen::Matrix<double, 4, 4> > q_t_e(x_t.data() + FullSystem::q_index());
+  Eigen::Map<Eigen::Matrix<Scalar, 4, 4> > q_t_e(FullSystemT::costateData(x_0) + FullSystemT::q_index());
   q_t_e.setIdentity();
   // init M_0 to identity and J_0 to zero
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > M_t_e(x_t.data() + FullSystem::MJ_index());
-  Eigen::Map<Eigen::Matrix<double, 6, 6> > J_t_e(x_t.data() + FullSystem::MJ_index() + 36);
+  Eigen::Map<Eigen::Matrix<JacobianScalar, 6, 6> > M_t_e(FullSystemT::jacobianData(x_0));
+  Eigen::Map<Eigen::Matrix<JacobianScalar, 6, 6> > J_t_e(FullSystemT::jacobianData(x_0) + FullSystemT::J_index());
   M_t_e.setIdentity();
   J_t_e.setZero();
 
-  // setup internal memory
-  m_nodes.resize(m_numNodes);
-  m_nodes[0] = q_t_e;      // store q_0
-  if(m_integrationOptions.keepMuValues)
+  // setup internal memory, for the nodes selected by integrateFromBaseWrench() only. With checkpoints, the kept
+  // mu values, M and J matrices are recomputed on access
+  const size_t numOutputs = m_outputNodes.empty() ? m_numNodes : m_outputNodes.size();
+  const size_t checkpointInterval = resetCheckpoints();
+  const bool storeMuValues = m_integrationOptions.keepMuValues && checkpointInterval == 0;
+  const bool storeMMatrices = m_integrationOptions.keepMMatrices && checkpointInterval == 0;
+  const bool storeJMatrices = m_integrationOptions.keepJMatrices && checkpointInterval == 0;
+  if(checkpointInterval > 0)
   {
-    m_mu.resize(m_numNodes);
-    // store mu_0
-    m_mu[0] = Eigen::Map<Wrench>(x_t.data() + FullSystem::mu_index());
+    saveCheckpoint<FullSystemT>(x_0, ktstart);
   }
-  else
-  {
-    m_mu.clear();
-  }
-  if(m_integrationOptions.keepMMatrices)
-  {
-    m_M.resize(m_numNodes);
-    m_M[0] = M_t_e;
-  }
-  else
+  if(i_outputs)
   {
+    // outputs are written into the caller buffers, checked by integrateFromBaseWrench()
+    m_nodes.clear();
+    m_mu.overwrite().assign(1, i_wrench);
     m_M.clear();
-  }
-  if(m_integrationOptions.keepJMatrices)
-  {
-    m_J.resize(m_numNodes);
-    m_J[0] = J_t_e;
-  }
-  else
-  {
     m_J.clear();
-  }
-  if(m_integrationOptions.keepJdet)
-  {
-    m_J_det.resize(m_numNodes);
-    m_J_det[0] = 0.;
+    m_J_det.clear();
+    resizeSoA(0, false);
+    writeOutputs<FullSystemT>(*i_outputs, 0, x_0, 0.);
+    if(!i_outputs->mu.empty())
+    {
+      Eigen::Map<Wrench>(i_outputs->mu.element(0)) = i_wrench;
+    }
   }
   else
   {
-    m_J_det.clear();
+    // buffers shared with copies of the state are replaced instead of copied, as they are entirely rewritten
+    Displacements& nodes = m_nodes.overwrite();
+    nodes.resize(numOutputs);
+    nodes[0] = q_t_e.template cast<double>();      // store q_0
+    Wrenches& mu = m_mu.overwrite();
+    if(storeMuValues)
+    {
+      mu.resize(numOutputs);
+      // store mu_0
+      mu[0] = i_wrench;
+    }
+    else
+    {
+      // mu_0 is kept in any case, so the state can be integrated again
+      mu.resize(1);
+      mu[0] = i_wrench;
+    }
+    if(storeMMatrices)
+    {
+      Matrices6d& M = m_M.overwrite();
+      M.resize(numOutputs);
+      M[0] = M_t_e.template cast<double>();
+    }
+    else
+    {
+      m_M.clear();
+    }
+    if(storeJMatrices)
+    {
+      Matrices6d& J = m_J.overwrite();
+      J.resize(numOutputs);
+      J[0] = J_t_e.template cast<double>();
+    }
+    else
+    {
+      m_J.clear();
+    }
+    if(m_integrationOptions.keepJdet)
+    {
+      std::vector<double>& J_det = m_J_det.overwrite();
+      J_det.resize(numOutputs);
+      J_det[0] = 0.;
+    }
+    else
+    {
+      m_J_det.clear();
+    }
+    resizeSoA(numOutputs, false);
+    storeSoA(0, J_t_e);
   }
 
   m_isStable = true;
   bool isThresholdOn = false;
 
   size_t step_idx = 1;
+  size_t idxOutput = 1;     // index of the next stored node
   double prev_det_J = 0.;
   double det_J = 0.;
   for(double t = ktstart; step_idx < m_numNodes; ++step_idx, t += dt)
   {
-    fss_stepper.do_step(full_system, x_t, t, dt);
-    // save state
-    if(m_integrationOptions.keepMuValues)
-    {
-      m_mu[step_idx] = Eigen::Map<Wrench>(x_t.data() + FullSystem::mu_index());
-    }
-    m_nodes[step_idx] = Eigen::Map<const Eigen::Matrix4d>(x_t.data() + FullSystem::q_index());
-    if(m_integrationOptions.keepMMatrices)
-    {
-      m_M[step_idx] = Eigen::Map<Eigen::Matrix<double, 6, 6> >(x_t.data() + FullSystem::MJ_index());
-    }
-    auto J_mat = Eigen::Map<Eigen::Matrix<double, 6, 6> >(x_t.data() + FullSystem::MJ_index() + 36);
+    const state_type& x_prev = states[idxCurState];
+    idxCurState = 1 - idxCurState;
+    state_type& x_t = states[idxCurState];
+    fss_stepper.do_step(stepped_system, x_prev, t, x_t, dt);
+    QSERL_STATS(++m_stats.numSteps);
+    const Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> > J_mat(FullSystemT::jacobianData(x_t) +
+                                                                      FullSystemT::J_index());
     // check stability
     prev_det_J = det_J;
-    det_J =  Eigen::Map<Eigen::Matrix<double, 6, 6> >(x_t.data() + FullSystem::MJ_index() + 36).determinant();
-    if(m_integrationOptions.keepJMatrices)
     {
-      m_J[step_idx] = J_mat;
+      QSERL_STATS(util::StatsTimer determinantTimer(m_stats.determinantTimeNs));
+      det_J = static_cast<double>(J_mat.determinant());
     }
-    if(m_integrationOptions.keepJdet)
+    // save state of selected nodes
+    if(idxOutput < numOutputs && (m_outputNodes.empty() || m_outputNodes[idxOutput] == step_idx))
+    {
+      QSERL_STATS(util::StatsTimer storageTimer(m_stats.storageTimeNs));
+      if(i_outputs)
+      {
+        writeOutputs<FullSystemT>(*i_outputs, idxOutput, x_t, det_J);
+      }
+      else
+      {
+        if(storeMuValues)
+        {
+          m_mu.mutate()[idxOutput] = Eigen::Map<const Eigen::Matrix<Scalar, 6, 1> >(FullSystemT::costateData(x_t) +
+                                                                           FullSystemT::mu_index()).template cast<double>();
+        }
+        m_nodes.mutate()[idxOutput] = Eigen::Map<const Eigen::Matrix<Scalar, 4, 4> >(FullSystemT::costateData(x_t) +
+                                                                           FullSystemT::q_index()).template cast<double>();
+        if(storeMMatrices)
+        {
+          m_M.mutate()[idxOutput] = Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> >(
+              FullSystemT::jacobianData(x_t)).template cast<double>();
+        }
+        if(storeJMatrices)
+        {
+          m_J.mutate()[idxOutput] = J_mat.template cast<double>();
+        }
+        if(m_integrationOptions.keepJdet)
+        {
+          m_J_det.mutate()[idxOutput] = det_J;
+        }
+        storeSoA(idxOutput, J_mat);
+      }
+      ++idxOutput;
+    }
+    if(checkpointInterval > 0 && step_idx % checkpointInterval == 0)
     {
-      m_J_det[step_idx] = det_J;
+      saveCheckpoint<FullSystemT>(x_t, t + dt);
     }
-    if(std::abs(det_J) > full_system.jacobianStabilityThreshold())
+    if(!isThresholdOn && std::abs(det_J) > full_system.jacobianStabilityThreshold())
     {
       isThresholdOn = true;
+      QSERL_STATS(m_stats.stabilityThresholdNode = static_cast<int>(step_idx));
     }
-    if(isThresholdOn and (std::abs(det_J) < full_system.jacobianStabilityTolerance() or
+    if(m_isStable and isThresholdOn and (std::abs(det_J) < full_system.jacobianStabilityTolerance() or
       det_J * prev_det_J < 0.))
     {  // zero crossing
       m_isStable = false;
+      m_conjugatePointT = locateConjugatePoint(full_system, x_prev, x_t, t, dt,
+                                               m_integrationOptions.conjugatePointTolerance);
     }
   }
 
+  m_numIntegratedNodes = m_numNodes;
+
   // compute J nu part singular values
   if((!m_integrationOptions.stop_if_unstable || m_isStable) && m_integrationOptions.computeJ_nu_sv)
   {
-    m_J_nu_sv.assign(m_numNodes, Eigen::Vector3d::Zero());
-    for(size_t idxNode = 1; idxNode < m_numNodes; ++idxNode)
+    QSERL_STATS(util::StatsTimer svdTimer(m_stats.svdTimeNs));
+    std::vector<Eigen::Vector3d>& J_nu_sv = m_J_nu_sv.overwrite();
+    J_nu_sv.assign(m_J.size(), Eigen::Vector3d::Zero());
+    for(size_t idxNode = 1; idxNode < m_J.size(); ++idxNode)
     {
       Eigen::JacobiSVD<Eigen::Matrix<double, 3, 6> > svd_J_nu(m_J[idxNode].block<3, 6>(3, 0));
-      m_J_nu_sv[idxNode] = svd_J_nu.singularValues();
+      J_nu_sv[idxNode] = svd_J_nu.singularValues();
     }
   }
 
@@ -265,6 +837,247 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const Wrench& i_wrench)
   return IR_VALID;
 }
 
+/************************************************************************/
+/*													integrateWhileValid													*/
+/************************************************************************/
+WorkspaceIntegratedState::IntegrationResultT
+WorkspaceIntegratedState::integrateWhileValid(const Wrench& i_maxWrench,
+                                              double& o_tinv)
+{
+  static const double ktstart = 0.;                          // Start integration time
+  const double ktend = m_rodParameters.integrationTime;      // End integration time
+  const double dt = (ktend - ktstart) / static_cast<double>(m_numNodes - 1);  // Integration time step
+
+  o_tinv = -1.;
+  QSERL_PROFILE_ZONE("rod3d::integrateWhileValid");
+  QSERL_TRACE_SCOPE("rod3d::integrateWhileValid");
+  QSERL_ALLOCATION_SCOPE("rod3d::integrateWhileValid");
+  QSERL_METRICS(util::MetricsTimer latencyTimer(*s_integrationMetrics.integrateWhileValidSeconds));
+  m_stats.reset();
+  QSERL_STATS(util::StatsTimer totalTimer(m_stats.totalTimeNs));
+
+  if(selectOutputNodes() == 0)
+  {
+    m_isInitialized = false;
+    m_isStable = false;
+    m_nodes.clear();
+    return countResult(IR_INVALID_OPTIONS);
+  }
+  m_isInitialized = true;
+  m_conjugatePointT = -1.;
+
+  const Wrench mu_0 = m_mu[0];
+  if(Rod::isConfigurationSingular(mu_0))
+  {
+    // outputs of a previous integration are not kept, only the base wrench is
+    clearOutputs();
+    m_mu.overwrite().assign(1, mu_0);
+    m_isInitialized = true;
+    return countResult(IR_SINGULAR);
+  }
+
+  switch(m_integrationOptions.precision)
+  {
+    case IP_FLOAT:
+      return countResult(integrateWhileValidRK4<FullSystemFloat>(i_maxWrench, dt, o_tinv));
+    case IP_MIXED:
+      return countResult(integrateWhileValidRK4<FullSystemMixed>(i_maxWrench, dt, o_tinv));
+    default:
+      return countResult(integrateWhileValidRK4<FullSystem>(i_maxWrench, dt, o_tinv));
+  }
+}
+
+/************************************************************************/
+/*												integrateWhileValidRK4												*/
+/************************************************************************/
+template<typename FullSystemT>
+WorkspaceIntegratedState::IntegrationResultT
+WorkspaceIntegratedState::integrateWhileValidRK4(const Wrench& i_maxWrench,
+                                                 double i_dt,
+                                                 double& o_tinv)
+{
+  typedef typename FullSystemT::state_type state_type;
+  typedef typename FullSystemT::scalar_type Scalar;
+  typedef typename FullSystemT::jacobian_scalar_type JacobianScalar;
+  static const double ktstart = 0.;                          // Start integration time
+  const double dt = i_dt;                                    // Integration time step
+  const Wrench mu_0 = m_mu[0];
+
+  FullSystemT full_system(m_rodParameters, dt);
+  auto&& stepped_system = util::instrument(full_system, m_stats);
+  boost::numeric::odeint::runge_kutta4<state_type, typename FullSystemT::value_type, state_type, double,
+                                       typename FullSystemT::algebra_type> fss_stepper;
+
+  std::array<state_type, 2> states;
+  size_t idxCurState = 0;
+  states[idxCurState] = FullSystemT::defaultState();
+  state_type& x_0 = states[idxCurState];
+
+  // init mu(0) = a (base DLO wrench), q_0 to identity, M_0 to identity and J_0 to zero
+  Eigen::Map<Eigen::Matrix<Scalar, 6, 1> >(FullSystemT::costateData(x_0) + FullSystemT::mu_index()) =
+      mu_0.template cast<Scalar>();
+  Eigen::Map<Eigen::Matrix<Scalar, 4, 4> > q_t_e(FullSystemT::costateData(x_0) + FullSystemT::q_index());
+  q_t_e.setIdentity();
+  Eigen::Map<Eigen::Matrix<JacobianScalar, 6, 6> > M_t_e(FullSystemT::jacobianData(x_0));
+  Eigen::Map<Eigen::Matrix<JacobianScalar, 6, 6> > J_t_e(FullSystemT::jacobianData(x_0) + FullSystemT::J_index());
+  M_t_e.setIdentity();
+  J_t_e.setZero();
+
+  // only the selected nodes of the valid prefix of the rod are stored, so storage grows with the integration
+  const size_t numOutputs = m_outputNodes.empty() ? m_numNodes : m_outputNodes.size();
+  const size_t checkpointInterval = resetCheckpoints();
+  const bool storeMuValues = m_integrationOptions.keepMuValues && checkpointInterval == 0;
+  const bool storeMMatrices = m_integrationOptions.keepMMatrices && checkpointInterval == 0;
+  const bool storeJMatrices = m_integrationOptions.keepJMatrices && checkpointInterval == 0;
+  if(checkpointInterval > 0)
+  {
+    saveCheckpoint<FullSystemT>(x_0, ktstart);
+  }
+  // buffers shared with copies of the state are replaced instead of copied, as they are entirely rewritten
+  Displacements& nodes = m_nodes.overwrite();
+  nodes.clear();
+  nodes.reserve(numOutputs);
+  nodes.push_back(q_t_e.template cast<double>());
+  Wrenches& mu = m_mu.overwrite();
+  mu.assign(1, mu_0);
+  if(storeMuValues)
+  {
+    mu.reserve(numOutputs);
+  }
+  m_M.clear();
+  if(storeMMatrices)
+  {
+    Matrices6d& M = m_M.overwrite();
+    M.reserve(numOutputs);
+    M.push_back(M_t_e.template cast<double>());
+  }
+  m_J.clear();
+  if(storeJMatrices)
+  {
+    Matrices6d& J = m_J.overwrite();
+    J.reserve(numOutputs);
+    J.push_back(J_t_e.template cast<double>());
+  }
+  m_J_det.clear();
+  if(m_integrationOptions.keepJdet)
+  {
+    std::vector<double>& J_det = m_J_det.overwrite();
+    J_det.reserve(numOutputs);
+    J_det.push_back(0.);
+  }
+  m_J_nu_sv.clear();
+  resizeSoA(numOutputs, false);
+  storeSoA(0, J_t_e);
+
+  // integrate until unstability, wrench bounds or max iteration reached
+  m_isStable = true;  // will stay true as we keep the last valid state, which always exists starting from origin
+  bool isStable = true;
+  bool isOutOfWrenchBounds = !isWithinBounds(mu_0, i_maxWrench);
+  bool isThresholdOn = false;
+  double prev_det_J = 0.;
+  double det_J = 0.;
+  double t = ktstart;
+  for(size_t step_idx = 1; isStable && !isOutOfWrenchBounds && step_idx < m_numNodes; ++step_idx)
+  {
+    const state_type& x_prev = states[idxCurState];
+    state_type& x_t = states[1 - idxCurState];
+    fss_stepper.do_step(stepped_system, x_prev, t, x_t, dt);
+    QSERL_STATS(++m_stats.numSteps);
+
+    const Wrench mu_t = Eigen::Map<const Eigen::Matrix<Scalar, 6, 1> >(FullSystemT::costateData(x_t) +
+                                                                        FullSystemT::mu_index()).template cast<double>();
+    if(!isWithinBounds(mu_t, i_maxWrench))
+    {
+      isOutOfWrenchBounds = true;
+      break;
+    }
+
+    // check stability
+    const Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> > J_mat(FullSystemT::jacobianData(x_t) +
+                                                                      FullSystemT::J_index());
+    prev_det_J = det_J;
+    {
+      QSERL_STATS(util::StatsTimer determinantTimer(m_stats.determinantTimeNs));
+      det_J = static_cast<double>(J_mat.determinant());
+    }
+    if(!isThresholdOn && std::abs(det_J) > full_system.jacobianStabilityThreshold())
+    {
+      isThresholdOn = true;
+      QSERL_STATS(m_stats.stabilityThresholdNode = static_cast<int>(step_idx));
+    }
+    if(isThresholdOn and (std::abs(det_J) < full_system.jacobianStabilityTolerance() or
+      det_J * prev_det_J < 0.))
+    {  // zero crossing
+      isStable = false;
+      m_conjugatePointT = locateConjugatePoint(full_system, x_prev, x_t, t, dt,
+                                               m_integrationOptions.conjugatePointTolerance);
+      break;
+    }
+
+    // node is valid, save state of selected nodes
+    idxCurState = 1 - idxCurState;
+    t += dt;
+    m_numIntegratedNodes = step_idx + 1;
+    if(checkpointInterval > 0 && step_idx % checkpointInterval == 0)
+    {
+      saveCheckpoint<FullSystemT>(x_t, t);
+    }
+    if(m_nodes.size() >= numOutputs || (!m_outputNodes.empty() && m_outputNodes[m_nodes.size()] != step_idx))
+    {
+      continue;
+    }
+    QSERL_STATS(util::StatsTimer storageTimer(m_stats.storageTimeNs));
+    m_nodes.mutate().push_back(Eigen::Map<const Eigen::Matrix<Scalar, 4, 4> >(FullSystemT::costateData(x_t) +
+                                                                     FullSystemT::q_index()).template cast<double>());
+    if(storeMuValues)
+    {
+      m_mu.mutate().push_back(mu_t);
+    }
+    if(storeMMatrices)
+    {
+      m_M.mutate().push_back(Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> >(
+          FullSystemT::jacobianData(x_t)).template cast<double>());
+    }
+    if(storeJMatrices)
+    {
+      m_J.mutate().push_back(J_mat.template cast<double>());
+    }
+    storeSoA(m_nodes.size() - 1, J_mat);
+    if(m_integrationOptions.keepJdet)
+    {
+      m_J_det.mutate().push_back(det_J);
+    }
+  }
+
+  resizeSoA(m_nodes.size(), true);
+
+  // compute J nu part singular values of the valid prefix
+  if(m_integrationOptions.computeJ_nu_sv && m_integrationOptions.keepJMatrices)
+  {
+    QSERL_STATS(util::StatsTimer svdTimer(m_stats.svdTimeNs));
+    std::vector<Eigen::Vector3d>& J_nu_sv = m_J_nu_sv.overwrite();
+    J_nu_sv.assign(m_J.size(), Eigen::Vector3d::Zero());
+    for(size_t idxNode = 1; idxNode < m_J.size(); ++idxNode)
+    {
+      Eigen::JacobiSVD<Eigen::Matrix<double, 3, 6> > svd_J_nu(m_J[idxNode].block<3, 6>(3, 0));
+      J_nu_sv[idxNode] = svd_J_nu.singularValues();
+    }
+  }
+
+  if(!isStable)
+  {
+    // conjugate point found
+    o_tinv = m_conjugatePointT;
+    return IR_UNSTABLE;
+  }
+  else if(isOutOfWrenchBounds)
+  {
+    o_tinv = t;
+    return IR_OUT_OF_WRENCH_BOUNDS;
+  }
+  return IR_VALID;
+}
+
 /************************************************************************/
 /*									computeJacobianNuSingularValues											*/
 /************************************************************************/
@@ -281,6 +1094,110 @@ WorkspaceIntegratedState::integrateFromBaseWrenchRK4(const Wrench& i_wrench)
 //	return m_computeJ_nu_sv;
 //}
 
+/************************************************************************/
+/*														recomputeSegment																	*/
+/************************************************************************/
+template<typename FullSystemT>
+void
+WorkspaceIntegratedState::recomputeSegment(size_t i_checkpointIdx,
+                                           LazySegment& o_segment) const
+{
+  typedef typename FullSystemT::state_type state_type;
+  typedef typename FullSystemT::scalar_type Scalar;
+  typedef typename FullSystemT::jacobian_scalar_type JacobianScalar;
+  QSERL_PROFILE_ZONE("rod3d::recomputeSegment");
+  // same time step as the integration, so the recomputed values are identical to the integrated ones
+  const double dt = m_rodParameters.integrationTime / static_cast<double>(m_numNodes - 1);
+  const size_t checkpointInterval = m_integrationOptions.checkpointInterval;
+  const size_t firstNode = i_checkpointIdx * checkpointInterval;
+  const size_t numSegmentNodes = std::min(checkpointInterval, m_numIntegratedNodes - firstNode);
+
+  FullSystemT full_system(m_rodParameters, dt);
+  boost::numeric::odeint::runge_kutta4<state_type, typename FullSystemT::value_type, state_type, double,
+                                       typename FullSystemT::algebra_type> fss_stepper;
+
+  // checkpoints are stored in double precision, so casting them back to the integration precision is exact
+  const Checkpoint& checkpoint = m_checkpoints[i_checkpointIdx];
+  std::array<state_type, 2> states;
+  size_t idxCurState = 0;
+  states[idxCurState] = FullSystemT::defaultState();
+  for(size_t i = 0; i < kCostateSize; ++i)
+  {
+    FullSystemT::costateData(states[idxCurState])[i] = static_cast<Scalar>(checkpoint.x[i]);
+  }
+  for(size_t i = 0; i < kJacobiansSize; ++i)
+  {
+    FullSystemT::jacobianData(states[idxCurState])[i] = static_cast<JacobianScalar>(checkpoint.x[kCostateSize + i]);
+  }
+
+  o_segment.checkpointIdx = i_checkpointIdx;
+  o_segment.mu.resize(numSegmentNodes);
+  o_segment.M.resize(numSegmentNodes);
+  o_segment.J.resize(numSegmentNodes);
+  double t = checkpoint.t;
+  for(size_t idxSegmentNode = 0; idxSegmentNode < numSegmentNodes; ++idxSegmentNode)
+  {
+    if(idxSegmentNode > 0)
+    {
+      fss_stepper.do_step(std::ref(full_system), states[idxCurState], t, states[1 - idxCurState], dt);
+      idxCurState = 1 - idxCurState;
+      t += dt;
+    }
+    const state_type& x_t = states[idxCurState];
+    o_segment.mu[idxSegmentNode] = Eigen::Map<const Eigen::Matrix<Scalar, 6, 1> >(
+        FullSystemT::costateData(x_t) + FullSystemT::mu_index()).template cast<double>();
+    o_segment.M[idxSegmentNode] = Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> >(
+        FullSystemT::jacobianData(x_t)).template cast<double>();
+    o_segment.J[idxSegmentNode] = Eigen::Map<const Eigen::Matrix<JacobianScalar, 6, 6> >(
+        FullSystemT::jacobianData(x_t) + FullSystemT::J_index()).template cast<double>();
+  }
+}
+
+/************************************************************************/
+/*														lazySegment																	*/
+/************************************************************************/
+const WorkspaceIntegratedState::LazySegment&
+WorkspaceIntegratedState::lazySegment(size_t i_nodeIdx) const
+{
+  assert(!m_checkpoints.empty() && "checkpoints must be enabled");
+  if(i_nodeIdx >= m_numIntegratedNodes)
+  {
+    throwNodeNotStored(i_nodeIdx);
+  }
+  const size_t checkpointIdx = i_nodeIdx / m_integrationOptions.checkpointInterval;
+
+  // look for the segment in cache, or evict the least recently used one
+  ++m_lazyClock;
+  LazySegment* segment = &m_lazySegments[0];
+  for(LazySegment& cachedSegment : m_lazySegments)
+  {
+    if(cachedSegment.lastUse > 0 && cachedSegment.checkpointIdx == checkpointIdx)
+    {
+      cachedSegment.lastUse = m_lazyClock;
+      return cachedSegment;
+    }
+    if(cachedSegment.lastUse < segment->lastUse)
+    {
+      segment = &cachedSegment;
+    }
+  }
+
+  switch(m_integrationOptions.precision)
+  {
+    case IP_FLOAT:
+      recomputeSegment<FullSystemFloat>(checkpointIdx, *segment);
+      break;
+    case IP_MIXED:
+      recomputeSegment<FullSystemMixed>(checkpointIdx, *segment);
+      break;
+    default:
+      recomputeSegment<FullSystem>(checkpointIdx, *segment);
+      break;
+  }
+  segment->lastUse = m_lazyClock;
+  return *segment;
+}
+
 /************************************************************************/
 /*																isStable															*/
 /************************************************************************/
@@ -291,6 +1208,16 @@ WorkspaceIntegratedState::isStable() const
   return m_isStable;
 }
 
+/************************************************************************/
+/*														conjugatePointT														*/
+/************************************************************************/
+double
+WorkspaceIntegratedState::conjugatePointT() const
+{
+  assert(m_isInitialized && "the state must be integrated first");
+  return m_conjugatePointT;
+}
+
 /************************************************************************/
 /*																baseWrench														*/
 /************************************************************************/
@@ -308,6 +1235,10 @@ Wrench
 WorkspaceIntegratedState::tipWrench() const
 {
   assert(m_isInitialized && "the state must be integrated first");
+  if(!m_checkpoints.empty())
+  {
+    return wrench(m_numIntegratedNodes - 1);
+  }
   return m_mu.back();
 }
 
@@ -318,8 +1249,32 @@ Wrench
 WorkspaceIntegratedState::wrench(size_t i_idxNode) const
 {
   assert(m_isInitialized && "the state must be integrated first");
-  assert(i_idxNode < m_mu.size() && "invalid node index");
-  return m_mu[i_idxNode];
+  if(i_idxNode > 0 && !m_checkpoints.empty())
+  {
+    const LazySegment& segment = lazySegment(i_idxNode);
+    return segment.mu[i_idxNode - segment.checkpointIdx * m_integrationOptions.checkpointInterval];
+  }
+  const size_t idxOutput = i_idxNode == 0 ? 0 : outputIndex(i_idxNode);
+  return storedOutput(m_mu.get(), idxOutput, i_idxNode);
+}
+
+/************************************************************************/
+/*															node																		*/
+/************************************************************************/
+const Displacement&
+WorkspaceIntegratedState::node(size_t i_nodeIdx) const
+{
+  const size_t idxOutput = outputIndex(i_nodeIdx);
+  return storedOutput(m_nodes.get(), idxOutput, i_nodeIdx);
+}
+
+/************************************************************************/
+/*														outputNodes																	*/
+/************************************************************************/
+const std::vector<size_t>&
+WorkspaceIntegratedState::outputNodes() const
+{
+  return m_outputNodes;
 }
 
 /************************************************************************/
@@ -329,7 +1284,7 @@ const Wrenches&
 WorkspaceIntegratedState::mu() const
 {
   assert(m_isInitialized && "the state must be integrated first");
-  return m_mu;
+  return m_mu.get();
 }
 
 /************************************************************************/
@@ -339,8 +1294,13 @@ const Matrix6d&
 WorkspaceIntegratedState::getMMatrix(size_t i_nodeIdx) const
 {
   assert(m_isInitialized && "the state must be integrated first");
-  assert(i_nodeIdx < m_numNodes && "invalid node index");
-  return m_M[i_nodeIdx];
+  if(!m_checkpoints.empty())
+  {
+    const LazySegment& segment = lazySegment(i_nodeIdx);
+    return segment.M[i_nodeIdx - segment.checkpointIdx * m_integrationOptions.checkpointInterval];
+  }
+  const size_t idxOutput = outputIndex(i_nodeIdx);
+  return storedOutput(m_M.get(), idxOutput, i_nodeIdx);
 }
 
 /************************************************************************/
@@ -350,8 +1310,13 @@ const Matrix6d&
 WorkspaceIntegratedState::getJMatrix(size_t i_nodeIdx) const
 {
   assert(m_isInitialized && "the state must be integrated first");
-  assert(i_nodeIdx < m_numNodes && "invalid node index");
-  return m_J[i_nodeIdx];
+  if(!m_checkpoints.empty())
+  {
+    const LazySegment& segment = lazySegment(i_nodeIdx);
+    return segment.J[i_nodeIdx - segment.checkpointIdx * m_integrationOptions.checkpointInterval];
+  }
+  const size_t idxOutput = outputIndex(i_nodeIdx);
+  return storedOutput(m_J.get(), idxOutput, i_nodeIdx);
 }
 
 /************************************************************************/
@@ -361,7 +1326,7 @@ const std::vector<double>&
 WorkspaceIntegratedState::J_det() const
 {
   assert(m_isInitialized && "the state must be integrated first");
-  return m_J_det;
+  return m_J_det.get();
 }
 
 /************************************************************************/
@@ -370,8 +1335,8 @@ WorkspaceIntegratedState::J_det() const
 const Eigen::Vector3d&
 WorkspaceIntegratedState::J_nu_sv(size_t i_nodeIdx) const
 {
-  assert(i_nodeIdx < m_numNodes && "invalid node index");
-  return m_J_nu_sv[i_nodeIdx];
+  const size_t idxOutput = outputIndex(i_nodeIdx);
+  return storedOutput(m_J_nu_sv.get(), idxOutput, i_nodeIdx);
 }
 
 /************************************************************************/
@@ -400,21 +1365,78 @@ WorkspaceIntegratedState::J_nu_sv(size_t i_nodeIdx) const
 //}
 
 
+/************************************************************************/
+/*														positionsSoA																	*/
+/************************************************************************/
+const PositionsSoA&
+WorkspaceIntegratedState::positionsSoA() const
+{
+  assert(m_isInitialized && "the state must be integrated first");
+  return m_positionsSoA.get();
+}
+
+/************************************************************************/
+/*														rotationsSoA																	*/
+/************************************************************************/
+const RotationsSoA&
+WorkspaceIntegratedState::rotationsSoA() const
+{
+  assert(m_isInitialized && "the state must be integrated first");
+  return m_rotationsSoA.get();
+}
+
+/************************************************************************/
+/*														quaternionsSoA																	*/
+/************************************************************************/
+const QuaternionsSoA&
+WorkspaceIntegratedState::quaternionsSoA() const
+{
+  assert(m_isInitialized && "the state must be integrated first");
+  return m_quaternionsSoA.get();
+}
+
+/************************************************************************/
+/*															JSoA																		*/
+/************************************************************************/
+const Matrices6dSoA&
+WorkspaceIntegratedState::JSoA() const
+{
+  assert(m_isInitialized && "the state must be integrated first");
+  return m_JSoA.get();
+}
+
 /************************************************************************/
 /*																	memUsage														*/
 /************************************************************************/
 size_t
 WorkspaceIntegratedState::memUsage() const
 {
+  // shared buffers are counted in full, see the declaration
   return WorkspaceState::memUsage() +
          sizeof(m_isInitialized) +
          sizeof(m_isStable) +
-         m_mu.capacity() * sizeof(Wrench) +
-         m_M.capacity() * sizeof(Matrix6d) +
-         m_J.capacity() * sizeof(Matrix6d) +
-         m_J_det.capacity() * sizeof(double) +
-         m_J_nu_sv.capacity() * sizeof(Eigen::Vector3d) +
-         sizeof(m_integrationOptions);
+         sizeof(m_conjugatePointT) +
+         m_mu.get().capacity() * sizeof(Wrench) +
+         m_M.get().capacity() * sizeof(Matrix6d) +
+         m_J.get().capacity() * sizeof(Matrix6d) +
+         m_J_det.get().capacity() * sizeof(double) +
+         m_J_nu_sv.get().capacity() * sizeof(Eigen::Vector3d) +
+         m_outputNodes.capacity() * sizeof(size_t) +
+         (m_positionsSoA.size() + m_rotationsSoA.size() + m_quaternionsSoA.size() + m_JSoA.size()) *
+         sizeof(double) +
+         m_checkpoints.get().capacity() * sizeof(Checkpoint) +
+         lazySegmentsMemUsage(m_lazySegments) +
+         sizeof(m_integrationOptions) +
+         sizeof(m_stats);
+}
+
+/************************************************************************/
+/*												integrationStats															*/
+/************************************************************************/
+const util::IntegrationStats&
+WorkspaceIntegratedState::integrationStats() const
+{
+  return m_stats;
 }
 
 /************************************************************************/
@@ -444,7 +1466,16 @@ WorkspaceIntegratedState::IntegrationOptions::IntegrationOptions() :
     keepMuValues(false),
     keepJdet(false),
     keepMMatrices(false),
-    keepJMatrices(true)
+    keepJMatrices(true),
+    conjugatePointTolerance(1.e-9),
+    precision(IP_DOUBLE),
+    outputNodes(),
+    outputStride(1),
+    keepPositionsSoA(false),
+    keepRotationsSoA(false),
+    keepQuaternionsSoA(false),
+    keepJSoA(false),
+    checkpointInterval(0)
 {
 }
 
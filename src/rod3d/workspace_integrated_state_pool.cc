@@ -0,0 +1,285 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/rod3d/workspace_integrated_state_pool.h"
+
+#include <cassert>
+
+namespace qserl {
+namespace rod3d {
+
+/**
+* \brief Allocator of the shared pointers control blocks, recycled by the pool.
+* It keeps the pool alive until the control block is deallocated.
+*/
+template<typename T>
+class WorkspaceIntegratedStatePool::BlockAllocator
+{
+public:
+  typedef T value_type;
+
+  explicit BlockAllocator(const WorkspaceIntegratedStatePoolShPtr& i_pool) :
+      m_pool(i_pool)
+  {
+  }
+
+  template<typename U>
+  BlockAllocator(const BlockAllocator<U>& i_other) :
+      m_pool(i_other.m_pool)
+  {
+  }
+
+  T*
+  allocate(size_t i_num)
+  {
+    return static_cast<T*>(m_pool->allocateBlock(i_num * sizeof(T)));
+  }
+
+  void
+  deallocate(T* i_block,
+             size_t i_num)
+  {
+    m_pool->deallocateBlock(i_block, i_num * sizeof(T));
+  }
+
+  template<typename U>
+  bool
+  operator==(const BlockAllocator<U>& i_other) const
+  {
+    return m_pool == i_other.m_pool;
+  }
+
+  template<typename U>
+  bool
+  operator!=(const BlockAllocator<U>& i_other) const
+  {
+    return m_pool != i_other.m_pool;
+  }
+
+  WorkspaceIntegratedStatePoolShPtr m_pool;
+};
+
+/**
+* \brief Deleter of the acquired states, putting them back into the pool.
+*/
+struct WorkspaceIntegratedStatePool::Releaser
+{
+  void
+  operator()(WorkspaceIntegratedState* io_state) const
+  {
+    m_pool->release(io_state);
+  }
+
+  WorkspaceIntegratedStatePoolShPtr m_pool;
+};
+
+/************************************************************************/
+/*														Constructor																	*/
+/************************************************************************/
+WorkspaceIntegratedStatePool::WorkspaceIntegratedStatePool(unsigned int i_nnodes,
+                                                           const Parameters& i_rodParams) :
+    m_weakPtr(),
+    m_numNodes(i_nnodes),
+    m_rodParameters(i_rodParams),
+    m_mutex(),
+    m_freeStates(),
+    m_freeBlocks(),
+    m_blockSize(0),
+    m_numStates(0)
+{
+}
+
+/************************************************************************/
+/*														Destructor																	*/
+/************************************************************************/
+WorkspaceIntegratedStatePool::~WorkspaceIntegratedStatePool()
+{
+  // acquired states keep the pool alive, so all states are free here
+  assert(m_freeStates.size() == m_numStates && "acquired states must not outlive the pool");
+  for(WorkspaceIntegratedState* state : m_freeStates)
+  {
+    delete state;
+  }
+  for(void* block : m_freeBlocks)
+  {
+    ::operator delete(block);
+  }
+}
+
+/************************************************************************/
+/*															create																	*/
+/************************************************************************/
+WorkspaceIntegratedStatePoolShPtr
+WorkspaceIntegratedStatePool::create(unsigned int i_nnodes,
+                                     const Parameters& i_rodParams)
+{
+  WorkspaceIntegratedStatePoolShPtr shPtr(new WorkspaceIntegratedStatePool(i_nnodes, i_rodParams));
+
+  if(!shPtr->init(shPtr))
+  {
+    shPtr.reset();
+  }
+
+  return shPtr;
+}
+
+/************************************************************************/
+/*															init																		*/
+/************************************************************************/
+bool
+WorkspaceIntegratedStatePool::init(const WorkspaceIntegratedStatePoolWkPtr& i_weakPtr)
+{
+  bool success = true;
+
+  if(success)
+  {
+    m_weakPtr = i_weakPtr;
+  }
+
+  return success;
+}
+
+/************************************************************************/
+/*															acquire																	*/
+/************************************************************************/
+WorkspaceIntegratedStateShPtr
+WorkspaceIntegratedStatePool::acquire(const Wrench& i_baseWrench,
+                                      const Displacement& i_basePosition)
+{
+  WorkspaceIntegratedState* state = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(!m_freeStates.empty())
+    {
+      state = m_freeStates.back();
+      m_freeStates.pop_back();
+    }
+    else
+    {
+      ++m_numStates;
+    }
+  }
+
+  if(state)
+  {
+    // nothing of the previous user is kept but the storage
+    state->clearOutputs();
+    state->base(i_basePosition);
+    state->integrationOptions(WorkspaceIntegratedState::IntegrationOptions());
+  }
+  else
+  {
+    state = new WorkspaceIntegratedState(m_numNodes, i_basePosition, m_rodParameters);
+  }
+  const bool success = state->init(i_baseWrench);
+  assert(success && "failed to initialize a pooled state");
+  (void) success;
+
+  const WorkspaceIntegratedStatePoolShPtr self = m_weakPtr.lock();
+  return WorkspaceIntegratedStateShPtr(state, Releaser{self}, BlockAllocator<WorkspaceIntegratedState>(self));
+}
+
+/************************************************************************/
+/*															reserve																	*/
+/************************************************************************/
+void
+WorkspaceIntegratedStatePool::reserve(size_t i_numStates)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_freeStates.reserve(i_numStates);
+  m_freeBlocks.reserve(i_numStates);
+  while(m_numStates < i_numStates)
+  {
+    m_freeStates.push_back(new WorkspaceIntegratedState(m_numNodes, Displacement::Identity(), m_rodParameters));
+    ++m_numStates;
+  }
+}
+
+/************************************************************************/
+/*														numFreeStates																	*/
+/************************************************************************/
+size_t
+WorkspaceIntegratedStatePool::numFreeStates() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_freeStates.size();
+}
+
+/************************************************************************/
+/*														numStates																	*/
+/************************************************************************/
+size_t
+WorkspaceIntegratedStatePool::numStates() const
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return m_numStates;
+}
+
+/************************************************************************/
+/*															release																	*/
+/************************************************************************/
+void
+WorkspaceIntegratedStatePool::release(WorkspaceIntegratedState* io_state)
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  m_freeStates.push_back(io_state);
+}
+
+/************************************************************************/
+/*														allocateBlock																	*/
+/************************************************************************/
+void*
+WorkspaceIntegratedStatePool::allocateBlock(size_t i_size)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_blockSize == 0)
+    {
+      m_blockSize = i_size;
+    }
+    if(i_size == m_blockSize && !m_freeBlocks.empty())
+    {
+      void* block = m_freeBlocks.back();
+      m_freeBlocks.pop_back();
+      return block;
+    }
+  }
+  return ::operator new(i_size);
+}
+
+/************************************************************************/
+/*														deallocateBlock																	*/
+/************************************************************************/
+void
+WorkspaceIntegratedStatePool::deallocateBlock(void* i_block,
+                                              size_t i_size)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(i_size == m_blockSize)
+    {
+      m_freeBlocks.push_back(i_block);
+      return;
+    }
+  }
+  ::operator delete(i_block);
+}
+
+}  // namespace rod3d
+}  // namespace qserl
@@ -20,6 +20,7 @@
 #include "qserl/rod3d/workspace_state.h"
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 
 namespace qserl {
 namespace rod3d {
@@ -98,7 +99,49 @@ WorkspaceState::numNodes() const
 const Displacements&
 WorkspaceState::nodes() const
 {
-  return m_nodes;
+  return m_nodes.get();
+}
+
+/************************************************************************/
+/*														exportPositions																	*/
+/************************************************************************/
+void
+WorkspaceState::exportPositions(PositionsSoA& o_positions) const
+{
+  o_positions.resize(3, m_nodes.size());
+  for(size_t idxNode = 0; idxNode < m_nodes.size(); ++idxNode)
+  {
+    o_positions.col(idxNode) = m_nodes[idxNode].block<3, 1>(0, 3);
+  }
+}
+
+/************************************************************************/
+/*														exportRotations																	*/
+/************************************************************************/
+void
+WorkspaceState::exportRotations(RotationsSoA& o_rotations) const
+{
+  o_rotations.resize(9, m_nodes.size());
+  for(size_t idxNode = 0; idxNode < m_nodes.size(); ++idxNode)
+  {
+    for(int j = 0; j < 3; ++j)
+    {
+      o_rotations.block<3, 1>(3 * j, idxNode) = m_nodes[idxNode].block<3, 1>(0, j);
+    }
+  }
+}
+
+/************************************************************************/
+/*														exportQuaternions																	*/
+/************************************************************************/
+void
+WorkspaceState::exportQuaternions(QuaternionsSoA& o_quaternions) const
+{
+  o_quaternions.resize(4, m_nodes.size());
+  for(size_t idxNode = 0; idxNode < m_nodes.size(); ++idxNode)
+  {
+    o_quaternions.col(idxNode) = Eigen::Quaterniond(m_nodes[idxNode].topLeftCorner<3, 3>()).coeffs();
+  }
 }
 
 /************************************************************************/
@@ -165,7 +208,7 @@ size_t
 WorkspaceState::memUsage() const
 {
   return sizeof(m_numNodes) +
-         m_nodes.capacity() * sizeof(Displacement) +
+         m_nodes.get().capacity() * sizeof(Displacement) +
          sizeof(m_base) +
          sizeof(m_rodParameters);/* +
 		sizeof(m_weakPtr);*/
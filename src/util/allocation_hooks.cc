@@ -0,0 +1,170 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/**
+* Allocation hooks counting the heap allocations of the process in util::AllocationTracker.
+* This file is not part of the library: it is compiled in executables that account allocations (tests, benchmarks),
+* through the qserl-allocation-hooks object library.
+* With the GNU C library, the C allocation functions are replaced, so that allocations made by Eigen (aligned
+* allocator, dynamic matrices) and the C++ runtime are counted as well. Otherwise, only the global operator new is.
+*/
+
+#include "qserl/util/allocation_tracker.h"
+
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+
+#if defined(__GLIBC__)
+
+extern "C" {
+
+void* __libc_malloc(size_t i_size);
+void* __libc_calloc(size_t i_num, size_t i_size);
+void* __libc_realloc(void* i_ptr, size_t i_size);
+void* __libc_memalign(size_t i_alignment, size_t i_size);
+void __libc_free(void* i_ptr);
+
+void*
+malloc(size_t i_size)
+{
+  qserl::util::AllocationTracker::recordAllocation(i_size);
+  return __libc_malloc(i_size);
+}
+
+void*
+calloc(size_t i_num,
+       size_t i_size)
+{
+  qserl::util::AllocationTracker::recordAllocation(i_num * i_size);
+  return __libc_calloc(i_num, i_size);
+}
+
+void*
+realloc(void* i_ptr,
+        size_t i_size)
+{
+  qserl::util::AllocationTracker::recordAllocation(i_size);
+  return __libc_realloc(i_ptr, i_size);
+}
+
+void*
+memalign(size_t i_alignment,
+         size_t i_size)
+{
+  qserl::util::AllocationTracker::recordAllocation(i_size);
+  return __libc_memalign(i_alignment, i_size);
+}
+
+void*
+aligned_alloc(size_t i_alignment,
+              size_t i_size)
+{
+  return memalign(i_alignment, i_size);
+}
+
+int
+posix_memalign(void** o_ptr,
+               size_t i_alignment,
+               size_t i_size)
+{
+  void* ptr = memalign(i_alignment, i_size);
+  if(!ptr)
+  {
+    return ENOMEM;
+  }
+  *o_ptr = ptr;
+  return 0;
+}
+
+void
+free(void* i_ptr)
+{
+  __libc_free(i_ptr);
+}
+
+} // extern "C"
+
+#else
+
+namespace {
+
+void*
+countedAllocation(std::size_t i_size)
+{
+  qserl::util::AllocationTracker::recordAllocation(i_size);
+  void* ptr = std::malloc(i_size > 0 ? i_size : 1);
+  if(!ptr)
+  {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+} // namespace
+
+void*
+operator new(std::size_t i_size)
+{
+  return countedAllocation(i_size);
+}
+
+void*
+operator new[](std::size_t i_size)
+{
+  return countedAllocation(i_size);
+}
+
+void
+operator delete(void* i_ptr) noexcept
+{
+  std::free(i_ptr);
+}
+
+void
+operator delete[](void* i_ptr) noexcept
+{
+  std::free(i_ptr);
+}
+
+void
+operator delete(void* i_ptr, std::size_t) noexcept
+{
+  std::free(i_ptr);
+}
+
+void
+operator delete[](void* i_ptr, std::size_t) noexcept
+{
+  std::free(i_ptr);
+}
+
+#endif
+
+namespace {
+
+struct HooksInstaller
+{
+  HooksInstaller()
+  {
+    qserl::util::AllocationTracker::setEnabled();
+  }
+} s_hooksInstaller;
+
+} // namespace
@@ -0,0 +1,248 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/allocation_tracker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Allocation counts of an API, shared by all threads.
+*/
+struct AllocationTracker::Api
+{
+  explicit Api(const char* i_name) :
+      name(i_name),
+      calls(0),
+      count(0),
+      bytes(0)
+  {
+  }
+
+  const char* name;
+  std::atomic<uint64_t> calls;
+  std::atomic<uint64_t> count;
+  std::atomic<uint64_t> bytes;
+};
+
+namespace {
+
+/** Maximal number of nested APIs accounted on a thread. */
+const int kMaxDepth = 16;
+
+struct Registry
+{
+  std::mutex mutex;
+  std::map<std::string, AllocationTracker::Api*> apis;
+};
+
+Registry&
+registry()
+{
+  // never destroyed, APIs may be left during static destruction
+  static Registry* s_registry = new Registry;
+  return *s_registry;
+}
+
+std::atomic<bool> s_isEnabled(false);
+
+// trivially initialized, as they are accessed from the allocation hooks
+thread_local AllocationCounts t_counts = {0, 0};
+thread_local AllocationTracker::Api* t_apis[kMaxDepth];
+thread_local int t_depth = 0;
+
+} // namespace
+
+/************************************************************************/
+/*														isEnabled																	*/
+/************************************************************************/
+bool
+AllocationTracker::isEnabled()
+{
+  return s_isEnabled.load(std::memory_order_relaxed);
+}
+
+/************************************************************************/
+/*														isPerApiEnabled																	*/
+/************************************************************************/
+bool
+AllocationTracker::isPerApiEnabled()
+{
+#ifdef QSERL_ENABLE_ALLOCATION_TRACKING
+  return isEnabled();
+#else
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*														threadCounts																	*/
+/************************************************************************/
+AllocationCounts
+AllocationTracker::threadCounts()
+{
+  return t_counts;
+}
+
+/************************************************************************/
+/*															report																	*/
+/************************************************************************/
+std::vector<AllocationReport>
+AllocationTracker::report()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::vector<AllocationReport> reports;
+  for(const std::pair<const std::string, Api*>& entry : reg.apis)
+  {
+    const Api& api = *entry.second;
+    AllocationReport report;
+    report.name = entry.first;
+    report.calls = api.calls.load(std::memory_order_relaxed);
+    report.allocations.count = api.count.load(std::memory_order_relaxed);
+    report.allocations.bytes = api.bytes.load(std::memory_order_relaxed);
+    if(report.calls > 0)
+    {
+      reports.push_back(report);
+    }
+  }
+  return reports;
+}
+
+/************************************************************************/
+/*														printReport																	*/
+/************************************************************************/
+void
+AllocationTracker::printReport(std::ostream& io_os)
+{
+  const std::vector<AllocationReport> reports = report();
+  size_t nameWidth = 3;
+  for(const AllocationReport& api : reports)
+  {
+    nameWidth = std::max(nameWidth, api.name.size());
+  }
+  const std::ios::fmtflags flags = io_os.flags();
+  io_os << std::left << std::setw(static_cast<int>(nameWidth)) << "api" << std::right
+        << std::setw(12) << "calls" << std::setw(14) << "allocs" << std::setw(16) << "bytes"
+        << std::setw(14) << "allocs/call" << std::setw(14) << "bytes/call" << std::endl;
+  io_os << std::fixed << std::setprecision(1);
+  for(const AllocationReport& api : reports)
+  {
+    io_os << std::left << std::setw(static_cast<int>(nameWidth)) << api.name << std::right
+          << std::setw(12) << api.calls << std::setw(14) << api.allocations.count
+          << std::setw(16) << api.allocations.bytes
+          << std::setw(14) << static_cast<double>(api.allocations.count) / static_cast<double>(api.calls)
+          << std::setw(14) << static_cast<double>(api.allocations.bytes) / static_cast<double>(api.calls)
+          << std::endl;
+  }
+  io_os.flags(flags);
+}
+
+/************************************************************************/
+/*															reset																		*/
+/************************************************************************/
+void
+AllocationTracker::reset()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for(const std::pair<const std::string, Api*>& entry : reg.apis)
+  {
+    entry.second->calls.store(0, std::memory_order_relaxed);
+    entry.second->count.store(0, std::memory_order_relaxed);
+    entry.second->bytes.store(0, std::memory_order_relaxed);
+  }
+}
+
+/************************************************************************/
+/*															api																		*/
+/************************************************************************/
+AllocationTracker::Api*
+AllocationTracker::api(const char* i_name)
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  Api*& api = reg.apis[i_name];
+  if(!api)
+  {
+    api = new Api(i_name);
+  }
+  return api;
+}
+
+/************************************************************************/
+/*															enter																		*/
+/************************************************************************/
+bool
+AllocationTracker::enter(Api* i_api)
+{
+  if(t_depth == kMaxDepth || std::find(t_apis, t_apis + t_depth, i_api) != t_apis + t_depth)
+  {
+    return false;
+  }
+  i_api->calls.fetch_add(1, std::memory_order_relaxed);
+  t_apis[t_depth++] = i_api;
+  return true;
+}
+
+/************************************************************************/
+/*															leave																		*/
+/************************************************************************/
+void
+AllocationTracker::leave(bool i_entered)
+{
+  if(i_entered)
+  {
+    --t_depth;
+  }
+}
+
+/************************************************************************/
+/*														recordAllocation																	*/
+/************************************************************************/
+void
+AllocationTracker::recordAllocation(std::size_t i_size)
+{
+  ++t_counts.count;
+  t_counts.bytes += i_size;
+  for(int depth = 0; depth < t_depth; ++depth)
+  {
+    t_apis[depth]->count.fetch_add(1, std::memory_order_relaxed);
+    t_apis[depth]->bytes.fetch_add(i_size, std::memory_order_relaxed);
+  }
+}
+
+/************************************************************************/
+/*														setEnabled																	*/
+/************************************************************************/
+void
+AllocationTracker::setEnabled()
+{
+  s_isEnabled.store(true, std::memory_order_relaxed);
+}
+
+} // namespace util
+} // namespace qserl
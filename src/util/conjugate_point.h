@@ -0,0 +1,122 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/** Localization of conjugate points within an integration step. */
+
+#ifndef QSERL_UTIL_CONJUGATE_POINT_H_
+#define QSERL_UTIL_CONJUGATE_POINT_H_
+
+#include <cmath>
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+namespace qserl {
+namespace util {
+
+/**
+* Returns the cubic Hermite interpolation at s in [0, 1] of the matrix J over an integration step of length h,
+* from its values and derivatives w.r.t. t at both ends of the step.
+*/
+template<int N>
+inline Eigen::Matrix<double, N, N>
+hermiteInterpolation(double s,
+                     double h,
+                     const Eigen::Matrix<double, N, N>& J0,
+                     const Eigen::Matrix<double, N, N>& dJ0,
+                     const Eigen::Matrix<double, N, N>& J1,
+                     const Eigen::Matrix<double, N, N>& dJ1)
+{
+  const double s2 = s * s;
+  const double s3 = s2 * s;
+  return (2. * s3 - 3. * s2 + 1.) * J0 + (s3 - 2. * s2 + s) * h * dJ0 +
+         (-2. * s3 + 3. * s2) * J1 + (s3 - s2) * h * dJ1;
+}
+
+/**
+* Locates the conjugate point, i.e. the zero of det(J(t)), within the integration step [t0, t1].
+* J(t) is interpolated by a cubic Hermite polynomial (which matches the order of the RK4 integrator),
+* and the zero of its determinant is found by the Illinois variant of the regula falsi method.
+* If det(J) does not change sign over the step (i.e. it only vanished below the stability tolerance at t1),
+* t1 is returned.
+* \param tolerance Requested accuracy on the conjugate point location.
+*/
+template<int N>
+inline double
+findConjugatePoint(double t0,
+                   double t1,
+                   const Eigen::Matrix<double, N, N>& J0,
+                   const Eigen::Matrix<double, N, N>& dJ0,
+                   const Eigen::Matrix<double, N, N>& J1,
+                   const Eigen::Matrix<double, N, N>& dJ1,
+                   double tolerance)
+{
+  static const int kMaxIterations = 100;
+
+  const double h = t1 - t0;
+  double a = 0., b = 1.;
+  double fa = J0.determinant();
+  double fb = J1.determinant();
+  if(fa * fb > 0. || fb == 0.)
+  {
+    return t1;
+  }
+  if(fa == 0.)
+  {
+    return t0;
+  }
+
+  const double sTolerance = tolerance / h;
+  double s = 0.;
+  int side = 0;
+  for(int iter = 0; iter < kMaxIterations && b - a > sTolerance; ++iter)
+  {
+    s = (a * fb - b * fa) / (fb - fa);
+    const double fs = hermiteInterpolation<N>(s, h, J0, dJ0, J1, dJ1).determinant();
+    if(fs * fb > 0.)
+    {
+      b = s;
+      fb = fs;
+      if(side == -1)
+      {
+        fa *= 0.5;
+      }
+      side = -1;
+    }
+    else if(fs * fa > 0.)
+    {
+      a = s;
+      fa = fs;
+      if(side == 1)
+      {
+        fb *= 0.5;
+      }
+      side = 1;
+    }
+    else
+    {
+      return t0 + s * h;
+    }
+  }
+  return t0 + (a * fb - b * fa) / (fb - fa) * h;
+}
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_CONJUGATE_POINT_H_
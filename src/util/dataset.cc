@@ -0,0 +1,402 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/dataset.h"
+
+#include <cassert>
+#include <cstring>
+
+namespace qserl {
+namespace util {
+
+namespace {
+
+const char kMagic[8] = {'Q', 'S', 'E', 'R', 'L', 'D', 'S', '\0'};
+const uint32_t kVersion = 1;
+const uint32_t kByteOrderMark = 0x01020304;
+const size_t kAlignment = 64;
+const uint32_t kMaxGridDimension = 6;   /**< Dimension of the 3D rods A-space. */
+
+size_t
+alignOffset(size_t i_offset)
+{
+  return (i_offset + kAlignment - 1) / kAlignment * kAlignment;
+}
+
+size_t
+scalarSize(DatasetScalarT i_type)
+{
+  return i_type == DS_INT32 ? sizeof(int32_t) : sizeof(double);
+}
+
+template<typename T>
+void
+appendPod(std::vector<char>& io_buffer,
+          const T& i_value)
+{
+  const char* bytes = reinterpret_cast<const char*>(&i_value);
+  io_buffer.insert(io_buffer.end(), bytes, bytes + sizeof(T));
+}
+
+/**
+* \brief Sequential reader of the header bytes, with bounds checking.
+*/
+class HeaderReader
+{
+public:
+  HeaderReader(const char* i_data,
+               size_t i_size) :
+      m_data(i_data),
+      m_size(i_size),
+      m_pos(0)
+  {
+  }
+
+  template<typename T>
+  bool
+  read(T& o_value)
+  {
+    if(m_pos + sizeof(T) > m_size)
+    {
+      return false;
+    }
+    std::memcpy(&o_value, m_data + m_pos, sizeof(T));
+    m_pos += sizeof(T);
+    return true;
+  }
+
+  bool
+  read(std::string& o_value,
+       size_t i_length)
+  {
+    if(i_length > m_size - m_pos)
+    {
+      return false;
+    }
+    o_value.assign(m_data + m_pos, i_length);
+    m_pos += i_length;
+    return true;
+  }
+
+private:
+  const char* m_data;
+  size_t m_size;
+  size_t m_pos;
+};
+
+/**
+* \brief Serializes the header and computes the byte offset of each column.
+*/
+void
+serializeHeader(const DatasetHeader& i_header,
+                std::vector<char>& o_bytes,
+                std::vector<size_t>& o_columnOffsets,
+                size_t& o_fileSize)
+{
+  const size_t gridDim = i_header.gridNumSamples.size();
+
+  // the header size must be known to place the columns
+  const size_t headerSize = sizeof(kMagic) + 5 * sizeof(uint32_t) + sizeof(uint64_t) +
+                            DC_NUMBER_OF_COLUMNS * (2 * sizeof(uint32_t) + sizeof(uint64_t)) +
+                            gridDim * (2 * sizeof(double) + sizeof(uint64_t)) +
+                            sizeof(uint64_t) + i_header.parameters.size();
+  o_columnOffsets.assign(DC_NUMBER_OF_COLUMNS, 0);
+  size_t offset = alignOffset(headerSize);
+  for(int col = 0; col < DC_NUMBER_OF_COLUMNS; ++col)
+  {
+    const DatasetColumnT column = static_cast<DatasetColumnT>(col);
+    if(i_header.hasColumn(column))
+    {
+      o_columnOffsets[col] = offset;
+      offset = alignOffset(offset + i_header.numSamples * i_header.columnWidth(column) *
+                                    scalarSize(DatasetHeader::columnScalarType(column)));
+    }
+  }
+  o_fileSize = offset;
+
+  o_bytes.clear();
+  o_bytes.reserve(headerSize);
+  o_bytes.insert(o_bytes.end(), kMagic, kMagic + sizeof(kMagic));
+  appendPod(o_bytes, kVersion);
+  appendPod(o_bytes, kByteOrderMark);
+  appendPod(o_bytes, static_cast<uint32_t>(i_header.rodDimension));
+  appendPod(o_bytes, static_cast<uint32_t>(gridDim));
+  appendPod(o_bytes, static_cast<uint64_t>(i_header.numSamples));
+  appendPod(o_bytes, static_cast<uint32_t>(DC_NUMBER_OF_COLUMNS));
+  for(int col = 0; col < DC_NUMBER_OF_COLUMNS; ++col)
+  {
+    const DatasetColumnT column = static_cast<DatasetColumnT>(col);
+    appendPod(o_bytes, static_cast<uint32_t>(DatasetHeader::columnScalarType(column)));
+    appendPod(o_bytes, static_cast<uint32_t>(i_header.hasColumn(column) ? i_header.columnWidth(column) : 0));
+    appendPod(o_bytes, static_cast<uint64_t>(o_columnOffsets[col]));
+  }
+  for(size_t d = 0; d < gridDim; ++d)
+  {
+    appendPod(o_bytes, i_header.gridLowerBounds[d]);
+    appendPod(o_bytes, i_header.gridUpperBounds[d]);
+    appendPod(o_bytes, static_cast<uint64_t>(i_header.gridNumSamples[d]));
+  }
+  appendPod(o_bytes, static_cast<uint64_t>(i_header.parameters.size()));
+  o_bytes.insert(o_bytes.end(), i_header.parameters.begin(), i_header.parameters.end());
+  assert(o_bytes.size() == headerSize && "inconsistent dataset header size");
+}
+
+} // namespace
+
+/************************************************************************/
+/*													DatasetHeader																*/
+/************************************************************************/
+DatasetHeader::DatasetHeader() :
+    rodDimension(2),
+    numSamples(0),
+    columns(0),
+    gridLowerBounds(),
+    gridUpperBounds(),
+    gridNumSamples(),
+    parameters()
+{
+}
+
+size_t
+DatasetHeader::aDimension() const
+{
+  return rodDimension == 2 ? 3 : 6;
+}
+
+bool
+DatasetHeader::hasColumn(DatasetColumnT i_column) const
+{
+  return (columns & (1u << i_column)) != 0;
+}
+
+size_t
+DatasetHeader::columnWidth(DatasetColumnT i_column) const
+{
+  switch(i_column)
+  {
+    case DC_A:
+      return aDimension();
+    case DC_STABILITY:
+    case DC_ENERGY:
+      return 1;
+    case DC_TIP_POSE:
+      return rodDimension == 2 ? 3 : 16;
+    case DC_TIP_JACOBIAN:
+      return aDimension() * aDimension();
+    default:
+      assert(false && "invalid dataset column");
+      return 0;
+  }
+}
+
+DatasetScalarT
+DatasetHeader::columnScalarType(DatasetColumnT i_column)
+{
+  return i_column == DC_STABILITY ? DS_INT32 : DS_FLOAT64;
+}
+
+/************************************************************************/
+/*													DatasetWriter																*/
+/************************************************************************/
+DatasetWriter::DatasetWriter(const DatasetHeader& i_header) :
+    m_header(i_header),
+    m_file(),
+    m_columnOffsets()
+{
+}
+
+DatasetWriterShPtr
+DatasetWriter::create(const std::string& i_filename,
+                      const DatasetHeader& i_header)
+{
+  DatasetWriterShPtr writer(new DatasetWriter(i_header));
+  if(!writer->init(i_filename))
+  {
+    writer.reset();
+  }
+  return writer;
+}
+
+bool
+DatasetWriter::init(const std::string& i_filename)
+{
+  assert((m_header.rodDimension == 2 || m_header.rodDimension == 3) && "rod dimension must be 2 or 3");
+  assert(m_header.gridLowerBounds.size() == m_header.gridUpperBounds.size() &&
+         static_cast<size_t>(m_header.gridLowerBounds.size()) == m_header.gridNumSamples.size() &&
+         "inconsistent grid dimensions");
+
+  std::vector<char> headerBytes;
+  size_t fileSize;
+  serializeHeader(m_header, headerBytes, m_columnOffsets, fileSize);
+
+  m_file = MappedFile::create(i_filename, fileSize);
+  if(!m_file)
+  {
+    return false;
+  }
+  std::memcpy(m_file->data(), headerBytes.data(), headerBytes.size());
+  return true;
+}
+
+const DatasetHeader&
+DatasetWriter::header() const
+{
+  return m_header;
+}
+
+ArrayView<double>
+DatasetWriter::column(DatasetColumnT i_column)
+{
+  assert(m_header.hasColumn(i_column) && "column is not stored in the dataset");
+  assert(DatasetHeader::columnScalarType(i_column) == DS_FLOAT64 && "column is not a floating point column");
+  return ArrayView<double>(reinterpret_cast<double*>(m_file->data() + m_columnOffsets[i_column]),
+                           m_header.numSamples * m_header.columnWidth(i_column));
+}
+
+ArrayView<int32_t>
+DatasetWriter::stabilityColumn()
+{
+  assert(m_header.hasColumn(DC_STABILITY) && "column is not stored in the dataset");
+  return ArrayView<int32_t>(reinterpret_cast<int32_t*>(m_file->data() + m_columnOffsets[DC_STABILITY]),
+                            m_header.numSamples);
+}
+
+bool
+DatasetWriter::sync()
+{
+  return m_file->sync();
+}
+
+/************************************************************************/
+/*														Dataset																		*/
+/************************************************************************/
+Dataset::Dataset() :
+    m_header(),
+    m_file(),
+    m_columnOffsets(DC_NUMBER_OF_COLUMNS, 0)
+{
+}
+
+DatasetConstShPtr
+Dataset::open(const std::string& i_filename)
+{
+  DatasetShPtr dataset(new Dataset());
+  if(!dataset->init(i_filename))
+  {
+    dataset.reset();
+  }
+  return dataset;
+}
+
+bool
+Dataset::init(const std::string& i_filename)
+{
+  m_file = MappedFile::open(i_filename);
+  if(!m_file)
+  {
+    return false;
+  }
+  HeaderReader reader(m_file->data(), m_file->size());
+
+  char magic[sizeof(kMagic)];
+  uint32_t version, byteOrderMark, rodDim, gridDim, numColumns;
+  uint64_t numSamples;
+  if(!reader.read(magic) || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+     !reader.read(version) || version != kVersion ||
+     !reader.read(byteOrderMark) || byteOrderMark != kByteOrderMark ||
+     !reader.read(rodDim) || (rodDim != 2 && rodDim != 3) ||
+     !reader.read(gridDim) || gridDim > kMaxGridDimension ||
+     !reader.read(numSamples) || !reader.read(numColumns))
+  {
+    return false;
+  }
+  m_header.rodDimension = rodDim;
+  m_header.numSamples = static_cast<size_t>(numSamples);
+  m_header.columns = 0;
+
+  for(uint32_t col = 0; col < numColumns; ++col)
+  {
+    uint32_t scalarType, width;
+    uint64_t offset;
+    if(!reader.read(scalarType) || !reader.read(width) || !reader.read(offset))
+    {
+      return false;
+    }
+    // columns unknown to this version are ignored
+    if(col >= DC_NUMBER_OF_COLUMNS || offset == 0)
+    {
+      continue;
+    }
+    // the column size is checked by division, as the sample count read from the file may overflow it
+    const DatasetColumnT column = static_cast<DatasetColumnT>(col);
+    if(scalarType != static_cast<uint32_t>(DatasetHeader::columnScalarType(column)) ||
+       width != m_header.columnWidth(column) || offset % kAlignment != 0 ||
+       offset > m_file->size() ||
+       numSamples > (m_file->size() - offset) / (width * scalarSize(static_cast<DatasetScalarT>(scalarType))))
+    {
+      return false;
+    }
+    m_header.columns |= 1u << col;
+    m_columnOffsets[col] = static_cast<size_t>(offset);
+  }
+
+  m_header.gridLowerBounds.resize(gridDim);
+  m_header.gridUpperBounds.resize(gridDim);
+  m_header.gridNumSamples.resize(gridDim);
+  for(uint32_t d = 0; d < gridDim; ++d)
+  {
+    uint64_t gridNumSamples;
+    if(!reader.read(m_header.gridLowerBounds[d]) || !reader.read(m_header.gridUpperBounds[d]) ||
+       !reader.read(gridNumSamples) || gridNumSamples < 2 ||
+       !(m_header.gridUpperBounds[d] > m_header.gridLowerBounds[d]))
+    {
+      return false;
+    }
+    m_header.gridNumSamples[d] = static_cast<size_t>(gridNumSamples);
+  }
+
+  uint64_t parametersSize;
+  return reader.read(parametersSize) && reader.read(m_header.parameters, static_cast<size_t>(parametersSize));
+}
+
+const DatasetHeader&
+Dataset::header() const
+{
+  return m_header;
+}
+
+ArrayView<const double>
+Dataset::column(DatasetColumnT i_column) const
+{
+  assert(m_header.hasColumn(i_column) && "column is not stored in the dataset");
+  assert(DatasetHeader::columnScalarType(i_column) == DS_FLOAT64 && "column is not a floating point column");
+  return ArrayView<const double>(reinterpret_cast<const double*>(m_file->data() + m_columnOffsets[i_column]),
+                                 m_header.numSamples * m_header.columnWidth(i_column));
+}
+
+ArrayView<const int32_t>
+Dataset::stabilityColumn() const
+{
+  assert(m_header.hasColumn(DC_STABILITY) && "column is not stored in the dataset");
+  return ArrayView<const int32_t>(reinterpret_cast<const int32_t*>(m_file->data() + m_columnOffsets[DC_STABILITY]),
+                                  m_header.numSamples);
+}
+
+} // namespace util
+} // namespace qserl
@@ -0,0 +1,345 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/logger.h"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace qserl {
+namespace util {
+
+namespace {
+
+/** Period of the drain thread. */
+const std::chrono::milliseconds kDrainPeriod(10);
+
+struct Message
+{
+  int64_t timeNs;
+  LogLevelT level;
+  size_t length;
+  char text[Logger::kMaxMessageLength];
+};
+
+/**
+* \brief Single producer (the owner thread), single consumer (the drain) ring of messages.
+*/
+struct ThreadRing
+{
+  ThreadRing() :
+      messages(),
+      head(0),
+      tail(0),
+      numDropped(0),
+      isOrphaned(false)
+  {
+  }
+
+  std::array<Message, Logger::kBufferCapacity> messages;
+  std::atomic<uint64_t> head;       /**< Written by the owner thread. */
+  std::atomic<uint64_t> tail;       /**< Written by the drain, under the registry mutex. */
+  std::atomic<uint64_t> numDropped; /**< Written by the owner thread. */
+  std::atomic<bool> isOrphaned;     /**< Set when the owner thread exits, after its last message. */
+};
+
+struct Registry
+{
+  Registry() :
+      mutex(),
+      rings(),
+      numDroppedByDeletedRings(0),
+      sink(&std::cout),
+      epoch(std::chrono::steady_clock::now())
+  {
+  }
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadRing> > rings;  /**< Kept after thread exit, until drained. */
+  uint64_t numDroppedByDeletedRings;
+  std::ostream* sink;
+  std::chrono::steady_clock::time_point epoch;
+};
+
+Registry&
+registry()
+{
+  // never destroyed, messages may be logged during static destruction
+  static Registry* s_registry = new Registry;
+  return *s_registry;
+}
+
+/**
+* \brief Thread periodically writing logged messages to the sink, until the process exits.
+*/
+class Drain
+{
+public:
+  Drain() :
+      m_mutex(),
+      m_condition(),
+      m_isStopping(false),
+      m_thread(&Drain::run, this)
+  {
+  }
+
+  ~Drain()
+  {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_isStopping = true;
+    }
+    m_condition.notify_one();
+    m_thread.join();
+    Logger::flush();
+  }
+
+private:
+  void
+  run()
+  {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(!m_isStopping)
+    {
+      m_condition.wait_for(lock, kDrainPeriod);
+      lock.unlock();
+      Logger::flush();
+      lock.lock();
+    }
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_isStopping;
+  std::thread m_thread;
+};
+
+void
+startDrain()
+{
+  static Drain s_drain;
+}
+
+/**
+* \brief Ring of the owning thread, orphaned on thread exit so that flush() deletes it once drained.
+*/
+struct RingOwner
+{
+  ~RingOwner()
+  {
+    if(ring)
+    {
+      ring->isOrphaned.store(true, std::memory_order_release);
+      // messages logged by later thread local destructors go to a new ring, leaked as it is never orphaned
+      ring = nullptr;
+    }
+  }
+
+  ThreadRing* ring;
+};
+
+thread_local RingOwner t_ringOwner = {nullptr};
+
+ThreadRing&
+threadRing()
+{
+  if(!t_ringOwner.ring)
+  {
+    {
+      Registry& reg = registry();
+      std::lock_guard<std::mutex> lock(reg.mutex);
+      reg.rings.emplace_back(new ThreadRing);
+      t_ringOwner.ring = reg.rings.back().get();
+    }
+    startDrain();
+  }
+  return *t_ringOwner.ring;
+}
+
+} // namespace
+
+const size_t Logger::kMaxMessageLength;
+const size_t Logger::kBufferCapacity;
+std::atomic<int> Logger::s_verbosity(LL_WARNING);
+
+/************************************************************************/
+/*														setVerbosity																	*/
+/************************************************************************/
+void
+Logger::setVerbosity(int i_verbosity)
+{
+  s_verbosity.store(i_verbosity, std::memory_order_relaxed);
+}
+
+/************************************************************************/
+/*															setSink																	*/
+/************************************************************************/
+void
+Logger::setSink(std::ostream& io_sink)
+{
+  flush();
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  reg.sink = &io_sink;
+}
+
+/************************************************************************/
+/*															flush																		*/
+/************************************************************************/
+void
+Logger::flush()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  std::vector<const Message*> messages;
+  std::vector<std::pair<ThreadRing*, uint64_t> > drained;
+  for(const std::unique_ptr<ThreadRing>& ring : reg.rings)
+  {
+    const uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    const uint64_t head = ring->head.load(std::memory_order_acquire);
+    for(uint64_t index = tail; index < head; ++index)
+    {
+      messages.push_back(&ring->messages[index % kBufferCapacity]);
+    }
+    drained.push_back(std::make_pair(ring.get(), head));
+  }
+
+  if(!messages.empty())
+  {
+    std::stable_sort(messages.begin(), messages.end(), [](const Message* i_lhs,
+                                                          const Message* i_rhs)
+    {
+      return i_lhs->timeNs < i_rhs->timeNs;
+    });
+    std::ostream& sink = *reg.sink;
+    for(const Message* message : messages)
+    {
+      sink << '[' << levelName(message->level) << "] ";
+      sink.write(message->text, static_cast<std::streamsize>(message->length));
+      sink << '\n';
+    }
+    sink.flush();
+
+    // releases the slots to their thread
+    for(const std::pair<ThreadRing*, uint64_t>& ring : drained)
+    {
+      ring.first->tail.store(ring.second, std::memory_order_release);
+    }
+  }
+
+  // rings of exited threads are deleted once drained, their head being final once they are orphaned
+  bool hasDeletedRings = false;
+  for(size_t idxRing = 0; idxRing < drained.size(); ++idxRing)
+  {
+    ThreadRing* const ring = drained[idxRing].first;
+    if(ring->isOrphaned.load(std::memory_order_acquire) &&
+       ring->head.load(std::memory_order_relaxed) == drained[idxRing].second)
+    {
+      reg.numDroppedByDeletedRings += ring->numDropped.load(std::memory_order_relaxed);
+      reg.rings[idxRing].reset();
+      hasDeletedRings = true;
+    }
+  }
+  if(hasDeletedRings)
+  {
+    reg.rings.erase(std::remove(reg.rings.begin(), reg.rings.end(), nullptr), reg.rings.end());
+  }
+}
+
+/************************************************************************/
+/*														numDroppedMessages																	*/
+/************************************************************************/
+uint64_t
+Logger::numDroppedMessages()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  uint64_t numDropped = reg.numDroppedByDeletedRings;
+  for(const std::unique_ptr<ThreadRing>& ring : reg.rings)
+  {
+    numDropped += ring->numDropped.load(std::memory_order_relaxed);
+  }
+  return numDropped;
+}
+
+/************************************************************************/
+/*														numThreadBuffers																	*/
+/************************************************************************/
+size_t
+Logger::numThreadBuffers()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  return reg.rings.size();
+}
+
+/************************************************************************/
+/*															log																		*/
+/************************************************************************/
+void
+Logger::log(LogLevelT i_level,
+            const char* i_message,
+            size_t i_length)
+{
+  ThreadRing& ring = threadRing();
+  const uint64_t head = ring.head.load(std::memory_order_relaxed);
+  if(head - ring.tail.load(std::memory_order_acquire) >= kBufferCapacity)
+  {
+    ring.numDropped.store(ring.numDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return;
+  }
+  Message& message = ring.messages[head % kBufferCapacity];
+  message.timeNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - registry().epoch).count();
+  message.level = i_level;
+  message.length = std::min(i_length, kMaxMessageLength);
+  std::memcpy(message.text, i_message, message.length);
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+/************************************************************************/
+/*														levelName																	*/
+/************************************************************************/
+const char*
+Logger::levelName(LogLevelT i_level)
+{
+  switch(i_level)
+  {
+    case LL_ERROR:
+      return "ERROR";
+    case LL_WARNING:
+      return "WARNING";
+    case LL_INFO:
+      return "INFO";
+    case LL_DEBUG:
+      return "DEBUG";
+  }
+  return "UNKNOWN";
+}
+
+} // namespace util
+} // namespace qserl
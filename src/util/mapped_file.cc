@@ -0,0 +1,213 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/mapped_file.h"
+
+#include <cassert>
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QSERL_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace qserl {
+namespace util {
+
+MappedFile::MappedFile(const std::string& i_filename,
+                       bool i_writable) :
+    m_filename(i_filename),
+    m_writable(i_writable),
+    m_data(nullptr),
+    m_size(0),
+    m_buffer()
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef QSERL_HAS_MMAP
+  if(m_data && m_size > 0)
+  {
+    munmap(m_data, m_size);
+  }
+#else
+  if(m_writable)
+  {
+    sync();
+  }
+#endif
+}
+
+MappedFileConstShPtr
+MappedFile::open(const std::string& i_filename)
+{
+  MappedFileShPtr file(new MappedFile(i_filename, false));
+  if(!file->init(0))
+  {
+    file.reset();
+  }
+  return file;
+}
+
+MappedFileShPtr
+MappedFile::openWritable(const std::string& i_filename)
+{
+  MappedFileShPtr file(new MappedFile(i_filename, true));
+  if(!file->init(0))
+  {
+    file.reset();
+  }
+  return file;
+}
+
+MappedFileShPtr
+MappedFile::create(const std::string& i_filename,
+                   size_t i_size)
+{
+  assert(i_size > 0 && "cannot map an empty file");
+  MappedFileShPtr file(new MappedFile(i_filename, true));
+  if(!file->init(i_size))
+  {
+    file.reset();
+  }
+  return file;
+}
+
+bool
+MappedFile::init(size_t i_size)
+{
+#ifdef QSERL_HAS_MMAP
+  const bool truncate = m_writable && i_size > 0;
+  const int fd = truncate ? ::open(m_filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644) :
+                 ::open(m_filename.c_str(), m_writable ? O_RDWR : O_RDONLY);
+  if(fd < 0)
+  {
+    return false;
+  }
+  if(truncate)
+  {
+    if(ftruncate(fd, static_cast<off_t>(i_size)) != 0)
+    {
+      ::close(fd);
+      return false;
+    }
+    m_size = i_size;
+  }
+  else
+  {
+    struct stat fileStat;
+    if(fstat(fd, &fileStat) != 0)
+    {
+      ::close(fd);
+      return false;
+    }
+    m_size = static_cast<size_t>(fileStat.st_size);
+  }
+  if(m_size == 0)
+  {
+    // mmap() does not support empty mappings
+    ::close(fd);
+    return !m_writable;
+  }
+  void* addr = mmap(nullptr, m_size, m_writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+  // the mapping remains valid after the file descriptor is closed
+  ::close(fd);
+  if(addr == MAP_FAILED)
+  {
+    m_size = 0;
+    return false;
+  }
+  m_data = static_cast<char*>(addr);
+  return true;
+#else
+  if(m_writable && i_size > 0)
+  {
+    std::ofstream file(m_filename.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file)
+    {
+      return false;
+    }
+    m_buffer.assign(i_size, 0);
+  }
+  else
+  {
+    std::ifstream file(m_filename.c_str(), std::ios::binary | std::ios::ate);
+    if(!file)
+    {
+      return false;
+    }
+    m_buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if(!file.read(m_buffer.data(), m_buffer.size()) || (m_writable && m_buffer.empty()))
+    {
+      return false;
+    }
+  }
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  return true;
+#endif
+}
+
+const char*
+MappedFile::data() const
+{
+  return m_data;
+}
+
+char*
+MappedFile::data()
+{
+  assert(m_writable && "file is mapped in read only mode");
+  return m_data;
+}
+
+size_t
+MappedFile::size() const
+{
+  return m_size;
+}
+
+const std::string&
+MappedFile::filename() const
+{
+  return m_filename;
+}
+
+bool
+MappedFile::sync()
+{
+  if(!m_writable || !m_data)
+  {
+    return true;
+  }
+#ifdef QSERL_HAS_MMAP
+  return msync(m_data, m_size, MS_SYNC) == 0;
+#else
+  std::ofstream file(m_filename.c_str(), std::ios::binary | std::ios::trunc);
+  return file.write(m_data, m_size).good();
+#endif
+}
+
+} // namespace util
+} // namespace qserl
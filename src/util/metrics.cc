@@ -0,0 +1,428 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/metrics.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+
+namespace qserl {
+namespace util {
+
+namespace {
+
+template<typename Metric>
+struct Entry
+{
+  std::string help;
+  std::unique_ptr<Metric> metric;
+};
+
+struct Registry
+{
+  std::mutex mutex;
+  std::map<std::string, Entry<Counter> > counters;
+  std::map<std::string, Entry<Histogram> > histograms;
+};
+
+Registry&
+registry()
+{
+  // never destroyed, metrics may be updated during static destruction
+  static Registry* s_registry = new Registry;
+  return *s_registry;
+}
+
+std::atomic<int> s_numThreads(0);
+
+thread_local int t_shard = -1;
+
+/**
+* \brief Returns the name of the family of given metric, i.e. its name without labels.
+*/
+std::string
+familyName(const std::string& i_name)
+{
+  return i_name.substr(0, i_name.find('{'));
+}
+
+/**
+* \brief Returns given metric name with an additional label, e.g. for histogram buckets.
+*/
+std::string
+withLabel(const std::string& i_name,
+          const std::string& i_label)
+{
+  const size_t labelsStart = i_name.find('{');
+  if(labelsStart == std::string::npos)
+  {
+    return i_name + "{" + i_label + "}";
+  }
+  return i_name.substr(0, i_name.size() - 1) + "," + i_label + "}";
+}
+
+/**
+* \brief Returns given metric name with a suffix appended to its family name, e.g. _count.
+*/
+std::string
+withSuffix(const std::string& i_name,
+           const std::string& i_suffix)
+{
+  const size_t labelsStart = std::min(i_name.find('{'), i_name.size());
+  return i_name.substr(0, labelsStart) + i_suffix + i_name.substr(labelsStart);
+}
+
+void
+writeFamilyHeader(std::ostream& io_os,
+                  const std::string& i_name,
+                  const std::string& i_help,
+                  const char* i_type,
+                  std::string& io_lastFamily)
+{
+  const std::string family = familyName(i_name);
+  if(family != io_lastFamily)
+  {
+    io_os << "# HELP " << family << " " << i_help << "\n";
+    io_os << "# TYPE " << family << " " << i_type << "\n";
+    io_lastFamily = family;
+  }
+}
+
+} // namespace
+
+/************************************************************************/
+/*														metricShard																	*/
+/************************************************************************/
+int
+metricShard()
+{
+  if(t_shard < 0)
+  {
+    t_shard = s_numThreads.fetch_add(1, std::memory_order_relaxed) % kNumMetricShards;
+  }
+  return t_shard;
+}
+
+/************************************************************************/
+/*															Counter																	*/
+/************************************************************************/
+Counter::Counter() :
+    m_shards()
+{
+  reset();
+}
+
+/************************************************************************/
+/*															value																		*/
+/************************************************************************/
+uint64_t
+Counter::value() const
+{
+  uint64_t value = 0;
+  for(const Shard& shard : m_shards)
+  {
+    value += shard.value.load(std::memory_order_relaxed);
+  }
+  return value;
+}
+
+/************************************************************************/
+/*															reset																		*/
+/************************************************************************/
+void
+Counter::reset()
+{
+  for(Shard& shard : m_shards)
+  {
+    shard.value.store(0, std::memory_order_relaxed);
+  }
+}
+
+/************************************************************************/
+/*														Histogram																	*/
+/************************************************************************/
+Histogram::Shard::Shard(size_t i_numBuckets) :
+    counts(new std::atomic<uint64_t>[i_numBuckets]),
+    sum(0.)
+{
+  for(size_t bucket = 0; bucket < i_numBuckets; ++bucket)
+  {
+    counts[bucket].store(0, std::memory_order_relaxed);
+  }
+}
+
+Histogram::Histogram(const std::vector<double>& i_bounds) :
+    m_bounds(i_bounds),
+    m_shards()
+{
+  assert(std::is_sorted(m_bounds.begin(), m_bounds.end()) && "histogram bounds must be sorted");
+  for(int shard = 0; shard < kNumMetricShards; ++shard)
+  {
+    m_shards.emplace_back(new Shard(m_bounds.size() + 1));
+  }
+}
+
+/************************************************************************/
+/*															observe																	*/
+/************************************************************************/
+void
+Histogram::observe(double i_value)
+{
+  Shard& shard = *m_shards[metricShard()];
+  const size_t bucket = static_cast<size_t>(std::lower_bound(m_bounds.begin(), m_bounds.end(), i_value) -
+                                            m_bounds.begin());
+  shard.counts[bucket].fetch_add(1, std::memory_order_relaxed);
+  double sum = shard.sum.load(std::memory_order_relaxed);
+  while(!shard.sum.compare_exchange_weak(sum, sum + i_value, std::memory_order_relaxed))
+  {
+  }
+}
+
+/************************************************************************/
+/*															counts																	*/
+/************************************************************************/
+std::vector<uint64_t>
+Histogram::counts() const
+{
+  std::vector<uint64_t> counts(m_bounds.size() + 1, 0);
+  for(const std::unique_ptr<Shard>& shard : m_shards)
+  {
+    for(size_t bucket = 0; bucket < counts.size(); ++bucket)
+    {
+      counts[bucket] += shard->counts[bucket].load(std::memory_order_relaxed);
+    }
+  }
+  return counts;
+}
+
+/************************************************************************/
+/*															sum																		*/
+/************************************************************************/
+double
+Histogram::sum() const
+{
+  double sum = 0.;
+  for(const std::unique_ptr<Shard>& shard : m_shards)
+  {
+    sum += shard->sum.load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+/************************************************************************/
+/*															reset																		*/
+/************************************************************************/
+void
+Histogram::reset()
+{
+  for(const std::unique_ptr<Shard>& shard : m_shards)
+  {
+    for(size_t bucket = 0; bucket <= m_bounds.size(); ++bucket)
+    {
+      shard->counts[bucket].store(0, std::memory_order_relaxed);
+    }
+    shard->sum.store(0., std::memory_order_relaxed);
+  }
+}
+
+/************************************************************************/
+/*														exponentialBounds																	*/
+/************************************************************************/
+std::vector<double>
+Histogram::exponentialBounds(double i_start,
+                             double i_factor,
+                             int i_count)
+{
+  assert(i_start > 0. && i_factor > 1. && "invalid exponential bounds");
+  std::vector<double> bounds;
+  double bound = i_start;
+  for(int k = 0; k < i_count; ++k)
+  {
+    bounds.push_back(bound);
+    bound *= i_factor;
+  }
+  return bounds;
+}
+
+/************************************************************************/
+/*														isEnabled																	*/
+/************************************************************************/
+bool
+Metrics::isEnabled()
+{
+#ifdef QSERL_ENABLE_METRICS
+  return true;
+#else
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*															counter																	*/
+/************************************************************************/
+Counter&
+Metrics::counter(const std::string& i_name,
+                 const std::string& i_help)
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  Entry<Counter>& entry = reg.counters[i_name];
+  if(!entry.metric)
+  {
+    entry.help = i_help;
+    entry.metric.reset(new Counter);
+  }
+  return *entry.metric;
+}
+
+/************************************************************************/
+/*														histogram																	*/
+/************************************************************************/
+Histogram&
+Metrics::histogram(const std::string& i_name,
+                   const std::string& i_help,
+                   const std::vector<double>& i_bounds)
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  Entry<Histogram>& entry = reg.histograms[i_name];
+  if(!entry.metric)
+  {
+    entry.help = i_help;
+    entry.metric.reset(new Histogram(i_bounds));
+  }
+  assert(entry.metric->bounds() == i_bounds && "histogram registered with other bounds");
+  return *entry.metric;
+}
+
+/************************************************************************/
+/*															snapshot																	*/
+/************************************************************************/
+MetricsSnapshot
+Metrics::snapshot()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  MetricsSnapshot snapshot;
+  for(const std::pair<const std::string, Entry<Counter> >& entry : reg.counters)
+  {
+    CounterSnapshot counter;
+    counter.name = entry.first;
+    counter.help = entry.second.help;
+    counter.value = entry.second.metric->value();
+    snapshot.counters.push_back(counter);
+  }
+  for(const std::pair<const std::string, Entry<Histogram> >& entry : reg.histograms)
+  {
+    HistogramSnapshot histogram;
+    histogram.name = entry.first;
+    histogram.help = entry.second.help;
+    histogram.bounds = entry.second.metric->bounds();
+    histogram.counts = entry.second.metric->counts();
+    histogram.count = 0;
+    for(const uint64_t count : histogram.counts)
+    {
+      histogram.count += count;
+    }
+    histogram.sum = entry.second.metric->sum();
+    snapshot.histograms.push_back(histogram);
+  }
+  return snapshot;
+}
+
+/************************************************************************/
+/*														writeText																	*/
+/************************************************************************/
+void
+Metrics::writeText(std::ostream& io_os)
+{
+  const MetricsSnapshot metrics = snapshot();
+  const std::streamsize precision = io_os.precision(std::numeric_limits<double>::max_digits10);
+  std::string lastFamily;
+  for(const CounterSnapshot& counter : metrics.counters)
+  {
+    writeFamilyHeader(io_os, counter.name, counter.help, "counter", lastFamily);
+    io_os << counter.name << " " << counter.value << "\n";
+  }
+  for(const HistogramSnapshot& histogram : metrics.histograms)
+  {
+    writeFamilyHeader(io_os, histogram.name, histogram.help, "histogram", lastFamily);
+    // buckets are cumulative in the text format
+    uint64_t count = 0;
+    for(size_t bucket = 0; bucket < histogram.bounds.size(); ++bucket)
+    {
+      count += histogram.counts[bucket];
+      std::ostringstream bound;
+      bound.precision(std::numeric_limits<double>::max_digits10);
+      bound << histogram.bounds[bucket];
+      io_os << withLabel(withSuffix(histogram.name, "_bucket"), "le=\"" + bound.str() + "\"") << " " << count << "\n";
+    }
+    io_os << withLabel(withSuffix(histogram.name, "_bucket"), "le=\"+Inf\"") << " " << histogram.count << "\n";
+    io_os << withSuffix(histogram.name, "_sum") << " " << histogram.sum << "\n";
+    io_os << withSuffix(histogram.name, "_count") << " " << histogram.count << "\n";
+  }
+  io_os.precision(precision);
+}
+
+bool
+Metrics::writeText(const std::string& i_file)
+{
+  const std::string tmpFile = i_file + ".tmp";
+  {
+    std::ofstream os(tmpFile.c_str());
+    if(!os)
+    {
+      return false;
+    }
+    writeText(os);
+    if(!os)
+    {
+      return false;
+    }
+  }
+  return std::rename(tmpFile.c_str(), i_file.c_str()) == 0;
+}
+
+/************************************************************************/
+/*															reset																		*/
+/************************************************************************/
+void
+Metrics::reset()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for(const std::pair<const std::string, Entry<Counter> >& entry : reg.counters)
+  {
+    entry.second.metric->reset();
+  }
+  for(const std::pair<const std::string, Entry<Histogram> >& entry : reg.histograms)
+  {
+    entry.second.metric->reset();
+  }
+}
+
+} // namespace util
+} // namespace qserl
@@ -0,0 +1,452 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/profiler.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <deque>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+namespace qserl {
+namespace util {
+
+namespace {
+
+/** Histogram buckets: exact values below 4, then 4 buckets per octave. */
+const int kNumBuckets = 252;
+
+/** Counters are only written by their owner thread, and read by reports. */
+typedef std::atomic<uint64_t> Counter;
+
+inline void
+add(Counter& io_counter,
+    uint64_t i_value)
+{
+  io_counter.store(io_counter.load(std::memory_order_relaxed) + i_value, std::memory_order_relaxed);
+}
+
+inline uint64_t
+get(const Counter& i_counter)
+{
+  return i_counter.load(std::memory_order_relaxed);
+}
+
+inline int
+mostSignificantBit(uint64_t i_value)
+{
+#if defined(__GNUC__)
+  return 63 - __builtin_clzll(i_value);
+#else
+  int msb = 0;
+  while(i_value >>= 1)
+  {
+    ++msb;
+  }
+  return msb;
+#endif
+}
+
+inline int
+bucketIndex(uint64_t i_ticks)
+{
+  if(i_ticks < 4)
+  {
+    return static_cast<int>(i_ticks);
+  }
+  const int msb = mostSignificantBit(i_ticks);
+  return 4 * (msb - 1) + static_cast<int>((i_ticks >> (msb - 2)) & 3);
+}
+
+uint64_t
+bucketUpperBound(int i_index)
+{
+  if(i_index < 4)
+  {
+    return static_cast<uint64_t>(i_index);
+  }
+  const int msb = i_index / 4 + 1;
+  const uint64_t lower = static_cast<uint64_t>(4 + i_index % 4) << (msb - 2);
+  return lower + ((static_cast<uint64_t>(1) << (msb - 2)) - 1);
+}
+
+} // namespace
+
+/**
+* \brief Node of the per thread call tree of zones.
+*/
+struct Profiler::Node
+{
+  Node(const char* i_name,
+       Node* i_parent) :
+      name(i_name),
+      parent(i_parent),
+      children()
+  {
+    clear();
+  }
+
+  void
+  clear()
+  {
+    count.store(0, std::memory_order_relaxed);
+    totalTicks.store(0, std::memory_order_relaxed);
+    childTicks.store(0, std::memory_order_relaxed);
+    minTicks.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+    maxTicks.store(0, std::memory_order_relaxed);
+    for(Counter& bucket : histogram)
+    {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  const char* name;
+  Node* parent;
+  std::vector<Node*> children;  /**< Written by the owner thread under its mutex. */
+  Counter count;
+  Counter totalTicks;
+  Counter childTicks;
+  Counter minTicks;
+  Counter maxTicks;
+  std::array<Counter, kNumBuckets> histogram;
+};
+
+namespace {
+
+struct ThreadData
+{
+  ThreadData() :
+      mutex(),
+      nodes(),
+      current(nullptr)
+  {
+    nodes.emplace_back(nullptr, nullptr);
+    current = &nodes.front();
+  }
+
+  std::mutex mutex;                   /**< Guards the tree structure against reports. */
+  std::deque<Profiler::Node> nodes;   /**< Call tree nodes, the first one being the root. */
+  Profiler::Node* current;
+};
+
+struct Registry
+{
+  Registry() :
+      mutex(),
+      threads(),
+      startTicks(Profiler::now()),
+      startTime(std::chrono::steady_clock::now())
+  {
+  }
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadData> > threads;  /**< Kept after thread exit, for reports. */
+  Profiler::Ticks startTicks;                         /**< Reference for the calibration of ticks. */
+  std::chrono::steady_clock::time_point startTime;
+};
+
+Registry&
+registry()
+{
+  // never destroyed, zones may be left during static destruction
+  static Registry* s_registry = new Registry;
+  return *s_registry;
+}
+
+thread_local ThreadData* t_threadData = nullptr;
+
+ThreadData&
+threadData()
+{
+  if(!t_threadData)
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.threads.emplace_back(new ThreadData);
+    t_threadData = reg.threads.back().get();
+  }
+  return *t_threadData;
+}
+
+/**
+* \brief Returns the duration of a tick in nanoseconds, measured since the profiler creation.
+*/
+double
+nsPerTick()
+{
+#ifdef QSERL_PROFILER_USE_TSC
+  static const std::chrono::milliseconds kMinCalibrationTime(10);
+  const Registry& reg = registry();
+  const std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - reg.startTime;
+  if(elapsed < kMinCalibrationTime)
+  {
+    std::this_thread::sleep_for(kMinCalibrationTime - elapsed);
+  }
+  const Profiler::Ticks ticks = Profiler::now() - reg.startTicks;
+  const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - reg.startTime).count());
+  return ticks > 0 ? ns / static_cast<double>(ticks) : 1.;
+#else
+  return 1.;
+#endif
+}
+
+/**
+* \brief Timings of a zone merged over threads, in ticks.
+*/
+struct ZoneAccumulator
+{
+  ZoneAccumulator() :
+      count(0),
+      totalTicks(0),
+      childTicks(0),
+      minTicks(std::numeric_limits<uint64_t>::max()),
+      maxTicks(0),
+      histogram(kNumBuckets, 0)
+  {
+  }
+
+  void
+  add(const Profiler::Node& i_node)
+  {
+    count += get(i_node.count);
+    totalTicks += get(i_node.totalTicks);
+    childTicks += get(i_node.childTicks);
+    minTicks = std::min(minTicks, get(i_node.minTicks));
+    maxTicks = std::max(maxTicks, get(i_node.maxTicks));
+    for(int k = 0; k < kNumBuckets; ++k)
+    {
+      histogram[k] += get(i_node.histogram[k]);
+    }
+  }
+
+  uint64_t
+  percentile(double i_p) const
+  {
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(i_p * count)));
+    uint64_t cumulated = 0;
+    for(int k = 0; k < kNumBuckets; ++k)
+    {
+      cumulated += histogram[k];
+      if(cumulated >= rank)
+      {
+        return std::min(std::max(bucketUpperBound(k), minTicks), maxTicks);
+      }
+    }
+    return maxTicks;
+  }
+
+  uint64_t count;
+  uint64_t totalTicks;
+  uint64_t childTicks;
+  uint64_t minTicks;
+  uint64_t maxTicks;
+  std::vector<uint64_t> histogram;
+};
+
+void
+collect(const Profiler::Node& i_node,
+        const std::string& i_parentPath,
+        int i_depth,
+        std::vector<ProfileZoneReport>& io_reports,
+        std::vector<ZoneAccumulator>& io_accumulators,
+        std::map<std::string, size_t>& io_index)
+{
+  for(const Profiler::Node* child : i_node.children)
+  {
+    const std::string path = i_parentPath.empty() ? child->name : i_parentPath + "/" + child->name;
+    const auto inserted = io_index.insert(std::make_pair(path, io_reports.size()));
+    if(inserted.second)
+    {
+      ProfileZoneReport report = ProfileZoneReport();
+      report.path = path;
+      report.name = child->name;
+      report.depth = i_depth;
+      io_reports.push_back(report);
+      io_accumulators.push_back(ZoneAccumulator());
+    }
+    io_accumulators[inserted.first->second].add(*child);
+    collect(*child, path, i_depth + 1, io_reports, io_accumulators, io_index);
+  }
+}
+
+} // namespace
+
+/************************************************************************/
+/*														isEnabled																	*/
+/************************************************************************/
+bool
+Profiler::isEnabled()
+{
+#ifdef QSERL_ENABLE_PROFILER
+  return true;
+#else
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*															enter																		*/
+/************************************************************************/
+Profiler::Node*
+Profiler::enter(const char* i_name)
+{
+  ThreadData& data = threadData();
+  Node* parent = data.current;
+  for(Node* child : parent->children)
+  {
+    if(child->name == i_name || std::strcmp(child->name, i_name) == 0)
+    {
+      data.current = child;
+      return child;
+    }
+  }
+  std::lock_guard<std::mutex> lock(data.mutex);
+  data.nodes.emplace_back(i_name, parent);
+  Node* node = &data.nodes.back();
+  parent->children.push_back(node);
+  data.current = node;
+  return node;
+}
+
+/************************************************************************/
+/*															leave																		*/
+/************************************************************************/
+void
+Profiler::leave(Node* i_node,
+                Ticks i_elapsed)
+{
+  ThreadData& data = *t_threadData;
+  assert(data.current == i_node && "profiler zones must be left in reverse order of entry");
+  add(i_node->count, 1);
+  add(i_node->totalTicks, i_elapsed);
+  if(i_elapsed < get(i_node->minTicks))
+  {
+    i_node->minTicks.store(i_elapsed, std::memory_order_relaxed);
+  }
+  if(i_elapsed > get(i_node->maxTicks))
+  {
+    i_node->maxTicks.store(i_elapsed, std::memory_order_relaxed);
+  }
+  add(i_node->histogram[bucketIndex(i_elapsed)], 1);
+  add(i_node->parent->childTicks, i_elapsed);
+  data.current = i_node->parent;
+}
+
+/************************************************************************/
+/*															report																	*/
+/************************************************************************/
+std::vector<ProfileZoneReport>
+Profiler::report()
+{
+  std::vector<ProfileZoneReport> reports;
+  std::vector<ZoneAccumulator> accumulators;
+  std::map<std::string, size_t> index;
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for(const std::unique_ptr<ThreadData>& data : reg.threads)
+    {
+      std::lock_guard<std::mutex> threadLock(data->mutex);
+      collect(data->nodes.front(), std::string(), 0, reports, accumulators, index);
+    }
+  }
+
+  const double tickNs = nsPerTick();
+  std::vector<ProfileZoneReport> nonEmptyReports;
+  nonEmptyReports.reserve(reports.size());
+  for(size_t k = 0; k < reports.size(); ++k)
+  {
+    const ZoneAccumulator& acc = accumulators[k];
+    if(acc.count == 0)
+    {
+      continue;
+    }
+    ProfileZoneReport& zone = reports[k];
+    zone.count = acc.count;
+    zone.totalNs = tickNs * acc.totalTicks;
+    zone.selfNs = tickNs * (acc.totalTicks - std::min(acc.childTicks, acc.totalTicks));
+    zone.minNs = tickNs * acc.minTicks;
+    zone.maxNs = tickNs * acc.maxTicks;
+    zone.p50Ns = tickNs * acc.percentile(0.5);
+    zone.p99Ns = tickNs * acc.percentile(0.99);
+    nonEmptyReports.push_back(zone);
+  }
+  return nonEmptyReports;
+}
+
+/************************************************************************/
+/*														printReport																	*/
+/************************************************************************/
+void
+Profiler::printReport(std::ostream& io_os)
+{
+  const std::vector<ProfileZoneReport> reports = report();
+  size_t nameWidth = 4;
+  for(const ProfileZoneReport& zone : reports)
+  {
+    nameWidth = std::max(nameWidth, 2 * zone.depth + zone.name.size());
+  }
+  const std::ios::fmtflags flags = io_os.flags();
+  io_os << std::left << std::setw(static_cast<int>(nameWidth)) << "zone" << std::right
+        << std::setw(12) << "count" << std::setw(14) << "total(ms)" << std::setw(14) << "self(ms)"
+        << std::setw(12) << "min(us)" << std::setw(12) << "p50(us)" << std::setw(12) << "p99(us)"
+        << std::setw(12) << "max(us)" << std::endl;
+  io_os << std::fixed;
+  for(const ProfileZoneReport& zone : reports)
+  {
+    io_os << std::left << std::setw(static_cast<int>(nameWidth)) << std::string(2 * zone.depth, ' ') + zone.name
+          << std::right << std::setw(12) << zone.count
+          << std::setprecision(3) << std::setw(14) << zone.totalNs * 1.e-6 << std::setw(14) << zone.selfNs * 1.e-6
+          << std::setw(12) << zone.minNs * 1.e-3 << std::setw(12) << zone.p50Ns * 1.e-3
+          << std::setw(12) << zone.p99Ns * 1.e-3 << std::setw(12) << zone.maxNs * 1.e-3 << std::endl;
+  }
+  io_os.flags(flags);
+}
+
+/************************************************************************/
+/*															reset																		*/
+/************************************************************************/
+void
+Profiler::reset()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for(const std::unique_ptr<ThreadData>& data : reg.threads)
+  {
+    std::lock_guard<std::mutex> threadLock(data->mutex);
+    for(Node& node : data->nodes)
+    {
+      node.clear();
+    }
+  }
+}
+
+} // namespace util
+} // namespace qserl
@@ -0,0 +1,268 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/regular_grid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "qserl/util/trace.h"
+
+namespace qserl {
+namespace util {
+
+RegularGrid::RegularGrid(const Eigen::VectorXd& i_lowerBounds,
+                         const Eigen::VectorXd& i_upperBounds,
+                         const std::vector<size_t>& i_numSamples) :
+    m_lowerBounds(i_lowerBounds),
+    m_upperBounds(i_upperBounds),
+    m_step(i_lowerBounds.size()),
+    m_numSamples(i_numSamples),
+    m_strides(i_numSamples.size()),
+    m_numSamplesTotal(1)
+{
+  assert(m_lowerBounds.size() == m_upperBounds.size() &&
+         static_cast<size_t>(m_lowerBounds.size()) == m_numSamples.size() && "inconsistent grid dimensions");
+  for(size_t d = 0; d < m_numSamples.size(); ++d)
+  {
+    assert(m_numSamples[d] > 1 && "grid must have at least 2 samples along each axis");
+    assert(m_upperBounds[d] > m_lowerBounds[d] && "grid upper bounds must be greater than lower bounds");
+    m_step[d] = (m_upperBounds[d] - m_lowerBounds[d]) / static_cast<double>(m_numSamples[d] - 1);
+    m_strides[d] = m_numSamplesTotal;
+    m_numSamplesTotal *= m_numSamples[d];
+  }
+}
+
+size_t
+RegularGrid::dimension() const
+{
+  return m_numSamples.size();
+}
+
+size_t
+RegularGrid::numSamples() const
+{
+  return m_numSamplesTotal;
+}
+
+size_t
+RegularGrid::numSamples(size_t i_axis) const
+{
+  assert(i_axis < m_numSamples.size() && "invalid axis");
+  return m_numSamples[i_axis];
+}
+
+size_t
+RegularGrid::stride(size_t i_axis) const
+{
+  assert(i_axis < m_strides.size() && "invalid axis");
+  return m_strides[i_axis];
+}
+
+const Eigen::VectorXd&
+RegularGrid::lowerBounds() const
+{
+  return m_lowerBounds;
+}
+
+const Eigen::VectorXd&
+RegularGrid::upperBounds() const
+{
+  return m_upperBounds;
+}
+
+const Eigen::VectorXd&
+RegularGrid::step() const
+{
+  return m_step;
+}
+
+size_t
+RegularGrid::flatIndex(const std::vector<size_t>& i_gridIndex) const
+{
+  assert(i_gridIndex.size() == m_numSamples.size() && "invalid grid index dimension");
+  size_t idx = 0;
+  for(size_t d = 0; d < m_numSamples.size(); ++d)
+  {
+    assert(i_gridIndex[d] < m_numSamples[d] && "grid index out of bounds");
+    idx += i_gridIndex[d] * m_strides[d];
+  }
+  return idx;
+}
+
+void
+RegularGrid::gridIndex(size_t i_flatIndex,
+                       std::vector<size_t>& o_gridIndex) const
+{
+  assert(i_flatIndex < m_numSamplesTotal && "flat index out of bounds");
+  o_gridIndex.resize(m_numSamples.size());
+  for(size_t d = 0; d < m_numSamples.size(); ++d)
+  {
+    o_gridIndex[d] = i_flatIndex % m_numSamples[d];
+    i_flatIndex /= m_numSamples[d];
+  }
+}
+
+Eigen::VectorXd
+RegularGrid::sample(size_t i_flatIndex) const
+{
+  assert(i_flatIndex < m_numSamplesTotal && "flat index out of bounds");
+  Eigen::VectorXd point(m_numSamples.size());
+  for(size_t d = 0; d < m_numSamples.size(); ++d)
+  {
+    point[d] = m_lowerBounds[d] + static_cast<double>(i_flatIndex % m_numSamples[d]) * m_step[d];
+    i_flatIndex /= m_numSamples[d];
+  }
+  return point;
+}
+
+bool
+RegularGrid::contains(const Eigen::VectorXd& i_point) const
+{
+  assert(static_cast<size_t>(i_point.size()) == m_numSamples.size() && "invalid point dimension");
+  return (i_point.array() >= m_lowerBounds.array()).all() && (i_point.array() <= m_upperBounds.array()).all();
+}
+
+bool
+RegularGrid::cellIndex(const Eigen::VectorXd& i_point,
+                       std::vector<size_t>& o_gridIndex) const
+{
+  if(!contains(i_point))
+  {
+    return false;
+  }
+  o_gridIndex.resize(m_numSamples.size());
+  for(size_t d = 0; d < m_numSamples.size(); ++d)
+  {
+    const double k = std::floor((i_point[d] - m_lowerBounds[d]) / m_step[d]);
+    o_gridIndex[d] = std::min(static_cast<size_t>(std::max(k, 0.)), m_numSamples[d] - 2);
+  }
+  return true;
+}
+
+std::vector<size_t>
+extractBoundarySamples(const RegularGrid& i_grid,
+                       const std::vector<int>& i_labels)
+{
+  assert(i_labels.size() == i_grid.numSamples() && "labels must be given for each grid sample");
+
+  const size_t dim = i_grid.dimension();
+
+  // precompute the 3^n - 1 neighbour displacements, both as grid index and flat index offsets
+  std::vector<std::vector<int> > neighbDeltas;
+  std::vector<long> neighbOffsets;
+  std::vector<int> delta(dim, -1);
+  bool done = false;
+  while(!done)
+  {
+    long offset = 0;
+    bool isSelf = true;
+    for(size_t d = 0; d < dim; ++d)
+    {
+      offset += delta[d] * static_cast<long>(i_grid.stride(d));
+      isSelf = isSelf && delta[d] == 0;
+    }
+    if(!isSelf)
+    {
+      neighbDeltas.push_back(delta);
+      neighbOffsets.push_back(offset);
+    }
+    // next displacement in {-1, 0, 1}^n
+    size_t d = 0;
+    while(d < dim && delta[d] == 1)
+    {
+      delta[d] = -1;
+      ++d;
+    }
+    if(d == dim)
+    {
+      done = true;
+    }
+    else
+    {
+      ++delta[d];
+    }
+  }
+
+  const long numSamples = static_cast<long>(i_grid.numSamples());
+  std::vector<char> isBoundary(i_grid.numSamples(), 0);
+
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+  {
+    // one event per thread, showing the load balance of the parallel loop
+    QSERL_TRACE_SCOPE("util::extractBoundarySamples");
+    std::vector<size_t> gridIdx(dim);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+    for(long idx = 0; idx < numSamples; ++idx)
+    {
+      // grid index of the sample and whether it lies on the grid border
+      bool isOnBorder = false;
+      size_t rem = static_cast<size_t>(idx);
+      for(size_t d = 0; d < dim; ++d)
+      {
+        gridIdx[d] = rem % i_grid.numSamples(d);
+        rem /= i_grid.numSamples(d);
+        isOnBorder = isOnBorder || gridIdx[d] == 0 || gridIdx[d] == i_grid.numSamples(d) - 1;
+      }
+
+      const int label = i_labels[idx];
+      for(size_t k = 0; k < neighbOffsets.size(); ++k)
+      {
+        if(isOnBorder)
+        {
+          // skip out of grid neighbours
+          bool isInGrid = true;
+          for(size_t d = 0; d < dim && isInGrid; ++d)
+          {
+            const long coord = static_cast<long>(gridIdx[d]) + neighbDeltas[k][d];
+            isInGrid = coord >= 0 && coord < static_cast<long>(i_grid.numSamples(d));
+          }
+          if(!isInGrid)
+          {
+            continue;
+          }
+        }
+        if(i_labels[idx + neighbOffsets[k]] != label)
+        {
+          isBoundary[idx] = 1;
+          break;
+        }
+      }
+    }
+  }
+
+  std::vector<size_t> boundarySamples;
+  for(size_t idx = 0; idx < isBoundary.size(); ++idx)
+  {
+    if(isBoundary[idx])
+    {
+      boundarySamples.push_back(idx);
+    }
+  }
+  return boundarySamples;
+}
+
+} // namespace util
+} // namespace qserl
@@ -0,0 +1,305 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/stability_index.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+namespace qserl {
+namespace util {
+
+namespace {
+
+inline bool
+testBit(const std::vector<uint64_t>& i_bits,
+        size_t i_idx)
+{
+  return (i_bits[i_idx >> 6] >> (i_idx & 63)) & 1u;
+}
+
+inline void
+setBit(std::vector<uint64_t>& io_bits,
+       size_t i_idx)
+{
+  io_bits[i_idx >> 6] |= uint64_t(1) << (i_idx & 63);
+}
+
+} // namespace
+
+StabilityIndex::StabilityIndex(const RegularGrid& i_grid,
+                               const StabilityOracle& i_oracle) :
+    m_grid(i_grid),
+    m_oracle(i_oracle),
+    m_stableBits(),
+    m_uniformBits(),
+    m_numBoundaryCells(0),
+    m_cacheResolution(0),
+    m_cacheMutex(),
+    m_cache(),
+    m_numOracleCalls(0)
+{
+}
+
+StabilityIndexShPtr
+StabilityIndex::create(const RegularGrid& i_grid,
+                       const std::vector<bool>& i_isStable,
+                       const StabilityOracle& i_oracle)
+{
+  StabilityIndexShPtr index(new StabilityIndex(i_grid, i_oracle));
+  if(!index->init(i_isStable))
+  {
+    index.reset();
+  }
+  return index;
+}
+
+StabilityIndexShPtr
+StabilityIndex::create(const Dataset& i_dataset,
+                       const StabilityOracle& i_oracle)
+{
+  const DatasetHeader& header = i_dataset.header();
+  if(header.gridNumSamples.empty() || !header.hasColumn(DC_STABILITY))
+  {
+    return StabilityIndexShPtr();
+  }
+  const RegularGrid grid(header.gridLowerBounds, header.gridUpperBounds, header.gridNumSamples);
+  if(grid.numSamples() != header.numSamples)
+  {
+    return StabilityIndexShPtr();
+  }
+
+  const ArrayView<const int32_t> stability = i_dataset.stabilityColumn();
+  std::vector<bool> isStable(stability.size());
+  for(size_t idx = 0; idx < stability.size(); ++idx)
+  {
+    isStable[idx] = stability[idx] == 0;
+  }
+  return create(grid, isStable, i_oracle);
+}
+
+bool
+StabilityIndex::init(const std::vector<bool>& i_isStable)
+{
+  assert(m_oracle && "invalid stability oracle");
+
+  const size_t numSamples = m_grid.numSamples();
+  if(i_isStable.size() != numSamples)
+  {
+    return false;
+  }
+  const size_t dim = m_grid.dimension();
+  m_stableBits.assign((numSamples + 63) / 64, 0);
+  m_uniformBits.assign((numSamples + 63) / 64, 0);
+  for(size_t idx = 0; idx < numSamples; ++idx)
+  {
+    if(i_isStable[idx])
+    {
+      setBit(m_stableBits, idx);
+    }
+  }
+
+  // flat index offsets of the 2^n cell corners from its lower corner
+  std::vector<size_t> cornerOffsets(size_t(1) << dim, 0);
+  for(size_t c = 0; c < cornerOffsets.size(); ++c)
+  {
+    for(size_t d = 0; d < dim; ++d)
+    {
+      if((c >> d) & 1u)
+      {
+        cornerOffsets[c] += m_grid.stride(d);
+      }
+    }
+  }
+
+  m_numBoundaryCells = 0;
+  std::vector<size_t> gridIdx;
+  for(size_t idx = 0; idx < numSamples; ++idx)
+  {
+    // only lower corners of cells are considered
+    m_grid.gridIndex(idx, gridIdx);
+    bool isLowerCorner = true;
+    for(size_t d = 0; d < dim && isLowerCorner; ++d)
+    {
+      isLowerCorner = gridIdx[d] + 1 < m_grid.numSamples(d);
+    }
+    if(!isLowerCorner)
+    {
+      continue;
+    }
+    const bool cornerStability = testBit(m_stableBits, idx);
+    bool isUniform = true;
+    for(size_t c = 1; c < cornerOffsets.size() && isUniform; ++c)
+    {
+      isUniform = testBit(m_stableBits, idx + cornerOffsets[c]) == cornerStability;
+    }
+    if(isUniform)
+    {
+      setBit(m_uniformBits, idx);
+    }
+    else
+    {
+      ++m_numBoundaryCells;
+    }
+  }
+  return true;
+}
+
+const RegularGrid&
+StabilityIndex::grid() const
+{
+  return m_grid;
+}
+
+bool
+StabilityIndex::cellFlatIndex(const Eigen::VectorXd& i_a,
+                              size_t& o_cellIdx) const
+{
+  assert(static_cast<size_t>(i_a.size()) == m_grid.dimension() && "invalid wrench dimension");
+  if(!m_grid.contains(i_a))
+  {
+    return false;
+  }
+  o_cellIdx = 0;
+  for(size_t d = 0; d < m_grid.dimension(); ++d)
+  {
+    const double k = std::floor((i_a[d] - m_grid.lowerBounds()[d]) / m_grid.step()[d]);
+    o_cellIdx += std::min(static_cast<size_t>(std::max(k, 0.)), m_grid.numSamples(d) - 2) * m_grid.stride(d);
+  }
+  return true;
+}
+
+uint64_t
+StabilityIndex::cacheKey(const Eigen::VectorXd& i_a) const
+{
+  uint64_t key = 0;
+  uint64_t radix = 1;
+  for(size_t d = 0; d < m_grid.dimension(); ++d)
+  {
+    const uint64_t numSubCells = static_cast<uint64_t>(m_grid.numSamples(d) - 1) * m_cacheResolution;
+    const double k = std::floor((i_a[d] - m_grid.lowerBounds()[d]) / m_grid.step()[d] * m_cacheResolution);
+    key += std::min(static_cast<uint64_t>(std::max(k, 0.)), numSubCells - 1) * radix;
+    radix *= numSubCells;
+  }
+  return key;
+}
+
+bool
+StabilityIndex::isStable(const Eigen::VectorXd& i_a) const
+{
+  size_t cellIdx;
+  if(!cellFlatIndex(i_a, cellIdx))
+  {
+    ++m_numOracleCalls;
+    return m_oracle(i_a);
+  }
+  if(testBit(m_uniformBits, cellIdx))
+  {
+    return testBit(m_stableBits, cellIdx);
+  }
+
+  // boundary cell
+  if(m_cacheResolution == 0)
+  {
+    ++m_numOracleCalls;
+    return m_oracle(i_a);
+  }
+  const uint64_t key = cacheKey(i_a);
+  {
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    const auto it = m_cache.find(key);
+    if(it != m_cache.end())
+    {
+      return it->second;
+    }
+  }
+  // the oracle is not called under lock, concurrent queries of the same sub cell may both call it
+  ++m_numOracleCalls;
+  const bool isStable = m_oracle(i_a);
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  m_cache.insert(std::make_pair(key, isStable));
+  return isStable;
+}
+
+bool
+StabilityIndex::isOnBoundary(const Eigen::VectorXd& i_a) const
+{
+  size_t cellIdx;
+  return !cellFlatIndex(i_a, cellIdx) || !testBit(m_uniformBits, cellIdx);
+}
+
+bool
+StabilityIndex::cacheResolution(unsigned int i_resolution)
+{
+  // sub cells are keyed by their flat index, which must fit in 64 bits
+  bool isKeyable = true;
+  uint64_t numSubCellsTotal = 1;
+  for(size_t d = 0; d < m_grid.dimension() && isKeyable && i_resolution > 0; ++d)
+  {
+    const uint64_t numCells = static_cast<uint64_t>(m_grid.numSamples(d) - 1);
+    isKeyable = numCells <= std::numeric_limits<uint64_t>::max() / i_resolution;
+    const uint64_t numSubCells = isKeyable ? numCells * i_resolution : 0;
+    isKeyable = isKeyable && numSubCells <= std::numeric_limits<uint64_t>::max() / numSubCellsTotal;
+    numSubCellsTotal *= isKeyable ? numSubCells : 1;
+  }
+
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  m_cacheResolution = isKeyable ? i_resolution : 0;
+  m_cache.clear();
+  return isKeyable;
+}
+
+unsigned int
+StabilityIndex::cacheResolution() const
+{
+  return m_cacheResolution;
+}
+
+size_t
+StabilityIndex::cacheSize() const
+{
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  return m_cache.size();
+}
+
+size_t
+StabilityIndex::numBoundaryCells() const
+{
+  return m_numBoundaryCells;
+}
+
+size_t
+StabilityIndex::numOracleCalls() const
+{
+  return m_numOracleCalls;
+}
+
+size_t
+StabilityIndex::memUsage() const
+{
+  std::lock_guard<std::mutex> lock(m_cacheMutex);
+  return sizeof(StabilityIndex) + (m_stableBits.capacity() + m_uniformBits.capacity()) * sizeof(uint64_t) +
+         m_cache.size() * (sizeof(uint64_t) + sizeof(bool) + 2 * sizeof(void*)) +
+         m_cache.bucket_count() * sizeof(void*);
+}
+
+} // namespace util
+} // namespace qserl
@@ -0,0 +1,119 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+/** Instrumentation helpers filling util::IntegrationStats, compiled out unless QSERL_ENABLE_STATS is defined. */
+
+#ifndef QSERL_UTIL_STATS_H_
+#define QSERL_UTIL_STATS_H_
+
+#include "qserl/util/integration_stats.h"
+#include "qserl/util/timer.h"
+
+#include <functional>
+
+#ifdef QSERL_ENABLE_STATS
+# define QSERL_STATS(statement) statement
+#else
+# define QSERL_STATS(statement)
+#endif
+
+namespace qserl {
+namespace util {
+
+/**
+* \brief Adds the time elapsed during its scope to given counter.
+*/
+class StatsTimer
+{
+public:
+  explicit StatsTimer(int64_t& io_timeNs) :
+      m_timeNs(io_timeNs),
+      m_start(getTimePoint())
+  {
+  }
+
+  ~StatsTimer()
+  {
+    m_timeNs += getElapsedTimeNsec(m_start).count();
+  }
+
+private:
+  int64_t& m_timeNs;
+  TimePoint m_start;
+};
+
+/**
+* \brief Wraps a system integrated by odeint, counting and timing its right hand side evaluations.
+*/
+template<typename System>
+class InstrumentedSystem
+{
+public:
+  InstrumentedSystem(System& i_system,
+                     IntegrationStats& io_stats) :
+      m_system(&i_system),
+      m_stats(&io_stats)
+  {
+  }
+
+  template<typename State>
+  void
+  operator()(const State& i_x,
+             State& o_dxdt,
+             double i_t)
+  {
+    StatsTimer timer(m_stats->rhsTimeNs);
+    (*m_system)(i_x, o_dxdt, i_t);
+    ++m_stats->numRhsEvaluations;
+  }
+
+private:
+  System* m_system;
+  IntegrationStats* m_stats;
+};
+
+#ifdef QSERL_ENABLE_STATS
+/**
+* \brief Returns the system to step, wrapped to count its evaluations into given statistics.
+*/
+template<typename System>
+InstrumentedSystem<System>
+instrument(System& i_system,
+           IntegrationStats& io_stats)
+{
+  return InstrumentedSystem<System>(i_system, io_stats);
+}
+#else
+/**
+* \brief Returns the system to step, wrapped by reference as odeint steppers take systems by value,
+* which would copy the system (and its std::function members) at each step.
+*/
+template<typename System>
+std::reference_wrapper<System>
+instrument(System& i_system,
+           IntegrationStats&)
+{
+  return std::ref(i_system);
+}
+#endif
+
+} // namespace util
+} // namespace qserl
+
+#endif // QSERL_UTIL_STATS_H_
@@ -0,0 +1,344 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include "qserl/util/trace.h"
+
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <vector>
+
+namespace qserl {
+namespace util {
+
+namespace {
+
+struct Event
+{
+  const char* name;
+  int64_t startNs;
+  int64_t endNs;
+  const char* argName;
+  int64_t argValue;
+};
+
+/**
+* \brief Fixed size block of events. Events are written by the owner thread, then published by incrementing
+* the size, so that readers only access completed events.
+*/
+struct Chunk
+{
+  static const size_t kCapacity = 1024;
+
+  Chunk() :
+      events(),
+      size(0),
+      next(nullptr)
+  {
+  }
+
+  std::array<Event, kCapacity> events;
+  std::atomic<size_t> size;
+  std::atomic<Chunk*> next;
+};
+
+struct ThreadBuffer
+{
+  explicit ThreadBuffer(unsigned int i_tid) :
+      tid(i_tid),
+      name(),
+      head(new Chunk),
+      tail(head)
+  {
+  }
+
+  ~ThreadBuffer()
+  {
+    deleteChunks(head->next.load(std::memory_order_acquire));
+    delete head;
+  }
+
+  static void
+  deleteChunks(Chunk* i_chunk)
+  {
+    while(i_chunk)
+    {
+      Chunk* next = i_chunk->next.load(std::memory_order_acquire);
+      delete i_chunk;
+      i_chunk = next;
+    }
+  }
+
+  unsigned int tid;
+  std::string name;   /**< Guarded by the registry mutex. */
+  Chunk* head;
+  Chunk* tail;        /**< Only accessed by the owner thread (and clear()). */
+};
+
+struct Registry
+{
+  Registry() :
+      mutex(),
+      threads(),
+      internedNames(),
+      epoch(std::chrono::steady_clock::now())
+  {
+  }
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<ThreadBuffer> > threads;  /**< Kept after thread exit, for writing traces. */
+  std::set<std::string> internedNames;
+  std::chrono::steady_clock::time_point epoch;
+};
+
+Registry&
+registry()
+{
+  // never destroyed, scopes may be left during static destruction
+  static Registry* s_registry = new Registry;
+  return *s_registry;
+}
+
+thread_local ThreadBuffer* t_threadBuffer = nullptr;
+
+ThreadBuffer&
+threadBuffer()
+{
+  if(!t_threadBuffer)
+  {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    reg.threads.emplace_back(new ThreadBuffer(static_cast<unsigned int>(reg.threads.size() + 1)));
+    t_threadBuffer = reg.threads.back().get();
+  }
+  return *t_threadBuffer;
+}
+
+std::string
+jsonString(const char* i_str)
+{
+  std::string res = "\"";
+  for(const char* c = i_str; *c; ++c)
+  {
+    if(*c == '"' || *c == '\\')
+    {
+      res += '\\';
+    }
+    res += *c;
+  }
+  return res + "\"";
+}
+
+} // namespace
+
+std::atomic<bool> Tracer::s_isRecording(false);
+
+/************************************************************************/
+/*														isEnabled																	*/
+/************************************************************************/
+bool
+Tracer::isEnabled()
+{
+#ifdef QSERL_ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+/************************************************************************/
+/*															start																		*/
+/************************************************************************/
+void
+Tracer::start()
+{
+  // creates the registry, so that its epoch precedes all events
+  registry();
+  s_isRecording.store(true, std::memory_order_relaxed);
+}
+
+/************************************************************************/
+/*															stop																		*/
+/************************************************************************/
+void
+Tracer::stop()
+{
+  s_isRecording.store(false, std::memory_order_relaxed);
+}
+
+/************************************************************************/
+/*															clear																		*/
+/************************************************************************/
+void
+Tracer::clear()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  for(const std::unique_ptr<ThreadBuffer>& buffer : reg.threads)
+  {
+    ThreadBuffer::deleteChunks(buffer->head->next.exchange(nullptr, std::memory_order_acq_rel));
+    buffer->head->size.store(0, std::memory_order_release);
+    buffer->tail = buffer->head;
+  }
+}
+
+/************************************************************************/
+/*														numEvents																	*/
+/************************************************************************/
+size_t
+Tracer::numEvents()
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  size_t res = 0;
+  for(const std::unique_ptr<ThreadBuffer>& buffer : reg.threads)
+  {
+    for(const Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+    {
+      res += chunk->size.load(std::memory_order_acquire);
+    }
+  }
+  return res;
+}
+
+/************************************************************************/
+/*													setThreadName																	*/
+/************************************************************************/
+void
+Tracer::setThreadName(const std::string& i_name)
+{
+  ThreadBuffer& buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(registry().mutex);
+  buffer.name = i_name;
+}
+
+/************************************************************************/
+/*															intern																	*/
+/************************************************************************/
+const char*
+Tracer::intern(const std::string& i_name)
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  return reg.internedNames.insert(i_name).first->c_str();
+}
+
+/************************************************************************/
+/*																now																			*/
+/************************************************************************/
+int64_t
+Tracer::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - registry().epoch).count();
+}
+
+/************************************************************************/
+/*															record																	*/
+/************************************************************************/
+void
+Tracer::record(const char* i_name,
+               int64_t i_startNs,
+               int64_t i_endNs,
+               const char* i_argName,
+               int64_t i_argValue)
+{
+  ThreadBuffer& buffer = threadBuffer();
+  Chunk* chunk = buffer.tail;
+  size_t size = chunk->size.load(std::memory_order_relaxed);
+  if(size == Chunk::kCapacity)
+  {
+    Chunk* next = new Chunk;
+    chunk->next.store(next, std::memory_order_release);
+    buffer.tail = next;
+    chunk = next;
+    size = 0;
+  }
+  Event& event = chunk->events[size];
+  event.name = i_name;
+  event.startNs = i_startNs;
+  event.endNs = i_endNs;
+  event.argName = i_argName;
+  event.argValue = i_argValue;
+  chunk->size.store(size + 1, std::memory_order_release);
+}
+
+/************************************************************************/
+/*												writeChromeTrace															*/
+/************************************************************************/
+void
+Tracer::writeChromeTrace(std::ostream& io_os)
+{
+  Registry& reg = registry();
+  std::lock_guard<std::mutex> lock(reg.mutex);
+  const std::ios::fmtflags flags = io_os.flags();
+  io_os << std::fixed << std::setprecision(3);
+  io_os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  bool isFirst = true;
+  for(const std::unique_ptr<ThreadBuffer>& buffer : reg.threads)
+  {
+    if(!buffer->name.empty())
+    {
+      io_os << (isFirst ? "\n" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": "
+            << buffer->tid << ", \"args\": {\"name\": " << jsonString(buffer->name.c_str()) << "}}";
+      isFirst = false;
+    }
+    for(const Chunk* chunk = buffer->head; chunk; chunk = chunk->next.load(std::memory_order_acquire))
+    {
+      const size_t size = chunk->size.load(std::memory_order_acquire);
+      for(size_t idx = 0; idx < size; ++idx)
+      {
+        const Event& event = chunk->events[idx];
+        // timestamps are in microseconds
+        io_os << (isFirst ? "\n" : ",\n") << "{\"name\": " << jsonString(event.name)
+              << ", \"cat\": \"qserl\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+              << ", \"ts\": " << 1.e-3 * static_cast<double>(event.startNs)
+              << ", \"dur\": " << 1.e-3 * static_cast<double>(event.endNs - event.startNs);
+        if(event.argName)
+        {
+          io_os << ", \"args\": {" << jsonString(event.argName) << ": " << event.argValue << "}";
+        }
+        io_os << "}";
+        isFirst = false;
+      }
+    }
+  }
+  io_os << "\n]}\n";
+  io_os.flags(flags);
+}
+
+bool
+Tracer::writeChromeTrace(const std::string& i_file)
+{
+  std::ofstream output(i_file.c_str());
+  if(!output)
+  {
+    return false;
+  }
+  writeChromeTrace(output);
+  return static_cast<bool>(output);
+}
+
+} // namespace util
+} // namespace qserl
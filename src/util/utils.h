@@ -23,6 +23,7 @@
 #define QSERL_UTIL_UTILS_H_
 
 #include <Eigen/Core>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -113,6 +114,21 @@ sigpos(T a)
   return (a >= static_cast<T>(0) ? 1 : -1);
 }
 
+/**
+* \brief 64 bits FNV-1a hash of given bytes.
+*/
+inline uint64_t
+fnv1aHash(const std::string& i_bytes)
+{
+  uint64_t hash = 14695981039346656037ULL;
+  for(const char c : i_bytes)
+  {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
 /** rand utils */
 
 /** TODO doc. */
@@ -0,0 +1,337 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <thread>
+
+#include "qserl/rod2d/workspace_integrated_state.h"
+#include "qserl/rod3d/ik.h"
+#include "qserl/rod3d/rod.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/rod3d/workspace_integrated_state_pool.h"
+#include "qserl/util/allocation_tracker.h"
+
+namespace {
+
+/** Heap allocations allowed in steady state, i.e. when integrating again a state with unchanged options. */
+const uint64_t kSteadyStateAllocationBudget = 0;
+
+const int kNumRuns = 5;
+
+const qserl::util::AllocationReport*
+findApi(const std::vector<qserl::util::AllocationReport>& i_reports,
+        const std::string& i_name)
+{
+  for(const qserl::util::AllocationReport& report : i_reports)
+  {
+    if(report.name == i_name)
+    {
+      return &report;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+/* AllocationTrackerTests																										 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(AllocationTrackerTests)
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_threadCounts)
+{
+  // the allocation hooks are linked in the tests executable
+  BOOST_REQUIRE(qserl::util::AllocationTracker::isEnabled());
+
+  const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+  std::vector<double>* values = new std::vector<double>(100);
+  const qserl::util::AllocationCounts counts = qserl::util::AllocationTracker::threadCounts() - start;
+  delete values;
+  BOOST_CHECK_EQUAL(counts.count, 2u);
+  BOOST_CHECK(counts.bytes >= sizeof(std::vector<double>) + 100 * sizeof(double));
+
+  // allocations of other threads are not accounted
+  const qserl::util::AllocationCounts beforeThread = qserl::util::AllocationTracker::threadCounts();
+  qserl::util::AllocationCounts threadCounts = {0, 0};
+  std::thread thread([&threadCounts]()
+                     {
+                       const qserl::util::AllocationCounts threadStart =
+                           qserl::util::AllocationTracker::threadCounts();
+                       std::vector<int> buffer(1000);
+                       threadCounts = qserl::util::AllocationTracker::threadCounts() - threadStart;
+                     });
+  thread.join();
+  BOOST_CHECK_EQUAL(threadCounts.count, 1u);
+  BOOST_CHECK_EQUAL(threadCounts.bytes, 1000 * sizeof(int));
+  // only the thread creation is accounted on the calling thread
+  BOOST_CHECK(qserl::util::AllocationTracker::threadCounts().bytes - beforeThread.bytes < 1000 * sizeof(int));
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_rod3dBudget)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.keepMuValues = true;
+  integrationOptions.keepJMatrices = true;
+  integrationOptions.keepMMatrices = true;
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodState->integrationOptions(integrationOptions);
+  // the first integration allocates the state buffers
+  BOOST_REQUIRE(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    BOOST_CHECK(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - start).count, kSteadyStateAllocationBudget);
+
+  double tinv;
+  rodState->integrateWhileValid(qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max()), tinv);
+  const qserl::util::AllocationCounts whileValidStart = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    rodState->integrateWhileValid(qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max()), tinv);
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - whileValidStart).count,
+                    kSteadyStateAllocationBudget);
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_integrateIntoBudget)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  std::vector<double> nodes(rodParameters.numNodes * 16);
+  std::vector<double> J(rodParameters.numNodes * 36);
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOutputs outputs;
+  outputs.nodes = qserl::util::StridedView<double>(nodes.data(), rodParameters.numNodes, 16);
+  outputs.J = qserl::util::StridedView<double>(J.data(), rodParameters.numNodes, 36);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  // warm up the process wide registries (profiling, allocation scopes) on another state
+  qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters)->integrateInto(
+      stableConf, outputs);
+
+  // writing into caller buffers allocates nothing, even at the first integration
+  const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    BOOST_CHECK(rodState->integrateInto(stableConf, outputs) == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - start).count, 0u);
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_rodInPlaceBudget)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  const qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+  // the first calls create the current and the spare states
+  for(int run = 0; run < 2; ++run)
+  {
+    rod->integrateStateFromBaseWrench(stableConf, qserl::rod3d::Displacement::Identity(), integrationOptions);
+  }
+
+  const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    BOOST_CHECK(rod->integrateStateFromBaseWrench(stableConf, qserl::rod3d::Displacement::Identity(),
+                                                  integrationOptions) ==
+                qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - start).count, kSteadyStateAllocationBudget);
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_statePoolBudget)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  qserl::rod3d::WorkspaceIntegratedStatePoolShPtr pool = qserl::rod3d::WorkspaceIntegratedStatePool::create(
+      rodParameters.numNodes, rodParameters);
+  const int kNumStates = 4;
+  std::vector<qserl::rod3d::WorkspaceIntegratedStateShPtr> states(kNumStates);
+  for(int run = 0; run < 2; ++run)
+  {
+    for(qserl::rod3d::WorkspaceIntegratedStateShPtr& state : states)
+    {
+      state = pool->acquire(stableConf, qserl::rod3d::Displacement::Identity());
+      state->integrate();
+    }
+    for(qserl::rod3d::WorkspaceIntegratedStateShPtr& state : states)
+    {
+      state.reset();
+    }
+  }
+
+  // states and their shared pointers are recycled
+  const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    for(qserl::rod3d::WorkspaceIntegratedStateShPtr& state : states)
+    {
+      state = pool->acquire(stableConf, qserl::rod3d::Displacement::Identity());
+      BOOST_CHECK(state->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+    }
+    for(qserl::rod3d::WorkspaceIntegratedStateShPtr& state : states)
+    {
+      state.reset();
+    }
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - start).count, kSteadyStateAllocationBudget);
+  BOOST_CHECK_EQUAL(pool->numStates(), static_cast<size_t>(kNumStates));
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_ikBudget)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr targetState = qserl::rod3d::WorkspaceIntegratedState::create(
+      1.01 * stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(targetState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  qserl::rod3d::InverseKinematics ik(rod);
+  // the first run is a warm-up, e.g. registering the APIs of the allocation tracker
+  uint64_t numAllocations = 0;
+  for(int run = 0; run <= kNumRuns; ++run)
+  {
+    BOOST_REQUIRE(rodState->integrateFromBaseWrenchRK4(stableConf) ==
+                  qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+    const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+    BOOST_CHECK(ik.compute(rodState, rodParameters.numNodes - 1, targetState->nodes().back()) ==
+                qserl::rod3d::InverseKinematics::IK_VALID);
+    if(run > 0)
+    {
+      numAllocations += (qserl::util::AllocationTracker::threadCounts() - start).count;
+    }
+  }
+  BOOST_CHECK_EQUAL(numAllocations, kSteadyStateAllocationBudget);
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_rod2dBudget)
+{
+  qserl::rod2d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod2d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.delta_t = 0.01;
+  const qserl::rod2d::Wrench2D stableConf(0., 0., 1.);
+
+  qserl::rod2d::WorkspaceIntegratedStateShPtr rodState = qserl::rod2d::WorkspaceIntegratedState::create(
+      stableConf, qserl::rod2d::Displacement2D::Zero(), rodParameters);
+  // values which are not kept by the state are computed in reused buffers
+  qserl::rod2d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.keepMuValues = false;
+  integrationOptions.keepMMatrices = false;
+  integrationOptions.keepJMatrices = false;
+  integrationOptions.keepJdet = false;
+  rodState->integrationOptions(integrationOptions);
+  BOOST_REQUIRE(rodState->integrate() == qserl::rod2d::WorkspaceIntegratedState::IR_VALID);
+
+  const qserl::util::AllocationCounts start = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    BOOST_CHECK(rodState->integrate() == qserl::rod2d::WorkspaceIntegratedState::IR_VALID);
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - start).count, kSteadyStateAllocationBudget);
+
+  // integrating while valid does not accumulate kept values over calls
+  integrationOptions.keepMuValues = true;
+  integrationOptions.keepMMatrices = true;
+  integrationOptions.keepJMatrices = true;
+  rodState->integrationOptions(integrationOptions);
+  double tinv;
+  const qserl::rod2d::Wrench2D maxWrench = qserl::rod2d::Wrench2D::Constant(std::numeric_limits<double>::max());
+  rodState->integrateWhileValid(maxWrench, tinv);
+  const size_t numNodes = rodState->nodes().size();
+  const qserl::util::AllocationCounts whileValidStart = qserl::util::AllocationTracker::threadCounts();
+  for(int run = 0; run < kNumRuns; ++run)
+  {
+    rodState->integrateWhileValid(maxWrench, tinv);
+  }
+  BOOST_CHECK_EQUAL((qserl::util::AllocationTracker::threadCounts() - whileValidStart).count,
+                    kSteadyStateAllocationBudget);
+  BOOST_CHECK_EQUAL(rodState->mu().size(), numNodes);
+}
+
+BOOST_AUTO_TEST_CASE(AllocationTrackerTest_perApi)
+{
+  qserl::util::AllocationTracker::reset();
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.numNodes = 50;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodState->integrate();
+  const std::vector<qserl::util::AllocationReport> firstReports = qserl::util::AllocationTracker::report();
+  const qserl::util::AllocationReport* firstIntegrate = findApi(firstReports, "rod3d::integrate");
+  for(int run = 1; run < kNumRuns; ++run)
+  {
+    rodState->integrate();
+  }
+
+  const std::vector<qserl::util::AllocationReport> reports = qserl::util::AllocationTracker::report();
+  const qserl::util::AllocationReport* create = findApi(reports, "rod3d::WorkspaceIntegratedState::create");
+  const qserl::util::AllocationReport* integrate = findApi(reports, "rod3d::integrate");
+  if(qserl::util::AllocationTracker::isPerApiEnabled())
+  {
+    BOOST_REQUIRE(create && integrate && firstIntegrate);
+    BOOST_CHECK_EQUAL(create->calls, 1u);
+    BOOST_CHECK(create->allocations.count > 0);
+    BOOST_CHECK_EQUAL(integrate->calls, static_cast<uint64_t>(kNumRuns));
+    // only the first integration allocates the state buffers, the following ones reuse them
+    BOOST_CHECK(firstIntegrate->allocations.count > 0);
+    BOOST_CHECK_EQUAL(integrate->allocations.count, firstIntegrate->allocations.count);
+  }
+  else
+  {
+    BOOST_CHECK(!create && !integrate);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,180 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+#include "qserl/util/dataset.h"
+
+/* ------------------------------------------------------------------------- */
+/* DatasetTests																																 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(DatasetTests)
+
+BOOST_AUTO_TEST_CASE(DatasetTest_write_read)
+{
+  static const char* filename = "qserl_test_dataset.bin";
+  static const size_t numSamples = 101;
+
+  qserl::util::DatasetHeader header;
+  header.rodDimension = 3;
+  header.numSamples = numSamples;
+  header.columns = (1u << qserl::util::DC_A) | (1u << qserl::util::DC_STABILITY) |
+                   (1u << qserl::util::DC_TIP_JACOBIAN);
+  header.gridLowerBounds = Eigen::VectorXd::Constant(6, -1.);
+  header.gridUpperBounds = Eigen::VectorXd::Constant(6, 2.);
+  header.gridNumSamples = {3, 4, 5, 6, 7, 8};
+  header.parameters = "radius=0.01\nlength=1\n";
+
+  {
+    qserl::util::DatasetWriterShPtr writer = qserl::util::DatasetWriter::create(filename, header);
+    BOOST_REQUIRE(writer);
+    qserl::util::ArrayView<double> a = writer->column(qserl::util::DC_A);
+    qserl::util::ArrayView<int32_t> stability = writer->stabilityColumn();
+    qserl::util::ArrayView<double> jacobians = writer->column(qserl::util::DC_TIP_JACOBIAN);
+    BOOST_CHECK_EQUAL(a.size(), numSamples * 6);
+    BOOST_CHECK_EQUAL(jacobians.size(), numSamples * 36);
+    // columns are aligned for vectorized processing
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(a.data()) % 64, 0u);
+    BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(stability.data()) % 64, 0u);
+    for(size_t k = 0; k < numSamples; ++k)
+    {
+      for(size_t i = 0; i < 6; ++i)
+      {
+        a[6 * k + i] = static_cast<double>(k) + 0.1 * static_cast<double>(i);
+      }
+      stability[k] = static_cast<int32_t>(k % 3);
+      for(size_t i = 0; i < 36; ++i)
+      {
+        jacobians[36 * k + i] = -static_cast<double>(k * i);
+      }
+    }
+    BOOST_CHECK(writer->sync());
+  }
+
+  qserl::util::DatasetConstShPtr dataset = qserl::util::Dataset::open(filename);
+  BOOST_REQUIRE(dataset);
+  const qserl::util::DatasetHeader& readHeader = dataset->header();
+  BOOST_CHECK_EQUAL(readHeader.rodDimension, 3u);
+  BOOST_CHECK_EQUAL(readHeader.numSamples, numSamples);
+  BOOST_CHECK_EQUAL(readHeader.columns, header.columns);
+  BOOST_CHECK(!readHeader.hasColumn(qserl::util::DC_ENERGY));
+  BOOST_CHECK(readHeader.gridLowerBounds == header.gridLowerBounds);
+  BOOST_CHECK(readHeader.gridUpperBounds == header.gridUpperBounds);
+  BOOST_CHECK(readHeader.gridNumSamples == header.gridNumSamples);
+  BOOST_CHECK_EQUAL(readHeader.parameters, header.parameters);
+
+  const qserl::util::ArrayView<const double> a = dataset->column(qserl::util::DC_A);
+  const qserl::util::ArrayView<const int32_t> stability = dataset->stabilityColumn();
+  const qserl::util::ArrayView<const double> jacobians = dataset->column(qserl::util::DC_TIP_JACOBIAN);
+  BOOST_REQUIRE_EQUAL(a.size(), numSamples * 6);
+  BOOST_REQUIRE_EQUAL(stability.size(), numSamples);
+  BOOST_REQUIRE_EQUAL(jacobians.size(), numSamples * 36);
+  bool isSame = true;
+  for(size_t k = 0; k < numSamples; ++k)
+  {
+    isSame = isSame && stability[k] == static_cast<int32_t>(k % 3);
+    for(size_t i = 0; i < 6; ++i)
+    {
+      isSame = isSame && a[6 * k + i] == static_cast<double>(k) + 0.1 * static_cast<double>(i);
+    }
+    for(size_t i = 0; i < 36; ++i)
+    {
+      isSame = isSame && jacobians[36 * k + i] == -static_cast<double>(k * i);
+    }
+  }
+  BOOST_CHECK(isSame);
+
+  dataset.reset();
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(DatasetTest_invalid_file)
+{
+  static const char* filename = "qserl_test_invalid_dataset.bin";
+  BOOST_CHECK(!qserl::util::Dataset::open(filename));
+
+  {
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::binary);
+    file << "# a3(T) a4(Fx) a5(Fy) stability energy\n";
+  }
+  BOOST_CHECK(!qserl::util::Dataset::open(filename));
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(DatasetTest_corrupted_header)
+{
+  static const char* filename = "qserl_test_corrupted_dataset.bin";
+  static const std::streamoff kGridDimOffset = 20;
+  static const std::streamoff kNumSamplesOffset = 24;
+  static const std::streamoff kGridNumSamplesOffset = 36 + qserl::util::DC_NUMBER_OF_COLUMNS * 16 + 16;
+
+  qserl::util::DatasetHeader header;
+  header.rodDimension = 2;
+  header.numSamples = 8;
+  header.columns = (1u << qserl::util::DC_A) | (1u << qserl::util::DC_STABILITY);
+  header.gridLowerBounds = Eigen::VectorXd::Constant(3, -1.);
+  header.gridUpperBounds = Eigen::VectorXd::Constant(3, 1.);
+  header.gridNumSamples = {2, 2, 2};
+  {
+    qserl::util::DatasetWriterShPtr writer = qserl::util::DatasetWriter::create(filename, header);
+    BOOST_REQUIRE(writer);
+    BOOST_CHECK(writer->sync());
+  }
+  BOOST_REQUIRE(qserl::util::Dataset::open(filename));
+
+  // a sample count overflowing the column sizes is rejected
+  {
+    std::fstream file(filename, std::fstream::in | std::fstream::out | std::fstream::binary);
+    const uint64_t numSamples = (uint64_t(1) << 63) + 1;
+    file.seekp(kNumSamplesOffset);
+    file.write(reinterpret_cast<const char*>(&numSamples), sizeof(numSamples));
+  }
+  BOOST_CHECK(!qserl::util::Dataset::open(filename));
+
+  // as well as a grid with less than 2 samples along an axis
+  {
+    std::fstream file(filename, std::fstream::in | std::fstream::out | std::fstream::binary);
+    const uint64_t numSamples = 8;
+    const uint64_t gridNumSamples = 1;
+    file.seekp(kNumSamplesOffset);
+    file.write(reinterpret_cast<const char*>(&numSamples), sizeof(numSamples));
+    file.seekp(kGridNumSamplesOffset);
+    file.write(reinterpret_cast<const char*>(&gridNumSamples), sizeof(gridNumSamples));
+  }
+  BOOST_CHECK(!qserl::util::Dataset::open(filename));
+
+  // or a grid dimension larger than the A-space one
+  {
+    std::fstream file(filename, std::fstream::in | std::fstream::out | std::fstream::binary);
+    const uint64_t gridNumSamples = 2;
+    const uint32_t gridDim = 0xffffffffu;
+    file.seekp(kGridNumSamplesOffset);
+    file.write(reinterpret_cast<const char*>(&gridNumSamples), sizeof(gridNumSamples));
+    file.seekp(kGridDimOffset);
+    file.write(reinterpret_cast<const char*>(&gridDim), sizeof(gridDim));
+  }
+  BOOST_CHECK(!qserl::util::Dataset::open(filename));
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,146 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include "qserl/rod2d/workspace_integrated_state.h"
+#include "qserl/rod3d/ik.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+
+/* ------------------------------------------------------------------------- */
+/* IntegrationStatsTests																										 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(IntegrationStatsTests)
+
+BOOST_AUTO_TEST_CASE(IntegrationStatsTest_rod3d)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.computeJ_nu_sv = true;
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodState->integrationOptions(integrationOptions);
+  BOOST_CHECK(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  const qserl::util::IntegrationStats& stats = rodState->integrationStats();
+  if(qserl::util::IntegrationStats::isEnabled())
+  {
+    // a single system stepped by RK4, i.e. 4 evaluations per step
+    BOOST_CHECK_EQUAL(stats.numSteps, rodParameters.numNodes - 1);
+    BOOST_CHECK_EQUAL(stats.numRhsEvaluations, 4 * stats.numSteps);
+    BOOST_CHECK(stats.rhsTimeNs > 0);
+    BOOST_CHECK(stats.svdTimeNs > 0);
+    BOOST_CHECK(stats.rhsTimeNs + stats.determinantTimeNs + stats.svdTimeNs + stats.storageTimeNs <=
+                stats.totalTimeNs);
+  }
+  else
+  {
+    BOOST_CHECK_EQUAL(stats.numSteps, 0u);
+    BOOST_CHECK_EQUAL(stats.totalTimeNs, 0);
+    BOOST_CHECK_EQUAL(stats.stabilityThresholdNode, -1);
+  }
+
+  // statistics are those of the last integration
+  double tinv;
+  rodState->integrateWhileValid(qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max()), tinv);
+  if(qserl::util::IntegrationStats::isEnabled())
+  {
+    BOOST_CHECK_EQUAL(rodState->integrationStats().numSteps, rodParameters.numNodes - 1);
+  }
+
+  // threshold node of an unstable configuration
+  rodParameters.radius = 0.01;
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(15.4e6, 5.13e6);
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr unstableState = qserl::rod3d::WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_CHECK(unstableState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
+  if(qserl::util::IntegrationStats::isEnabled())
+  {
+    const int thresholdNode = unstableState->integrationStats().stabilityThresholdNode;
+    BOOST_CHECK(thresholdNode > 0);
+    BOOST_CHECK(thresholdNode < static_cast<int>(rodParameters.numNodes));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IntegrationStatsTest_rod2d)
+{
+  qserl::rod2d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod2d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.delta_t = 0.01;
+  const qserl::rod2d::Wrench2D stableConf(0., 0., 1.);
+
+  qserl::rod2d::WorkspaceIntegratedStateShPtr rodState = qserl::rod2d::WorkspaceIntegratedState::create(
+      stableConf, qserl::rod2d::Displacement2D::Zero(), rodParameters);
+  BOOST_CHECK(rodState->integrate() == qserl::rod2d::WorkspaceIntegratedState::IR_VALID);
+  const qserl::util::IntegrationStats& stats = rodState->integrationStats();
+  if(qserl::util::IntegrationStats::isEnabled())
+  {
+    // costate, state and jacobian systems
+    const size_t numSteps = 3 * (rodParameters.numberOfNodes() - 1);
+    BOOST_CHECK_EQUAL(stats.numSteps, numSteps);
+    BOOST_CHECK_EQUAL(stats.numRhsEvaluations, 4 * numSteps);
+    BOOST_CHECK(stats.totalTimeNs > 0);
+  }
+  else
+  {
+    BOOST_CHECK_EQUAL(stats.numRhsEvaluations, 0u);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IntegrationStatsTest_ik)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr targetState = qserl::rod3d::WorkspaceIntegratedState::create(
+      1.01 * stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(targetState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  qserl::rod3d::InverseKinematics ik(rod);
+  BOOST_CHECK(ik.compute(rodState, rodParameters.numNodes - 1, targetState->nodes().back()) ==
+              qserl::rod3d::InverseKinematics::IK_VALID);
+  const qserl::util::IntegrationStats& stats = ik.lastStats();
+  if(qserl::util::IntegrationStats::isEnabled())
+  {
+    BOOST_CHECK(stats.numIterations > 0);
+    // one integration per iteration
+    BOOST_CHECK_EQUAL(stats.numSteps, stats.numIterations * (rodParameters.numNodes - 1));
+    BOOST_CHECK(stats.linearSolveTimeNs > 0);
+    BOOST_CHECK(stats.rhsTimeNs < stats.totalTimeNs);
+  }
+  else
+  {
+    BOOST_CHECK_EQUAL(stats.numIterations, 0);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
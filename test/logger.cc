@@ -0,0 +1,210 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "qserl/rod3d/ik.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/logger.h"
+
+namespace {
+
+/**
+* \brief Redirects the log to a string stream during its scope.
+*/
+class LogCapture
+{
+public:
+  explicit LogCapture(int i_verbosity) :
+      m_stream(),
+      m_verbosity(qserl::util::Logger::verbosity())
+  {
+    qserl::util::Logger::setSink(m_stream);
+    qserl::util::Logger::setVerbosity(i_verbosity);
+  }
+
+  ~LogCapture()
+  {
+    qserl::util::Logger::setVerbosity(m_verbosity);
+    qserl::util::Logger::setSink(std::cout);
+  }
+
+  std::vector<std::string>
+  lines()
+  {
+    qserl::util::Logger::flush();
+    std::vector<std::string> res;
+    std::istringstream is(m_stream.str());
+    std::string line;
+    while(std::getline(is, line))
+    {
+      res.push_back(line);
+    }
+    return res;
+  }
+
+private:
+  std::ostringstream m_stream;
+  int m_verbosity;
+};
+
+int
+countEvaluation(int& io_numEvaluations)
+{
+  return ++io_numEvaluations;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+/* LoggerTests																															 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(LoggerTests)
+
+BOOST_AUTO_TEST_CASE(LoggerTest_levels)
+{
+  LogCapture capture(qserl::util::LL_WARNING);
+  int numEvaluations = 0;
+  QSERL_LOG(qserl::util::LL_DEBUG, "not formatted " << countEvaluation(numEvaluations));
+  QSERL_LOG(qserl::util::LL_INFO, "not formatted " << countEvaluation(numEvaluations));
+  QSERL_LOG(qserl::util::LL_WARNING, "warning " << countEvaluation(numEvaluations));
+  QSERL_LOG(qserl::util::LL_ERROR, "error " << 2.5);
+  BOOST_CHECK_EQUAL(numEvaluations, 1);
+
+  qserl::util::Logger::setVerbosity(0);
+  QSERL_LOG(qserl::util::LL_ERROR, "off " << countEvaluation(numEvaluations));
+  BOOST_CHECK_EQUAL(numEvaluations, 1);
+
+  const std::vector<std::string> lines = capture.lines();
+  BOOST_REQUIRE_EQUAL(lines.size(), 2u);
+  BOOST_CHECK_EQUAL(lines[0], "[WARNING] warning 1");
+  BOOST_CHECK_EQUAL(lines[1], "[ERROR] error 2.5");
+
+  // long messages are truncated
+  qserl::util::Logger::setVerbosity(qserl::util::LL_DEBUG);
+  QSERL_LOG(qserl::util::LL_DEBUG, std::string(2 * qserl::util::Logger::kMaxMessageLength, 'x'));
+  const std::vector<std::string> truncatedLines = capture.lines();
+  BOOST_REQUIRE_EQUAL(truncatedLines.size(), 3u);
+  BOOST_CHECK_EQUAL(truncatedLines[2], "[DEBUG] " + std::string(qserl::util::Logger::kMaxMessageLength, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(LoggerTest_threads)
+{
+  static const int kNumThreads = 4;
+  static const int kNumMessages = static_cast<int>(qserl::util::Logger::kBufferCapacity) + 50;
+
+  LogCapture capture(qserl::util::LL_INFO);
+  const uint64_t numDroppedStart = qserl::util::Logger::numDroppedMessages();
+  std::vector<std::thread> threads;
+  for(int threadIdx = 0; threadIdx < kNumThreads; ++threadIdx)
+  {
+    threads.emplace_back([threadIdx]()
+                         {
+                           for(int k = 0; k < kNumMessages; ++k)
+                           {
+                             QSERL_LOG(qserl::util::LL_INFO, threadIdx << ' ' << k);
+                           }
+                         });
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  // messages are either written, in order for each thread, or dropped if they overflow their thread buffer
+  const std::vector<std::string> lines = capture.lines();
+  const uint64_t numDropped = qserl::util::Logger::numDroppedMessages() - numDroppedStart;
+  BOOST_CHECK_EQUAL(lines.size() + numDropped, static_cast<size_t>(kNumThreads * kNumMessages));
+  BOOST_CHECK(lines.size() >= static_cast<size_t>(kNumThreads) * qserl::util::Logger::kBufferCapacity);
+  std::vector<int> lastMessage(kNumThreads, -1);
+  for(const std::string& line : lines)
+  {
+    std::istringstream is(line.substr(std::string("[INFO] ").size()));
+    int threadIdx, k;
+    is >> threadIdx >> k;
+    BOOST_REQUIRE(threadIdx >= 0 && threadIdx < kNumThreads);
+    BOOST_CHECK(k > lastMessage[threadIdx]);
+    lastMessage[threadIdx] = k;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(LoggerTest_threadExit)
+{
+  LogCapture capture(qserl::util::LL_INFO);
+  qserl::util::Logger::flush();
+  const size_t numBuffersStart = qserl::util::Logger::numThreadBuffers();
+  std::thread thread([]()
+                     {
+                       QSERL_LOG(qserl::util::LL_INFO, "last words");
+                     });
+  thread.join();
+
+  // the buffer of an exited thread is deleted once its messages are written
+  const std::vector<std::string> lines = capture.lines();
+  BOOST_REQUIRE_EQUAL(lines.size(), 1u);
+  BOOST_CHECK_EQUAL(lines[0], "[INFO] last words");
+  BOOST_CHECK_EQUAL(qserl::util::Logger::numThreadBuffers(), numBuffersStart);
+}
+
+BOOST_AUTO_TEST_CASE(LoggerTest_ik)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr targetState = qserl::rod3d::WorkspaceIntegratedState::create(
+      1.01 * stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(targetState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  qserl::rod3d::InverseKinematics ik(rod);
+
+  // no log by default
+  {
+    LogCapture capture(qserl::util::LL_DEBUG);
+    BOOST_CHECK(ik.compute(rodState, rodParameters.numNodes - 1, targetState->nodes().back()) ==
+                qserl::rod3d::InverseKinematics::IK_VALID);
+    BOOST_CHECK(capture.lines().empty());
+  }
+
+  // one line per iteration, and for the final error
+  BOOST_REQUIRE(rodState->integrateFromBaseWrenchRK4(stableConf) == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  ik.setVerbosity(1);
+  {
+    LogCapture capture(qserl::util::LL_INFO);
+    BOOST_CHECK(ik.compute(rodState, rodParameters.numNodes - 1, targetState->nodes().back()) ==
+                qserl::rod3d::InverseKinematics::IK_VALID);
+    const std::vector<std::string> lines = capture.lines();
+    BOOST_CHECK(lines.size() >= 2u);
+    for(const std::string& line : lines)
+    {
+      BOOST_CHECK_EQUAL(line.substr(0, 11), "[INFO] ik: ");
+    }
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,209 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "qserl/rod3d/ik.h"
+#include "qserl/rod3d/integration_cache.h"
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/metrics.h"
+
+namespace {
+
+/**
+* \brief Returns the value of the counter of given name in given snapshot, or -1 if it does not exist.
+*/
+int64_t
+counterValue(const qserl::util::MetricsSnapshot& i_snapshot,
+             const std::string& i_name)
+{
+  for(const qserl::util::CounterSnapshot& counter : i_snapshot.counters)
+  {
+    if(counter.name == i_name)
+    {
+      return static_cast<int64_t>(counter.value);
+    }
+  }
+  return -1;
+}
+
+/**
+* \brief Returns the number of observations of the histogram of given name in given snapshot, or -1 if it does not
+* exist.
+*/
+int64_t
+histogramCount(const qserl::util::MetricsSnapshot& i_snapshot,
+               const std::string& i_name)
+{
+  for(const qserl::util::HistogramSnapshot& histogram : i_snapshot.histograms)
+  {
+    if(histogram.name == i_name)
+    {
+      return static_cast<int64_t>(histogram.count);
+    }
+  }
+  return -1;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+/* MetricsTests																															 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(MetricsTests)
+
+BOOST_AUTO_TEST_CASE(MetricsTest_threads)
+{
+  static const int kNumThreads = 8;
+  static const int kNumUpdates = 10000;
+
+  qserl::util::Counter& counter = qserl::util::Metrics::counter("test_threads_total", "Test counter.");
+  qserl::util::Histogram& histogram = qserl::util::Metrics::histogram("test_threads", "Test histogram.",
+                                                                      std::vector<double>{1., 2.});
+  BOOST_CHECK_EQUAL(&counter, &qserl::util::Metrics::counter("test_threads_total", "Test counter."));
+  counter.reset();
+  histogram.reset();
+
+  std::vector<std::thread> threads;
+  for(int threadIdx = 0; threadIdx < kNumThreads; ++threadIdx)
+  {
+    threads.emplace_back([&counter, &histogram]()
+                         {
+                           for(int k = 0; k < kNumUpdates; ++k)
+                           {
+                             counter.increment();
+                             histogram.observe(k % 3 + 0.5);
+                           }
+                         });
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  BOOST_CHECK_EQUAL(counter.value(), static_cast<uint64_t>(kNumThreads * kNumUpdates));
+  const std::vector<uint64_t> counts = histogram.counts();
+  BOOST_REQUIRE_EQUAL(counts.size(), 3u);
+  BOOST_CHECK_EQUAL(counts[0] + counts[1] + counts[2], static_cast<uint64_t>(kNumThreads * kNumUpdates));
+  BOOST_CHECK_EQUAL(counts[0], static_cast<uint64_t>(kNumThreads * ((kNumUpdates + 2) / 3)));
+  BOOST_CHECK_EQUAL(counts[1], static_cast<uint64_t>(kNumThreads * ((kNumUpdates + 1) / 3)));
+  BOOST_CHECK_EQUAL(counts[2], static_cast<uint64_t>(kNumThreads * (kNumUpdates / 3)));
+  BOOST_CHECK_CLOSE(histogram.sum(), kNumThreads * (0.5 * counts[0] + 1.5 * counts[1] + 2.5 * counts[2]) / kNumThreads,
+                    1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(MetricsTest_textFormat)
+{
+  qserl::util::Metrics::counter("test_text_total{kind=\"a\"}", "Test family.").reset();
+  qserl::util::Metrics::counter("test_text_total{kind=\"b\"}", "Test family.").reset();
+  qserl::util::Metrics::counter("test_text_total{kind=\"a\"}", "Test family.").increment(3);
+  qserl::util::Histogram& histogram = qserl::util::Metrics::histogram("test_text_seconds", "Test histogram.",
+                                                                      std::vector<double>{0.5, 1.});
+  histogram.reset();
+  histogram.observe(0.5);
+  histogram.observe(0.75);
+  histogram.observe(4.);
+
+  std::ostringstream os;
+  qserl::util::Metrics::writeText(os);
+  const std::string text = os.str();
+  BOOST_CHECK(text.find("# HELP test_text_total Test family.\n"
+                        "# TYPE test_text_total counter\n"
+                        "test_text_total{kind=\"a\"} 3\n"
+                        "test_text_total{kind=\"b\"} 0\n") != std::string::npos);
+  BOOST_CHECK(text.find("# HELP test_text_seconds Test histogram.\n"
+                        "# TYPE test_text_seconds histogram\n"
+                        "test_text_seconds_bucket{le=\"0.5\"} 1\n"
+                        "test_text_seconds_bucket{le=\"1\"} 2\n"
+                        "test_text_seconds_bucket{le=\"+Inf\"} 3\n"
+                        "test_text_seconds_sum 5.25\n"
+                        "test_text_seconds_count 3\n") != std::string::npos);
+
+  // the file is replaced atomically, with the same content
+  const std::string file = "qserl_metrics_test.prom";
+  BOOST_REQUIRE(qserl::util::Metrics::writeText(file));
+  std::ifstream is(file.c_str());
+  std::ostringstream fileContent;
+  fileContent << is.rdbuf();
+  BOOST_CHECK_EQUAL(fileContent.str(), text);
+  BOOST_CHECK(!std::ifstream((file + ".tmp").c_str()));
+  std::remove(file.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(MetricsTest_library)
+{
+  if(!qserl::util::Metrics::isEnabled())
+  {
+    return;
+  }
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr targetState = qserl::rod3d::WorkspaceIntegratedState::create(
+      1.01 * stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+
+  qserl::util::Metrics::reset();
+  BOOST_REQUIRE(targetState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_REQUIRE(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK(rodState->integrateFromBaseWrenchRK4(qserl::rod3d::Wrench::Zero()) ==
+              qserl::rod3d::WorkspaceIntegratedState::IR_SINGULAR);
+  BOOST_REQUIRE(rodState->integrateFromBaseWrenchRK4(stableConf) == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  qserl::util::MetricsSnapshot snapshot = qserl::util::Metrics::snapshot();
+  BOOST_CHECK_EQUAL(counterValue(snapshot, "qserl_rod3d_integrations_total{result=\"valid\"}"), 3);
+  BOOST_CHECK_EQUAL(counterValue(snapshot, "qserl_rod3d_integrations_total{result=\"singular\"}"), 1);
+  BOOST_CHECK_EQUAL(histogramCount(snapshot, "qserl_rod3d_integration_seconds{method=\"rk4\"}"), 4);
+
+  qserl::rod3d::InverseKinematics ik(rod);
+  BOOST_REQUIRE(ik.compute(rodState, rodParameters.numNodes - 1, targetState->nodes().back()) ==
+                qserl::rod3d::InverseKinematics::IK_VALID);
+  snapshot = qserl::util::Metrics::snapshot();
+  BOOST_CHECK_EQUAL(counterValue(snapshot, "qserl_rod3d_ik_results_total{result=\"valid\"}"), 1);
+  BOOST_CHECK_EQUAL(counterValue(snapshot, "qserl_rod3d_ik_results_total{result=\"max_iter_reached\"}"), 0);
+  BOOST_CHECK_EQUAL(histogramCount(snapshot, "qserl_rod3d_ik_iterations"), 1);
+  BOOST_CHECK_EQUAL(histogramCount(snapshot, "qserl_rod3d_ik_seconds"), 1);
+  // each iteration integrates once
+  BOOST_CHECK(counterValue(snapshot, "qserl_rod3d_integrations_total{result=\"valid\"}") > 3);
+
+  qserl::rod3d::IntegrationCacheShPtr cache = qserl::rod3d::IntegrationCache::create(1 << 24);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr cachedState;
+  for(int k = 0; k < 2; ++k)
+  {
+    BOOST_CHECK(cache->integrate(stableConf, qserl::rod3d::Displacement::Identity(), rodParameters,
+                                 rodState->integrationOptions(), cachedState) ==
+                qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  }
+  snapshot = qserl::util::Metrics::snapshot();
+  BOOST_CHECK_EQUAL(counterValue(snapshot, "qserl_rod3d_integration_cache_hits_total"), 1);
+  BOOST_CHECK_EQUAL(counterValue(snapshot, "qserl_rod3d_integration_cache_misses_total"), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,151 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/profiler.h"
+
+namespace {
+
+const qserl::util::ProfileZoneReport*
+findZone(const std::vector<qserl::util::ProfileZoneReport>& i_reports,
+         const std::string& i_path)
+{
+  const auto it = std::find_if(i_reports.begin(), i_reports.end(),
+                               [&i_path](const qserl::util::ProfileZoneReport& i_zone)
+                               {
+                                 return i_zone.path == i_path;
+                               });
+  return it == i_reports.end() ? nullptr : &(*it);
+}
+
+double
+spin(int i_n)
+{
+  volatile double x = 0.;
+  for(int k = 0; k < i_n; ++k)
+  {
+    x = x + 1.e-3 * k;
+  }
+  return x;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+/* ProfilerTests																														 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(ProfilerTests)
+
+BOOST_AUTO_TEST_CASE(ProfilerTest_nestedZones)
+{
+  qserl::util::Profiler::reset();
+  {
+    qserl::util::ProfileZone outerZone("profilerTest::outer");
+    for(int k = 0; k < 10; ++k)
+    {
+      qserl::util::ProfileZone innerZone("profilerTest::inner");
+      spin(1000 * (k + 1));
+    }
+    spin(10000);
+  }
+
+  const std::vector<qserl::util::ProfileZoneReport> reports = qserl::util::Profiler::report();
+  const qserl::util::ProfileZoneReport* outer = findZone(reports, "profilerTest::outer");
+  const qserl::util::ProfileZoneReport* inner = findZone(reports, "profilerTest::outer/profilerTest::inner");
+  BOOST_REQUIRE(outer && inner);
+  BOOST_CHECK_EQUAL(outer->count, 1u);
+  BOOST_CHECK_EQUAL(outer->depth, 0);
+  BOOST_CHECK_EQUAL(inner->count, 10u);
+  BOOST_CHECK_EQUAL(inner->depth, 1);
+  BOOST_CHECK(inner->totalNs > 0.);
+  BOOST_CHECK(inner->totalNs <= outer->totalNs);
+  BOOST_CHECK_CLOSE(outer->selfNs, outer->totalNs - inner->totalNs, 1.e-6);
+  BOOST_CHECK_EQUAL(inner->selfNs, inner->totalNs);
+  BOOST_CHECK(inner->minNs <= inner->p50Ns);
+  BOOST_CHECK(inner->p50Ns <= inner->p99Ns);
+  BOOST_CHECK(inner->p99Ns <= inner->maxNs);
+
+  std::ostringstream os;
+  qserl::util::Profiler::printReport(os);
+  BOOST_CHECK(os.str().find("  profilerTest::inner") != std::string::npos);
+
+  qserl::util::Profiler::reset();
+  BOOST_CHECK(!findZone(qserl::util::Profiler::report(), "profilerTest::outer"));
+}
+
+BOOST_AUTO_TEST_CASE(ProfilerTest_threads)
+{
+  static const int kNumThreads = 4;
+  static const int kNumZones = 100;
+  qserl::util::Profiler::reset();
+  std::vector<std::thread> threads;
+  for(int k = 0; k < kNumThreads; ++k)
+  {
+    threads.emplace_back([]()
+                         {
+                           for(int i = 0; i < kNumZones; ++i)
+                           {
+                             qserl::util::ProfileZone zone("profilerTest::thread");
+                             spin(100);
+                           }
+                         });
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+
+  // zones of exited threads are merged by call path
+  const qserl::util::ProfileZoneReport* zone = findZone(qserl::util::Profiler::report(), "profilerTest::thread");
+  BOOST_REQUIRE(zone);
+  BOOST_CHECK_EQUAL(zone->count, static_cast<size_t>(kNumThreads * kNumZones));
+}
+
+BOOST_AUTO_TEST_CASE(ProfilerTest_libraryZones)
+{
+  qserl::util::Profiler::reset();
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_CHECK(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  // zones are compiled out unless the profiler is enabled
+  const qserl::util::ProfileZoneReport* zone = findZone(qserl::util::Profiler::report(), "rod3d::integrate");
+  if(qserl::util::Profiler::isEnabled())
+  {
+    BOOST_REQUIRE(zone);
+    BOOST_CHECK_EQUAL(zone->count, 1u);
+  }
+  else
+  {
+    BOOST_CHECK(!zone);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,94 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include "qserl/util/regular_grid.h"
+
+/* ------------------------------------------------------------------------- */
+/* RegularGridTests																													 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(RegularGridTests)
+
+BOOST_AUTO_TEST_CASE(RegularGridTest_indexing)
+{
+  const qserl::util::RegularGrid grid(Eigen::Vector3d(-1., -2., 0.), Eigen::Vector3d(1., 2., 3.), {5, 3, 4});
+  BOOST_CHECK_EQUAL(grid.numSamples(), 60u);
+  BOOST_CHECK_EQUAL(grid.stride(0), 1u);
+  BOOST_CHECK_EQUAL(grid.stride(1), 5u);
+  BOOST_CHECK_EQUAL(grid.stride(2), 15u);
+
+  std::vector<size_t> gridIdx;
+  for(size_t idx = 0; idx < grid.numSamples(); ++idx)
+  {
+    grid.gridIndex(idx, gridIdx);
+    BOOST_CHECK_EQUAL(grid.flatIndex(gridIdx), idx);
+  }
+
+  // bounds are sampled
+  BOOST_CHECK(grid.sample(0).isApprox(grid.lowerBounds()));
+  BOOST_CHECK(grid.sample(grid.numSamples() - 1).isApprox(grid.upperBounds()));
+
+  // cell of a point
+  BOOST_CHECK(grid.cellIndex(Eigen::Vector3d(0.1, 2., 1.1), gridIdx));
+  BOOST_CHECK_EQUAL(gridIdx[0], 2u);
+  BOOST_CHECK_EQUAL(gridIdx[1], 1u);
+  BOOST_CHECK_EQUAL(gridIdx[2], 1u);
+  BOOST_CHECK(!grid.cellIndex(Eigen::Vector3d(0., 0., 3.5), gridIdx));
+}
+
+BOOST_AUTO_TEST_CASE(RegularGridTest_boundary_samples)
+{
+  // label samples inside a ball, boundary samples must be the ones having a neighbour
+  // of different label in their 26-neighbourhood
+  static const size_t n = 21;
+  const qserl::util::RegularGrid grid(Eigen::Vector3d::Constant(-1.), Eigen::Vector3d::Constant(1.), {n, n, n});
+  std::vector<int> labels(grid.numSamples());
+  for(size_t idx = 0; idx < grid.numSamples(); ++idx)
+  {
+    labels[idx] = grid.sample(idx).norm() < 0.6 ? 0 : 2;
+  }
+
+  const std::vector<size_t> boundary = qserl::util::extractBoundarySamples(grid, labels);
+
+  // brute force reference
+  std::vector<size_t> expectedBoundary;
+  for(size_t i = 0; i < grid.numSamples(); ++i)
+  {
+    const Eigen::VectorXd a_i = grid.sample(i);
+    bool isBoundary = false;
+    for(size_t j = 0; j < grid.numSamples() && !isBoundary; ++j)
+    {
+      const Eigen::VectorXd diff = (grid.sample(j) - a_i).cwiseAbs();
+      isBoundary = labels[i] != labels[j] && (diff.array() < 1.1 * grid.step().array()).all();
+    }
+    if(isBoundary)
+    {
+      expectedBoundary.push_back(i);
+    }
+  }
+  BOOST_CHECK(!boundary.empty());
+  BOOST_CHECK(boundary == expectedBoundary);
+
+  // uniform labels do not have any boundary
+  const std::vector<int> uniformLabels(grid.numSamples(), 1);
+  BOOST_CHECK(qserl::util::extractBoundarySamples(grid, uniformLabels).empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -177,6 +177,52 @@ BOOST_AUTO_TEST_CASE(InextensibleRodStability2DTest_iterativeIntegration_stable1
   BOOST_CHECK_CLOSE(q_last[2], 1., 1.e-6);
 }
 
+BOOST_AUTO_TEST_CASE(InextensibleRodStability2DTest_conjugatePoint)
+{
+  qserl::rod2d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod2d::Parameters::RM_INEXTENSIBLE;
+
+  qserl::rod2d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.stop_if_unstable = true;
+
+  // unstable configuration
+  static const qserl::rod2d::Displacement2D identityDisp = qserl::rod2d::Displacement2D::Zero();
+  static const qserl::rod2d::Wrench2D maxWrench = qserl::rod2d::Wrench2D::Constant(std::numeric_limits<double>::max());
+  qserl::rod2d::Wrench2D unstableConf;
+  unstableConf[0] = -80.;
+  unstableConf[1] = -75.;
+  unstableConf[2] = 0.;
+
+  // reference conjugate point from a fine discretization
+  rodParameters.delta_t = 0.001;
+  qserl::rod2d::WorkspaceIntegratedStateShPtr rodFineState = qserl::rod2d::WorkspaceIntegratedState::create(
+      unstableConf, identityDisp, rodParameters);
+  rodFineState->integrationOptions(integrationOptions);
+  BOOST_CHECK(rodFineState->integrate() == qserl::rod2d::WorkspaceIntegratedState::IR_UNSTABLE);
+  const double tconjRef = rodFineState->conjugatePointT();
+  BOOST_CHECK(tconjRef > 0. && tconjRef < 1.);
+
+  // refined location on a coarse discretization is close to the reference, and returned as tinv
+  rodParameters.delta_t = 0.01;
+  qserl::rod2d::WorkspaceIntegratedStateShPtr rodState = qserl::rod2d::WorkspaceIntegratedState::create(
+      unstableConf, identityDisp, rodParameters);
+  rodState->integrationOptions(integrationOptions);
+  double tinv = 0.;
+  BOOST_CHECK(rodState->integrateWhileValid(maxWrench, tinv) == qserl::rod2d::WorkspaceIntegratedState::IR_UNSTABLE);
+  BOOST_CHECK_EQUAL(tinv, rodState->conjugatePointT());
+  BOOST_CHECK_SMALL(tinv - tconjRef, 5.e-4);
+
+  // location at node granularity
+  integrationOptions.conjugatePointTolerance = 0.;
+  rodState->integrationOptions(integrationOptions);
+  rodState->integrate();
+  const double tconjNode = rodState->conjugatePointT();
+  BOOST_CHECK(std::fabs(tconjNode - tconjRef) > std::fabs(tinv - tconjRef));
+  BOOST_CHECK_SMALL(tconjNode - std::round(tconjNode / rodParameters.delta_t) * rodParameters.delta_t, 1.e-12);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 
@@ -19,6 +19,11 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <stdexcept>
+
+#include <Eigen/Geometry>
+
 #include "qserl/rod3d/workspace_integrated_state.h"
 #include "qserl/util/timer.h"
 #include "util/lie_algebra_utils.h"
@@ -34,7 +39,6 @@ BOOST_AUTO_TEST_CASE(InextensibleRod3DRawDataTests_compare_external_data1)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   rodParameters.stiffnessCoefficients = Eigen::Matrix<double, 6, 1>::Ones();
   rodParameters.integrationTime = 1.;
   rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
@@ -142,6 +146,45 @@ BOOST_AUTO_TEST_CASE(SingularConfigurations3DTest_2)
   BOOST_CHECK(status == qserl::rod3d::WorkspaceIntegratedState::IR_SINGULAR);
 }
 
+BOOST_AUTO_TEST_CASE(SingularConfigurations3DTest_clearsOutputs)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  WorkspaceIntegratedState::IntegrationOptions options;
+  options.keepMuValues = true;
+  options.keepMMatrices = true;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  state->integrationOptions(options);
+  BOOST_REQUIRE(state->integrate() == WorkspaceIntegratedState::IR_VALID);
+  BOOST_REQUIRE_EQUAL(state->nodes().size(), static_cast<size_t>(rodParameters.numNodes));
+
+  // outputs of the previous integration are cleared, only the base wrench is kept
+  const qserl::rod3d::Wrench singularWrench = qserl::rod3d::Wrench::Zero();
+  BOOST_CHECK(state->integrateFromBaseWrenchRK4(singularWrench) == WorkspaceIntegratedState::IR_SINGULAR);
+  BOOST_CHECK(state->nodes().empty());
+  BOOST_REQUIRE_EQUAL(state->mu().size(), 1u);
+  BOOST_CHECK(state->baseWrench() == singularWrench);
+  BOOST_CHECK(!state->isStable());
+  BOOST_CHECK_THROW(state->node(1), std::out_of_range);
+  BOOST_CHECK_THROW(state->getMMatrix(1), std::out_of_range);
+  BOOST_CHECK_THROW(state->getJMatrix(1), std::out_of_range);
+
+  double tinv = 0.;
+  BOOST_CHECK(state->integrateWhileValid(maxWrench, tinv) == WorkspaceIntegratedState::IR_SINGULAR);
+  BOOST_CHECK(state->nodes().empty());
+  BOOST_REQUIRE_EQUAL(state->mu().size(), 1u);
+  BOOST_CHECK(state->baseWrench() == singularWrench);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 /* ------------------------------------------------------------------------- */
@@ -154,7 +197,6 @@ BOOST_AUTO_TEST_CASE(ExtensibleRodStability3DTest_stable1)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -190,7 +232,6 @@ BOOST_AUTO_TEST_CASE(ExtensibleRodStability3DTest_stable2)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -226,7 +267,6 @@ BOOST_AUTO_TEST_CASE(ExtensibleRodStability3DTest_unstable1)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -262,7 +302,6 @@ BOOST_AUTO_TEST_CASE(ExtensibleRodStability3DTest_unstable2)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -305,7 +344,6 @@ BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_stable1)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -341,7 +379,6 @@ BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_stable2)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -377,7 +414,6 @@ BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_unstable1)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -413,7 +449,6 @@ BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_unstable2)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -444,6 +479,853 @@ BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_unstable2)
   BOOST_CHECK(status == qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
 }
 
+BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_conjugatePoint)
+{
+  qserl::rod3d::Parameters rodParameters;
+  // set appropriate elasticity parameters
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+
+  // reference conjugate point from a fine discretization
+  rodParameters.numNodes = 1000;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodFineState = qserl::rod3d::WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_CHECK(rodFineState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
+  const double tconjRef = rodFineState->conjugatePointT();
+  BOOST_CHECK(tconjRef > 0. && tconjRef < 1.);
+
+  // refined location on a coarse discretization is close to the reference
+  rodParameters.numNodes = 100;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_CHECK(rodState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
+  const double tconj = rodState->conjugatePointT();
+  BOOST_CHECK_SMALL(tconj - tconjRef, 1.e-4);
+
+  // location at node granularity
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.conjugatePointTolerance = 0.;
+  rodState->integrationOptions(integrationOptions);
+  rodState->integrate();
+  BOOST_CHECK(std::fabs(rodState->conjugatePointT() - tconjRef) > std::fabs(tconj - tconjRef));
+
+  // stable configurations have no conjugate point
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodStableState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodStableState->integrate();
+  BOOST_CHECK(rodStableState->conjugatePointT() < 0.);
+}
+
+BOOST_AUTO_TEST_CASE(InextensibleRodStability3DTest_integrateWhileValid)
+{
+  qserl::rod3d::Parameters rodParameters;
+  // set appropriate elasticity parameters
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  const double dt = rodParameters.integrationTime / static_cast<double>(rodParameters.numNodes - 1);
+
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.stop_if_unstable = false;
+  integrationOptions.keepMuValues = true;
+  integrationOptions.keepJdet = true;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  // unstable configuration stops at the conjugate point, and keeps the same valid prefix as the full integration
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodFullState = qserl::rod3d::WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodFullState->integrationOptions(integrationOptions);
+  BOOST_CHECK(rodFullState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodState->integrationOptions(integrationOptions);
+  double tinv = 0.;
+  BOOST_CHECK(rodState->integrateWhileValid(maxWrench, tinv) == qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
+  BOOST_CHECK(rodState->isStable());
+  BOOST_CHECK_EQUAL(tinv, rodFullState->conjugatePointT());
+  const size_t numValidNodes = rodState->nodes().size();
+  BOOST_CHECK_EQUAL(numValidNodes, static_cast<size_t>(std::floor(tinv / dt)) + 1);
+  BOOST_CHECK_EQUAL(rodState->numNodes(), rodParameters.numNodes);
+  BOOST_CHECK_EQUAL(rodState->mu().size(), numValidNodes);
+  BOOST_CHECK_EQUAL(rodState->J_det().size(), numValidNodes);
+  BOOST_CHECK(rodState->nodes().back() == rodFullState->nodes()[numValidNodes - 1]);
+  BOOST_CHECK(rodState->getJMatrix(numValidNodes - 1) == rodFullState->getJMatrix(numValidNodes - 1));
+
+  // stable configuration is fully integrated
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  rodParameters.stiffnessCoefficients = qserl::rod3d::Parameters().stiffnessCoefficients;
+  rodFullState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodFullState->integrationOptions(integrationOptions);
+  BOOST_CHECK(rodFullState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  rodState->integrationOptions(integrationOptions);
+  BOOST_CHECK(rodState->integrateWhileValid(maxWrench, tinv) == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK(tinv < 0.);
+  BOOST_CHECK_EQUAL(rodState->nodes().size(), rodParameters.numNodes);
+  BOOST_CHECK(rodState->nodes().back() == rodFullState->nodes().back());
+
+  // wrench bounds stop integration at the first node exceeding them, on a component growing along the rod
+  int idxComponent = -1;
+  double maxMu = 0.;
+  for(int k = 0; k < 6 && idxComponent < 0; ++k)
+  {
+    maxMu = 0.;
+    for(size_t idxNode = 0; idxNode < static_cast<size_t>(rodParameters.numNodes); ++idxNode)
+    {
+      maxMu = std::max(maxMu, std::abs(rodFullState->wrench(idxNode)[k]));
+    }
+    if(maxMu > 1.01 * std::abs(stableConf[k]))
+    {
+      idxComponent = k;
+    }
+  }
+  BOOST_REQUIRE(idxComponent >= 0);
+  qserl::rod3d::Wrench wrenchBounds = maxWrench;
+  wrenchBounds[idxComponent] = 0.5 * (maxMu + std::abs(stableConf[idxComponent]));
+  size_t idxFirstInvalidNode = 0;
+  while(std::abs(rodFullState->wrench(idxFirstInvalidNode)[idxComponent]) <= wrenchBounds[idxComponent])
+  {
+    ++idxFirstInvalidNode;
+  }
+  BOOST_REQUIRE(idxFirstInvalidNode > 0);
+  BOOST_CHECK(rodState->integrateWhileValid(wrenchBounds, tinv) ==
+              qserl::rod3d::WorkspaceIntegratedState::IR_OUT_OF_WRENCH_BOUNDS);
+  BOOST_CHECK_EQUAL(rodState->nodes().size(), idxFirstInvalidNode);
+  BOOST_CHECK_CLOSE(tinv, (idxFirstInvalidNode - 1) * dt, 1.e-9);
+  BOOST_CHECK(rodState->nodes().back() == rodFullState->nodes()[idxFirstInvalidNode - 1]);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+/* ------------------------------------------------------------------------- */
+/* IntegrationPrecision3DTests																							*/
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(IntegrationPrecision3DTests)
+
+BOOST_AUTO_TEST_CASE(IntegrationPrecision3DTest_accuracy)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+  static const char* const kPrecisionNames[] = {"double", "float", "mixed"};
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.numNodes = 100;
+
+  // configurations of the stability tests, the first two are stable
+  std::vector<qserl::rod3d::Wrench> configurations(4);
+  configurations[0] << -0.3967, 0.2774, 0.1067, 0.54, 1.501, 0.2606;
+  configurations[1] << 0.5205, 0.2989, 0.0875, 0.9518, -0.8417, -0.8075;
+  configurations[2] << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  configurations[3] << -0.4294, -0.3144, -0.4496, -1.1369, -1.6963, -1.7618;
+
+  WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.stop_if_unstable = false;
+  integrationOptions.keepMuValues = true;
+  for(const qserl::rod3d::Parameters::RodModelT rodModel : {qserl::rod3d::Parameters::RM_INEXTENSIBLE,
+                                                             qserl::rod3d::Parameters::RM_EXTENSIBLE_SHEARABLE})
+  {
+    rodParameters.rodModel = rodModel;
+    for(size_t idxConf = 0; idxConf < configurations.size(); ++idxConf)
+    {
+      WorkspaceIntegratedState::IntegrationOptions doubleOptions = integrationOptions;
+      doubleOptions.precision = WorkspaceIntegratedState::IP_DOUBLE;
+      qserl::rod3d::WorkspaceIntegratedStateShPtr doubleState = WorkspaceIntegratedState::create(
+          configurations[idxConf], rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+      doubleState->integrationOptions(doubleOptions);
+      const WorkspaceIntegratedState::IntegrationResultT doubleResult = doubleState->integrate();
+      BOOST_CHECK(doubleResult == (idxConf < 2 ? WorkspaceIntegratedState::IR_VALID :
+                                   WorkspaceIntegratedState::IR_UNSTABLE));
+
+      for(const WorkspaceIntegratedState::IntegrationPrecisionT precision : {WorkspaceIntegratedState::IP_FLOAT,
+                                                                             WorkspaceIntegratedState::IP_MIXED})
+      {
+        WorkspaceIntegratedState::IntegrationOptions options = integrationOptions;
+        options.precision = precision;
+        qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+            configurations[idxConf], rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+        state->integrationOptions(options);
+        BOOST_CHECK(state->integrate() == doubleResult);
+
+        // errors relative to the double precision integration, over all nodes
+        double nodeError = 0., muError = 0., JError = 0.;
+        for(size_t idxNode = 0; idxNode < static_cast<size_t>(rodParameters.numNodes); ++idxNode)
+        {
+          nodeError = std::max(nodeError, (state->nodes()[idxNode] - doubleState->nodes()[idxNode]).norm());
+          muError = std::max(muError, (state->mu()[idxNode] - doubleState->mu()[idxNode]).norm() /
+                                      doubleState->mu()[idxNode].norm());
+          JError = std::max(JError, (state->getJMatrix(idxNode) - doubleState->getJMatrix(idxNode)).norm() /
+                                    std::max(1., doubleState->getJMatrix(idxNode).norm()));
+        }
+        BOOST_TEST_MESSAGE("3D " << (rodModel == qserl::rod3d::Parameters::RM_INEXTENSIBLE ? "inextensible" :
+                                     "extensible") << " configuration " << idxConf << ", " << kPrecisionNames[precision]
+                           << " precision: node error = " << nodeError << ", relative mu error = " << muError
+                           << ", relative J error = " << JError);
+        BOOST_CHECK(JError < 1e-4);
+        if(precision == WorkspaceIntegratedState::IP_MIXED)
+        {
+          // costate and state are integrated in double precision, independently of the Jacobians
+          BOOST_CHECK_EQUAL(nodeError, 0.);
+          BOOST_CHECK_EQUAL(muError, 0.);
+        }
+        else
+        {
+          BOOST_CHECK(nodeError < 1e-4);
+          BOOST_CHECK(muError < 1e-4);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IntegrationPrecision3DTest_integrateWhileValid)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+  static const char* const kPrecisionNames[] = {"double", "float", "mixed"};
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  double doubleTinv = 0.;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr doubleState = WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(doubleState->integrateWhileValid(maxWrench, doubleTinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+
+  for(const WorkspaceIntegratedState::IntegrationPrecisionT precision : {WorkspaceIntegratedState::IP_FLOAT,
+                                                                         WorkspaceIntegratedState::IP_MIXED})
+  {
+    WorkspaceIntegratedState::IntegrationOptions options;
+    options.precision = precision;
+    qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+        unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+    state->integrationOptions(options);
+    double tinv = 0.;
+    BOOST_CHECK(state->integrateWhileValid(maxWrench, tinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+    BOOST_CHECK_EQUAL(state->nodes().size(), doubleState->nodes().size());
+    BOOST_TEST_MESSAGE("3D conjugate point, " << kPrecisionNames[precision] << " precision: " << tinv
+                       << " (double: " << doubleTinv << ")");
+    BOOST_CHECK_SMALL(tinv - doubleTinv, 1e-4);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+/* ------------------------------------------------------------------------- */
+/* OutputSelection3DTests																										*/
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(OutputSelection3DTests)
+
+BOOST_AUTO_TEST_CASE(OutputSelection3DTest_integrate)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << -0.3967, 0.2774, 0.1067, 0.54, 1.501, 0.2606;
+
+  WorkspaceIntegratedState::IntegrationOptions fullOptions;
+  fullOptions.keepMuValues = true;
+  fullOptions.keepMMatrices = true;
+  fullOptions.keepJdet = true;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr fullState = WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  fullState->integrationOptions(fullOptions);
+  BOOST_REQUIRE(fullState->integrate() == WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK(fullState->outputNodes().empty());
+
+  // selection by node list (unsorted, with duplicates) then by stride
+  WorkspaceIntegratedState::IntegrationOptions listOptions = fullOptions;
+  listOptions.outputNodes = {99, 42, 7, 42};
+  WorkspaceIntegratedState::IntegrationOptions strideOptions = fullOptions;
+  strideOptions.outputStride = 10;
+  const std::vector<size_t> expectedListNodes = {0, 7, 42, 99};
+  const std::vector<size_t> expectedStrideNodes = {0, 10, 20, 30, 40, 50, 60, 70, 80, 90, 99};
+  const WorkspaceIntegratedState::IntegrationOptions* const selectionOptions[] = {&listOptions, &strideOptions};
+  const std::vector<size_t>* const expectedNodes[] = {&expectedListNodes, &expectedStrideNodes};
+  for(size_t idxSelection = 0; idxSelection < 2; ++idxSelection)
+  {
+    qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+        stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+    state->integrationOptions(*selectionOptions[idxSelection]);
+    BOOST_REQUIRE(state->integrate() == WorkspaceIntegratedState::IR_VALID);
+    const std::vector<size_t>& outputNodes = state->outputNodes();
+    BOOST_CHECK_EQUAL_COLLECTIONS(outputNodes.begin(), outputNodes.end(),
+                                  expectedNodes[idxSelection]->begin(), expectedNodes[idxSelection]->end());
+    BOOST_REQUIRE_EQUAL(state->nodes().size(), outputNodes.size());
+    BOOST_CHECK_EQUAL(state->mu().size(), outputNodes.size());
+    BOOST_CHECK_EQUAL(state->J_det().size(), outputNodes.size());
+    // the rod is integrated at the same resolution, so the stored nodes are identical
+    for(size_t idxOutput = 0; idxOutput < outputNodes.size(); ++idxOutput)
+    {
+      const size_t nodeIdx = outputNodes[idxOutput];
+      BOOST_CHECK(state->nodes()[idxOutput] == fullState->nodes()[nodeIdx]);
+      BOOST_CHECK(state->node(nodeIdx) == fullState->node(nodeIdx));
+      BOOST_CHECK(state->wrench(nodeIdx) == fullState->wrench(nodeIdx));
+      BOOST_CHECK(state->getMMatrix(nodeIdx) == fullState->getMMatrix(nodeIdx));
+      BOOST_CHECK(state->getJMatrix(nodeIdx) == fullState->getJMatrix(nodeIdx));
+      BOOST_CHECK_EQUAL(state->J_det()[idxOutput], fullState->J_det()[nodeIdx]);
+    }
+    BOOST_CHECK(state->tipWrench() == fullState->tipWrench());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OutputSelection3DTest_invalidNodes)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << -0.3967, 0.2774, 0.1067, 0.54, 1.501, 0.2606;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  // output nodes out of the rod are rejected by both integrations
+  WorkspaceIntegratedState::IntegrationOptions options;
+  options.keepMuValues = true;
+  options.outputNodes = {7, 100};
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  state->integrationOptions(options);
+  BOOST_CHECK(state->integrate() == WorkspaceIntegratedState::IR_INVALID_OPTIONS);
+  BOOST_CHECK(state->nodes().empty());
+  double tinv = 0.;
+  BOOST_CHECK(state->integrateWhileValid(maxWrench, tinv) == WorkspaceIntegratedState::IR_INVALID_OPTIONS);
+  BOOST_CHECK(state->nodes().empty());
+
+  // accessing a node which is not stored throws
+  options.outputNodes = {7, 99};
+  state->integrationOptions(options);
+  BOOST_REQUIRE(state->integrate() == WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK_NO_THROW(state->node(7));
+  BOOST_CHECK_THROW(state->node(8), std::out_of_range);
+  BOOST_CHECK_THROW(state->wrench(8), std::out_of_range);
+  BOOST_CHECK_THROW(state->node(100), std::out_of_range);
+  BOOST_CHECK_THROW(state->getMMatrix(7), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(OutputSelection3DTest_integrateWhileValid)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  double fullTinv = 0.;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr fullState = WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE(fullState->integrateWhileValid(maxWrench, fullTinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+  const size_t numValidNodes = fullState->nodes().size();
+
+  WorkspaceIntegratedState::IntegrationOptions strideOptions;
+  strideOptions.outputStride = 4;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  state->integrationOptions(strideOptions);
+  double tinv = 0.;
+  BOOST_CHECK(state->integrateWhileValid(maxWrench, tinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+  BOOST_CHECK_EQUAL(tinv, fullTinv);
+  // only the selected nodes of the valid prefix are stored
+  BOOST_REQUIRE_EQUAL(state->nodes().size(), (numValidNodes + 3) / 4);
+  for(size_t idxOutput = 0; idxOutput < state->nodes().size(); ++idxOutput)
+  {
+    BOOST_CHECK_EQUAL(state->outputNodes()[idxOutput], 4 * idxOutput);
+    BOOST_CHECK(state->node(4 * idxOutput) == fullState->node(4 * idxOutput));
+    BOOST_CHECK(state->getJMatrix(4 * idxOutput) == fullState->getJMatrix(4 * idxOutput));
+  }
+  // selected nodes beyond the valid prefix are not stored
+  BOOST_CHECK_THROW(state->node(4 * state->nodes().size()), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+/* ------------------------------------------------------------------------- */
+/* Checkpoints3DTests																												*/
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(Checkpoints3DTests)
+
+BOOST_AUTO_TEST_CASE(Checkpoints3DTest_integrate)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_EXTENSIBLE_SHEARABLE;
+  rodParameters.numNodes = 1000;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 0.5205, 0.2989, 0.0875, 0.9518, -0.8417, -0.8075;
+
+  for(const WorkspaceIntegratedState::IntegrationPrecisionT precision : {WorkspaceIntegratedState::IP_DOUBLE,
+                                                                         WorkspaceIntegratedState::IP_FLOAT,
+                                                                         WorkspaceIntegratedState::IP_MIXED})
+  {
+    WorkspaceIntegratedState::IntegrationOptions fullOptions;
+    fullOptions.keepMuValues = true;
+    fullOptions.keepMMatrices = true;
+    fullOptions.precision = precision;
+    qserl::rod3d::WorkspaceIntegratedStateShPtr fullState = WorkspaceIntegratedState::create(
+        stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+    fullState->integrationOptions(fullOptions);
+    BOOST_REQUIRE(fullState->integrate() == WorkspaceIntegratedState::IR_VALID);
+
+    WorkspaceIntegratedState::IntegrationOptions checkpointOptions = fullOptions;
+    checkpointOptions.checkpointInterval = 64;
+    qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+        stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+    state->integrationOptions(checkpointOptions);
+    BOOST_REQUIRE(state->integrate() == WorkspaceIntegratedState::IR_VALID);
+    BOOST_CHECK_EQUAL(state->mu().size(), 1);
+    BOOST_TEST_MESSAGE("3D checkpoints, precision " << precision << ": memory usage " << state->memUsage()
+                       << " (stored nodes: " << fullState->memUsage() << ")");
+    BOOST_CHECK(4 * state->memUsage() < fullState->memUsage());
+
+    // recomputed values are identical to the stored ones, in order and in reverse order (segments evicted),
+    // then around a checkpoint (cached segments)
+    std::vector<size_t> nodeIndices;
+    for(size_t idxNode = 0; idxNode < static_cast<size_t>(rodParameters.numNodes); ++idxNode)
+    {
+      nodeIndices.push_back(idxNode);
+    }
+    for(size_t idxNode = rodParameters.numNodes; idxNode > 0; --idxNode)
+    {
+      nodeIndices.push_back(idxNode - 1);
+    }
+    for(size_t idxNode = 120; idxNode < 140; ++idxNode)
+    {
+      nodeIndices.push_back(idxNode);
+      nodeIndices.push_back(259 - idxNode);
+    }
+    for(const size_t idxNode : nodeIndices)
+    {
+      BOOST_REQUIRE(state->wrench(idxNode) == fullState->wrench(idxNode));
+      BOOST_REQUIRE(state->getMMatrix(idxNode) == fullState->getMMatrix(idxNode));
+      BOOST_REQUIRE(state->getJMatrix(idxNode) == fullState->getJMatrix(idxNode));
+    }
+    BOOST_CHECK(state->tipWrench() == fullState->tipWrench());
+    BOOST_CHECK(state->nodes() == fullState->nodes());
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Checkpoints3DTest_integrateWhileValid)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  WorkspaceIntegratedState::IntegrationOptions fullOptions;
+  fullOptions.keepMuValues = true;
+  double fullTinv = 0.;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr fullState = WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  fullState->integrationOptions(fullOptions);
+  BOOST_REQUIRE(fullState->integrateWhileValid(maxWrench, fullTinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+
+  WorkspaceIntegratedState::IntegrationOptions checkpointOptions = fullOptions;
+  checkpointOptions.checkpointInterval = 8;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  state->integrationOptions(checkpointOptions);
+  double tinv = 0.;
+  BOOST_CHECK(state->integrateWhileValid(maxWrench, tinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+  BOOST_CHECK_EQUAL(tinv, fullTinv);
+  BOOST_REQUIRE_EQUAL(state->nodes().size(), fullState->nodes().size());
+  // only the valid prefix can be recomputed
+  for(size_t idxNode = 0; idxNode < fullState->nodes().size(); ++idxNode)
+  {
+    BOOST_CHECK(state->wrench(idxNode) == fullState->wrench(idxNode));
+    BOOST_CHECK(state->getJMatrix(idxNode) == fullState->getJMatrix(idxNode));
+  }
+  BOOST_CHECK(state->tipWrench() == fullState->tipWrench());
+
+  // nodes past the valid prefix are not stored
+  const size_t numValidNodes = fullState->nodes().size();
+  BOOST_REQUIRE(numValidNodes < static_cast<size_t>(rodParameters.numNodes));
+  BOOST_CHECK_THROW(state->wrench(numValidNodes), std::out_of_range);
+  BOOST_CHECK_THROW(state->getMMatrix(numValidNodes), std::out_of_range);
+  BOOST_CHECK_THROW(state->getJMatrix(numValidNodes), std::out_of_range);
+  BOOST_CHECK_THROW(state->getJMatrix(rodParameters.numNodes), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+/* ------------------------------------------------------------------------- */
+/* StructureOfArrays3DTests																									*/
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(StructureOfArrays3DTests)
+
+BOOST_AUTO_TEST_CASE(StructureOfArrays3DTest_integrate)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << -0.3967, 0.2774, 0.1067, 0.54, 1.501, 0.2606;
+
+  WorkspaceIntegratedState::IntegrationOptions options;
+  options.outputStride = 3;
+  options.keepPositionsSoA = true;
+  options.keepRotationsSoA = true;
+  options.keepQuaternionsSoA = true;
+  options.keepJSoA = true;
+  for(const WorkspaceIntegratedState::IntegrationPrecisionT precision : {WorkspaceIntegratedState::IP_DOUBLE,
+                                                                         WorkspaceIntegratedState::IP_MIXED})
+  {
+    options.precision = precision;
+    qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+        stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+    state->integrationOptions(options);
+    BOOST_REQUIRE(state->integrate() == WorkspaceIntegratedState::IR_VALID);
+
+    const qserl::rod3d::Displacements& nodes = state->nodes();
+    const qserl::rod3d::PositionsSoA& positions = state->positionsSoA();
+    const qserl::rod3d::RotationsSoA& rotations = state->rotationsSoA();
+    const qserl::rod3d::QuaternionsSoA& quaternions = state->quaternionsSoA();
+    const qserl::rod3d::Matrices6dSoA& J = state->JSoA();
+    BOOST_REQUIRE_EQUAL(positions.cols(), nodes.size());
+    BOOST_REQUIRE_EQUAL(rotations.cols(), nodes.size());
+    BOOST_REQUIRE_EQUAL(quaternions.cols(), nodes.size());
+    BOOST_REQUIRE_EQUAL(J.cols(), nodes.size());
+    // each coordinate is contiguous over the nodes
+    BOOST_CHECK_EQUAL(&positions(1, 0) - &positions(0, 0), nodes.size());
+    for(size_t idxOutput = 0; idxOutput < nodes.size(); ++idxOutput)
+    {
+      const size_t nodeIdx = state->outputNodes()[idxOutput];
+      for(int i = 0; i < 3; ++i)
+      {
+        BOOST_CHECK_EQUAL(positions(i, idxOutput), nodes[idxOutput](i, 3));
+        for(int j = 0; j < 3; ++j)
+        {
+          BOOST_CHECK_EQUAL(rotations(3 * j + i, idxOutput), nodes[idxOutput](i, j));
+        }
+      }
+      const Eigen::Quaterniond quaternion(nodes[idxOutput].topLeftCorner<3, 3>());
+      BOOST_CHECK((quaternions.col(idxOutput) == quaternion.coeffs()));
+      for(int i = 0; i < 6; ++i)
+      {
+        for(int j = 0; j < 6; ++j)
+        {
+          BOOST_CHECK_EQUAL(J(6 * j + i, idxOutput), state->getJMatrix(nodeIdx)(i, j));
+        }
+      }
+    }
+
+    // exports from the nodes are identical
+    qserl::rod3d::PositionsSoA exportedPositions;
+    qserl::rod3d::RotationsSoA exportedRotations;
+    qserl::rod3d::QuaternionsSoA exportedQuaternions;
+    state->exportPositions(exportedPositions);
+    state->exportRotations(exportedRotations);
+    state->exportQuaternions(exportedQuaternions);
+    BOOST_CHECK(exportedPositions == positions);
+    BOOST_CHECK(exportedRotations == rotations);
+    BOOST_CHECK(exportedQuaternions == quaternions);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(StructureOfArrays3DTest_integrateWhileValid)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench unstableConf;
+  unstableConf << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+  static const qserl::rod3d::Wrench maxWrench = qserl::rod3d::Wrench::Constant(std::numeric_limits<double>::max());
+
+  WorkspaceIntegratedState::IntegrationOptions options;
+  options.keepPositionsSoA = true;
+  options.keepJSoA = true;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+      unstableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  state->integrationOptions(options);
+  double tinv = 0.;
+  BOOST_REQUIRE(state->integrateWhileValid(maxWrench, tinv) == WorkspaceIntegratedState::IR_UNSTABLE);
+
+  // only the valid prefix is kept
+  const qserl::rod3d::Displacements& nodes = state->nodes();
+  BOOST_REQUIRE(nodes.size() < static_cast<size_t>(rodParameters.numNodes));
+  BOOST_REQUIRE_EQUAL(state->positionsSoA().cols(), nodes.size());
+  BOOST_REQUIRE_EQUAL(state->JSoA().cols(), nodes.size());
+  BOOST_CHECK_EQUAL(state->rotationsSoA().cols(), 0);
+  for(size_t idxNode = 0; idxNode < nodes.size(); ++idxNode)
+  {
+    BOOST_CHECK((state->positionsSoA().col(idxNode) == nodes[idxNode].block<3, 1>(0, 3)));
+    BOOST_CHECK((state->JSoA().col(idxNode) ==
+                 Eigen::Map<const Eigen::Matrix<double, 36, 1> >(state->getJMatrix(idxNode).data())));
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+/* ------------------------------------------------------------------------- */
+/* IntegrateInto3DTests																											*/
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(IntegrateInto3DTests)
+
+BOOST_AUTO_TEST_CASE(IntegrateInto3DTest_callerBuffers)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
+  const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
+  rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  std::vector<qserl::rod3d::Wrench> configurations(2);
+  configurations[0] << -0.3967, 0.2774, 0.1067, 0.54, 1.501, 0.2606;
+  configurations[1] << -0.5885, -0.7467, 0.4277, -0.121, 0.0508, 0.9760;
+
+  for(const size_t outputStride : {1, 7})
+  {
+    WorkspaceIntegratedState::IntegrationOptions options;
+    options.stop_if_unstable = false;
+    options.keepMuValues = true;
+    options.keepMMatrices = true;
+    options.keepJdet = true;
+    options.outputStride = outputStride;
+    for(const qserl::rod3d::Wrench& configuration : configurations)
+    {
+      qserl::rod3d::WorkspaceIntegratedStateShPtr refState = WorkspaceIntegratedState::create(
+          configuration, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+      refState->integrationOptions(options);
+      const WorkspaceIntegratedState::IntegrationResultT refResult = refState->integrate();
+      const size_t numOutputs = refState->nodes().size();
+
+      // interleaved caller buffer: per stored node, position then J (with padding), and separate mu and det
+      const std::ptrdiff_t nodeStride = 16 + 36 + 4;
+      std::vector<double> nodeBuffer(numOutputs * nodeStride, -1.);
+      std::vector<double> muBuffer(numOutputs * 6);
+      std::vector<double> detBuffer(numOutputs);
+      WorkspaceIntegratedState::IntegrationOutputs outputs;
+      outputs.nodes = qserl::util::StridedView<double>(nodeBuffer.data(), numOutputs, nodeStride);
+      outputs.J = qserl::util::StridedView<double>(nodeBuffer.data() + 16, numOutputs, nodeStride);
+      outputs.mu = qserl::util::StridedView<double>(muBuffer.data(), numOutputs, 6);
+      outputs.J_det = qserl::util::StridedView<double>(detBuffer.data(), numOutputs, 1);
+
+      qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+          configuration, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+      state->integrationOptions(options);
+      BOOST_CHECK(state->integrateInto(configuration, outputs) == refResult);
+      BOOST_CHECK_EQUAL(state->isStable(), refState->isStable());
+      BOOST_CHECK_EQUAL(state->conjugatePointT(), refState->conjugatePointT());
+      BOOST_CHECK(state->nodes().empty());
+
+      for(size_t idxOutput = 0; idxOutput < numOutputs; ++idxOutput)
+      {
+        const size_t nodeIdx = outputStride == 1 ? idxOutput : refState->outputNodes()[idxOutput];
+        BOOST_CHECK(Eigen::Map<const qserl::rod3d::Displacement>(outputs.nodes.element(idxOutput)) ==
+                    refState->nodes()[idxOutput]);
+        BOOST_CHECK(Eigen::Map<const qserl::rod3d::Matrix6d>(outputs.J.element(idxOutput)) ==
+                    refState->getJMatrix(nodeIdx));
+        BOOST_CHECK(Eigen::Map<const qserl::rod3d::Wrench>(outputs.mu.element(idxOutput)) ==
+                    refState->wrench(nodeIdx));
+        BOOST_CHECK_EQUAL(*outputs.J_det.element(idxOutput), refState->J_det()[idxOutput]);
+        // padding is left untouched
+        for(std::ptrdiff_t k = 16 + 36; k < nodeStride; ++k)
+        {
+          BOOST_CHECK_EQUAL(nodeBuffer[idxOutput * nodeStride + k], -1.);
+        }
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(IntegrateInto3DTest_invalidOutputs)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+
+  // undersized and overlapping buffers are rejected before anything is written
+  std::vector<double> nodeBuffer(rodParameters.numNodes * 16, -1.);
+  WorkspaceIntegratedState::IntegrationOutputs outputs;
+  outputs.nodes = qserl::util::StridedView<double>(nodeBuffer.data(), rodParameters.numNodes - 1, 16);
+  BOOST_CHECK(state->integrateInto(stableConf, outputs) == WorkspaceIntegratedState::IR_INVALID_OPTIONS);
+  outputs.nodes = qserl::util::StridedView<double>(nodeBuffer.data(), rodParameters.numNodes, 12);
+  BOOST_CHECK(state->integrateInto(stableConf, outputs) == WorkspaceIntegratedState::IR_INVALID_OPTIONS);
+  BOOST_CHECK(std::count(nodeBuffer.begin(), nodeBuffer.end(), -1.) == static_cast<long>(nodeBuffer.size()));
+
+  // as well as options unavailable with caller buffers
+  outputs.nodes = qserl::util::StridedView<double>(nodeBuffer.data(), rodParameters.numNodes, 16);
+  WorkspaceIntegratedState::IntegrationOptions options;
+  options.checkpointInterval = 10;
+  state->integrationOptions(options);
+  BOOST_CHECK(state->integrateInto(stableConf, outputs) == WorkspaceIntegratedState::IR_INVALID_OPTIONS);
+  options.checkpointInterval = 0;
+  options.keepPositionsSoA = true;
+  state->integrationOptions(options);
+  BOOST_CHECK(state->integrateInto(stableConf, outputs) == WorkspaceIntegratedState::IR_INVALID_OPTIONS);
+  BOOST_CHECK(std::count(nodeBuffer.begin(), nodeBuffer.end(), -1.) == static_cast<long>(nodeBuffer.size()));
+
+  options.keepPositionsSoA = false;
+  state->integrationOptions(options);
+  BOOST_CHECK(state->integrateInto(stableConf, outputs) == WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK_EQUAL(nodeBuffer[0], 1.);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
+
+/* ------------------------------------------------------------------------- */
+/* CopyOnWrite3DTests																												*/
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(CopyOnWrite3DTests)
+
+BOOST_AUTO_TEST_CASE(CopyOnWrite3DTest_sharedUntilIntegrated)
+{
+  typedef qserl::rod3d::WorkspaceIntegratedState WorkspaceIntegratedState;
+
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench parentConf, childConf;
+  parentConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  childConf << -0.3967, 0.2774, 0.1067, 0.54, 1.501, 0.2606;
+
+  WorkspaceIntegratedState::IntegrationOptions options;
+  options.keepMuValues = true;
+  options.keepJdet = true;
+  options.keepPositionsSoA = true;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr parent = WorkspaceIntegratedState::create(
+      parentConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  parent->integrationOptions(options);
+  BOOST_REQUIRE(parent->integrate() == WorkspaceIntegratedState::IR_VALID);
+  const qserl::rod3d::Displacements parentNodes = parent->nodes();
+  const qserl::rod3d::Wrenches parentMu = parent->mu();
+  const std::vector<double> parentJdet = parent->J_det();
+
+  // clones share the per node buffers, also when moved to another base
+  qserl::rod3d::WorkspaceIntegratedStateShPtr child = std::dynamic_pointer_cast<WorkspaceIntegratedState>(
+      parent->clone());
+  BOOST_REQUIRE(child);
+  qserl::rod3d::Displacement otherBase = qserl::rod3d::Displacement::Identity();
+  otherBase.block<3, 1>(0, 3) = Eigen::Vector3d(1., 2., 3.);
+  child->base(otherBase);
+  BOOST_CHECK(&child->nodes() == &parent->nodes());
+  BOOST_CHECK(&child->mu() == &parent->mu());
+  BOOST_CHECK(&child->J_det() == &parent->J_det());
+  BOOST_CHECK(&child->positionsSoA() == &parent->positionsSoA());
+  BOOST_CHECK(&child->getJMatrix(rodParameters.numNodes - 1) == &parent->getJMatrix(rodParameters.numNodes - 1));
+  BOOST_CHECK(parent->base() == qserl::rod3d::Displacement::Identity());
+
+  // integrating the clone replaces its buffers, and leaves the parent untouched
+  BOOST_CHECK(child->integrateFromBaseWrenchRK4(childConf) == WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK(&child->nodes() != &parent->nodes());
+  BOOST_CHECK(child->nodes().back() != parentNodes.back());
+  BOOST_CHECK(parent->nodes() == parentNodes);
+  BOOST_CHECK(parent->mu() == parentMu);
+  BOOST_CHECK(parent->J_det() == parentJdet);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr reference = WorkspaceIntegratedState::create(
+      childConf, rodParameters.numNodes, otherBase, rodParameters);
+  reference->integrationOptions(options);
+  reference->integrate();
+  BOOST_CHECK(child->nodes() == reference->nodes());
+  BOOST_CHECK(child->mu() == reference->mu());
+  BOOST_CHECK(child->positionsSoA() == reference->positionsSoA());
+
+  // same with a partial integration of another clone
+  qserl::rod3d::WorkspaceIntegratedStateShPtr partial = WorkspaceIntegratedState::createCopy(parent);
+  double tinv = 0.;
+  partial->integrateWhileValid(100. * childConf, tinv);
+  BOOST_CHECK(parent->nodes() == parentNodes);
+  BOOST_CHECK(parent->mu() == parentMu);
+  BOOST_CHECK(parent->J_det() == parentJdet);
+
+  // plain states share their nodes as well
+  qserl::rod3d::WorkspaceStateShPtr plainState = qserl::rod3d::WorkspaceState::create(
+      parentNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_CHECK(&plainState->clone()->nodes() == &plainState->nodes());
+}
+
 BOOST_AUTO_TEST_SUITE_END();
 
 /* ------------------------------------------------------------------------- */
@@ -458,7 +1340,6 @@ BOOST_AUTO_TEST_CASE(Extensible3DBencnhmark_1)
   qserl::rod3d::Parameters rodParameters;
   // set appropriate elasticity parameters
   rodParameters.radius = 0.01;
-  rodParameters.length = 1.;
   const double youngModulus = 15.4e6;  /** Default Young modulus of rubber: 15.4 MPa */
   const double shearModulus = 5.13e6;  /** Default Shear modulus of rubber: 5.13 MPa */
   rodParameters.setIsotropicStiffnessCoefficientsFromElasticityParameters(youngModulus, shearModulus);
@@ -0,0 +1,121 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include "qserl/rod3d/integration_cache.h"
+#include "qserl/rod3d/rod.h"
+
+/* ------------------------------------------------------------------------- */
+/* IntegrationCache3DTests																									 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(IntegrationCache3DTests)
+
+BOOST_AUTO_TEST_CASE(IntegrationCache3DTest_rod)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  const qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+  qserl::rod3d::IntegrationCacheShPtr cache = qserl::rod3d::IntegrationCache::create(1 << 24);
+  rod->integrationCache(cache);
+
+  BOOST_CHECK_EQUAL(rod->integrateStateFromBaseWrench(stableConf, qserl::rod3d::Displacement::Identity(),
+                                                      integrationOptions),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  const qserl::rod3d::WorkspaceIntegratedStateShPtr firstState = rod->integratedState();
+  BOOST_REQUIRE(firstState);
+  BOOST_CHECK_EQUAL(cache->numMisses(), 1u);
+  BOOST_CHECK_EQUAL(cache->numHits(), 0u);
+
+  // same query from another base is served from the cache
+  qserl::rod3d::Displacement otherBase = qserl::rod3d::Displacement::Identity();
+  otherBase.block<3, 1>(0, 3) = Eigen::Vector3d(1., 2., 3.);
+  BOOST_CHECK_EQUAL(rod->integrateStateFromBaseWrench(stableConf, otherBase, integrationOptions),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  const qserl::rod3d::WorkspaceIntegratedStateShPtr secondState = rod->integratedState();
+  BOOST_REQUIRE(secondState);
+  BOOST_CHECK_EQUAL(cache->numHits(), 1u);
+  BOOST_CHECK(secondState != firstState);
+  BOOST_CHECK(secondState->base() == otherBase);
+  BOOST_CHECK(secondState->nodes().back() == firstState->nodes().back());
+  BOOST_CHECK(secondState->getJMatrix(rodParameters.numNodes - 1) ==
+              firstState->getJMatrix(rodParameters.numNodes - 1));
+
+  // other parameters or options are not served from the cache
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions otherOptions = integrationOptions;
+  otherOptions.keepMuValues = !otherOptions.keepMuValues;
+  rod->integrateStateFromBaseWrench(stableConf, otherBase, otherOptions);
+  qserl::rod3d::Parameters otherParameters = rodParameters;
+  otherParameters.numNodes = 50;
+  qserl::rod3d::RodShPtr otherRod = qserl::rod3d::Rod::create(otherParameters);
+  otherRod->integrationCache(cache);
+  otherRod->integrateStateFromBaseWrench(stableConf, otherBase, integrationOptions);
+  BOOST_CHECK_EQUAL(cache->numMisses(), 3u);
+  BOOST_CHECK_EQUAL(cache->size(), 3u);
+  BOOST_CHECK(cache->memUsage() >= firstState->memUsage());
+
+  // invalid results are cached too
+  const qserl::rod3d::Wrench singularConf = qserl::rod3d::Wrench::Zero();
+  BOOST_CHECK_EQUAL(rod->integrateStateFromBaseWrench(singularConf, otherBase, integrationOptions),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_SINGULAR);
+  BOOST_CHECK_EQUAL(rod->integrateStateFromBaseWrench(singularConf, otherBase, integrationOptions),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_SINGULAR);
+  BOOST_CHECK_EQUAL(cache->numHits(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(IntegrationCache3DTest_budget_and_tolerance)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  const qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+
+  // quantized wrenches
+  qserl::rod3d::IntegrationCacheShPtr cache = qserl::rod3d::IntegrationCache::create(1 << 24, 1.e-3);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state;
+  cache->integrate(stableConf, qserl::rod3d::Displacement::Identity(), rodParameters, integrationOptions, state);
+  const qserl::rod3d::Wrench nearConf = stableConf + qserl::rod3d::Wrench::Constant(1.e-6);
+  cache->integrate(nearConf, qserl::rod3d::Displacement::Identity(), rodParameters, integrationOptions, state);
+  BOOST_CHECK_EQUAL(cache->numHits(), 1u);
+
+  // budget of a single entry evicts the least recently used ones
+  const size_t entryMemUsage = cache->memUsage();
+  qserl::rod3d::IntegrationCacheShPtr smallCache = qserl::rod3d::IntegrationCache::create(entryMemUsage + entryMemUsage / 2);
+  for(int k = 0; k < 3; ++k)
+  {
+    const qserl::rod3d::Wrench conf = stableConf + qserl::rod3d::Wrench::Constant(0.01 * k);
+    smallCache->integrate(conf, qserl::rod3d::Displacement::Identity(), rodParameters, integrationOptions, state);
+    BOOST_CHECK_EQUAL(smallCache->size(), 1u);
+    BOOST_CHECK(smallCache->memUsage() <= smallCache->maxMemUsage());
+  }
+  smallCache->integrate(stableConf, qserl::rod3d::Displacement::Identity(), rodParameters, integrationOptions, state);
+  BOOST_CHECK_EQUAL(smallCache->numHits(), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,130 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+
+#include "qserl/rod3d/lazy_integrated_state.h"
+
+/* ------------------------------------------------------------------------- */
+/* LazyIntegratedState3DTests																								 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(LazyIntegratedState3DTests)
+
+BOOST_AUTO_TEST_CASE(LazyIntegratedState3DTest_evictedStatesIntegratedAgain)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  const qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+
+  // the cache budget only fits a few integrated states
+  qserl::rod3d::WorkspaceIntegratedStateShPtr referenceState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  referenceState->integrate();
+  const size_t kNumCachedStates = 3;
+  qserl::rod3d::IntegrationCacheShPtr cache = qserl::rod3d::IntegrationCache::create(
+      kNumCachedStates * (referenceState->memUsage() + 1024));
+  const qserl::rod3d::LazyIntegrationSettingsConstShPtr settings =
+      std::make_shared<const qserl::rod3d::LazyIntegrationSettings>(rodParameters, integrationOptions, cache);
+
+  const size_t kNumStates = 10;
+  qserl::rod3d::LazyIntegratedStates lazyStates;
+  qserl::rod3d::Displacement otherBase = qserl::rod3d::Displacement::Identity();
+  otherBase.block<3, 1>(0, 3) = Eigen::Vector3d(1., 2., 3.);
+  for(size_t stateIdx = 0; stateIdx < kNumStates; ++stateIdx)
+  {
+    lazyStates.push_back(qserl::rod3d::LazyIntegratedState((1. + 0.01 * static_cast<double>(stateIdx)) * stableConf,
+                                                           otherBase, settings));
+  }
+  // nothing is integrated until accessed
+  BOOST_CHECK_EQUAL(cache->size(), 0u);
+  BOOST_CHECK(lazyStates[0].memUsage() < referenceState->memUsage() / 10);
+
+  std::vector<qserl::rod3d::Displacement> tips;
+  for(const qserl::rod3d::LazyIntegratedState& lazyState : lazyStates)
+  {
+    const qserl::rod3d::WorkspaceIntegratedStateShPtr state = lazyState.state();
+    BOOST_REQUIRE(state);
+    BOOST_CHECK(state->base() == otherBase);
+    qserl::rod3d::WorkspaceIntegratedStateShPtr directState = qserl::rod3d::WorkspaceIntegratedState::create(
+        lazyState.baseWrench(), rodParameters.numNodes, otherBase, rodParameters);
+    directState->integrate();
+    BOOST_CHECK(state->nodes() == directState->nodes());
+    tips.push_back(state->nodes().back());
+  }
+  BOOST_CHECK_EQUAL(cache->numMisses(), kNumStates);
+  BOOST_CHECK(cache->size() <= kNumCachedStates);
+
+  // the most recent states are served from the cache, the evicted ones are integrated again identically
+  BOOST_CHECK(lazyStates.back().node(rodParameters.numNodes - 1) == tips.back());
+  BOOST_CHECK_EQUAL(cache->numHits(), 1u);
+  BOOST_CHECK(lazyStates.front().nodes().back() == tips.front());
+  BOOST_CHECK(lazyStates.front().getJMatrix(rodParameters.numNodes - 1) ==
+              referenceState->getJMatrix(rodParameters.numNodes - 1));
+  BOOST_CHECK_EQUAL(cache->numMisses(), kNumStates + 1);
+  BOOST_CHECK_EQUAL(cache->numHits(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(LazyIntegratedState3DTest_settings)
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+
+  // states are held by the global cache by default
+  const qserl::rod3d::LazyIntegrationSettingsConstShPtr globalSettings =
+      std::make_shared<const qserl::rod3d::LazyIntegrationSettings>(rodParameters);
+  BOOST_CHECK(globalSettings->cache == qserl::rod3d::IntegrationCache::global());
+  BOOST_CHECK_EQUAL(qserl::rod3d::IntegrationCache::global()->maxMemUsage(),
+                    qserl::rod3d::IntegrationCache::kDefaultGlobalMaxMemUsage);
+  BOOST_CHECK_EQUAL(qserl::rod3d::IntegrationCache::global()->wrenchTolerance(), 0.);
+
+  // invalid results have no state
+  const qserl::rod3d::LazyIntegratedState singularState(qserl::rod3d::Wrench::Zero(),
+                                                        qserl::rod3d::Displacement::Identity(), globalSettings);
+  BOOST_CHECK(singularState.result() == qserl::rod3d::WorkspaceIntegratedState::IR_SINGULAR);
+  BOOST_CHECK(!singularState.state());
+  BOOST_CHECK_THROW(singularState.nodes(), std::logic_error);
+  BOOST_CHECK_THROW(singularState.node(0), std::logic_error);
+  BOOST_CHECK_THROW(singularState.getJMatrix(0), std::logic_error);
+
+  // without cache, states are integrated on every access
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  const qserl::rod3d::LazyIntegrationSettingsConstShPtr uncachedSettings =
+      std::make_shared<const qserl::rod3d::LazyIntegrationSettings>(
+          rodParameters, qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions(),
+          qserl::rod3d::IntegrationCacheShPtr());
+  const qserl::rod3d::LazyIntegratedState uncachedState(stableConf, qserl::rod3d::Displacement::Identity(),
+                                                        uncachedSettings);
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationResultT result;
+  const qserl::rod3d::WorkspaceIntegratedStateShPtr state = uncachedState.state(result);
+  BOOST_CHECK(result == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_REQUIRE(state);
+  BOOST_CHECK(uncachedState.state() != state);
+  BOOST_CHECK(uncachedState.nodes() == state->nodes());
+}
+
+BOOST_AUTO_TEST_SUITE_END();
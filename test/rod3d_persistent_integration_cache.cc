@@ -0,0 +1,309 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include "qserl/rod3d/integration_cache.h"
+#include "qserl/rod3d/persistent_integration_cache.h"
+
+namespace {
+
+/**
+* \brief Removes the files of a persistent cache directory, and the directory.
+*/
+void
+removeCacheDirectory(const std::string& i_directory)
+{
+  std::remove((i_directory + "/index.bin").c_str());
+  std::remove((i_directory + "/lock").c_str());
+  for(int segment = 0; segment < 1000; ++segment)
+  {
+    std::remove((i_directory + "/segment_" + std::to_string(segment) + ".bin").c_str());
+  }
+  std::remove(i_directory.c_str());
+}
+
+qserl::rod3d::Parameters
+persistentCacheRodParameters()
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+  return rodParameters;
+}
+
+qserl::rod3d::Wrench
+persistentCacheStableConf()
+{
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  return stableConf;
+}
+
+}
+
+/* ------------------------------------------------------------------------- */
+/* PersistentIntegrationCache3DTests																				 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(PersistentIntegrationCache3DTests)
+
+BOOST_AUTO_TEST_CASE(PersistentIntegrationCache3DTest_acrossRuns)
+{
+  static const std::string directory = "qserl_test_persistent_cache";
+  removeCacheDirectory(directory);
+  const qserl::rod3d::Parameters rodParameters = persistentCacheRodParameters();
+  const qserl::rod3d::Wrench stableConf = persistentCacheStableConf();
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.keepMuValues = true;
+  integrationOptions.keepJdet = true;
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr firstState;
+  {
+    qserl::rod3d::IntegrationCacheShPtr cache = qserl::rod3d::IntegrationCache::create(1 << 24);
+    cache->persistentCache(qserl::rod3d::PersistentIntegrationCache::open(directory));
+    BOOST_REQUIRE(cache->persistentCache());
+    BOOST_CHECK_EQUAL(cache->integrate(stableConf, qserl::rod3d::Displacement::Identity(), rodParameters,
+                                       integrationOptions, firstState),
+                      qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+    BOOST_REQUIRE(firstState);
+    BOOST_CHECK_EQUAL(cache->numMisses(), 1u);
+    BOOST_CHECK_EQUAL(cache->persistentCache()->size(), 1u);
+    BOOST_CHECK(cache->persistentCache()->diskUsage() > 0u);
+  }
+
+  // another run finds the state on disk, and keeps it in memory
+  qserl::rod3d::IntegrationCacheShPtr cache = qserl::rod3d::IntegrationCache::create(1 << 24);
+  cache->persistentCache(qserl::rod3d::PersistentIntegrationCache::open(directory));
+  BOOST_REQUIRE(cache->persistentCache());
+  qserl::rod3d::Displacement otherBase = qserl::rod3d::Displacement::Identity();
+  otherBase.block<3, 1>(0, 3) = Eigen::Vector3d(1., 2., 3.);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state;
+  BOOST_CHECK_EQUAL(cache->integrate(stableConf, otherBase, rodParameters, integrationOptions, state),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_REQUIRE(state);
+  BOOST_CHECK_EQUAL(cache->numMisses(), 0u);
+  BOOST_CHECK_EQUAL(cache->numHits(), 1u);
+  BOOST_CHECK_EQUAL(cache->numPersistentHits(), 1u);
+  BOOST_CHECK_EQUAL(cache->size(), 1u);
+  BOOST_CHECK(state->base() == otherBase);
+  BOOST_CHECK(state->nodes() == firstState->nodes());
+  BOOST_CHECK(state->mu() == firstState->mu());
+  BOOST_CHECK(state->J_det() == firstState->J_det());
+  BOOST_CHECK(state->getJMatrix(rodParameters.numNodes - 1) == firstState->getJMatrix(rodParameters.numNodes - 1));
+  BOOST_CHECK_EQUAL(state->isStable(), firstState->isStable());
+  BOOST_CHECK(state->integrationOptions().keepMuValues);
+
+  BOOST_CHECK_EQUAL(cache->integrate(stableConf, otherBase, rodParameters, integrationOptions, state),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK_EQUAL(cache->numPersistentHits(), 1u);
+
+  // other options are other entries, and options the state file cannot store are not persisted
+  integrationOptions.keepMMatrices = true;
+  BOOST_CHECK_EQUAL(cache->integrate(stableConf, otherBase, rodParameters, integrationOptions, state),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK_EQUAL(cache->numMisses(), 1u);
+  BOOST_CHECK_EQUAL(cache->persistentCache()->size(), 2u);
+  integrationOptions.checkpointInterval = 10;
+  BOOST_CHECK_EQUAL(cache->integrate(stableConf, otherBase, rodParameters, integrationOptions, state),
+                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_CHECK_EQUAL(cache->persistentCache()->size(), 2u);
+  BOOST_CHECK(!cache->persistentCache()->insert("key", state, qserl::rod3d::WorkspaceIntegratedState::IR_VALID));
+
+  // results without state are persisted as well
+  BOOST_CHECK(cache->persistentCache()->insert("unstable", qserl::rod3d::WorkspaceIntegratedStateShPtr(),
+                                               qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE));
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationResultT result;
+  BOOST_CHECK(qserl::rod3d::PersistentIntegrationCache::open(directory)->find("unstable", state, result));
+  BOOST_CHECK_EQUAL(result, qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE);
+  BOOST_CHECK(!state);
+  BOOST_CHECK(!cache->persistentCache()->find("missing", state, result));
+
+  cache.reset();
+  removeCacheDirectory(directory);
+}
+
+BOOST_AUTO_TEST_CASE(PersistentIntegrationCache3DTest_integratorRevision)
+{
+  static const std::string directory = "qserl_test_persistent_cache_revision";
+  static const std::streamoff kIntegratorRevisionOffset = 56;
+  removeCacheDirectory(directory);
+  {
+    qserl::rod3d::PersistentIntegrationCacheShPtr cache = qserl::rod3d::PersistentIntegrationCache::open(directory);
+    BOOST_REQUIRE(cache);
+    BOOST_REQUIRE(cache->insert("unstable", qserl::rod3d::WorkspaceIntegratedStateShPtr(),
+                                qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE));
+  }
+
+  // results persisted by other integrators are discarded
+  {
+    std::fstream index(directory + "/index.bin", std::fstream::in | std::fstream::out | std::fstream::binary);
+    const uint64_t otherRevision = qserl::rod3d::PersistentIntegrationCache::kIntegratorRevision + 1;
+    index.seekp(kIntegratorRevisionOffset);
+    index.write(reinterpret_cast<const char*>(&otherRevision), sizeof(otherRevision));
+  }
+  qserl::rod3d::PersistentIntegrationCacheShPtr cache = qserl::rod3d::PersistentIntegrationCache::open(directory);
+  BOOST_REQUIRE(cache);
+  BOOST_CHECK_EQUAL(cache->size(), 0u);
+  BOOST_CHECK_EQUAL(cache->diskUsage(), 0u);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state;
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationResultT result;
+  BOOST_CHECK(!cache->find("unstable", state, result));
+
+  // and the index recreated for the current ones
+  BOOST_CHECK(cache->insert("unstable", state, qserl::rod3d::WorkspaceIntegratedState::IR_UNSTABLE));
+  cache = qserl::rod3d::PersistentIntegrationCache::open(directory);
+  BOOST_REQUIRE(cache);
+  BOOST_CHECK(cache->find("unstable", state, result));
+  cache.reset();
+  removeCacheDirectory(directory);
+}
+
+BOOST_AUTO_TEST_CASE(PersistentIntegrationCache3DTest_eviction)
+{
+  static const std::string directory = "qserl_test_persistent_cache_eviction";
+  removeCacheDirectory(directory);
+  const qserl::rod3d::Parameters rodParameters = persistentCacheRodParameters();
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = qserl::rod3d::WorkspaceIntegratedState::create(
+      persistentCacheStableConf(), rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE_EQUAL(state->integrate(), qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  // the disk budget fits about 10 records
+  qserl::rod3d::PersistentIntegrationCacheShPtr cache = qserl::rod3d::PersistentIntegrationCache::open(directory);
+  BOOST_REQUIRE(cache->insert("probe", state, qserl::rod3d::WorkspaceIntegratedState::IR_VALID));
+  const size_t recordSize = cache->diskUsage();
+  cache.reset();
+  removeCacheDirectory(directory);
+  cache = qserl::rod3d::PersistentIntegrationCache::open(directory, 10 * recordSize);
+  BOOST_REQUIRE(cache);
+
+  const size_t kNumEntries = 50;
+  for(size_t idx = 0; idx < kNumEntries; ++idx)
+  {
+    BOOST_CHECK(cache->insert("key" + std::to_string(idx), state, qserl::rod3d::WorkspaceIntegratedState::IR_VALID));
+    BOOST_CHECK(cache->diskUsage() <= cache->maxDiskUsage());
+  }
+  BOOST_CHECK(cache->size() < kNumEntries);
+  BOOST_CHECK(cache->size() > 3u);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr foundState;
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationResultT result;
+  BOOST_CHECK(!cache->find("key0", foundState, result));
+  BOOST_REQUIRE(cache->find("key" + std::to_string(kNumEntries - 1), foundState, result));
+  BOOST_REQUIRE(foundState);
+  BOOST_CHECK(foundState->nodes() == state->nodes());
+
+  // the number of entries is bounded as well
+  cache.reset();
+  removeCacheDirectory(directory);
+  cache = qserl::rod3d::PersistentIntegrationCache::open(
+      directory, qserl::rod3d::PersistentIntegrationCache::kDefaultMaxDiskUsage, 8);
+  BOOST_REQUIRE(cache);
+  BOOST_CHECK(cache->maxEntries() >= 8u);
+  for(size_t idx = 0; idx < kNumEntries; ++idx)
+  {
+    BOOST_CHECK(cache->insert("key" + std::to_string(idx), state, qserl::rod3d::WorkspaceIntegratedState::IR_VALID));
+    BOOST_CHECK(cache->size() <= cache->maxEntries());
+  }
+  BOOST_CHECK(cache->find("key" + std::to_string(kNumEntries - 1), foundState, result));
+
+  cache.reset();
+  removeCacheDirectory(directory);
+}
+
+BOOST_AUTO_TEST_CASE(PersistentIntegrationCache3DTest_concurrentInstances)
+{
+  static const std::string directory = "qserl_test_persistent_cache_concurrent";
+  removeCacheDirectory(directory);
+  const qserl::rod3d::Parameters rodParameters = persistentCacheRodParameters();
+  const qserl::rod3d::Wrench stableConf = persistentCacheStableConf();
+  const size_t kNumStates = 4;
+  std::vector<qserl::rod3d::WorkspaceIntegratedStateShPtr> states;
+  for(size_t idx = 0; idx < kNumStates; ++idx)
+  {
+    states.push_back(qserl::rod3d::WorkspaceIntegratedState::create(
+        (1. + 0.01 * static_cast<double>(idx)) * stableConf, rodParameters.numNodes,
+        qserl::rod3d::Displacement::Identity(), rodParameters));
+    BOOST_REQUIRE_EQUAL(states.back()->integrate(), qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  }
+
+  // each instance locks the directory as a separate process would
+  const int kNumThreads = 4;
+  const size_t kNumKeys = 40;
+  std::vector<std::thread> threads;
+  std::vector<int> numErrors(kNumThreads, 0);
+  for(int threadIdx = 0; threadIdx < kNumThreads; ++threadIdx)
+  {
+    threads.emplace_back([&, threadIdx]()
+                         {
+                           qserl::rod3d::PersistentIntegrationCacheShPtr cache =
+                               qserl::rod3d::PersistentIntegrationCache::open(directory);
+                           if(!cache)
+                           {
+                             ++numErrors[threadIdx];
+                             return;
+                           }
+                           for(size_t idx = 0; idx < kNumKeys; ++idx)
+                           {
+                             const size_t keyIdx = (idx + 7 * threadIdx) % kNumKeys;
+                             const std::string key = "key" + std::to_string(keyIdx);
+                             qserl::rod3d::WorkspaceIntegratedStateShPtr state;
+                             qserl::rod3d::WorkspaceIntegratedState::IntegrationResultT result;
+                             if(cache->find(key, state, result))
+                             {
+                               numErrors[threadIdx] += state->nodes() != states[keyIdx % kNumStates]->nodes();
+                             }
+                             else if(!cache->insert(key, states[keyIdx % kNumStates],
+                                                    qserl::rod3d::WorkspaceIntegratedState::IR_VALID))
+                             {
+                               ++numErrors[threadIdx];
+                             }
+                           }
+                         });
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  for(int threadIdx = 0; threadIdx < kNumThreads; ++threadIdx)
+  {
+    BOOST_CHECK_EQUAL(numErrors[threadIdx], 0);
+  }
+
+  // each key is stored once
+  qserl::rod3d::PersistentIntegrationCacheShPtr cache = qserl::rod3d::PersistentIntegrationCache::open(directory);
+  BOOST_REQUIRE(cache);
+  BOOST_CHECK_EQUAL(cache->size(), kNumKeys);
+  for(size_t keyIdx = 0; keyIdx < kNumKeys; ++keyIdx)
+  {
+    qserl::rod3d::WorkspaceIntegratedStateShPtr state;
+    qserl::rod3d::WorkspaceIntegratedState::IntegrationResultT result;
+    BOOST_REQUIRE(cache->find("key" + std::to_string(keyIdx), state, result));
+    BOOST_CHECK(state->nodes() == states[keyIdx % kNumStates]->nodes());
+  }
+
+  cache.reset();
+  removeCacheDirectory(directory);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
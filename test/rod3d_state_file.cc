@@ -0,0 +1,205 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+#include "qserl/rod3d/state_file.h"
+
+namespace {
+
+qserl::rod3d::Parameters
+stateFileRodParameters()
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+  return rodParameters;
+}
+
+qserl::rod3d::Wrench
+stateFileStableConf()
+{
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  return stableConf;
+}
+
+}
+
+/* ------------------------------------------------------------------------- */
+/* StateFile3DTests																														 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(StateFile3DTests)
+
+BOOST_AUTO_TEST_CASE(StateFile3DTest_roundTrip)
+{
+  static const char* filename = "qserl_test_state.bin";
+  const qserl::rod3d::Parameters rodParameters = stateFileRodParameters();
+  qserl::rod3d::Displacement base = qserl::rod3d::Displacement::Identity();
+  base.block<3, 1>(0, 3) = Eigen::Vector3d(1., 2., 3.);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = qserl::rod3d::WorkspaceIntegratedState::create(
+      stateFileStableConf(), rodParameters.numNodes, base, rodParameters);
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.keepMuValues = true;
+  integrationOptions.keepMMatrices = true;
+  integrationOptions.keepJdet = true;
+  integrationOptions.precision = qserl::rod3d::WorkspaceIntegratedState::IP_MIXED;
+  state->integrationOptions(integrationOptions);
+  BOOST_REQUIRE_EQUAL(state->integrate(), qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  for(int encoding = 0; encoding < qserl::rod3d::NE_NUMBER_OF_NODES_ENCODINGS; ++encoding)
+  {
+    const qserl::rod3d::NodesEncodingT nodesEncoding = static_cast<qserl::rod3d::NodesEncodingT>(encoding);
+    BOOST_REQUIRE(qserl::rod3d::StateFile::write(filename, *state, qserl::rod3d::StateFile::kAllArrays,
+                                                 nodesEncoding));
+    qserl::rod3d::StateFileConstShPtr stateFile = qserl::rod3d::StateFile::open(filename);
+    BOOST_REQUIRE(stateFile);
+
+    BOOST_CHECK(stateFile->rodParameters().rodModel == rodParameters.rodModel);
+    BOOST_CHECK_EQUAL(stateFile->rodParameters().numNodes, rodParameters.numNodes);
+    BOOST_CHECK_EQUAL(stateFile->rodParameters().radius, rodParameters.radius);
+    BOOST_CHECK(stateFile->rodParameters().gravity == rodParameters.gravity);
+    BOOST_CHECK(stateFile->integrationOptions().precision == integrationOptions.precision);
+    BOOST_CHECK(stateFile->integrationOptions().keepMMatrices);
+    BOOST_CHECK(!stateFile->integrationOptions().keepPositionsSoA);
+    BOOST_CHECK_EQUAL(stateFile->isStable(), state->isStable());
+    BOOST_CHECK_EQUAL(stateFile->conjugatePointT(), state->conjugatePointT());
+    BOOST_CHECK(stateFile->baseWrench() == state->baseWrench());
+    BOOST_CHECK(stateFile->base() == base);
+    BOOST_CHECK(stateFile->nodesEncoding() == nodesEncoding);
+    BOOST_REQUIRE_EQUAL(stateFile->numStoredNodes(), state->nodes().size());
+
+    // arrays are mapped in place, aligned for vectorized reads
+    for(int array = 0; array < qserl::rod3d::SA_NUMBER_OF_ARRAYS; ++array)
+    {
+      BOOST_REQUIRE(stateFile->hasArray(static_cast<qserl::rod3d::StateArrayT>(array)));
+    }
+    const qserl::util::ArrayView<const double> J = stateFile->array(qserl::rod3d::SA_J);
+    BOOST_CHECK_EQUAL(J.size(), 36 * state->nodes().size());
+    BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(J.data()) % 64, 0u);
+    BOOST_CHECK(Eigen::Map<const qserl::rod3d::Matrix6d>(J.data() + 36 * 7) == state->getJMatrix(7));
+    BOOST_CHECK_EQUAL(stateFile->array(qserl::rod3d::SA_J_DET)[12], state->J_det()[12]);
+    if(nodesEncoding == qserl::rod3d::NE_AFFINE_FLOAT)
+    {
+      BOOST_CHECK_EQUAL(stateFile->floatArray(qserl::rod3d::SA_NODES).size(), 12 * state->nodes().size());
+    }
+
+    const qserl::rod3d::WorkspaceIntegratedStateShPtr loadedState = stateFile->state();
+    BOOST_REQUIRE(loadedState);
+    BOOST_CHECK_EQUAL(loadedState->isStable(), state->isStable());
+    BOOST_CHECK(loadedState->base() == base);
+    BOOST_REQUIRE_EQUAL(loadedState->nodes().size(), state->nodes().size());
+    for(size_t idxNode = 0; idxNode < state->nodes().size(); ++idxNode)
+    {
+      if(nodesEncoding == qserl::rod3d::NE_AFFINE_FLOAT)
+      {
+        BOOST_CHECK(loadedState->node(idxNode).isApprox(state->node(idxNode), 1e-6));
+        BOOST_CHECK(loadedState->node(idxNode).row(3) == Eigen::RowVector4d(0., 0., 0., 1.));
+      }
+      else
+      {
+        BOOST_CHECK(loadedState->node(idxNode) == state->node(idxNode));
+      }
+      BOOST_CHECK(loadedState->wrench(idxNode) == state->wrench(idxNode));
+      BOOST_CHECK(loadedState->getMMatrix(idxNode) == state->getMMatrix(idxNode));
+      BOOST_CHECK(loadedState->getJMatrix(idxNode) == state->getJMatrix(idxNode));
+    }
+    BOOST_CHECK(loadedState->J_det() == state->J_det());
+  }
+
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(StateFile3DTest_outputNodesAndCheckpoints)
+{
+  static const char* filename = "qserl_test_state_outputs.bin";
+  const qserl::rod3d::Parameters rodParameters = stateFileRodParameters();
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = qserl::rod3d::WorkspaceIntegratedState::create(
+      stateFileStableConf(), rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.keepMuValues = true;
+  integrationOptions.outputStride = 7;
+  integrationOptions.checkpointInterval = 10;
+  state->integrationOptions(integrationOptions);
+  BOOST_REQUIRE_EQUAL(state->integrate(), qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+
+  // only the node positions and the wrenches recomputed from the checkpoints are written
+  BOOST_REQUIRE(qserl::rod3d::StateFile::write(filename, *state, 1u << qserl::rod3d::SA_MU,
+                                               qserl::rod3d::NE_AFFINE));
+  qserl::rod3d::StateFileConstShPtr stateFile = qserl::rod3d::StateFile::open(filename);
+  BOOST_REQUIRE(stateFile);
+  BOOST_CHECK(stateFile->hasArray(qserl::rod3d::SA_NODES));
+  BOOST_CHECK(stateFile->hasArray(qserl::rod3d::SA_MU));
+  BOOST_CHECK(!stateFile->hasArray(qserl::rod3d::SA_J));
+  BOOST_CHECK(stateFile->outputNodes() == state->outputNodes());
+  BOOST_CHECK_EQUAL(stateFile->integrationOptions().checkpointInterval, integrationOptions.checkpointInterval);
+
+  const qserl::rod3d::WorkspaceIntegratedStateShPtr loadedState = stateFile->state();
+  BOOST_CHECK_EQUAL(loadedState->integrationOptions().checkpointInterval, 0u);
+  BOOST_CHECK(!loadedState->integrationOptions().keepJMatrices);
+  BOOST_CHECK(loadedState->outputNodes() == state->outputNodes());
+  for(size_t idx = 0; idx < state->outputNodes().size(); ++idx)
+  {
+    const size_t idxNode = state->outputNodes()[idx];
+    BOOST_CHECK(loadedState->node(idxNode) == state->node(idxNode));
+    BOOST_CHECK(loadedState->wrench(idxNode) == state->wrench(idxNode));
+  }
+  BOOST_CHECK(loadedState->tipWrench() == state->tipWrench());
+
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(StateFile3DTest_invalidFile)
+{
+  static const char* filename = "qserl_test_invalid_state.bin";
+  BOOST_CHECK(!qserl::rod3d::StateFile::open(filename));
+
+  {
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::binary);
+    file << "QSERLST";
+  }
+  BOOST_CHECK(!qserl::rod3d::StateFile::open(filename));
+
+  // a file truncated within its arrays is rejected as well
+  const qserl::rod3d::Parameters rodParameters = stateFileRodParameters();
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = qserl::rod3d::WorkspaceIntegratedState::create(
+      stateFileStableConf(), rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+  BOOST_REQUIRE_EQUAL(state->integrate(), qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  BOOST_REQUIRE(qserl::rod3d::StateFile::write(filename, *state));
+  std::string content;
+  {
+    std::ifstream file(filename, std::ifstream::in | std::ifstream::binary);
+    content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+  BOOST_REQUIRE(qserl::rod3d::StateFile::open(filename));
+  {
+    std::ofstream file(filename, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    file.write(content.data(), content.size() - 8);
+  }
+  BOOST_CHECK(!qserl::rod3d::StateFile::open(filename));
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
@@ -0,0 +1,187 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "qserl/rod3d/rod.h"
+#include "qserl/rod3d/workspace_integrated_state_pool.h"
+
+namespace {
+
+qserl::rod3d::Parameters
+poolParameters()
+{
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.radius = 0.01;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 50;
+  return rodParameters;
+}
+
+qserl::rod3d::Wrench
+stableWrench()
+{
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  return stableConf;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+/* StatePool3DTests																													 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(StatePool3DTests)
+
+BOOST_AUTO_TEST_CASE(StatePool3DTest_recycling)
+{
+  const qserl::rod3d::Parameters rodParameters = poolParameters();
+  qserl::rod3d::WorkspaceIntegratedStatePoolShPtr pool = qserl::rod3d::WorkspaceIntegratedStatePool::create(
+      rodParameters.numNodes, rodParameters);
+  BOOST_REQUIRE(pool);
+
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state = pool->acquire(stableWrench(),
+                                                                    qserl::rod3d::Displacement::Identity());
+  BOOST_REQUIRE(state);
+  BOOST_CHECK_EQUAL(pool->numStates(), 1u);
+  BOOST_CHECK_EQUAL(pool->numFreeStates(), 0u);
+  qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions options;
+  options.keepMuValues = true;
+  options.keepJdet = true;
+  options.outputStride = 7;
+  state->integrationOptions(options);
+  BOOST_CHECK(state->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  const qserl::rod3d::WorkspaceIntegratedState* const address = state.get();
+
+  // released states go back to the pool and are handed out again, reset like newly created ones
+  state.reset();
+  BOOST_CHECK_EQUAL(pool->numFreeStates(), 1u);
+  qserl::rod3d::Displacement otherBase = qserl::rod3d::Displacement::Identity();
+  otherBase.block<3, 1>(0, 3) = Eigen::Vector3d(1., 2., 3.);
+  state = pool->acquire(-stableWrench(), otherBase);
+  BOOST_CHECK(state.get() == address);
+  BOOST_CHECK_EQUAL(pool->numStates(), 1u);
+  BOOST_CHECK(state->base() == otherBase);
+  BOOST_CHECK(!state->integrationOptions().keepMuValues);
+  // nothing of the previous integration is exposed
+  BOOST_CHECK(state->nodes().empty());
+  BOOST_CHECK(state->outputNodes().empty());
+  BOOST_CHECK_THROW(state->node(0), std::out_of_range);
+  BOOST_CHECK_EQUAL(state->integrationStats().stabilityThresholdNode, -1);
+
+  // integration results are the same as the ones of a new state
+  BOOST_CHECK(state->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  qserl::rod3d::WorkspaceIntegratedStateShPtr newState = qserl::rod3d::WorkspaceIntegratedState::create(
+      -stableWrench(), rodParameters.numNodes, otherBase, rodParameters);
+  BOOST_CHECK(newState->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  for(size_t nodeIdx = 0; nodeIdx < static_cast<size_t>(rodParameters.numNodes); ++nodeIdx)
+  {
+    BOOST_CHECK(state->nodes()[nodeIdx] == newState->nodes()[nodeIdx]);
+    BOOST_CHECK(state->getJMatrix(nodeIdx) == newState->getJMatrix(nodeIdx));
+  }
+  BOOST_CHECK(state->wrench(0) == newState->wrench(0));
+  BOOST_CHECK(state->tipWrench() == newState->tipWrench());
+
+  pool->reserve(3);
+  BOOST_CHECK_EQUAL(pool->numStates(), 3u);
+  BOOST_CHECK_EQUAL(pool->numFreeStates(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(StatePool3DTest_statesOutlivePool)
+{
+  const qserl::rod3d::Parameters rodParameters = poolParameters();
+  qserl::rod3d::WorkspaceIntegratedStateShPtr state;
+  {
+    qserl::rod3d::WorkspaceIntegratedStatePoolShPtr pool = qserl::rod3d::WorkspaceIntegratedStatePool::create(
+        rodParameters.numNodes, rodParameters);
+    state = pool->acquire(stableWrench(), qserl::rod3d::Displacement::Identity());
+  }
+  // the state keeps its pool alive
+  BOOST_CHECK(state->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID);
+  state.reset();
+}
+
+BOOST_AUTO_TEST_CASE(StatePool3DTest_threads)
+{
+  const qserl::rod3d::Parameters rodParameters = poolParameters();
+  qserl::rod3d::WorkspaceIntegratedStatePoolShPtr pool = qserl::rod3d::WorkspaceIntegratedStatePool::create(
+      rodParameters.numNodes, rodParameters);
+  const int kNumThreads = 4;
+  const int kNumRuns = 10;
+  std::vector<int> numValid(kNumThreads, 0);
+  std::vector<std::thread> threads;
+  for(int threadIdx = 0; threadIdx < kNumThreads; ++threadIdx)
+  {
+    threads.emplace_back([&pool, &numValid, threadIdx]()
+                         {
+                           for(int run = 0; run < kNumRuns; ++run)
+                           {
+                             qserl::rod3d::WorkspaceIntegratedStateShPtr state = pool->acquire(
+                                 stableWrench(), qserl::rod3d::Displacement::Identity());
+                             if(state->integrate() == qserl::rod3d::WorkspaceIntegratedState::IR_VALID)
+                             {
+                               ++numValid[threadIdx];
+                             }
+                           }
+                         });
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  for(int threadIdx = 0; threadIdx < kNumThreads; ++threadIdx)
+  {
+    BOOST_CHECK_EQUAL(numValid[threadIdx], kNumRuns);
+  }
+  BOOST_CHECK(pool->numStates() <= static_cast<size_t>(kNumThreads));
+  BOOST_CHECK_EQUAL(pool->numFreeStates(), pool->numStates());
+}
+
+BOOST_AUTO_TEST_CASE(StatePool3DTest_rodInPlace)
+{
+  const qserl::rod3d::Parameters rodParameters = poolParameters();
+  const qserl::rod3d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  qserl::rod3d::RodShPtr rod = qserl::rod3d::Rod::create(rodParameters);
+
+  // the rod alternates between two states when no one else references them
+  rod->integrateStateFromBaseWrench(stableWrench(), qserl::rod3d::Displacement::Identity(), integrationOptions);
+  const qserl::rod3d::WorkspaceIntegratedState* const first = rod->integratedState().get();
+  rod->integrateStateFromBaseWrench(stableWrench(), qserl::rod3d::Displacement::Identity(), integrationOptions);
+  const qserl::rod3d::WorkspaceIntegratedState* const second = rod->integratedState().get();
+  BOOST_CHECK(second != first);
+  rod->integrateStateFromBaseWrench(-stableWrench(), qserl::rod3d::Displacement::Identity(), integrationOptions);
+  BOOST_CHECK(rod->integratedState().get() == first);
+  BOOST_CHECK(rod->integratedState()->wrench(0) == -stableWrench());
+
+  // a referenced state is never overwritten
+  const qserl::rod3d::WorkspaceIntegratedStateShPtr held = rod->integratedState();
+  const qserl::rod3d::Displacement heldTip = held->nodes().back();
+  rod->integrateStateFromBaseWrench(stableWrench(), qserl::rod3d::Displacement::Identity(), integrationOptions);
+  BOOST_CHECK(rod->integratedState().get() == second);
+  rod->integrateStateFromBaseWrench(stableWrench(), qserl::rod3d::Displacement::Identity(), integrationOptions);
+  BOOST_CHECK(rod->integratedState().get() != held.get());
+  BOOST_CHECK(held->wrench(0) == -stableWrench());
+  BOOST_CHECK(held->nodes().back() == heldTip);
+}
+
+BOOST_AUTO_TEST_SUITE_END();
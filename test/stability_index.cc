@@ -0,0 +1,179 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+
+#include "qserl/rod2d/stability_oracle.h"
+#include "qserl/rod2d/workspace_integrated_state.h"
+#include "qserl/util/dataset.h"
+#include "qserl/util/stability_index.h"
+
+/* ------------------------------------------------------------------------- */
+/* StabilityIndexTests																											 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(StabilityIndexTests)
+
+BOOST_AUTO_TEST_CASE(StabilityIndexTest_queries)
+{
+  // stable region is a ball of radius 0.6
+  const auto isInBall = [](const Eigen::VectorXd& i_a)
+  {
+    return i_a.norm() < 0.6;
+  };
+  static const size_t n = 21;
+  const qserl::util::RegularGrid grid(Eigen::Vector3d::Constant(-1.), Eigen::Vector3d::Constant(1.), {n, n, n});
+  std::vector<bool> isStable(grid.numSamples());
+  for(size_t idx = 0; idx < grid.numSamples(); ++idx)
+  {
+    isStable[idx] = isInBall(grid.sample(idx));
+  }
+  qserl::util::StabilityIndexShPtr index = qserl::util::StabilityIndex::create(grid, isStable, isInBall);
+  BOOST_REQUIRE(index);
+  BOOST_CHECK(index->numBoundaryCells() > 0);
+  BOOST_CHECK(index->numBoundaryCells() < (n - 1) * (n - 1) * (n - 1));
+
+  // queries far from the boundary are answered without the oracle
+  BOOST_CHECK(index->isStable(Eigen::Vector3d(0.01, -0.02, 0.03)));
+  BOOST_CHECK(!index->isStable(Eigen::Vector3d(0.9, 0.9, -0.9)));
+  BOOST_CHECK(!index->isOnBoundary(Eigen::Vector3d(0.9, 0.9, -0.9)));
+  BOOST_CHECK_EQUAL(index->numOracleCalls(), 0u);
+
+  // queries in boundary cells and out of the grid are answered by the oracle
+  const Eigen::Vector3d boundaryA(0.59, 0., 0.);
+  const Eigen::Vector3d outOfGridA(1.5, 0., 0.);
+  BOOST_CHECK(index->isOnBoundary(boundaryA));
+  BOOST_CHECK(index->isStable(boundaryA));
+  BOOST_CHECK(!index->isStable(Eigen::Vector3d(0.58, 0.15, 0.05)));
+  BOOST_CHECK(!index->isStable(outOfGridA));
+  BOOST_CHECK_EQUAL(index->numOracleCalls(), 3u);
+
+  // all answers match the oracle, as long as the boundary is well sampled
+  size_t numMismatches = 0;
+  for(int k = 0; k < 1000; ++k)
+  {
+    const Eigen::Vector3d a = Eigen::Vector3d::Random();
+    numMismatches += index->isStable(a) != isInBall(a) ? 1 : 0;
+  }
+  BOOST_CHECK_EQUAL(numMismatches, 0u);
+
+  // cached answers of boundary cells
+  BOOST_CHECK(index->cacheResolution(4));
+  const size_t numOracleCalls = index->numOracleCalls();
+  BOOST_CHECK(index->isStable(boundaryA));
+  BOOST_CHECK(index->isStable(boundaryA));
+  BOOST_CHECK_EQUAL(index->numOracleCalls(), numOracleCalls + 1);
+  BOOST_CHECK_EQUAL(index->cacheSize(), 1u);
+
+  // resolutions whose sub cells cannot be keyed on 64 bits disable caching
+  BOOST_CHECK(!index->cacheResolution(1u << 20));
+  BOOST_CHECK_EQUAL(index->cacheResolution(), 0u);
+  BOOST_CHECK_EQUAL(index->cacheSize(), 0u);
+  BOOST_CHECK(index->isStable(boundaryA));
+  BOOST_CHECK_EQUAL(index->numOracleCalls(), numOracleCalls + 2);
+}
+
+BOOST_AUTO_TEST_CASE(StabilityIndexTest_dataset)
+{
+  static const char* filename = "qserl_test_stability_index_dataset.bin";
+  const auto isStableOracle = [](const Eigen::VectorXd&)
+  {
+    return true;
+  };
+
+  qserl::util::DatasetHeader header;
+  header.rodDimension = 2;
+  header.numSamples = 8;
+  header.columns = (1u << qserl::util::DC_A) | (1u << qserl::util::DC_STABILITY);
+  header.gridLowerBounds = Eigen::VectorXd::Constant(3, -1.);
+  header.gridUpperBounds = Eigen::VectorXd::Constant(3, 1.);
+  header.gridNumSamples = {2, 2, 2};
+  {
+    qserl::util::DatasetWriterShPtr writer = qserl::util::DatasetWriter::create(filename, header);
+    BOOST_REQUIRE(writer);
+    qserl::util::ArrayView<int32_t> stability = writer->stabilityColumn();
+    for(size_t k = 0; k < stability.size(); ++k)
+    {
+      stability[k] = k == 0 ? 0 : 1;
+    }
+    BOOST_CHECK(writer->sync());
+  }
+  qserl::util::DatasetConstShPtr dataset = qserl::util::Dataset::open(filename);
+  BOOST_REQUIRE(dataset);
+  qserl::util::StabilityIndexShPtr index = qserl::util::StabilityIndex::create(*dataset, isStableOracle);
+  BOOST_REQUIRE(index);
+  BOOST_CHECK_EQUAL(index->grid().numSamples(), 8u);
+  BOOST_CHECK_EQUAL(index->numBoundaryCells(), 1u);
+  index.reset();
+  dataset.reset();
+
+  // datasets which are not sampled on a grid, without stability, or whose number of samples does not match
+  // the grid are rejected
+  const auto createFromHeader = [&](const qserl::util::DatasetHeader& i_header) -> qserl::util::StabilityIndexShPtr
+  {
+    {
+      qserl::util::DatasetWriterShPtr writer = qserl::util::DatasetWriter::create(filename, i_header);
+      BOOST_REQUIRE(writer);
+      BOOST_CHECK(writer->sync());
+    }
+    qserl::util::DatasetConstShPtr invalidDataset = qserl::util::Dataset::open(filename);
+    BOOST_REQUIRE(invalidDataset);
+    return qserl::util::StabilityIndex::create(*invalidDataset, isStableOracle);
+  };
+  qserl::util::DatasetHeader invalidHeader = header;
+  invalidHeader.gridLowerBounds.resize(0);
+  invalidHeader.gridUpperBounds.resize(0);
+  invalidHeader.gridNumSamples.clear();
+  BOOST_CHECK(!createFromHeader(invalidHeader));
+  invalidHeader = header;
+  invalidHeader.columns = 1u << qserl::util::DC_A;
+  BOOST_CHECK(!createFromHeader(invalidHeader));
+  invalidHeader = header;
+  invalidHeader.numSamples = 9;
+  BOOST_CHECK(!createFromHeader(invalidHeader));
+  std::remove(filename);
+}
+
+BOOST_AUTO_TEST_CASE(StabilityIndexTest_rod2d_oracle)
+{
+  qserl::rod2d::Parameters rodParameters;
+  rodParameters.radius = 1.;
+  rodParameters.length = 1.;
+  rodParameters.integrationTime = 1.;
+  rodParameters.rodModel = qserl::rod2d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.delta_t = 1. / 100.;
+
+  const qserl::util::StabilityIndex::StabilityOracle oracle = qserl::rod2d::createStabilityOracle(rodParameters);
+
+  qserl::rod2d::WorkspaceIntegratedState::IntegrationOptions integrationOptions;
+  integrationOptions.stop_if_unstable = true;
+  static const qserl::rod2d::Displacement2D identityDisp = qserl::rod2d::Displacement2D{0., 0., 0.};
+  for(int k = 0; k < 50; ++k)
+  {
+    const Eigen::Vector3d a_TXY = Eigen::Vector3d::Random().cwiseProduct(Eigen::Vector3d(10., 100., 100.));
+    const qserl::rod2d::Wrench2D wrench_XYT{a_TXY[1], a_TXY[2], a_TXY[0]};
+    qserl::rod2d::WorkspaceIntegratedStateShPtr rodState =
+        qserl::rod2d::WorkspaceIntegratedState::create(wrench_XYT, identityDisp, rodParameters);
+    rodState->integrationOptions(integrationOptions);
+    BOOST_CHECK_EQUAL(oracle(a_TXY), rodState->integrate() == qserl::rod2d::WorkspaceIntegratedState::IR_VALID);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END();
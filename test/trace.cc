@@ -0,0 +1,120 @@
+/**
+* Copyright (c) 2012-2018 CNRS
+* Author: Olivier Roussel
+*
+* This file is part of the qserl package.
+* qserl is free software: you can redistribute it
+* and/or modify it under the terms of the GNU Lesser General Public
+* License as published by the Free Software Foundation, either version
+* 3 of the License, or (at your option) any later version.
+*
+* qserl is distributed in the hope that it will be
+* useful, but WITHOUT ANY WARRANTY; without even the implied warranty
+* of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Lesser Public License for more details.  You should have
+* received a copy of the GNU Lesser General Public License along with
+* qserl.  If not, see
+* <http://www.gnu.org/licenses/>.
+**/
+
+#include <boost/test/unit_test.hpp>
+
+#include <sstream>
+#include <thread>
+
+#include "qserl/rod3d/workspace_integrated_state.h"
+#include "qserl/util/trace.h"
+
+namespace {
+
+size_t
+countOccurrences(const std::string& i_str,
+                 const std::string& i_pattern)
+{
+  size_t count = 0;
+  for(size_t pos = i_str.find(i_pattern); pos != std::string::npos; pos = i_str.find(i_pattern, pos + 1))
+  {
+    ++count;
+  }
+  return count;
+}
+
+} // namespace
+
+/* ------------------------------------------------------------------------- */
+/* TraceTests																																 */
+/* ------------------------------------------------------------------------- */
+BOOST_AUTO_TEST_SUITE(TraceTests)
+
+BOOST_AUTO_TEST_CASE(TraceTest_threads)
+{
+  static const int kNumThreads = 4;
+  static const int kNumScopes = 1500;  // more than a buffer chunk
+  qserl::util::Tracer::clear();
+
+  // nothing is recorded until tracing is started
+  {
+    qserl::util::TraceScope scope("traceTest::stopped");
+  }
+  BOOST_CHECK_EQUAL(qserl::util::Tracer::numEvents(), 0u);
+
+  qserl::util::Tracer::start();
+  std::vector<std::thread> threads;
+  for(int k = 0; k < kNumThreads; ++k)
+  {
+    threads.emplace_back([k]()
+                         {
+                           qserl::util::Tracer::setThreadName("worker " + std::to_string(k));
+                           for(int i = 0; i < kNumScopes; ++i)
+                           {
+                             qserl::util::TraceScope scope("traceTest::item");
+                             scope.arg("index", i);
+                           }
+                         });
+  }
+  for(std::thread& thread : threads)
+  {
+    thread.join();
+  }
+  qserl::util::Tracer::stop();
+  BOOST_CHECK_EQUAL(qserl::util::Tracer::numEvents(), static_cast<size_t>(kNumThreads * kNumScopes));
+
+  std::ostringstream os;
+  qserl::util::Tracer::writeChromeTrace(os);
+  const std::string trace = os.str();
+  BOOST_CHECK_EQUAL(trace.compare(0, 17, "{\"displayTimeUnit"), 0);
+  BOOST_CHECK_EQUAL(countOccurrences(trace, "\"name\": \"traceTest::item\""),
+                    static_cast<size_t>(kNumThreads * kNumScopes));
+  BOOST_CHECK_EQUAL(countOccurrences(trace, "\"thread_name\""), static_cast<size_t>(kNumThreads));
+  BOOST_CHECK(trace.find("\"args\": {\"index\": 1499}") != std::string::npos);
+  BOOST_CHECK(trace.find("traceTest::stopped") == std::string::npos);
+
+  qserl::util::Tracer::clear();
+  BOOST_CHECK_EQUAL(qserl::util::Tracer::numEvents(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(TraceTest_libraryScopes)
+{
+  qserl::util::Tracer::clear();
+  qserl::rod3d::Parameters rodParameters;
+  rodParameters.rodModel = qserl::rod3d::Parameters::RM_INEXTENSIBLE;
+  rodParameters.numNodes = 100;
+  qserl::rod3d::Wrench stableConf;
+  stableConf << 5.7449, -0.1838, 3.7734, -71.6227, -15.6477, 83.1471;
+  qserl::rod3d::WorkspaceIntegratedStateShPtr rodState = qserl::rod3d::WorkspaceIntegratedState::create(
+      stableConf, rodParameters.numNodes, qserl::rod3d::Displacement::Identity(), rodParameters);
+
+  qserl::util::Tracer::start();
+  rodState->integrate();
+  rodState->integrate();
+  qserl::util::Tracer::stop();
+
+  // scopes are compiled out unless tracing is enabled
+  std::ostringstream os;
+  qserl::util::Tracer::writeChromeTrace(os);
+  const size_t numIntegrations = countOccurrences(os.str(), "\"name\": \"rod3d::integrate\"");
+  BOOST_CHECK_EQUAL(numIntegrations, qserl::util::Tracer::isEnabled() ? 2u : 0u);
+  qserl::util::Tracer::clear();
+}
+
+BOOST_AUTO_TEST_SUITE_END();